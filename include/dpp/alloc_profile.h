@@ -0,0 +1,246 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace dpp {
+
+/**
+ * @brief Parts of the library which memory is counted against by the allocation profiler.
+ * See dpp::alloc_scope.
+ */
+enum alloc_subsystem : uint8_t {
+	/**
+	 * @brief Anything not allocated inside an dpp::alloc_scope, including user code
+	 */
+	as_other = 0,
+
+	/**
+	 * @brief Gateway frames: decompression, and the JSON or ETF documents they are decoded into
+	 */
+	as_decode,
+
+	/**
+	 * @brief Event objects built from decoded events, and whatever event handlers allocate
+	 */
+	as_events,
+
+	/**
+	 * @brief Guild, channel, role, emoji and user caches
+	 */
+	as_cache,
+
+	/**
+	 * @brief REST requests and their responses, including completed responses kept until they are deleted
+	 */
+	as_rest,
+
+	/**
+	 * @brief Voice connections and their audio buffers
+	 */
+	as_voice,
+
+	/**
+	 * @brief Number of subsystems
+	 */
+	as_count
+};
+
+/**
+ * @brief Allocation counters for one subsystem
+ */
+struct DPP_EXPORT alloc_counters {
+	/**
+	 * @brief Bytes allocated and not yet freed
+	 */
+	int64_t live_bytes = 0;
+
+	/**
+	 * @brief Most bytes ever live at once
+	 */
+	int64_t peak_bytes = 0;
+
+	/**
+	 * @brief Number of allocations made
+	 */
+	uint64_t allocations = 0;
+
+	/**
+	 * @brief Bytes allocated in total, including those since freed
+	 */
+	uint64_t allocated_bytes = 0;
+};
+
+/**
+ * @brief Allocation counters for every subsystem at a point in time
+ */
+struct DPP_EXPORT alloc_profile {
+	/**
+	 * @brief True if the library was built with DPP_ALLOC_PROFILING, otherwise every counter is zero
+	 */
+	bool enabled = false;
+
+	/**
+	 * @brief When the counters were read, in fractional seconds from dpp::utility::time_f
+	 */
+	double time = 0;
+
+	/**
+	 * @brief Counters indexed by dpp::alloc_subsystem
+	 */
+	std::array<alloc_counters, as_count> subsystems{};
+
+	/**
+	 * @brief Allocations per second for a subsystem between an earlier profile and this one
+	 * @param earlier Profile read earlier
+	 * @param subsystem Subsystem
+	 * @return double allocations per second
+	 */
+	double allocation_rate(const alloc_profile& earlier, alloc_subsystem subsystem) const;
+
+	/**
+	 * @brief Bytes allocated per second for a subsystem between an earlier profile and this one
+	 * @param earlier Profile read earlier
+	 * @param subsystem Subsystem
+	 * @return double bytes per second
+	 */
+	double byte_rate(const alloc_profile& earlier, alloc_subsystem subsystem) const;
+};
+
+/**
+ * @brief Get the allocation counters for every subsystem
+ * @return alloc_profile counters
+ */
+alloc_profile DPP_EXPORT get_alloc_profile();
+
+/**
+ * @brief Get the name of a subsystem, e.g. "decode"
+ * @param subsystem Subsystem
+ * @return const char* name
+ */
+const char* DPP_EXPORT alloc_subsystem_name(alloc_subsystem subsystem);
+
+#ifdef DPP_ALLOC_PROFILING
+
+/**
+ * @brief Subsystem the calling thread's allocations are counted against
+ */
+DPP_EXPORT extern thread_local alloc_subsystem current_alloc_subsystem;
+
+/**
+ * @brief Counts the calling thread's allocations against a subsystem for as long as it exists.
+ *
+ * When the library is built with the DPP_ALLOC_PROFILING cmake option, global operator new and delete are
+ * replaced with versions which record the size and subsystem of each block in a small header, so memory is
+ * counted against the subsystem it was allocated in wherever it is later freed. Without the option this is
+ * an empty object and costs nothing.
+ */
+class DPP_EXPORT alloc_scope {
+	/**
+	 * @brief Subsystem to restore when the scope ends
+	 */
+	alloc_subsystem previous;
+
+public:
+	/**
+	 * @brief Count allocations against a subsystem until the scope ends
+	 * @param subsystem Subsystem
+	 */
+	explicit alloc_scope(alloc_subsystem subsystem) : previous(current_alloc_subsystem) {
+		current_alloc_subsystem = subsystem;
+	}
+
+	/**
+	 * @brief Go back to counting against the previous subsystem
+	 */
+	~alloc_scope() {
+		current_alloc_subsystem = previous;
+	}
+
+	/**
+	 * @brief dpp::alloc_scope is non-copyable
+	 */
+	alloc_scope(const alloc_scope&) = delete;
+
+	/**
+	 * @brief dpp::alloc_scope is non-copyable
+	 */
+	alloc_scope& operator=(const alloc_scope&) = delete;
+};
+
+#else
+
+/**
+ * @brief Counts the calling thread's allocations against a subsystem. The library was built without
+ * DPP_ALLOC_PROFILING, so this does nothing.
+ */
+class alloc_scope {
+public:
+	/**
+	 * @brief Does nothing
+	 */
+	explicit alloc_scope(alloc_subsystem) {
+	}
+};
+
+#endif
+
+/**
+ * @brief A std::allocator which counts what it allocates against a subsystem, for containers which are
+ * filled from several places, such as caches. It behaves exactly like std::allocator without DPP_ALLOC_PROFILING.
+ *
+ * @tparam T Type allocated
+ * @tparam Subsystem Subsystem to count against
+ */
+template <typename T, alloc_subsystem Subsystem> struct counting_allocator : public std::allocator<T> {
+	/**
+	 * @brief The same allocator for another type
+	 */
+	template <typename U> struct rebind {
+		using other = counting_allocator<U, Subsystem>;
+	};
+
+	counting_allocator() noexcept = default;
+
+	/**
+	 * @brief Convert from the allocator for another type
+	 */
+	template <typename U> counting_allocator(const counting_allocator<U, Subsystem>&) noexcept {
+	}
+
+	/**
+	 * @brief Allocate storage for n objects
+	 * @param n Number of objects
+	 * @return T* storage
+	 */
+	T* allocate(size_t n) {
+		alloc_scope scope(Subsystem);
+		return std::allocator<T>::allocate(n);
+	}
+};
+
+} // namespace dpp
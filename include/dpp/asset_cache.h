@@ -0,0 +1,358 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <dpp/queues.h>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dpp {
+
+class cluster;
+
+/**
+ * @brief An image or other file downloaded from Discord's CDN
+ */
+struct DPP_EXPORT cached_asset {
+	/**
+	 * @brief Content of the file
+	 */
+	std::string body;
+
+	/**
+	 * @brief Content-Type it was served with
+	 */
+	std::string content_type;
+
+	/**
+	 * @brief ETag it was served with, sent back as If-None-Match when revalidating
+	 */
+	std::string etag;
+
+	/**
+	 * @brief Last-Modified it was served with, sent back as If-Modified-Since when revalidating
+	 */
+	std::string last_modified;
+
+	/**
+	 * @brief When the CDN last confirmed the content, as a unix timestamp
+	 */
+	time_t validated = 0;
+};
+
+/**
+ * @brief Counts of how asset requests were answered
+ */
+struct DPP_EXPORT asset_cache_stats {
+	/**
+	 * @brief Answered from memory
+	 */
+	uint64_t memory_hits = 0;
+
+	/**
+	 * @brief Answered from disk
+	 */
+	uint64_t disk_hits = 0;
+
+	/**
+	 * @brief Downloaded in full
+	 */
+	uint64_t downloads = 0;
+
+	/**
+	 * @brief Revalidated with a 304 Not Modified instead of downloading again
+	 */
+	uint64_t revalidations = 0;
+
+	/**
+	 * @brief Joined a download already in progress for the same asset
+	 */
+	uint64_t coalesced = 0;
+
+	/**
+	 * @brief Removed from memory or disk to stay within the limits
+	 */
+	uint64_t evictions = 0;
+
+	/**
+	 * @brief Downloads which failed
+	 */
+	uint64_t failures = 0;
+};
+
+/**
+ * @brief Called when an asset is available. The asset is nullptr if it could not be downloaded, in which case
+ * http describes the failure. For cache hits http has status 200 and no latency.
+ */
+typedef std::function<void(const std::shared_ptr<const cached_asset>& asset, const http_request_completion_t& http)> asset_completion_t;
+
+/**
+ * @brief Downloads a URL for the asset cache, sending the given headers. By default this is dpp::cluster::request.
+ */
+typedef std::function<void(const std::string& url, const std::multimap<std::string, std::string>& headers, http_completion_event callback)> asset_fetcher_t;
+
+/**
+ * @brief A cache of files from Discord's CDN, such as avatars, emojis, stickers and attachments, for bots which
+ * render the same images over and over.
+ *
+ * Assets are keyed by their CDN path with the icon hash (see dpp::utility::iconhash) normalised, plus the
+ * requested size. The host and any signed query parameters are not part of the key, so the same avatar
+ * fetched from cdn.discordapp.com and media.discordapp.net, or the same attachment under two signatures,
+ * is one entry. They are kept in memory up to a limit in bytes and, if a directory is set, on disk up to a
+ * second limit, evicting the least recently used first. Assets older than the maximum age are revalidated
+ * with a conditional request, and several requests for an asset which is already downloading share the
+ * one download.
+ *
+ * @note Hits are answered on the calling thread, downloads on the thread which completes the HTTP request.
+ * The disk tier is read on the calling thread, so keep it on local storage.
+ */
+class DPP_EXPORT asset_cache {
+	/**
+	 * @brief An asset held in memory
+	 */
+	struct memory_entry {
+		/**
+		 * @brief The asset
+		 */
+		std::shared_ptr<const cached_asset> asset;
+
+		/**
+		 * @brief Position in the memory LRU list
+		 */
+		std::list<std::string>::iterator lru;
+	};
+
+	/**
+	 * @brief An asset stored on disk
+	 */
+	struct disk_entry {
+		/**
+		 * @brief Size of the file in bytes
+		 */
+		size_t size;
+
+		/**
+		 * @brief Position in the disk LRU list
+		 */
+		std::list<std::string>::iterator lru;
+	};
+
+	/**
+	 * @brief Protects everything below
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief Downloads assets
+	 */
+	asset_fetcher_t fetcher;
+
+	/**
+	 * @brief Assets in memory by key
+	 */
+	std::unordered_map<std::string, memory_entry> memory;
+
+	/**
+	 * @brief Keys in memory, most recently used first
+	 */
+	std::list<std::string> memory_lru;
+
+	/**
+	 * @brief Bytes of asset content held in memory
+	 */
+	size_t memory_used;
+
+	/**
+	 * @brief Maximum bytes of asset content held in memory
+	 */
+	size_t memory_limit;
+
+	/**
+	 * @brief Directory of the disk tier, empty if there is none
+	 */
+	std::string disk_path;
+
+	/**
+	 * @brief Files on disk by file name
+	 */
+	std::unordered_map<std::string, disk_entry> disk;
+
+	/**
+	 * @brief File names on disk, most recently used first
+	 */
+	std::list<std::string> disk_lru;
+
+	/**
+	 * @brief Bytes of files on disk
+	 */
+	size_t disk_used;
+
+	/**
+	 * @brief Maximum bytes of files on disk
+	 */
+	size_t disk_limit;
+
+	/**
+	 * @brief Seconds after which an asset is revalidated
+	 */
+	time_t max_age;
+
+	/**
+	 * @brief Callbacks waiting on a download, by key
+	 */
+	std::unordered_map<std::string, std::vector<asset_completion_t>> in_flight;
+
+	/**
+	 * @brief Counts of how requests were answered
+	 */
+	asset_cache_stats stats;
+
+	/**
+	 * @brief Store an asset in memory, evicting others to make room. Mutex must be held.
+	 */
+	void store_memory(const std::string& key, const std::shared_ptr<const cached_asset>& asset);
+
+	/**
+	 * @brief Write an asset to disk, evicting others to make room. Mutex must not be held,
+	 * it is only taken to update the index.
+	 */
+	void store_disk(const std::string& key, const cached_asset& asset);
+
+	/**
+	 * @brief Read an asset from disk. Mutex must not be held, it is only taken to look up the index.
+	 * @return nullptr if it is not on disk
+	 */
+	std::shared_ptr<const cached_asset> load_disk(const std::string& key);
+
+	/**
+	 * @brief Find an asset in memory or on disk. Mutex must not be held.
+	 * @return nullptr if it is not cached
+	 */
+	std::shared_ptr<const cached_asset> lookup(const std::string& key);
+
+	/**
+	 * @brief Handle the response to a download or revalidation
+	 */
+	void completed(const std::string& key, std::shared_ptr<const cached_asset> stale, const http_request_completion_t& http);
+
+	/**
+	 * @brief File name on disk for a key
+	 */
+	static std::string file_of(const std::string& key);
+
+public:
+	/**
+	 * @brief Construct an asset cache which downloads through a cluster's dpp::cluster::request.
+	 * It holds up to 32MB in memory and has no disk tier.
+	 *
+	 * @param owner Cluster to download with
+	 */
+	explicit asset_cache(cluster* owner);
+
+	/**
+	 * @brief Set the maximum bytes of asset content held in memory
+	 * @param bytes Maximum size
+	 * @return asset_cache& reference to self
+	 */
+	asset_cache& set_memory_limit(size_t bytes);
+
+	/**
+	 * @brief Keep assets on disk as well as in memory. Files already in the directory are reused.
+	 * @param directory Directory to keep them in, created if it does not exist. Empty to disable the disk tier.
+	 * @param bytes Maximum bytes of files kept there
+	 * @return asset_cache& reference to self
+	 * @throw dpp::file_exception if the directory could not be created
+	 */
+	asset_cache& set_disk_path(const std::string& directory, size_t bytes = 256 * 1024 * 1024);
+
+	/**
+	 * @brief Set how old an asset can be before it is revalidated with the CDN
+	 * @param seconds Maximum age. Assets named by an icon hash never change, so this mostly affects attachments.
+	 * @return asset_cache& reference to self
+	 */
+	asset_cache& set_max_age(time_t seconds);
+
+	/**
+	 * @brief Replace how assets are downloaded, e.g. to send them through a proxy
+	 * @param f Function to download with
+	 * @return asset_cache& reference to self
+	 */
+	asset_cache& set_fetcher(asset_fetcher_t f);
+
+	/**
+	 * @brief Get an asset from the cache, downloading it if needed
+	 *
+	 * @param url CDN URL, e.g. from dpp::user::get_avatar_url or dpp::utility::cdn_endpoint_url
+	 * @param callback Called with the asset
+	 * @note The cache must outlive any download it starts.
+	 */
+	void fetch(const std::string& url, asset_completion_t callback);
+
+	/**
+	 * @brief Get an asset only if it is cached, without downloading or revalidating it
+	 *
+	 * @param url CDN URL
+	 * @return std::shared_ptr<const cached_asset> The asset, or nullptr
+	 */
+	std::shared_ptr<const cached_asset> find(const std::string& url);
+
+	/**
+	 * @brief Remove an asset from memory and disk
+	 * @param url CDN URL
+	 */
+	void remove(const std::string& url);
+
+	/**
+	 * @brief Remove every asset from memory. Files on disk are kept.
+	 */
+	void clear_memory();
+
+	/**
+	 * @brief Get the counts of how requests were answered
+	 * @return asset_cache_stats counts
+	 */
+	asset_cache_stats get_stats();
+
+	/**
+	 * @brief Get the bytes of asset content held in memory
+	 * @return size_t bytes
+	 */
+	size_t get_memory_used();
+
+	/**
+	 * @brief Get the cache key of a URL
+	 *
+	 * @param url CDN URL
+	 * @return std::string The path with its icon hash normalised, plus any size, e.g.
+	 * `/avatars/189759562910400512/a_0123456789abcdef0123456789abcdef.gif?size=256`
+	 */
+	static std::string key_of(const std::string& url);
+};
+
+} // namespace dpp
@@ -0,0 +1,113 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <dpp/appcommand.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace dpp {
+
+/**
+ * @brief A prefix and fuzzy search index over a fixed set of autocomplete choices.
+ *
+ * The choices are indexed once when the index is built, so answering a query does not
+ * scan every choice. Names are matched case insensitively (ASCII only). Results are ranked:
+ * 1. Names which start with the query, shortest first.
+ * 2. Names containing a word which starts with the query.
+ * 3. Names sharing the most character trigrams with the query, which finds substrings and
+ * tolerates small typos.
+ *
+ * Prefix lookup uses a sorted array of lowercased names, which is a flattened trie: the
+ * choices sharing a prefix form one contiguous range found by binary search. Fuzzy lookup
+ * uses an inverted index from each trigram to the choices containing it.
+ *
+ * An index is immutable once built and can be queried from any number of threads at once.
+ * Usually it is registered with dpp::cluster::register_autocomplete, and the library then
+ * answers matching autocomplete interactions itself.
+ */
+class DPP_EXPORT autocomplete_index {
+	/**
+	 * @brief Choices, in the order they were given
+	 */
+	std::vector<command_option_choice> choices;
+
+	/**
+	 * @brief Lowercased names of the choices, indexed the same as choices
+	 */
+	std::vector<std::string> folded;
+
+	/**
+	 * @brief Choice indexes sorted by their lowercased name
+	 */
+	std::vector<uint32_t> sorted;
+
+	/**
+	 * @brief Choice indexes of names containing a word which is not the first word,
+	 * sorted by the lowercased text from the start of that word
+	 */
+	std::vector<std::pair<uint32_t, uint32_t>> word_starts;
+
+	/**
+	 * @brief Trigram to the sorted indexes of the choices containing it
+	 */
+	std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+
+public:
+	/**
+	 * @brief Construct an empty index
+	 */
+	autocomplete_index() = default;
+
+	/**
+	 * @brief Build an index over a set of choices
+	 *
+	 * @param choices Choices to index
+	 */
+	autocomplete_index(std::vector<command_option_choice> choices);
+
+	/**
+	 * @brief Build an index over a list of strings, each used as both the name and value of a choice
+	 *
+	 * @param names Names to index
+	 */
+	autocomplete_index(const std::vector<std::string>& names);
+
+	/**
+	 * @brief Find the best matching choices for what the user has typed so far
+	 *
+	 * @param query Text typed by the user
+	 * @param limit Maximum number of choices to return
+	 * @return std::vector<command_option_choice> Matching choices, best first. An empty query
+	 * returns the first choices in the order they were given.
+	 */
+	std::vector<command_option_choice> search(const std::string& query, size_t limit = AUTOCOMPLETE_MAX_CHOICES) const;
+
+	/**
+	 * @brief Get the number of choices in the index
+	 */
+	size_t size() const;
+};
+
+} // namespace dpp
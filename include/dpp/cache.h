@@ -24,6 +24,7 @@
 #include <dpp/export.h>
 #include <dpp/snowflake.h>
 #include <dpp/managed.h>
+#include <dpp/alloc_profile.h>
 #include <unordered_map>
 #include <mutex>
 #include <shared_mutex>
@@ -102,6 +103,7 @@ public:
 		if (!object) {
 			return;
 		}
+		alloc_scope scope(as_cache);
 		std::unique_lock l(cache_mutex);
 		auto existing = cache_map->find(object->id);
 		if (existing == cache_map->end()) {
@@ -114,6 +116,24 @@ public:
 		}
 	}
 
+	/**
+	 * @brief Publish a new version of a cached object, leaving the current version unchanged.
+	 *
+	 * The new version is a copy of `current` with `apply` called on it, and it replaces `current`
+	 * as if by cache::store(). Threads still holding `current` keep a consistent object until it
+	 * is garbage collected.
+	 *
+	 * @param current Version to copy, normally the one returned by cache::find()
+	 * @param apply Called with the new version before it is published
+	 * @return The new version, now owned by the cache
+	 */
+	template <typename F> T* update(const T* current, F&& apply) {
+		T* next = new T(*current);
+		apply(*next);
+		store(next);
+		return next;
+	}
+
 	/**
 	 * @brief Remove an object from the cache.
 	 * 
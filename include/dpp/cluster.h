@@ -31,6 +31,8 @@
 #include <dpp/timer.h>
 #include <dpp/json_fwd.h>
 #include <dpp/discordclient.h>
+#include <dpp/event_queue.h>
+#include <dpp/message_template.h>
 #include <dpp/discordvoiceclient.h>
 #include <dpp/voiceregion.h>
 #include <dpp/dtemplate.h>
@@ -44,8 +46,12 @@
 #include <algorithm>
 #include <iostream>
 #include <shared_mutex>
+#include <chrono>
+#include <memory>
 #include <cstring>
 #include <dpp/restresults.h>
+#include <dpp/autocomplete.h>
+#include <dpp/interaction_watchdog.h>
 #include <dpp/event_router.h>
 #include <dpp/coro/async.h>
 
@@ -87,6 +93,11 @@ class DPP_EXPORT cluster {
 	 */
 	std::string default_gateway;
 
+	/**
+	 * @brief Scheme, host and optional port which REST requests to Discord are sent to
+	 */
+	std::string rest_host;
+
 	/**
 	 * @brief queue system for commands sent to Discord, and any replies
 	 */
@@ -117,12 +128,63 @@ class DPP_EXPORT cluster {
 	 */
 	std::unordered_map<snowflake, snowflake> dm_channels;
 
+	/**
+	 * @brief Lock to prevent concurrent access to autocomplete_indexes
+	 */
+	std::shared_mutex autocomplete_lock;
+
+	/**
+	 * @brief Autocomplete indexes registered with register_autocomplete, by command name and option name
+	 */
+	std::map<std::pair<std::string, std::string>, std::shared_ptr<const autocomplete_index>> autocomplete_indexes;
+
+	/**
+	 * @brief Lock to prevent concurrent access to the automatic deferral settings and watchdog
+	 */
+	std::mutex auto_defer_lock;
+
+	/**
+	 * @brief Watchdog which defers slow interactions, created by set_auto_defer
+	 */
+	std::unique_ptr<interaction_watchdog> watchdog;
+
+	/**
+	 * @brief Time after an interaction arrives at which the watchdog defers it, zero when disabled
+	 */
+	std::chrono::milliseconds auto_defer_after{0};
+
+	/**
+	 * @brief True if deferred responses sent by the watchdog for commands are ephemeral
+	 */
+	bool auto_defer_ephemeral{false};
+
 	/**
 	 * @brief Active shards on this cluster. Shard IDs may have gaps between if there
 	 * are multiple clusters.
 	 */
 	shard_list shards;
 
+	/**
+	 * @brief Protects shards and numshards, which cluster::reshard replaces while the cluster runs
+	 */
+	std::shared_mutex shards_lock;
+
+	/**
+	 * @brief Shards closed by cluster::reshard. Pointers to them may still be held, so they are
+	 * only freed when the cluster shuts down.
+	 */
+	std::vector<std::unique_ptr<discord_client>> retired_shards;
+
+	/**
+	 * @brief Held by cluster::reshard for the whole procedure, so only one runs at a time
+	 */
+	std::mutex reshard_lock;
+
+	/**
+	 * @brief Decides which events are handled while two shard sets are connected
+	 */
+	shard_handover handover;
+
 	/**
 	 * @brief List of all active registered timers
 	 */
@@ -197,6 +259,32 @@ public:
 	 */
 	websocket_protocol_t ws_mode;
 
+	/**
+	 * @brief Settings for each shard's event queue, nullptr if events are dispatched on the socket thread
+	 */
+	std::shared_ptr<const event_queue_config> event_queue_settings;
+
+	/**
+	 * @brief File the REST rate limit state is checkpointed to, empty if none
+	 */
+	std::string ratelimit_checkpoint_file;
+
+	/**
+	 * @brief Timer which writes the rate limit checkpoint
+	 */
+	timer ratelimit_checkpoint_timer;
+
+	/**
+	 * @brief Serialises writes of the rate limit checkpoint, which come from its timer and from shutdown,
+	 * and protects ratelimit_checkpoint_file
+	 */
+	std::mutex ratelimit_checkpoint_mutex;
+
+	/**
+	 * @brief Write the REST rate limit state to ratelimit_checkpoint_file
+	 */
+	void write_ratelimit_checkpoint();
+
 	/**
 	 * @brief Condition variable notified when the cluster is terminating.
 	 */
@@ -273,6 +361,47 @@ public:
 	 */
 	cluster& set_websocket_protocol(websocket_protocol_t mode);
 
+	/**
+	 * @brief Queue each shard's events between its socket and dispatch, with a dispatch thread per shard.
+	 * Without this, events are handled on the socket thread as they are read, so slow handlers delay
+	 * heartbeats. With it, the socket thread only reads and queues, and under sustained overload low
+	 * priority events such as typing and presence are shed according to dpp::event_queue_config.
+	 * You should call this method before cluster::start.
+	 *
+	 * @param config Capacity and per-event policies
+	 * @return cluster& Reference to self for chaining.
+	 * @throw dpp::logic_exception If called after the cluster is started
+	 */
+	cluster& set_event_queue(const event_queue_config& config);
+
+	/**
+	 * @brief Get the event queue settings
+	 * @return const event_queue_config* settings, or nullptr if set_event_queue has not been called
+	 */
+	const event_queue_config* get_event_queue() const;
+
+	/**
+	 * @brief Get the counters of every shard's event queue added together, including events shed under overload
+	 * @return event_queue_stats counters
+	 */
+	event_queue_stats get_event_queue_stats();
+
+	/**
+	 * @brief Keep the REST rate limits learned from Discord in a file, so they survive a restart.
+	 *
+	 * Without this every start begins with no knowledge of Discord's rate limit buckets, so the
+	 * first requests to each route after a restart run into limits Discord is still applying from
+	 * before it, and are answered with 429s and retry delays just as the bot is busiest. With it,
+	 * the file is read immediately, ignoring buckets which have reset since it was written, and
+	 * then written every interval seconds and on shutdown.
+	 *
+	 * @note Call this before cluster::start. Do not share the file between clusters using different tokens.
+	 * @param filename File to keep the checkpoint in. It need not exist yet.
+	 * @param interval Seconds between checkpoints
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& set_ratelimit_checkpoint(const std::string& filename, uint64_t interval = 30);
+
 	/**
 	 * @brief Set the audit log reason for the next REST call to be made.
 	 * This is set per-thread, so you must ensure that if you call this method, your request that
@@ -327,6 +456,22 @@ public:
 	 */
 	cluster& set_default_gateway(std::string& default_gateway);
 
+	/**
+	 * @brief Set where REST requests to Discord are sent, e.g. to point the bot at a local emulator
+	 * such as the one in src/restemulator. Call this before cluster::start.
+	 *
+	 * @param host Scheme, host and optional port, e.g. "http://127.0.0.1:8008". The default is dpp::DISCORD_HOST.
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& set_rest_host(const std::string& host);
+
+	/**
+	 * @brief Get where REST requests to Discord are sent
+	 *
+	 * @return const std::string& Scheme, host and optional port
+	 */
+	const std::string& get_rest_host() const;
+
 	/**
 	 * @brief Log a message to whatever log the user is using.
 	 * The logged message is passed up the chain to the on_log event in user code which can then do whatever
@@ -398,6 +543,45 @@ public:
 	 */
 	void start(bool return_after = true);
 
+	/**
+	 * @brief Move the cluster to a new number of shards without dropping its sessions.
+	 *
+	 * A new set of shards is started alongside the running one, using the session starts
+	 * left in Discord's budget. While it connects its events are dropped, the running shards
+	 * still handle everything and the caches they fill are shared, so there is nothing for
+	 * the new shards to rebuild. The GUILD_CREATE the new shards receive for each guild in
+	 * their READY is for a guild already cached, so it is dropped rather than dispatched.
+	 *
+	 * Once every new shard is ready both sets deliver events for `overlap`. Each event handled
+	 * from one set is paired with its copy from the other set, which is dropped, see
+	 * dpp::shard_handover. Then the old shards are closed, dpp::guild::shard_id is recomputed
+	 * as `(guild_id >> 22) % shards` and the new shards deliver events on their own. Closed
+	 * shards are kept in memory until the cluster shuts down, so a pointer from get_shard
+	 * stays valid, but it no longer sends or receives anything.
+	 *
+	 * This blocks until the procedure completes, so call it from a thread of your own and
+	 * never from an event handler.
+	 *
+	 * @param shards New total number of shards across all clusters, or zero to use the number Discord recommends
+	 * @param overlap How long both shard sets deliver events before the old set is closed
+	 * @throw dpp::connection_exception if there are not enough session starts left, or the new shards did not connect in time.
+	 * The old shards keep running in either case.
+	 * @note Voice connections belong to a shard, and those on the old shards are closed. Bots running several
+	 * clusters must reshard each of them to the same total.
+	 */
+	void reshard(uint32_t shards = 0, std::chrono::seconds overlap = std::chrono::seconds(5));
+
+	/**
+	 * @brief Decide whether a shard should handle an event, see cluster::reshard.
+	 * Called by dpp::discord_client::handle_event for every event.
+	 *
+	 * @param shard Shard the event arrived on
+	 * @param event Event name, e.g. MESSAGE_CREATE
+	 * @param j Event payload
+	 * @return true if the event should be handled
+	 */
+	bool accept_event(discord_client* shard, const std::string& event, const json& j);
+
 	/**
 	 * @brief Set the presence for all shards on the cluster
 	 *
@@ -416,9 +600,108 @@ public:
 	/**
 	 * @brief Get the list of shards
 	 *
-	 * @return shard_list& Reference to map of shards for this cluster
+	 * @return shard_list A copy of the map of shards for this cluster, as cluster::reshard may replace it
+	 */
+	shard_list get_shards();
+
+	/**
+	 * @brief Get a guild member, fetching it over the gateway only if it is not already cached.
+	 *
+	 * This is intended for use with the dpp::cp_lazy user cache policy, where members are not
+	 * downloaded when a guild is created. Cache misses are collected for up to a second and
+	 * sent in batches of up to 100 user ids per guild, so memory use and startup bandwidth
+	 * grow with the number of active users rather than total guild members. Fetched members
+	 * are added to the guild's member list.
+	 *
+	 * If the guild's shard is not part of this cluster, the member is fetched with
+	 * cluster::guild_get_member instead.
+	 *
+	 * @param guild_id Guild to get the member from
+	 * @param user_id User to get
+	 * @param callback Function to call when the member is available.
+	 * On success the callback will contain a dpp::guild_member object in confirmation_callback_t::value. On failure, the value is undefined and confirmation_callback_t::is_error() method will return true. You can obtain full error details with confirmation_callback_t::get_error().
+	 */
+	void request_guild_member(snowflake guild_id, snowflake user_id, command_completion_event_t callback);
+
+#ifdef DPP_CORO
+	/**
+	 * @brief Get a guild member, fetching it over the gateway only if it is not already cached.
+	 *
+	 * @see dpp::cluster::request_guild_member
+	 * @param guild_id Guild to get the member from
+	 * @param user_id User to get
+	 * @return async<confirmation_callback_t> Object that can be co_await-ed, containing a dpp::guild_member on success
 	 */
-	const shard_list& get_shards();
+	[[nodiscard]] async<confirmation_callback_t> co_request_guild_member(snowflake guild_id, snowflake user_id);
+#endif
+
+	/**
+	 * @brief Register a set of choices for an autocomplete option, which the library will then answer itself.
+	 *
+	 * The choices are indexed once here. When an autocomplete interaction arrives for this option,
+	 * the best matches for what the user has typed are sent straight back as the response, ahead of
+	 * other queued REST requests, and on_autocomplete is not called for it. Autocomplete interactions
+	 * for options which are not registered are passed to on_autocomplete as normal.
+	 *
+	 * Registering the same command and option again replaces its choices, which is safe to do while
+	 * the bot is running.
+	 *
+	 * @see dpp::autocomplete_index
+	 * @param command Name of the slash command
+	 * @param option Name of the option with autocomplete enabled. For subcommands this is the
+	 * option name within the subcommand.
+	 * @param index Choices to suggest
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& register_autocomplete(const std::string& command, const std::string& option, autocomplete_index index);
+
+	/**
+	 * @brief Stop answering an autocomplete option, so that it is passed to on_autocomplete again
+	 *
+	 * @param command Name of the slash command
+	 * @param option Name of the option
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& unregister_autocomplete(const std::string& command, const std::string& option);
+
+	/**
+	 * @brief Find the index registered for an autocomplete option
+	 *
+	 * @param command Name of the slash command
+	 * @param option Name of the option
+	 * @return std::shared_ptr<const autocomplete_index> The index, or nullptr if none is registered
+	 */
+	std::shared_ptr<const autocomplete_index> find_autocomplete(const std::string& command, const std::string& option);
+
+	/**
+	 * @brief Automatically defer interactions whose handlers have not responded in time.
+	 *
+	 * Discord fails an interaction which has no response within three seconds, so slow handlers
+	 * have to call thinking() first, which costs a request even when the handler would have
+	 * replied in time. With this enabled, if nothing has responded through the interaction's event
+	 * by the deadline, the library sends the deferred response itself: a thinking state for commands
+	 * and modal submits, and a deferred update for components. A reply made through the event after
+	 * that edits the original response instead, so handlers can call reply() however long they take.
+	 *
+	 * @note Whether the response is ephemeral is fixed by the deferral, a later reply cannot change it.
+	 * A dialog cannot be opened once the interaction has been deferred. Responses sent directly with
+	 * cluster::interaction_response_create are not seen by the watchdog.
+	 * @param deadline Time after the interaction arrives at which to defer it, or zero to disable, which
+	 * is the default. Around 2500ms leaves time for the deferral to reach Discord.
+	 * @param ephemeral True if the deferred responses for commands and modal submits are ephemeral
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& set_auto_defer(std::chrono::milliseconds deadline, bool ephemeral = false);
+
+	/**
+	 * @brief Start the deferral watchdog for a newly received interaction.
+	 * Called by the library before dispatching the interaction's events.
+	 *
+	 * @param i The interaction
+	 * @return std::shared_ptr<interaction_response_state> State to share between the interaction's events,
+	 * or nullptr if set_auto_defer is not enabled or the interaction cannot be deferred
+	 */
+	std::shared_ptr<interaction_response_state> watch_interaction(const interaction& i);
 
 	/* Functions for attaching to event handlers */
 
@@ -1722,6 +2005,28 @@ public:
 	 */
 	void message_get(snowflake message_id, snowflake channel_id, command_completion_event_t callback);
 
+	/**
+	 * @brief Get a message, returning a typed result.
+	 *
+	 * @see dpp::cluster::message_get
+	 * @param message_id Message ID
+	 * @param channel_id Channel ID
+	 * @param callback Function to call when the API call completes, with a dpp::rest_result<message>
+	 */
+	void message_get_typed(snowflake message_id, snowflake channel_id, typed_completion_event_t<message> callback);
+
+#ifdef DPP_CORO
+	/**
+	 * @brief Get a message, returning a typed result.
+	 *
+	 * @see dpp::cluster::message_get
+	 * @param message_id Message ID
+	 * @param channel_id Channel ID
+	 * @return async<rest_result<message>> Object that can be co_await-ed, containing a dpp::message or an error
+	 */
+	[[nodiscard]] async<rest_result<message>> co_message_get_typed(snowflake message_id, snowflake channel_id);
+#endif
+
 	/**
 	 * @brief Get multiple messages.
 	 * 
@@ -1748,6 +2053,40 @@ public:
 	 */
 	void message_create(const struct message &m, command_completion_event_t callback = utility::log_error());
 
+	/**
+	 * @brief Send a message built from a template to a channel. The slots are filled into the serialised
+	 * template, so nothing is built or serialised per send.
+	 *
+	 * @see https://discord.com/developers/docs/resources/channel#create-message
+	 * @param t Template to send
+	 * @param channel_id Channel to send it to
+	 * @param values Values for the template's slots, from dpp::message_template::args
+	 * @param callback Function to call when the API call completes.
+	 * On success the callback will contain a dpp::message object in confirmation_callback_t::value. On failure, the value is undefined and confirmation_callback_t::is_error() method will return true. You can obtain full error details with confirmation_callback_t::get_error().
+	 * @throw dpp::logic_exception if the values were made for a different template
+	 */
+	void message_template_send(const class message_template& t, snowflake channel_id, const class template_args& values, command_completion_event_t callback = utility::log_error());
+
+	/**
+	 * @brief Send a message to a channel, returning a typed result.
+	 *
+	 * @see dpp::cluster::message_create
+	 * @param m Message to send
+	 * @param callback Function to call when the API call completes, with a dpp::rest_result<message>
+	 */
+	void message_create_typed(const struct message &m, typed_completion_event_t<message> callback);
+
+#ifdef DPP_CORO
+	/**
+	 * @brief Send a message to a channel, returning a typed result.
+	 *
+	 * @see dpp::cluster::message_create
+	 * @param m Message to send
+	 * @return async<rest_result<message>> Object that can be co_await-ed, containing a dpp::message or an error
+	 */
+	[[nodiscard]] async<rest_result<message>> co_message_create_typed(const struct message &m);
+#endif
+
 	/**
 	 * @brief Crosspost a message. The callback function is called when the message has been sent
 	 *
@@ -1769,6 +2108,26 @@ public:
 	 */
 	void message_edit(const struct message &m, command_completion_event_t callback = utility::log_error());
 
+	/**
+	 * @brief Edit a message on a channel, returning a typed result.
+	 *
+	 * @see dpp::cluster::message_edit
+	 * @param m Message to edit
+	 * @param callback Function to call when the API call completes, with a dpp::rest_result<message>
+	 */
+	void message_edit_typed(const struct message &m, typed_completion_event_t<message> callback);
+
+#ifdef DPP_CORO
+	/**
+	 * @brief Edit a message on a channel, returning a typed result.
+	 *
+	 * @see dpp::cluster::message_edit
+	 * @param m Message to edit
+	 * @return async<rest_result<message>> Object that can be co_await-ed, containing a dpp::message or an error
+	 */
+	[[nodiscard]] async<rest_result<message>> co_message_edit_typed(const struct message &m);
+#endif
+
 	/**
 	 * @brief Edit the flags of a message on a channel. The callback function is called when the message has been edited
 	 *
@@ -1958,6 +2317,26 @@ public:
 	 */
 	void channel_get(snowflake c, command_completion_event_t callback);
 
+	/**
+	 * @brief Get a channel, returning a typed result.
+	 *
+	 * @see dpp::cluster::channel_get
+	 * @param c Channel ID to retrieve
+	 * @param callback Function to call when the API call completes, with a dpp::rest_result<channel>
+	 */
+	void channel_get_typed(snowflake c, typed_completion_event_t<channel> callback);
+
+#ifdef DPP_CORO
+	/**
+	 * @brief Get a channel, returning a typed result.
+	 *
+	 * @see dpp::cluster::channel_get
+	 * @param c Channel ID to retrieve
+	 * @return async<rest_result<channel>> Object that can be co_await-ed, containing a dpp::channel or an error
+	 */
+	[[nodiscard]] async<rest_result<channel>> co_channel_get_typed(snowflake c);
+#endif
+
 	/**
 	 * @brief Get all channels for a guild
 	 *
@@ -3118,6 +3497,26 @@ public:
 	 */
 	void user_get(snowflake user_id, command_completion_event_t callback);
 
+	/**
+	 * @brief Get a user by id, without using the cache, returning a typed result.
+	 *
+	 * @see dpp::cluster::user_get
+	 * @param user_id User ID to retrieve
+	 * @param callback Function to call when the API call completes, with a dpp::rest_result<user_identified>
+	 */
+	void user_get_typed(snowflake user_id, typed_completion_event_t<user_identified> callback);
+
+#ifdef DPP_CORO
+	/**
+	 * @brief Get a user by id, without using the cache, returning a typed result.
+	 *
+	 * @see dpp::cluster::user_get
+	 * @param user_id User ID to retrieve
+	 * @return async<rest_result<user_identified>> Object that can be co_await-ed, containing a dpp::user_identified or an error
+	 */
+	[[nodiscard]] async<rest_result<user_identified>> co_user_get_typed(snowflake user_id);
+#endif
+
 	/**
 	 * @brief Get a user by id, checking in the cache first
 	 *
@@ -31,6 +31,8 @@
 #include <dpp/utility.h>
 #include <dpp/json_fwd.h>
 #include <dpp/event_router.h>
+#include <dpp/rate_controller.h>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <functional>
@@ -223,6 +225,12 @@ struct DPP_EXPORT command_source {
  */
 typedef std::function<void(const std::string&, const parameter_list_t&, command_source)> command_handler;
 
+/**
+ * @brief The function definition for a handler called when a command is refused by a rate limit.
+ * Receives the command, the decision of the rule which refused it, and the source to reply to.
+ */
+typedef std::function<void(const std::string&, const rate_decision&, command_source)> command_rate_limited_handler;
+
 /**
  * @brief Represents the details of a command added to the command handler class.
  * @deprecated commandhandler and message commands are deprecated and dpp::slashcommand is encouraged as a replacement.
@@ -243,6 +251,11 @@ struct DPP_EXPORT command_info_t {
 	 * @brief Guild ID the command exists on, or 0 to be present on all guilds
 	 */
 	snowflake guild_id;
+
+	/**
+	 * @brief Rate rules checked before the command is run, in commandhandler::rate_limits
+	 */
+	std::vector<rate_rule_id> rate_rules;
 };
 
 
@@ -300,6 +313,27 @@ public:
 	 */
 	event_handle messages;
 
+	/**
+	 * @brief Cooldowns and flood control for commands, created by the first add_rate_limit
+	 */
+	std::unique_ptr<rate_controller> rate_limits;
+
+	/**
+	 * @brief Called when a command is refused by a rate limit
+	 */
+	command_rate_limited_handler rate_limited;
+
+	/**
+	 * @brief Check a command's rate rules, counting the use if every rule allows it.
+	 * Calls the rate_limited handler if one does not.
+	 *
+	 * @param command Command name
+	 * @param info Command details
+	 * @param source Source of the command, which the rules' scopes choose keys from
+	 * @return true if the command may run
+	 */
+	bool check_rate_limits(const std::string& command, const command_info_t& info, const command_source& source);
+
 	/**
 	 * @brief Returns true if the string has a known prefix on the start.
 	 * Modifies string to remove prefix if it returns true.
@@ -361,6 +395,33 @@ public:
 	 */
 	commandhandler& add_command(const std::string &command, const parameter_registration_t &parameters, command_handler handler, const std::string &description = "", snowflake guild_id = 0);
 
+	/**
+	 * @brief Add a cooldown or flood limit to a command.
+	 *
+	 * Uses are counted per user, guild or channel, according to the rule's scope. When a rule refuses
+	 * a use the command is not run, and the handler set by set_rate_limited_handler is called instead.
+	 * A command can have several rules, e.g. a per user cooldown and a per guild limit; a use is only
+	 * counted once every rule allows it. For example:
+	 * @code{cpp}
+	 * handler.add_rate_limit("daily", dpp::rate_rule::cooldown(dpp::rs_user, 86400));
+	 * @endcode
+	 *
+	 * @param command Command, which must already have been added
+	 * @param rule Rule
+	 * @return commandhandler& reference to self
+	 * @throw dpp::logic_exception if there is no such command, or the rule is invalid
+	 */
+	commandhandler& add_rate_limit(const std::string &command, const rate_rule &rule);
+
+	/**
+	 * @brief Set the function called when a command is refused by a rate limit,
+	 * e.g. to reply saying when the user can try again
+	 *
+	 * @param handler Handler
+	 * @return commandhandler& reference to self
+	 */
+	commandhandler& set_rate_limited_handler(command_rate_limited_handler handler);
+
 	/**
 	 * @brief Register all slash commands with Discord
 	 * This method must be called at least once  if you are using the "/" prefix to mark the
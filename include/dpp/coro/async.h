@@ -83,7 +83,7 @@ enum class state_t {
  * Defined outside of dpp::async because this seems to work better with Intellisense.
  */
 template <typename R>
-struct async_callback_data {
+struct async_callback_data : detail::pooled_allocation {
 	/**
 	 * @brief Number of references to this callback state.
 	 */
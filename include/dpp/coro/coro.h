@@ -42,6 +42,12 @@ namespace std {
 #  include <coroutine>
 #endif
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
 namespace dpp {
 
 /**
@@ -152,8 +158,368 @@ decltype(auto) co_await_resolve(auto&& expr) {}
 template <typename T>
 using awaitable_result = decltype(co_await_resolve(std::declval<T>()).await_resume());
 
+/**
+ * @brief Thread-local pool of fixed size blocks for coroutine frames and async shared state.
+ *
+ * Blocks are grouped into power of two size classes from 64 to 4096 bytes, including a small
+ * header which records the thread pool the block belongs to. A block always goes back to the
+ * pool of the thread which allocated it: freed on that thread it goes straight onto a free list,
+ * freed on another thread (a co_* call is usually started on a shard thread and finished on a
+ * REST thread) it is pushed onto a lock-free list which the owning thread takes back the next
+ * time it runs out of blocks. Once a program is warmed up, coroutine REST calls reuse blocks
+ * instead of going to the heap.
+ */
+namespace coro_pool {
+
+/**
+ * @brief Smallest block size, including the header
+ */
+inline constexpr size_t min_block_size = 64;
+
+/**
+ * @brief Number of size classes, so the largest pooled block is min_block_size << (size_classes - 1)
+ */
+inline constexpr size_t size_classes = 7;
+
+/**
+ * @brief Maximum number of free blocks kept per size class, per thread
+ */
+inline constexpr size_t max_free_blocks = 128;
+
+/**
+ * @brief Allocation counters, shared by all threads
+ */
+struct counters {
+	/**
+	 * @brief Allocations served from a free list
+	 */
+	std::atomic<uint64_t> pool_hits{0};
+
+	/**
+	 * @brief Allocations which had to go to the heap, because the free list was empty or the size was too large
+	 */
+	std::atomic<uint64_t> heap_allocations{0};
+
+	/**
+	 * @brief Blocks currently allocated
+	 */
+	std::atomic<int64_t> live{0};
+};
+
+/**
+ * @brief Global counters
+ */
+inline counters stats;
+
+struct pool_owner;
+
+/**
+ * @brief Header in front of every pooled block
+ */
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) block_header {
+	/**
+	 * @brief Pool the block belongs to, or nullptr if it was allocated after the thread's pool was destroyed
+	 */
+	pool_owner* owner;
+
+	/**
+	 * @brief Size class of the block
+	 */
+	size_t index;
+};
+
+/**
+ * @brief An unused block on a free list
+ */
+struct free_block : block_header {
+	free_block* next;
+};
+
+/**
+ * @brief Return a block's memory to the heap
+ */
+inline void heap_free(block_header* block) noexcept {
+	::operator delete(static_cast<void*>(block));
+}
+
+/**
+ * @brief The part of a thread's pool which other threads can reach. It is reference counted,
+ * holding one reference for its thread and one for each block which has not gone back to the
+ * heap, so a block freed after its thread has exited still has somewhere to go.
+ */
+struct pool_owner {
+	/**
+	 * @brief Blocks freed by other threads, waiting for the owning thread to take them back
+	 */
+	std::atomic<free_block*> remote_frees{nullptr};
+
+	/**
+	 * @brief The owning thread plus the blocks belonging to this pool
+	 */
+	std::atomic<size_t> refs{1};
+
+	/**
+	 * @brief False once the owning thread has exited
+	 */
+	std::atomic<bool> alive{true};
+
+	/**
+	 * @brief Drop references, deleting the owner when the last one goes
+	 */
+	void release(size_t count) noexcept {
+		if (count && refs.fetch_sub(count, std::memory_order_acq_rel) == count) {
+			delete this;
+		}
+	}
+
+	/**
+	 * @brief Take all blocks freed by other threads
+	 */
+	free_block* take_remote() noexcept {
+		return remote_frees.exchange(nullptr, std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief Return all blocks freed by other threads to the heap. Used once the owning thread has exited.
+	 * This may delete the owner.
+	 */
+	void free_remote() noexcept {
+		size_t freed = 0;
+		for (free_block* block = take_remote(); block; ++freed) {
+			free_block* next = block->next;
+			heap_free(block);
+			block = next;
+		}
+		release(freed);
+	}
+
+	/**
+	 * @brief Give a block back from another thread
+	 */
+	void push_remote(block_header* header) noexcept {
+		/* Once pushed the block can be taken and freed at any moment, so keep the owner alive until we are done */
+		refs.fetch_add(1, std::memory_order_relaxed);
+		free_block* block = ::new (static_cast<void*>(header)) free_block{{this, header->index}, remote_frees.load(std::memory_order_relaxed)};
+		while (!remote_frees.compare_exchange_weak(block->next, block)) {
+		}
+		/* The owning thread may have exited after the push was started, in which case nobody else will collect it */
+		if (!alive.load()) {
+			free_remote();
+		}
+		release(1);
+	}
+};
+
+/**
+ * @brief Set once the calling thread's pool is destroyed. Blocks freed after this go straight back to the heap.
+ */
+inline thread_local bool pool_destroyed = false;
+
+/**
+ * @brief Free lists of one thread
+ */
+struct thread_pool {
+	/**
+	 * @brief Shared part of this pool, referenced by every block it hands out
+	 */
+	pool_owner* owner = new pool_owner;
+
+	/**
+	 * @brief Head of the free list for each size class
+	 */
+	std::array<free_block*, size_classes> free_lists{};
+
+	/**
+	 * @brief Length of each free list
+	 */
+	std::array<size_t, size_classes> free_counts{};
+
+	/**
+	 * @brief Put a block of this pool on its free list, or return it to the heap if the list is full
+	 */
+	void push_local(block_header* header) noexcept {
+		if (free_counts[header->index] < max_free_blocks) {
+			free_block* block = ::new (static_cast<void*>(header)) free_block{{owner, header->index}, free_lists[header->index]};
+			free_lists[header->index] = block;
+			++free_counts[header->index];
+		} else {
+			heap_free(header);
+			owner->release(1);
+		}
+	}
+
+	/**
+	 * @brief Move blocks freed by other threads onto this thread's free lists
+	 */
+	void collect_remote() noexcept {
+		if (!owner->remote_frees.load(std::memory_order_relaxed)) {
+			return;
+		}
+		for (free_block* block = owner->take_remote(); block;) {
+			free_block* next = block->next;
+			push_local(block);
+			block = next;
+		}
+	}
+
+	~thread_pool() {
+		pool_destroyed = true;
+		size_t freed = 0;
+		for (free_block* head : free_lists) {
+			while (head) {
+				free_block* next = head->next;
+				heap_free(head);
+				head = next;
+				++freed;
+			}
+		}
+		owner->release(freed);
+		owner->alive.store(false);
+		owner->free_remote();
+		/* The thread's own reference goes last. Blocks still in use keep the owner alive after this. */
+		owner->release(1);
+	}
+};
+
+/**
+ * @brief Pool of the calling thread
+ */
+inline thread_local thread_pool pool;
+
+/**
+ * @brief Get the size class for an allocation size
+ *
+ * @param size Allocation size in bytes, including the header
+ * @return size_t Size class, or size_classes if the size is too large to pool
+ */
+constexpr size_t size_class(size_t size) noexcept {
+	size_t index = 0;
+	size_t block = min_block_size;
+	while (block < size && index < size_classes) {
+		block <<= 1;
+		++index;
+	}
+	return index;
+}
+
+/**
+ * @brief Allocate a block of at least size bytes
+ *
+ * @param size Size in bytes
+ * @return void* Allocated memory, aligned to __STDCPP_DEFAULT_NEW_ALIGNMENT__
+ * @throw std::bad_alloc on failure
+ */
+inline void* allocate(size_t size) {
+	size_t index = size_class(size + sizeof(block_header));
+	stats.live.fetch_add(1, std::memory_order_relaxed);
+	if (index >= size_classes) {
+		stats.heap_allocations.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(size);
+	}
+	pool_owner* owner = nullptr;
+	if (!pool_destroyed) {
+		if (!pool.free_lists[index]) {
+			pool.collect_remote();
+		}
+		if (free_block* block = pool.free_lists[index]; block) {
+			pool.free_lists[index] = block->next;
+			--pool.free_counts[index];
+			stats.pool_hits.fetch_add(1, std::memory_order_relaxed);
+			return static_cast<block_header*>(block) + 1;
+		}
+		owner = pool.owner;
+	}
+	stats.heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	block_header* header = ::new (::operator new(min_block_size << index)) block_header{owner, index};
+	if (owner) {
+		owner->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+	return header + 1;
+}
+
+/**
+ * @brief Return a block allocated with allocate to the pool it came from
+ *
+ * @param ptr Block to free
+ * @param size Size passed to allocate
+ */
+inline void deallocate(void* ptr, size_t size) noexcept {
+	if (!ptr) {
+		return;
+	}
+	stats.live.fetch_sub(1, std::memory_order_relaxed);
+	if (size_class(size + sizeof(block_header)) >= size_classes) {
+		::operator delete(ptr);
+		return;
+	}
+	block_header* header = static_cast<block_header*>(ptr) - 1;
+	pool_owner* owner = header->owner;
+	if (!owner) {
+		heap_free(header);
+	} else if (!pool_destroyed && owner == pool.owner) {
+		pool.push_local(header);
+	} else {
+		owner->push_remote(header);
+	}
+}
+
+} // namespace coro_pool
+
+/**
+ * @brief Mixin giving a promise or shared state type pooled operator new and operator delete.
+ */
+struct pooled_allocation {
+	/**
+	 * @brief Allocate from the calling thread's pool
+	 */
+	static void* operator new(size_t size) {
+		return coro_pool::allocate(size);
+	}
+
+	/**
+	 * @brief Return memory to the pool it was allocated from
+	 */
+	static void operator delete(void* ptr, size_t size) noexcept {
+		coro_pool::deallocate(ptr, size);
+	}
+};
+
 } // namespace detail
 
+/**
+ * @brief Allocation counters for coroutine frames and async shared state
+ */
+struct coro_allocation_stats {
+	/**
+	 * @brief Allocations which reused a pooled block
+	 */
+	uint64_t pool_hits;
+
+	/**
+	 * @brief Allocations which went to the heap
+	 */
+	uint64_t heap_allocations;
+
+	/**
+	 * @brief Number of frames and states currently alive
+	 */
+	int64_t live;
+};
+
+/**
+ * @brief Get allocation counters for coroutine frames (dpp::task, dpp::coroutine, dpp::job) and dpp::async
+ * shared state, across all threads. Once a program is warmed up, heap_allocations should stop growing.
+ *
+ * @return coro_allocation_stats Current counters
+ */
+inline coro_allocation_stats get_coro_allocation_stats() noexcept {
+	return {
+		detail::coro_pool::stats.pool_hits.load(std::memory_order_relaxed),
+		detail::coro_pool::stats.heap_allocations.load(std::memory_order_relaxed),
+		detail::coro_pool::stats.live.load(std::memory_order_relaxed)
+	};
+}
+
 struct confirmation_callback_t;
 
 template <typename R = confirmation_callback_t>
@@ -378,7 +378,7 @@ namespace detail::coroutine {
 	 * @brief Promise type for coroutine.
 	 */
 	template <typename R>
-	struct promise_t {
+	struct promise_t : detail::pooled_allocation {
 		/**
 		 * @brief Handle of the coroutine co_await-ing this coroutine.
 		 */
@@ -512,7 +512,7 @@ namespace detail::coroutine {
 	 * @brief Struct returned by a coroutine's final_suspend, resumes the continuation
 	 */
 	template <>
-	struct promise_t<void> {
+	struct promise_t<void> : detail::pooled_allocation {
 		/**
 		 * @brief Handle of the coroutine co_await-ing this coroutine.
 		 */
@@ -67,7 +67,7 @@ namespace job {
  * @brief Coroutine promise type for a job
  */
 template <typename... Args>
-struct promise {
+struct promise : detail::pooled_allocation {
 
 #ifdef DPP_CORO_TEST
 	promise() {
@@ -527,7 +527,7 @@ struct final_awaiter {
 /**
  * @brief Base implementation of task::promise_t, without the logic that would depend on the return type. Meant to be inherited from
  */
-struct promise_base {
+struct promise_base : detail::pooled_allocation {
 	/**
 	 * @brief State of the task, used to keep track of lifetime and status
 	 */
@@ -29,11 +29,15 @@
 #include <dpp/wsclient.h>
 #include <dpp/dispatcher.h>
 #include <dpp/event.h>
+#include <dpp/event_queue.h>
+#include <dpp/shard_handover.h>
+#include <dpp/zlibcontext.h>
 #include <queue>
 #include <thread>
 #include <deque>
 #include <mutex>
 #include <shared_mutex>
+#include <atomic>
 
 
 
@@ -45,11 +49,111 @@ namespace dpp {
 class cluster;
 
 /**
- * @brief This is an opaque class containing zlib library specific structures.
- * We define it this way so that the public facing D++ library doesn't require
- * the zlib headers be available to build against it.
+ * @brief Lazy guild member lookups for one shard.
+ *
+ * Lookups are collected and sent as REQUEST_GUILD_MEMBERS payloads with a list of user
+ * ids and a nonce. GUILD_MEMBERS_CHUNK replies carrying that nonce complete the waiting
+ * callbacks. This holds no connection of its own, dpp::discord_client sends the payloads
+ * it returns.
  */
-class zlibcontext;
+class DPP_EXPORT member_request_queue {
+	/**
+	 * @brief A batch of lazy member lookups sent as a single
+	 * REQUEST_GUILD_MEMBERS with a list of user ids
+	 */
+	struct member_request_batch {
+		/**
+		 * @brief Guild the members are being requested from
+		 */
+		snowflake guild_id;
+
+		/**
+		 * @brief Users requested which have not been answered yet
+		 */
+		std::vector<snowflake> user_ids;
+
+		/**
+		 * @brief Time the request was sent
+		 */
+		time_t sent;
+	};
+
+	/**
+	 * @brief Owning cluster, passed to callbacks
+	 */
+	cluster* creator;
+
+	/**
+	 * @brief Mutex for the containers below
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief User ids waiting to be sent in the next batch, keyed by guild id
+	 */
+	std::unordered_map<snowflake, std::vector<snowflake>> pending;
+
+	/**
+	 * @brief Callbacks waiting on a guild member, keyed by guild id and user id.
+	 * A user id is only requested once no matter how many callbacks are waiting on it.
+	 */
+	std::map<std::pair<snowflake, snowflake>, std::vector<command_completion_event_t>> callbacks;
+
+	/**
+	 * @brief Batches which have been sent and are waiting for a member chunk, keyed by nonce
+	 */
+	std::unordered_map<std::string, member_request_batch> batches;
+
+	/**
+	 * @brief Last nonce used for a lazy member request
+	 */
+	uint64_t nonce{0};
+
+	/**
+	 * @brief Call all callbacks waiting on a guild member
+	 *
+	 * @param guild_id Guild id
+	 * @param user_id User id
+	 * @param result Result to pass to the callbacks
+	 */
+	void complete(snowflake guild_id, snowflake user_id, const confirmation_callback_t& result);
+
+public:
+	/**
+	 * @brief Construct a new member request queue
+	 *
+	 * @param owner Owning cluster
+	 */
+	member_request_queue(cluster* owner);
+
+	/**
+	 * @brief Queue a lookup of a guild member
+	 *
+	 * @param guild_id Guild to get the member from
+	 * @param user_id User to get
+	 * @param callback Function to call when the member arrives, or the lookup fails
+	 */
+	void request(snowflake guild_id, snowflake user_id, command_completion_event_t callback);
+
+	/**
+	 * @brief Build REQUEST_GUILD_MEMBERS payloads for the pending lookups, in batches of
+	 * up to 100 user ids per guild, and fail batches which never received a reply.
+	 *
+	 * @param presences True to ask for presences with the members
+	 * @return std::vector<json> Gateway payloads to send
+	 */
+	std::vector<json> build_requests(bool presences);
+
+	/**
+	 * @brief Complete lookups from a GUILD_MEMBERS_CHUNK event. Members in the chunk
+	 * complete successfully and users in its `not_found` list complete with an error,
+	 * whether or not the members are cached. Users still unanswered when the last chunk
+	 * of a batch arrives also complete with an error.
+	 *
+	 * @param d The `d` field of the event
+	 */
+	void chunk_received(json& d);
+};
 
 /**
  * @brief Represents a connection to a voice channel.
@@ -152,6 +256,11 @@ protected:
 	 */
 	friend class dpp::events::guild_create;
 
+	/**
+	 * @brief Needed so that guild_members_chunk can complete lazy member requests
+	 */
+	friend class dpp::events::guild_members_chunk;
+
 	/**
 	 * @brief Needed to allow cluster::set_presence to use the ETF functions
 	 */
@@ -171,6 +280,11 @@ protected:
 	 */
 	void disconnect_voice_internal(snowflake guild_id, bool send_json = true);
 
+	/**
+	 * @brief Lazy member lookups waiting to be sent or answered on this shard
+	 */
+	member_request_queue member_requests;
+
 private:
 
 	/**
@@ -200,22 +314,19 @@ private:
 	bool compressed;
 
 	/**
-	 * @brief ZLib decompression buffer
+	 * @brief Decompressed string
 	 */
-	unsigned char* decomp_buffer;
+	std::string decompressed;
 
 	/**
-	 * @brief Decompressed string
+	 * @brief True if the compressed stream failed, so input is ignored until the shard reconnects
 	 */
-	std::string decompressed;
+	bool inflate_failed;
 
 	/**
-	 * @brief This object contains the various zlib structs which
-	 * are not usable by the user of the library directly. They
-	 * are wrapped within this opaque object so that this header
-	 * file does not bring in a dependency on zlib.h.
+	 * @brief The compressed stream of the current connection, if compression is enabled
 	 */
-	zlibcontext* zlib;
+	std::unique_ptr<zlibcontext> zlib;
 
 	/**
 	 * @brief Total decompressed received bytes
@@ -258,12 +369,33 @@ private:
 	 */
 	void end_zlib();
 
+	/**
+	 * @brief Inflate compressed input into decompressed. Discord compresses every message on a
+	 * connection as one stream, so this must see all input in order, whether complete or not.
+	 * @param input Compressed input
+	 * @return true on success, false if the stream failed and the connection is being closed
+	 */
+	bool inflate_input(std::string_view input);
+
+	/**
+	 * @brief Parse a complete, decompressed message from the websocket and act on it
+	 * @param data JSON or ETF message
+	 * @return True if the message has been handled
+	 */
+	bool handle_payload(const std::string &data);
+
 	/**
 	 * @brief Update the websocket hostname with the resume url
 	 * from the last READY event
 	 */
 	void set_resume_hostname();
 
+	/**
+	 * @brief Close the connection and wait for the shard's thread and event queue to finish.
+	 * The shard can still be called afterwards, but sends and receives nothing.
+	 */
+	void stop();
+
 	/**
 	 * @brief Clean up resources
 	 */
@@ -346,6 +478,16 @@ public:
 	 */
 	bool ready;
 
+	/**
+	 * @brief How events received by this shard are delivered, see dpp::cluster::reshard
+	 */
+	std::atomic<shard_delivery> delivery{sd_dispatch};
+
+	/**
+	 * @brief Queue between the socket and event dispatch, if dpp::cluster::set_event_queue was called
+	 */
+	std::unique_ptr<event_queue> events;
+
 	/**
 	 * @brief Last heartbeat ACK (opcode 11)
 	 */
@@ -376,13 +518,22 @@ public:
 	virtual void log(dpp::loglevel severity, const std::string &msg) const;
 
 	/**
-	 * @brief Handle an event (opcode 0)
+	 * @brief Handle an event (opcode 0). If the cluster has an event queue the event is queued,
+	 * otherwise it is dispatched straight away.
 	 * @param event Event name, e.g. MESSAGE_CREATE
 	 * @param j JSON object for the event content
 	 * @param raw Raw JSON event string
 	 */
 	virtual void handle_event(const std::string &event, json &j, const std::string &raw);
 
+	/**
+	 * @brief Dispatch an event to its handler
+	 * @param event Event name, e.g. MESSAGE_CREATE
+	 * @param j JSON object for the event content
+	 * @param raw Raw JSON event string
+	 */
+	void dispatch_event(const std::string &event, json &j, const std::string &raw);
+
 	/**
 	 * @brief Get the Guild Count for this shard
 	 * 
@@ -430,6 +581,25 @@ public:
 	 */
 	size_t get_queue_size();
 
+	/**
+	 * @brief Get a guild member over the gateway.
+	 *
+	 * Lookups are collected for up to a second and then sent as REQUEST_GUILD_MEMBERS
+	 * requests of up to 100 user ids per guild. A user who is already waiting to be
+	 * fetched is not requested again. Fetched members are stored in the guild's member
+	 * list unless the user cache policy is dpp::cp_none.
+	 *
+	 * @note You probably want dpp::cluster::request_guild_member instead, which checks the
+	 * cache first and picks the correct shard for the guild.
+	 * @param guild_id Guild to get the member from. The guild must be on this shard.
+	 * @param user_id User to get
+	 * @param callback Function to call when the member arrives.
+	 * On success the callback will contain a dpp::guild_member object in confirmation_callback_t::value. If the member
+	 * does not exist, or the request times out, confirmation_callback_t::is_error() method will return true.
+	 * @return discord_client& Reference to self
+	 */
+	discord_client& request_member(snowflake guild_id, snowflake user_id, command_completion_event_t callback);
+
 	/**
 	 * @brief Returns true if the shard is connected
 	 * 
@@ -470,6 +640,12 @@ public:
 	 */
 	uint64_t get_decompressed_bytes_in();
 
+	/**
+	 * @brief Get the counters of this shard's event queue
+	 * @return event_queue_stats counters, all zero if the cluster has no event queue
+	 */
+	event_queue_stats get_event_queue_stats() const;
+
 	/**
 	 * @brief Handle JSON from the websocket.
 	 * @param buffer The entire buffer content from the websocket client
@@ -477,6 +653,21 @@ public:
 	 */
 	virtual bool handle_frame(const std::string &buffer);
 
+	/**
+	 * @brief Get the payload size from which compressed frames are inflated piece by piece as they arrive,
+	 * so that inflating a large message such as a GUILD_CREATE overlaps receiving it
+	 * @return size_t Payload size in bytes, 0 if the connection is not compressed
+	 */
+	virtual size_t get_stream_threshold() const;
+
+	/**
+	 * @brief Inflate part of a large compressed frame as it arrives, and handle the message once it is complete
+	 * @param chunk Compressed bytes received
+	 * @param first True for the first piece of the frame
+	 * @param last True for the last piece of the frame
+	 */
+	virtual void handle_frame_data(std::string_view chunk, bool first, bool last);
+
 	/**
 	 * @brief Handle a websocket error.
 	 * @param errorcode The error returned from the websocket
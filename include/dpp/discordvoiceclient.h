@@ -32,6 +32,7 @@
 #include <cstring>
 #include <string>
 #include <map>
+#include <unordered_set>
 #include <vector>
 #include <dpp/json_fwd.h>
 #include <dpp/wsclient.h>
@@ -43,6 +44,7 @@
 #include <thread>
 #include <deque>
 #include <mutex>
+#include <atomic>
 #include <shared_mutex>
 #include <memory>
 #include <future>
@@ -64,6 +66,50 @@ class audio_mixer;
 
 inline constexpr size_t send_audio_raw_max_length = 11520;
 
+/**
+ * @brief Number of 20ms opus silence frames Discord expects at the end of
+ * speech before transmission stops, so that receivers do not interpolate
+ * over the gap.
+ */
+inline constexpr uint8_t trailing_silence_frame_count = 5;
+
+/**
+ * @brief Seconds of mixed track audio to keep in the output buffer ahead of
+ * the send loop. Changes to tracks are heard after at most this long.
+ */
+inline constexpr float voice_track_mix_lead = 0.12f;
+
+/**
+ * @brief Which speakers' audio a discord_voice_client receives
+ */
+enum voice_receive_filter_t : uint8_t {
+	/**
+	 * @brief Receive audio from every speaker (the default)
+	 */
+	vrf_all = 0,
+
+	/**
+	 * @brief Receive audio only from the listed users
+	 */
+	vrf_allow = 1,
+
+	/**
+	 * @brief Receive audio from everyone except the listed users
+	 */
+	vrf_deny = 2,
+
+	/**
+	 * @brief Receive audio from users for which a predicate returns true
+	 */
+	vrf_predicate = 3,
+};
+
+/**
+ * @brief Decides if audio from a user is received. Called once per speaker,
+ * not once per packet, on the voice client's socket thread.
+ */
+typedef std::function<bool(snowflake user_id)> voice_receive_predicate_t;
+
 /*
 * @brief For holding a moving average of the number of current voice users, for applying a smooth gain ramp.
 */
@@ -81,6 +127,171 @@ protected:
 	uint64_t collectionCount{};
 };
 
+/**
+ * @brief Mixes several named tracks of 48kHz stereo 16 bit PCM into one stream.
+ *
+ * Each track has its own queue, gain and ducking level, so that for example
+ * music, sound effects and text to speech can be queued independently and
+ * played over each other on a single voice connection, where otherwise they
+ * would have to be pre-mixed by the caller. Mixing uses the same vectorised
+ * audio_mixer kernels as received audio.
+ *
+ * Usually this is used via discord_voice_client::send_track_audio, which mixes
+ * one frame at a time just ahead of the send loop so that changes to gain
+ * and newly queued audio are heard within a frame or two.
+ *
+ * All methods are thread safe.
+ */
+class DPP_EXPORT voice_track_mixer {
+	/**
+	 * @brief A single named input track
+	 */
+	struct track {
+		/**
+		 * @brief Queued interleaved stereo samples
+		 */
+		std::vector<int16_t> pcm;
+
+		/**
+		 * @brief Position of the next unmixed sample in pcm
+		 */
+		size_t read_pos{0};
+
+		/**
+		 * @brief Gain set by the user
+		 */
+		float gain{1.0f};
+
+		/**
+		 * @brief Gain applied to every other track while this track has audio queued
+		 */
+		float duck_gain{1.0f};
+
+		/**
+		 * @brief Gain applied at the end of the last mixed frame. Gain changes are
+		 * ramped from here over the next frame to avoid clicks.
+		 */
+		float current_gain{1.0f};
+
+		/**
+		 * @brief True if the track had audio queued at the start of the frame being mixed
+		 */
+		bool active{false};
+
+		/**
+		 * @brief Number of samples still queued
+		 */
+		size_t queued() const;
+	};
+
+	/**
+	 * @brief Mutex for tracks
+	 */
+	std::mutex mix_mutex;
+
+	/**
+	 * @brief Tracks by name
+	 */
+	std::map<std::string, track> tracks;
+
+	/**
+	 * @brief Total number of samples queued across all tracks, readable without the mutex
+	 */
+	std::atomic<size_t> queued_samples;
+
+	/**
+	 * @brief Vectorised mixing kernels
+	 */
+	std::unique_ptr<audio_mixer> mixer;
+
+	/**
+	 * @brief Scratch buffer for the mixed frame before clipping
+	 */
+	std::vector<int32_t> mix_buffer;
+
+	/**
+	 * @brief Scratch buffer for one track before gain is applied
+	 */
+	std::vector<int32_t> track_buffer;
+
+	/**
+	 * @brief Scratch buffer for one track after gain is applied
+	 */
+	std::vector<int16_t> scaled_buffer;
+
+public:
+	/**
+	 * @brief Construct a new voice track mixer with no tracks
+	 */
+	voice_track_mixer();
+
+	/**
+	 * @brief Destroy the voice track mixer
+	 */
+	~voice_track_mixer();
+
+	/**
+	 * @brief Queue audio on a track, creating the track if it does not exist.
+	 *
+	 * @param name Track name
+	 * @param pcm Interleaved 48kHz stereo 16 bit PCM
+	 * @param samples Number of samples in pcm, across both channels
+	 */
+	void queue(const std::string& name, const int16_t* pcm, size_t samples);
+
+	/**
+	 * @brief Set the gain of a track, creating the track if it does not exist.
+	 *
+	 * @param name Track name
+	 * @param gain Gain, where 1.0 is unchanged and 0.0 is muted
+	 */
+	void set_gain(const std::string& name, float gain);
+
+	/**
+	 * @brief Set the ducking level of a track, creating the track if it does not exist.
+	 * While this track has audio queued, all other tracks are multiplied by this gain.
+	 *
+	 * @param name Track name
+	 * @param duck_gain Gain for other tracks, where 1.0 disables ducking
+	 */
+	void set_ducking(const std::string& name, float duck_gain);
+
+	/**
+	 * @brief Remove a track and discard any audio queued on it
+	 *
+	 * @param name Track name
+	 */
+	void clear(const std::string& name);
+
+	/**
+	 * @brief Get the number of samples queued on a track
+	 *
+	 * @param name Track name
+	 * @return size_t Samples across both channels, zero if the track does not exist
+	 */
+	size_t get_queued(const std::string& name);
+
+	/**
+	 * @brief Returns true if any track has audio queued
+	 */
+	bool has_audio() const;
+
+	/**
+	 * @brief Mix the next frame of all tracks. Tracks with less queued
+	 * audio than the frame length are padded with silence. A track which
+	 * has audio at the start of the frame ducks the other tracks for the
+	 * whole frame.
+	 *
+	 * @param out Buffer to receive the mixed PCM
+	 * @param samples Number of samples to mix, across both channels.
+	 * Must be a multiple of 16.
+	 * @return true if any audio was mixed, false if all tracks were empty
+	 * and out was left untouched
+	 * @throw dpp::voice_exception if samples is not a multiple of 16
+	 */
+	bool mix(int16_t* out, size_t samples);
+};
+
 // Forward declaration
 class cluster;
 
@@ -361,13 +572,132 @@ class DPP_EXPORT discord_voice_client : public websocket_client
 	 */
 	std::unordered_map<uint32_t, snowflake> ssrc_map;
 
+	/**
+	 * @brief Which speakers are received. Protected by receive_filter_mutex, as are receive_filter_users,
+	 * receive_filter_predicate, receive_filter_decisions and receive_filter_generation.
+	 */
+	voice_receive_filter_t receive_filter;
+
+	/**
+	 * @brief Incremented each time the filter or a speaker's ssrc changes, so a predicate's answer
+	 * is not remembered if either changed while it ran
+	 */
+	uint64_t receive_filter_generation;
+
+	/**
+	 * @brief Users listed for vrf_allow or vrf_deny
+	 */
+	std::unordered_set<snowflake> receive_filter_users;
+
+	/**
+	 * @brief Predicate for vrf_predicate
+	 */
+	voice_receive_predicate_t receive_filter_predicate;
+
+	/**
+	 * @brief Filter result for each ssrc, so the filter runs once per speaker.
+	 * Cleared when the filter changes and updated when an ssrc is mapped to a user.
+	 */
+	std::unordered_map<uint32_t, bool> receive_filter_decisions;
+
+	/**
+	 * @brief Mutex for the receive filter
+	 */
+	std::mutex receive_filter_mutex;
+
+	/**
+	 * @brief Number of packets dropped by the receive filter before decryption
+	 */
+	std::atomic<uint64_t> filtered_packets;
+
+	/**
+	 * @brief Check the receive filter for a speaker
+	 *
+	 * @param ssrc Speaker's ssrc, from the RTP header
+	 * @param user_id User the ssrc is mapped to, or 0 if not known yet
+	 * @return true if the speaker's audio is received
+	 */
+	bool receive_allowed(uint32_t ssrc, snowflake user_id);
+
 	/**
 	 * @brief This is set to true if we have started sending audio.
 	 * When this moves from false to true, this causes the
 	 * client to send the 'talking' notification to the websocket.
+	 * Protected by stream_mutex, as it is set by callers queueing audio
+	 * and cleared by the send loop when it reaches a silence gap.
 	 */
 	bool sending;
 
+	/**
+	 * @brief If true, silent frames passed to send_audio_raw are
+	 * neither encoded nor sent.
+	 */
+	bool silence_suppression;
+
+	/**
+	 * @brief Peak sample amplitude at or below which a raw
+	 * PCM frame is considered silent.
+	 */
+	uint16_t silence_threshold;
+
+	/**
+	 * @brief Number of trailing 20ms silence frames still to be
+	 * sent before transmission stops.
+	 */
+	uint8_t trailing_silence_frames;
+
+	/**
+	 * @brief Number of raw PCM frames which were not encoded
+	 * or sent at all because of silence suppression. Frames which
+	 * were replaced by trailing silence frames are not counted.
+	 */
+	uint64_t suppressed_frames;
+
+	/**
+	 * @brief Sample rate of received audio passed to on_voice_receive
+	 * and on_voice_receive_combined. Protected by voice_courier_shared_state.mtx,
+	 * as are receive_channels and receive_format.
+	 */
+	uint32_t receive_sample_rate;
+
+	/**
+	 * @brief Channel count of received audio
+	 */
+	uint8_t receive_channels;
+
+	/**
+	 * @brief Sample format of received audio
+	 */
+	voice_sample_format_t receive_format;
+
+	/**
+	 * @brief Mixer for audio queued with send_track_audio
+	 */
+	voice_track_mixer track_mixer;
+
+	/**
+	 * @brief Mix and send frames of track audio until the output
+	 * buffer holds voice_track_mix_lead seconds. Called from the
+	 * send loop, so that track audio is mixed just ahead of when
+	 * it is sent rather than all at once.
+	 */
+	void mix_tracks();
+
+	/**
+	 * @brief Set the audio of a voice_receive_t from decoded PCM,
+	 * converting it to the receive format. This is done once per
+	 * frame, before the event is passed to any listeners.
+	 *
+	 * @param vr Event to fill
+	 * @param user_id User the audio is from, or zero for combined audio
+	 * @param pcm Decoded 16 bit PCM
+	 * @param sample_count Number of samples in pcm, across all channels
+	 * @param sample_rate Sample rate the audio was decoded at
+	 * @param channels Channel count the audio was decoded with
+	 * @param format Format to convert the audio to
+	 */
+	void set_received_audio(voice_receive_t& vr, snowflake user_id, const int16_t* pcm, size_t sample_count, uint32_t sample_rate, uint8_t channels, voice_sample_format_t format);
+
 	/**
 	 * @brief Number of track markers in the buffer. For example if there
 	 * are two track markers in the buffer there are 3 tracks.
@@ -809,6 +1139,193 @@ public:
 	 */
 	discord_voice_client& send_silence(const uint64_t duration);
 
+	/**
+	 * @brief Enable or disable silence suppression on send_audio_raw.
+	 *
+	 * When enabled, each frame of raw PCM is checked before encoding. Once a
+	 * frame is silent, the required trailing silence frames are sent and then
+	 * transmission stops: nothing more is encoded, encrypted or sent until the
+	 * audio is no longer silent, and the speaking flag is cleared when the gap
+	 * reaches the head of the output buffer. Gaps still take up time in the
+	 * output buffer, so recorded audio keeps its timing. Opus DTX is also
+	 * enabled on the encoder.
+	 *
+	 * This is useful for bots which are mostly silent, such as talk radio or
+	 * text to speech bots. It has no effect on send_audio_opus or send_silence.
+	 *
+	 * @param enabled True to enable silence suppression, false to disable it
+	 * @param threshold Peak sample amplitude at or below which a frame is
+	 * considered silent. Zero only suppresses digital silence.
+	 * @return discord_voice_client& Reference to self
+	 * @throw dpp::voice_exception if voice support is not compiled into D++
+	 */
+	discord_voice_client& set_silence_suppression(bool enabled, uint16_t threshold = 32);
+
+	/**
+	 * @brief Set the format of audio passed to on_voice_receive and on_voice_receive_combined.
+	 *
+	 * Opus decodes directly at the requested sample rate and channel count, so there is no
+	 * separate resampling or downmix step. Conversion to float happens once per frame before
+	 * the event is passed to listeners. The default is 48kHz stereo int16.
+	 *
+	 * For example, speech to text usually wants 16kHz mono float:
+	 * @code{cpp}
+	 * event.voice_client->set_receive_format(16000, 1, dpp::vsf_float32);
+	 * @endcode
+	 *
+	 * @note This is best called from on_voice_ready, before any audio is received. If it is
+	 * called later, the decoder of each speaker already heard is replaced, which can cause
+	 * a brief glitch in their audio. Every frame is delivered with the sample_rate, channels
+	 * and format it was actually decoded with.
+	 * @param sample_rate Sample rate in Hz. Must be 8000, 12000, 16000, 24000 or 48000.
+	 * @param channels Number of channels, 1 or 2
+	 * @param format Sample format
+	 * @return discord_voice_client& Reference to self
+	 * @throw dpp::voice_exception if the format is not supported
+	 */
+	discord_voice_client& set_receive_format(uint32_t sample_rate, uint8_t channels, voice_sample_format_t format = vsf_int16);
+
+	/**
+	 * @brief Only receive audio from the given users.
+	 *
+	 * Packets from every other speaker are dropped straight after their RTP header is read,
+	 * before decryption, decoding or on_voice_receive, so ignored speakers cost almost nothing.
+	 * This is useful in stages and large channels where only a few speakers matter, for
+	 * example the host of a transcribed event. It can be changed at any time.
+	 *
+	 * @note Audio from a speaker whose user ID is not known yet is dropped until Discord
+	 * maps their ssrc to a user, which normally happens when they start speaking.
+	 * @param users Users to receive audio from
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& set_receive_allow_list(const std::vector<snowflake>& users);
+
+	/**
+	 * @brief Receive audio from every speaker except the given users.
+	 *
+	 * Packets from these users are dropped before decryption, as with set_receive_allow_list.
+	 *
+	 * @param users Users to ignore
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& set_receive_deny_list(const std::vector<snowflake>& users);
+
+	/**
+	 * @brief Receive audio from speakers for which a predicate returns true.
+	 *
+	 * The predicate is called once per speaker, the first time a packet arrives from them, and
+	 * its answer is remembered. It is called on the voice client's socket thread, so it should
+	 * not block. Speakers whose user ID is not known yet are passed as user ID 0, and the
+	 * predicate is asked again once their user ID is known. No lock is held while it runs, so
+	 * it may change the filter.
+	 *
+	 * @param predicate Predicate, or an empty function to receive from everyone
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& set_receive_filter(voice_receive_predicate_t predicate);
+
+	/**
+	 * @brief Remove any receive filter, receiving audio from every speaker again
+	 *
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& clear_receive_filter();
+
+	/**
+	 * @brief Get the number of received packets dropped by the receive filter
+	 *
+	 * @return uint64_t Number of packets dropped before decryption
+	 */
+	uint64_t get_filtered_packets();
+
+	/**
+	 * @brief Queue raw PCM audio on a named track of the outbound mixer.
+	 *
+	 * Unlike send_audio_raw, which queues audio strictly one piece after another,
+	 * each track has its own queue and all tracks play at the same time. Tracks
+	 * are mixed one frame at a time just before sending and encoded as a single
+	 * opus stream, so for example background music can keep playing while a text
+	 * to speech track is queued over it. Tracks are created on first use.
+	 *
+	 * Mixed audio is passed through send_audio_raw, so it is queued after any audio
+	 * already sent with the other send_audio_* methods, and silence suppression applies.
+	 *
+	 * @param track Track name
+	 * @param audio_data Interleaved 48kHz stereo 16 bit signed PCM
+	 * @param length Length of audio_data in bytes
+	 * @return discord_voice_client& Reference to self
+	 * @throw dpp::voice_exception if voice support is not compiled into D++
+	 */
+	discord_voice_client& send_track_audio(const std::string& track, const uint16_t* audio_data, const size_t length);
+
+	/**
+	 * @brief Set the gain of a track of the outbound mixer. Changes are ramped over one frame.
+	 *
+	 * @param track Track name
+	 * @param gain Gain, where 1.0 is unchanged and 0.0 is muted
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& set_track_gain(const std::string& track, float gain);
+
+	/**
+	 * @brief Set how much a track ducks the other tracks of the outbound mixer.
+	 * While the track has audio queued, every other track is multiplied by this gain,
+	 * e.g. 0.25 for text to speech over music.
+	 *
+	 * @param track Track name
+	 * @param duck_gain Gain for the other tracks, where 1.0 disables ducking
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& set_track_ducking(const std::string& track, float duck_gain);
+
+	/**
+	 * @brief Remove a track from the outbound mixer, discarding any audio queued on it.
+	 * Audio from the track which was already mixed into the output buffer still plays.
+	 *
+	 * @param track Track name
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& clear_track(const std::string& track);
+
+	/**
+	 * @brief Get the number of seconds of audio queued on a track of the outbound mixer
+	 *
+	 * @param track Track name
+	 * @return float Seconds remaining, zero if the track does not exist
+	 */
+	float get_track_secs_remaining(const std::string& track);
+
+	/**
+	 * @brief Get the number of raw PCM frames which were not encoded or
+	 * sent because silence suppression detected them as silent. Silent
+	 * frames which still had to carry some of the trailing silence frames
+	 * Discord expects are not counted.
+	 *
+	 * @return uint64_t Number of frames saved
+	 */
+	uint64_t get_suppressed_frames();
+
+	/**
+	 * @brief Check if a buffer of 16 bit signed PCM is silent.
+	 *
+	 * @param audio_data PCM samples
+	 * @param length Length of audio_data in bytes
+	 * @param threshold Peak sample amplitude at or below which the
+	 * audio is considered silent
+	 * @return true if no sample exceeds the threshold
+	 */
+	static bool is_silent(const uint16_t* audio_data, const size_t length, uint16_t threshold);
+
+	/**
+	 * @brief Convert 16 bit signed PCM to float samples in the range -1.0 to 1.0,
+	 * as passed to on_voice_receive with the dpp::vsf_float32 receive format.
+	 *
+	 * @param pcm PCM samples
+	 * @param sample_count Number of samples to convert, across all channels
+	 * @param out Buffer for at least sample_count floats
+	 */
+	static void pcm_to_float(const int16_t* pcm, size_t sample_count, float* out);
+
 	/**
 	 * @brief Sets the audio type that will be sent with send_audio_* methods.
 	 *
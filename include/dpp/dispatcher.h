@@ -44,11 +44,14 @@
 #include <dpp/integration.h>
 #include <dpp/auditlog.h>
 #include <dpp/entitlement.h>
+#include <dpp/event_router.h>
 #include <functional>
 #include <variant>
 #include <exception>
 #include <algorithm>
 #include <string>
+#include <memory>
+#include <mutex>
 
 #ifdef DPP_CORO
 #include <dpp/coro.h>
@@ -453,6 +456,61 @@ struct DPP_EXPORT voice_state_update_t : public event_dispatch_t {
 	 * @brief Voice state
 	 */
 	voicestate state = {};
+
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
+};
+
+/**
+ * @brief How far the response to an interaction has got, as tracked for the deferral watchdog
+ */
+enum interaction_response_stage : uint8_t {
+	/**
+	 * @brief Nothing has been sent yet
+	 */
+	irs_waiting = 0,
+
+	/**
+	 * @brief The watchdog is sending a deferred response
+	 */
+	irs_deferring = 1,
+
+	/**
+	 * @brief The watchdog has deferred the interaction, replies now edit the original response
+	 */
+	irs_deferred = 2,
+
+	/**
+	 * @brief A handler has responded
+	 */
+	irs_responded = 3,
+};
+
+/**
+ * @brief Response state of an interaction, shared by every event dispatched for it
+ * while the deferral watchdog is enabled with cluster::set_auto_defer.
+ */
+struct DPP_EXPORT interaction_response_state {
+	/**
+	 * @brief Mutex to protect the state
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief How far the response has got
+	 */
+	interaction_response_stage stage = irs_waiting;
+
+	/**
+	 * @brief Replies made while the watchdog's deferred response was in flight,
+	 * sent once it completes
+	 */
+	std::vector<std::function<void()>> after_deferral;
 };
 
 /**
@@ -462,6 +520,23 @@ struct DPP_EXPORT interaction_create_t : public event_dispatch_t {
 	using event_dispatch_t::event_dispatch_t;
 	using event_dispatch_t::operator=;
 
+	/**
+	 * @brief Response state shared with the deferral watchdog, or nullptr if cluster::set_auto_defer is not enabled.
+	 *
+	 * When the watchdog defers the interaction before a handler responds, a later reply with a message
+	 * edits the original response instead, and thinking() completes without another request.
+	 * Dialogs cannot be sent once the interaction has been deferred.
+	 */
+	std::shared_ptr<interaction_response_state> response_state;
+
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
+
 	/**
 	 * @brief Acknowledge interaction without displaying a message to the user,
 	 * for use with button and select menu components.
@@ -953,6 +1028,14 @@ struct DPP_EXPORT channel_update_t : public event_dispatch_t {
 	 * @brief channel being updated
 	 */
 	channel* updated = nullptr;
+
+	/**
+	 * @brief The cached version of the channel from before this update, or nullptr if it was not cached.
+	 * @note The cache never modifies a channel in place. An update publishes a new version and the previous
+	 * one stays valid, unchanged, for 60 seconds before it is garbage collected. That is a hard limit: a
+	 * pointer kept for longer than that dangles. Copy the channel if it is needed after the event handler returns.
+	 */
+	const channel* before = nullptr;
 };
 
 /**
@@ -1006,6 +1089,14 @@ struct DPP_EXPORT message_delete_t : public event_dispatch_t {
 	 */
 	snowflake guild_id{0};
 
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
+
 };
 
 /**
@@ -1084,6 +1175,18 @@ struct DPP_EXPORT typing_start_t : public event_dispatch_t {
 	 */
 	channel* typing_channel = nullptr;
 
+	/**
+	 * @brief Guild id user is typing on, zero in a DM.
+	 * Always set regardless of caching
+	 */
+	snowflake guild_id = {};
+
+	/**
+	 * @brief Channel id user is typing on.
+	 * Always set regardless of caching, including for threads
+	 */
+	snowflake channel_id = {};
+
 	/**
 	 * @brief user who is typing.
 	 * Can be nullptr if user is not cached
@@ -1096,6 +1199,14 @@ struct DPP_EXPORT typing_start_t : public event_dispatch_t {
 	 */
 	snowflake user_id = {};
 
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
+
 	/**
 	 * @brief Time of typing event
 	 */
@@ -1128,11 +1239,25 @@ struct DPP_EXPORT message_reaction_add_t : public event_dispatch_t {
 	using event_dispatch_t::event_dispatch_t;
 	using event_dispatch_t::operator=;
 
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
+
 	/**
 	 * @brief Guild reaction occurred on
 	 */
 	guild* reacting_guild = nullptr;
 
+	/**
+	 * @brief Guild id reaction occurred on, zero in a DM.
+	 * Always set regardless of caching
+	 */
+	snowflake guild_id = {};
+
 	/**
 	 * @brief User who reacted
 	 */
@@ -1195,11 +1320,25 @@ struct DPP_EXPORT message_reaction_remove_t : public event_dispatch_t {
 	using event_dispatch_t::event_dispatch_t;
 	using event_dispatch_t::operator=;
 
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
+
 	/**
 	 * @brief Guild reaction occurred on
 	 */
 	guild* reacting_guild = nullptr;
 
+	/**
+	 * @brief Guild id reaction occurred on, zero in a DM.
+	 * Always set regardless of caching
+	 */
+	snowflake guild_id = {};
+
 	/**
 	 * @brief User who reacted
 	 */
@@ -1364,6 +1503,14 @@ struct DPP_EXPORT guild_role_update_t : public event_dispatch_t {
 	 * @brief the role being updated
 	 */
 	role* updated = nullptr;
+
+	/**
+	 * @brief The cached version of the role from before this update, or nullptr if it was not cached.
+	 * @note The cache never modifies a role in place. An update publishes a new version and the previous
+	 * one stays valid, unchanged, for 60 seconds before it is garbage collected. That is a hard limit: a
+	 * pointer kept for longer than that dangles. Copy the role if it is needed after the event handler returns.
+	 */
+	const role* before = nullptr;
 };
 
 /**
@@ -1557,6 +1704,14 @@ struct DPP_EXPORT guild_update_t : public event_dispatch_t {
 	 * @brief guild being updated
 	 */
 	guild* updated = nullptr;
+
+	/**
+	 * @brief The cached version of the guild from before this update, or nullptr if it was not cached.
+	 * @note The cache never modifies a guild in place on a guild update. An update publishes a new version
+	 * and the previous one stays valid, unchanged, for 60 seconds before it is garbage collected. That is a hard
+	 * limit: a pointer kept for longer than that dangles. Copy the guild if it is needed after the event handler returns.
+	 */
+	const guild* before = nullptr;
 };
 
 /**
@@ -1614,6 +1769,14 @@ struct DPP_EXPORT message_update_t : public event_dispatch_t {
 	 * @brief message being updated
 	 */
 	message msg = {};
+
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
 };
 
 /**
@@ -1640,6 +1803,14 @@ struct DPP_EXPORT message_create_t : public event_dispatch_t {
 	 * @brief message that was created (sent).
 	 */
 	message msg = {};
+
+	/**
+	 * @brief Get the guild, channel and user this event relates to,
+	 * used to route it to listeners attached with event_router_t::attach_scoped
+	 *
+	 * @return event_scope ids for this event
+	 */
+	event_scope get_scope() const;
 	/**
 	 * @brief Send a text to the same channel as the channel_id in received event.
 	 * @param m Text to send
@@ -1958,6 +2129,22 @@ struct DPP_EXPORT voice_ready_t : public event_dispatch_t {
 	snowflake voice_channel_id = {};
 };
 
+/**
+ * @brief Sample format of received voice audio
+ * @see discord_voice_client::set_receive_format
+ */
+enum voice_sample_format_t : uint8_t {
+	/**
+	 * @brief Signed 16 bit integer samples
+	 */
+	vsf_int16 = 0,
+
+	/**
+	 * @brief 32 bit float samples, in the range -1.0 to 1.0
+	 */
+	vsf_float32 = 1,
+};
+
 /**
  * @brief voice receive packet
  */
@@ -2011,7 +2198,8 @@ struct DPP_EXPORT voice_receive_t : public event_dispatch_t {
 	size_t audio_size = 0;
 
 	/**
-	 * @brief Audio data, encoded as 48kHz stereo PCM or Opus,
+	 * @brief Audio data, encoded as PCM or Opus. PCM is 48kHz stereo
+	 * int16 unless changed with discord_voice_client::set_receive_format.
 	 */
 	std::basic_string<uint8_t> audio_data = {};
 
@@ -2020,6 +2208,21 @@ struct DPP_EXPORT voice_receive_t : public event_dispatch_t {
 	 */
 	snowflake user_id = {};
 
+	/**
+	 * @brief Sample rate of audio_data in Hz
+	 */
+	uint32_t sample_rate = 48000;
+
+	/**
+	 * @brief Number of interleaved channels in audio_data
+	 */
+	uint8_t channels = 2;
+
+	/**
+	 * @brief Format of each sample in audio_data
+	 */
+	voice_sample_format_t format = vsf_int16;
+
 protected:
 	/**
 	 * @brief Reassign values outside of the constructor for use within discord_voice_client
@@ -36,6 +36,7 @@
 #include <dpp/snowflake.h>
 #include <dpp/misc-enum.h>
 #include <dpp/stringops.h>
+#include <dpp/textkernels.h>
 #include <dpp/managed.h>
 #include <dpp/utility.h>
 #include <dpp/voicestate.h>
@@ -65,9 +66,21 @@
 #include <dpp/dispatcher.h>
 #include <dpp/cluster.h>
 #include <dpp/cache.h>
+#include <dpp/thread_cache.h>
 #include <dpp/httpsclient.h>
 #include <dpp/queues.h>
 #include <dpp/commandhandler.h>
+#include <dpp/autocomplete.h>
+#include <dpp/interaction_watchdog.h>
+#include <dpp/asset_cache.h>
+#include <dpp/entitlement_cache.h>
+#include <dpp/event_queue.h>
+#include <dpp/alloc_profile.h>
+#include <dpp/message_template.h>
+#include <dpp/rate_controller.h>
+#include <dpp/shard_handover.h>
+#include <dpp/zlibcontext.h>
+#include <dpp/subprocess.h>
 #include <dpp/once.h>
 #include <dpp/sync.h>
 #include <dpp/colors.h>
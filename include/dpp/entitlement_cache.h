@@ -0,0 +1,183 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <dpp/snowflake.h>
+#include <dpp/entitlement.h>
+#include <dpp/dispatcher.h>
+#include <functional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace dpp {
+
+class cluster;
+
+/**
+ * @brief Keeps the application's entitlements in memory so premium checks do not need a REST call.
+ *
+ * Entitlements are indexed by owner and SKU. The owner is the user or guild the entitlement was granted to;
+ * user and guild IDs never collide, so both kinds share one index. The cache is filled by load(), which pages
+ * through dpp::cluster::entitlements_get, and kept current from the entitlement create, update and delete
+ * events, which it attaches to when constructed. An entitlement counts from its starts_at until its ends_at,
+ * so subscriptions lapse on time even if no event arrives for them.
+ *
+ * @note Entitlement events are only sent to bots, so the cache must be constructed before the cluster is
+ * started, and load() called once it is ready, e.g. from on_ready when dpp::run_once says so.
+ */
+class DPP_EXPORT entitlement_cache {
+	/**
+	 * @brief When an entitlement is valid
+	 */
+	struct window {
+		/**
+		 * @brief Start, 0 if it has none
+		 */
+		time_t starts_at;
+
+		/**
+		 * @brief End, 0 if it never ends
+		 */
+		time_t ends_at;
+	};
+
+	/**
+	 * @brief Hashes an owner and SKU pair
+	 */
+	struct key_hash {
+		size_t operator()(const std::pair<snowflake, snowflake>& k) const {
+			return std::hash<uint64_t>()(k.first) ^ (std::hash<uint64_t>()(k.second) * 0x9e3779b97f4a7c15ULL);
+		}
+	};
+
+	/**
+	 * @brief Cluster the events and REST calls belong to
+	 */
+	cluster* owner;
+
+	/**
+	 * @brief Protects the indexes
+	 */
+	mutable std::shared_mutex mutex;
+
+	/**
+	 * @brief Entitlement windows by owner and SKU, then by entitlement ID. There is usually one per pair,
+	 * more if a subscription was renewed as a new entitlement.
+	 */
+	std::unordered_map<std::pair<snowflake, snowflake>, std::unordered_map<snowflake, window>, key_hash> by_owner;
+
+	/**
+	 * @brief Owner and SKU of each entitlement by ID, so it can be found when updated or deleted
+	 */
+	std::unordered_map<snowflake, std::pair<snowflake, snowflake>> by_id;
+
+	/**
+	 * @brief Event handles, detached on destruction
+	 */
+	event_handle created, updated, deleted;
+
+	/**
+	 * @brief Request the page of entitlements after an ID, and the pages after it
+	 */
+	void load_page(snowflake after, size_t loaded, command_completion_event_t callback);
+
+public:
+	/**
+	 * @brief Construct an entitlement cache and attach it to a cluster's entitlement events
+	 *
+	 * @param o Cluster to attach to
+	 */
+	explicit entitlement_cache(cluster* o);
+
+	/**
+	 * @brief Detach from the cluster's events
+	 */
+	~entitlement_cache();
+
+	/**
+	 * @brief dpp::entitlement_cache is non-copyable
+	 */
+	entitlement_cache(const entitlement_cache&) = delete;
+
+	/**
+	 * @brief dpp::entitlement_cache is non-copyable
+	 */
+	entitlement_cache& operator=(const entitlement_cache&) = delete;
+
+	/**
+	 * @brief Fetch every current entitlement of the application over REST, 100 at a time, into the cache.
+	 * Entitlements which have ended are skipped.
+	 *
+	 * @param callback Called once every page has been loaded, with a dpp::confirmation, or with the error if
+	 * a page could not be fetched. Pages loaded before the error are kept.
+	 */
+	void load(command_completion_event_t callback = utility::log_error());
+
+	/**
+	 * @brief Add or replace an entitlement. Deleted entitlements are removed instead.
+	 * The cache calls this for entitlement events; it is public for entitlements obtained in other ways.
+	 *
+	 * @param e Entitlement
+	 */
+	void insert(const entitlement& e);
+
+	/**
+	 * @brief Remove an entitlement
+	 * @param id Entitlement ID
+	 */
+	void remove(snowflake id);
+
+	/**
+	 * @brief Check if a user or guild holds an SKU now
+	 *
+	 * @param owner_id User or guild ID
+	 * @param sku_id SKU ID
+	 * @return true if it holds an entitlement to the SKU which has started and not ended
+	 */
+	bool has_entitlement(snowflake owner_id, snowflake sku_id) const;
+
+	/**
+	 * @brief Check if the user who invoked an interaction, or the guild it was invoked in, holds an SKU now.
+	 * Entitlements Discord sent with the interaction are checked as well as the cache.
+	 *
+	 * @param i Interaction
+	 * @param sku_id SKU ID
+	 * @return true if the user or guild holds an entitlement to the SKU which has started and not ended
+	 */
+	bool has_entitlement(const interaction& i, snowflake sku_id) const;
+
+	/**
+	 * @brief Remove entitlements which have ended
+	 * @return size_t Number removed
+	 */
+	size_t prune();
+
+	/**
+	 * @brief Get the number of entitlements in the cache
+	 * @return size_t count
+	 */
+	size_t count() const;
+};
+
+} // namespace dpp
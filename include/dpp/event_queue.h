@@ -0,0 +1,214 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <dpp/json_fwd.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace dpp {
+
+/**
+ * @brief Order in which queued events are dispatched, and whether they may be shed
+ */
+enum event_priority : uint8_t {
+	/**
+	 * @brief Dispatched ahead of everything else queued, never shed. For events with a deadline,
+	 * such as interactions which must be answered within three seconds.
+	 */
+	ep_critical = 0,
+
+	/**
+	 * @brief Dispatched in the order received, never shed
+	 */
+	ep_normal = 1,
+
+	/**
+	 * @brief Dispatched in the order received, shed according to its dpp::shed_policy while the queue is over capacity
+	 */
+	ep_low = 2,
+};
+
+/**
+ * @brief What happens to a low priority event which arrives while the queue is over capacity
+ */
+enum shed_policy : uint8_t {
+	/**
+	 * @brief The event is dropped
+	 */
+	sp_drop = 0,
+
+	/**
+	 * @brief One event in every dpp::event_queue_config::sample_rate is kept, the rest are dropped
+	 */
+	sp_sample = 1,
+
+	/**
+	 * @brief If an event of the same type for the same user, guild and channel is still queued, it is
+	 * replaced by the new one, keeping its place in the queue. Otherwise the event is dropped.
+	 * Suits events which carry the whole current state, such as PRESENCE_UPDATE.
+	 */
+	sp_coalesce = 2,
+};
+
+/**
+ * @brief How one type of event is queued
+ */
+struct DPP_EXPORT event_policy {
+	/**
+	 * @brief Priority of the event
+	 */
+	event_priority priority = ep_normal;
+
+	/**
+	 * @brief What happens to it under overload, if its priority is dpp::ep_low
+	 */
+	shed_policy shed = sp_drop;
+};
+
+/**
+ * @brief Settings for the queues between each shard's socket and event dispatch, see dpp::cluster::set_event_queue
+ */
+struct DPP_EXPORT event_queue_config {
+	/**
+	 * @brief Number of queued events above which low priority events are shed. Critical and normal events are
+	 * always queued, so the queue can grow past this if they alone arrive faster than they are handled.
+	 */
+	size_t capacity = 10000;
+
+	/**
+	 * @brief For dpp::sp_sample, keep one event in this many
+	 */
+	uint32_t sample_rate = 10;
+
+	/**
+	 * @brief Policy for each event by gateway name, e.g. "PRESENCE_UPDATE". Events not listed are dpp::ep_normal.
+	 * By default interactions are critical, presence updates are coalesced and typing notifications are dropped.
+	 */
+	std::map<std::string, event_policy> events = {
+		{"INTERACTION_CREATE", {ep_critical, sp_drop}},
+		{"PRESENCE_UPDATE", {ep_low, sp_coalesce}},
+		{"TYPING_START", {ep_low, sp_drop}},
+	};
+};
+
+/**
+ * @brief Counters for a shard's event queue
+ */
+struct DPP_EXPORT event_queue_stats {
+	/**
+	 * @brief Events waiting to be dispatched
+	 */
+	size_t depth = 0;
+
+	/**
+	 * @brief Most events ever waiting at once
+	 */
+	size_t peak_depth = 0;
+
+	/**
+	 * @brief Events dispatched
+	 */
+	uint64_t dispatched = 0;
+
+	/**
+	 * @brief Events dropped by dpp::sp_drop or dpp::sp_sample, by gateway name
+	 */
+	std::map<std::string, uint64_t> shed;
+
+	/**
+	 * @brief Queued events replaced by a newer one by dpp::sp_coalesce, by gateway name
+	 */
+	std::map<std::string, uint64_t> coalesced;
+
+	/**
+	 * @brief Add another shard's counters to these
+	 * @param other Counters to add
+	 * @return event_queue_stats& reference to self
+	 */
+	event_queue_stats& operator+=(const event_queue_stats& other);
+};
+
+/**
+ * @brief Dispatches a queued event, see dpp::event_queue
+ */
+typedef std::function<void(const std::string& event, json& j, const std::string& raw)> event_queue_dispatch_t;
+
+/**
+ * @brief A bounded queue between a shard's socket and the dispatch of its events, with a thread of its own
+ * which dispatches them. The socket thread only parses and queues events, so it keeps up with heartbeats
+ * however slow event handlers are, and low priority events are shed under sustained overload instead of
+ * the shard falling behind.
+ *
+ * Events are dispatched one at a time in the order they arrived, except critical events which go first.
+ */
+class DPP_EXPORT event_queue {
+public:
+	/**
+	 * @brief Queued events and the dispatch thread
+	 */
+	struct state;
+
+private:
+	/**
+	 * @brief Queued events and the dispatch thread
+	 */
+	std::unique_ptr<state> queue;
+
+public:
+	/**
+	 * @brief Start a queue and its dispatch thread
+	 *
+	 * @param config Settings
+	 * @param dispatch Called on the dispatch thread for each event, e.g. dpp::discord_client::dispatch_event.
+	 * It should not throw.
+	 * @param thread_name Name of the dispatch thread
+	 */
+	event_queue(const event_queue_config& config, event_queue_dispatch_t dispatch, const std::string& thread_name);
+
+	/**
+	 * @brief Stop the dispatch thread. Events still queued are discarded.
+	 */
+	~event_queue();
+
+	/**
+	 * @brief Queue an event, or shed it
+	 *
+	 * @param event Gateway name of the event
+	 * @param j Parsed event, moved from
+	 * @param raw Raw event
+	 * @return true if the event was queued, false if it was shed or coalesced
+	 */
+	bool push(const std::string& event, json& j, const std::string& raw);
+
+	/**
+	 * @brief Get the queue's counters
+	 * @return event_queue_stats counters
+	 */
+	event_queue_stats get_stats() const;
+};
+
+} // namespace dpp
@@ -24,6 +24,8 @@
 #include <dpp/export.h>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <array>
 #include <variant>
 #include <dpp/snowflake.h>
 #include <dpp/misc-enum.h>
@@ -158,6 +160,64 @@ public:
  */
 typedef size_t event_handle;
 
+/**
+ * @brief The guild, channel and user which an event relates to.
+ * Events which support scoped listeners provide this through a
+ * `get_scope()` method. Any of the ids may be zero if the event
+ * does not relate to one.
+ */
+struct event_scope {
+	/**
+	 * @brief Guild the event happened on
+	 */
+	snowflake guild_id;
+
+	/**
+	 * @brief Channel the event happened on
+	 */
+	snowflake channel_id;
+
+	/**
+	 * @brief User who caused the event
+	 */
+	snowflake user_id;
+};
+
+/**
+ * @brief What a scoped listener is attached to
+ * @see event_router_t::attach_scoped
+ */
+enum event_scope_type : uint8_t {
+	/**
+	 * @brief Listener receives events for one guild
+	 */
+	es_guild = 0,
+
+	/**
+	 * @brief Listener receives events for one channel
+	 */
+	es_channel = 1,
+
+	/**
+	 * @brief Listener receives events for one user
+	 */
+	es_user = 2,
+};
+
+namespace detail::event_router {
+
+/**
+ * @brief True if the event type T has a `get_scope()` method, and so
+ * supports listeners attached with event_router_t::attach_scoped
+ */
+template <typename T, typename = void>
+inline constexpr bool has_scope_v = false;
+
+template <typename T>
+inline constexpr bool has_scope_v<T, std::void_t<decltype(std::declval<const T&>().get_scope())>> = true;
+
+}
+
 /**
  * @brief Handles routing of an event to multiple listeners.
  * Multiple listeners may attach to the event_router_t by means of @ref operator()(F&&) "operator()". Passing a
@@ -247,6 +307,20 @@ private:
 	 */
 	std::map<event_handle, event_handler_t> dispatch_container;
 
+	/**
+	 * @brief Listeners attached with attach_scoped, indexed by event_scope_type
+	 * and then by guild, channel or user id. Each inner map is ordered by handle
+	 * like dispatch_container, so scoped listeners are also called in the order
+	 * they were attached.
+	 */
+	std::array<std::unordered_map<snowflake, std::map<event_handle, event_handler_t>>, 3> scoped_container;
+
+	/**
+	 * @brief The scope of each listener in scoped_container, keyed by handle,
+	 * so that detach can find it without searching
+	 */
+	std::unordered_map<event_handle, std::pair<event_scope_type, snowflake>> scoped_handles;
+
 #ifdef DPP_CORO
 	/**
 	 * @brief Mutex for messing with coro_awaiters.
@@ -291,6 +365,66 @@ protected:
 		warning = warning_function;
 	}
 
+	/**
+	 * @brief Call a function for every listener which should receive an event: first the
+	 * global listeners, then listeners scoped to the event's guild, channel and user.
+	 * Only the scoped listeners for the ids in the event are visited, no matter how many
+	 * other guilds, channels or users have listeners. Stops when the event is cancelled.
+	 * The caller must hold the mutex.
+	 *
+	 * @param event Event being dispatched
+	 * @param fn Function to call with each listener
+	 */
+	template <typename Fn>
+	void for_each_listener(const T& event, Fn&& fn) const {
+		for (const auto& [_, listener] : dispatch_container) {
+			if (event.is_cancelled()) {
+				return;
+			}
+			fn(listener);
+		}
+		if constexpr (detail::event_router::has_scope_v<T>) {
+			if (scoped_handles.empty()) {
+				return;
+			}
+			const event_scope scope = event.get_scope();
+			const snowflake ids[] = { scope.guild_id, scope.channel_id, scope.user_id };
+			for (size_t type = 0; type < scoped_container.size(); ++type) {
+				if (ids[type].empty()) {
+					continue;
+				}
+				auto listeners = scoped_container[type].find(ids[type]);
+				if (listeners == scoped_container[type].end()) {
+					continue;
+				}
+				for (const auto& [_, listener] : listeners->second) {
+					if (event.is_cancelled()) {
+						return;
+					}
+					fn(listener);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Wrap a callable in the type listeners are stored as
+	 *
+	 * @param fun Callable of the form `void(const T&)`, or `dpp::task<void>(const T&)` with DPP_CORO
+	 * @return event_handler_t the stored listener
+	 */
+	template <typename F>
+	static event_handler_t make_handler(F&& fun) {
+#ifdef DPP_CORO
+		if constexpr (utility::callable_returns_v<F, task<void>, const T&>) {
+			return event_handler_t{std::in_place_type_t<task_handler_t>{}, std::forward<F>(fun)};
+		} else
+#endif
+		{
+			return event_handler_t{std::in_place_type_t<regular_handler_t>{}, std::forward<F>(fun)};
+		}
+	}
+
 	/**
 	 * @brief Handle an event. This function should only be used without coro enabled, otherwise use handle_coro.
 	 */
@@ -300,15 +434,13 @@ protected:
 		}
 
 		std::shared_lock l(mutex);
-		for (const auto& [_, listener] : dispatch_container) {
-			if (!event.is_cancelled()) {
-				if (std::holds_alternative<regular_handler_t>(listener)) {
-					std::get<regular_handler_t>(listener)(event);
-				} else {
-					throw dpp::logic_exception("cannot handle a coroutine event handler with a library built without DPP_CORO");
-				}
+		for_each_listener(event, [&event](const event_handler_t& listener) {
+			if (std::holds_alternative<regular_handler_t>(listener)) {
+				std::get<regular_handler_t>(listener)(event);
+			} else {
+				throw dpp::logic_exception("cannot handle a coroutine event handler with a library built without DPP_CORO");
 			}
-		};
+		});
 	}
 
 #ifdef DPP_CORO
@@ -326,15 +458,13 @@ protected:
 		{
 			std::shared_lock l(mutex);
 
-			for (const auto& [_, listener] : dispatch_container) {
-				if (!event.is_cancelled()) {
-					if (std::holds_alternative<task_handler_t>(listener)) {
-						tasks.push_back(std::get<task_handler_t>(listener)(event));
-					} else if (std::holds_alternative<regular_handler_t>(listener)) {
-						std::get<regular_handler_t>(listener)(event);
-					}
+			for_each_listener(event, [&event, &tasks](const event_handler_t& listener) {
+				if (std::holds_alternative<task_handler_t>(listener)) {
+					tasks.push_back(std::get<task_handler_t>(listener)(event));
+				} else if (std::holds_alternative<regular_handler_t>(listener)) {
+					std::get<regular_handler_t>(listener)(event);
 				}
-			};
+			});
 		}
 
 		for (dpp::task<void>& t : tasks) {
@@ -547,11 +677,11 @@ public:
 		std::shared_lock lock{mutex};
 		std::shared_lock coro_lock{coro_mutex};
 
-		return dispatch_container.empty() && coro_awaiters.empty();
+		return dispatch_container.empty() && scoped_handles.empty() && coro_awaiters.empty();
 #else
 		std::shared_lock lock{mutex};
 
-		return dispatch_container.empty();
+		return dispatch_container.empty() && scoped_handles.empty();
 #endif
 	}
 
@@ -706,17 +836,75 @@ public:
 	}
 #  endif /* DPP_CORO */
 #endif /* _DOXYGEN_ */
+
+	/**
+	 * @brief Attach a callable to the event which only receives events for one guild,
+	 * channel or user. The callable takes the same forms as for @ref attach(F&&) "attach".
+	 *
+	 * Scoped listeners are kept in a hash index, so dispatching an event only calls the
+	 * listeners for the guild, channel and user in that event, instead of every listener
+	 * checking the ids for itself. They are called after all global listeners.
+	 *
+	 * This is only available for events which have a `get_scope()` method, such as
+	 * dpp::message_create_t, dpp::message_reaction_add_t, dpp::voice_state_update_t
+	 * and interaction events.
+	 *
+	 * Example:
+	 * @code{cpp}
+	 * bot.on_message_create.attach_scoped(dpp::es_guild, guild_id, [](const dpp::message_create_t& event) {
+	 *	// Only called for messages on guild_id
+	 * });
+	 * @endcode
+	 *
+	 * @warning You cannot call this within an event handler.
+	 *
+	 * @param type What the listener is scoped to
+	 * @param id Id of the guild, channel or user to receive events for
+	 * @param fun Callable to attach to event
+	 * @return event_handle An event handle unique to this event, used to
+	 * detach the listener from the event later if necessary.
+	 */
+	template <typename F>
+	[[maybe_unused]] event_handle attach_scoped(event_scope_type type, snowflake id, F&& fun) {
+		static_assert(detail::event_router::has_scope_v<T>, "This event type does not support scoped listeners");
+		static_assert(utility::callable_returns_v<F, void, const T&>
+#ifdef DPP_CORO
+			|| utility::callable_returns_v<F, task<void>, const T&>
+#endif
+			, "Scoped listeners must be callables of the form void(const T&) or dpp::task<void>(const T&)");
+
+		std::unique_lock l(mutex);
+		event_handle h = next_handle++;
+		scoped_container[type][id].emplace(h, make_handler(std::forward<F>(fun)));
+		scoped_handles.emplace(h, std::make_pair(type, id));
+		return h;
+	}
+
 	/**
 	 * @brief Detach a listener from the event using a previously obtained ID.
+	 * This works for both global and scoped listeners.
 	 *
 	 * @warning You cannot call this within an event handler.
 	 *
-	 * @param handle An ID obtained from @ref operator(F&&) "operator()"
+	 * @param handle An ID obtained from @ref operator(F&&) "operator()" or attach_scoped
 	 * @retval true  The event was successfully detached
 	 * @retval false The ID is invalid (possibly already detached, or does not exist)
 	 */
 	[[maybe_unused]] bool detach(const event_handle& handle) {
 		std::unique_lock l(mutex);
+		auto scoped = scoped_handles.find(handle);
+		if (scoped != scoped_handles.end()) {
+			auto& [type, id] = scoped->second;
+			auto listeners = scoped_container[type].find(id);
+			if (listeners != scoped_container[type].end()) {
+				listeners->second.erase(handle);
+				if (listeners->second.empty()) {
+					scoped_container[type].erase(listeners);
+				}
+			}
+			scoped_handles.erase(scoped);
+			return true;
+		}
 		return this->dispatch_container.erase(handle);
 	}
 };
@@ -104,6 +104,13 @@ enum exception_error_code {
 	err_icon_size = 35,
 	err_massive_audio = 36,
 	err_unknown = 37,
+	err_shared_memory = 38,
+	err_asset_cache = 39,
+	err_subprocess = 40,
+	err_event_queue_already_set = 41,
+	err_message_template = 42,
+	err_rate_rule = 43,
+	err_ratelimit_checkpoint = 44,
 	err_bad_request = 400,
 	err_unauthorized = 401,
 	err_payment_required = 402,
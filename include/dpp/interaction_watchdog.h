@@ -0,0 +1,100 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace dpp {
+
+/**
+ * @brief Runs callbacks when their deadlines pass, on a thread of its own and with millisecond resolution.
+ *
+ * Used by cluster::set_auto_defer to defer interactions whose handlers have not responded in time.
+ * The cluster's own timers tick once a second, which is too coarse for Discord's three second
+ * response window. Callbacks run one at a time on the watchdog thread, so they should only
+ * queue work, e.g. a REST request, and return.
+ */
+class DPP_EXPORT interaction_watchdog {
+	/**
+	 * @brief Mutex to protect deadlines and terminating
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief Notified when an earlier deadline is added, or on destruction
+	 */
+	std::condition_variable changed;
+
+	/**
+	 * @brief Callbacks waiting to run, by deadline
+	 */
+	std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> deadlines;
+
+	/**
+	 * @brief True when the watchdog is being destroyed
+	 */
+	bool terminating;
+
+	/**
+	 * @brief Thread which waits for the deadlines
+	 */
+	std::thread runner;
+
+	/**
+	 * @brief Thread loop, runs each callback as its deadline passes
+	 */
+	void run();
+
+public:
+	/**
+	 * @brief Construct a new watchdog and start its thread
+	 */
+	interaction_watchdog();
+
+	/**
+	 * @brief Stop the watchdog thread. Callbacks whose deadlines have not passed are dropped.
+	 */
+	~interaction_watchdog();
+
+	/**
+	 * @brief Run a callback once a deadline passes
+	 *
+	 * @param deadline When to run the callback
+	 * @param on_expiry Callback to run on the watchdog thread
+	 */
+	void watch(std::chrono::steady_clock::time_point deadline, std::function<void()> on_expiry);
+
+	/**
+	 * @brief Get the number of callbacks waiting to run
+	 *
+	 * @return size_t Number of callbacks
+	 */
+	size_t pending();
+};
+
+} // namespace dpp
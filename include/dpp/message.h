@@ -1701,6 +1701,9 @@ enum cache_policy_setting_t {
 struct DPP_EXPORT cache_policy_t {
 	/**
 	 * @brief Caching policy for users and guild members
+	 *
+	 * With dpp::cp_lazy, members are not requested when a guild is created.
+	 * Use dpp::cluster::request_guild_member to fetch them as they are needed.
 	 */
 	cache_policy_setting_t user_policy = cp_aggressive;
 
@@ -1723,6 +1726,13 @@ struct DPP_EXPORT cache_policy_t {
 	 * @brief Caching policy for roles
 	 */
 	cache_policy_setting_t guild_policy = cp_aggressive;
+
+	/**
+	 * @brief Caching policy for threads.
+	 * Aggressive caches threads and their member lists, lazy caches only the threads.
+	 * @see dpp::thread_cache
+	 */
+	cache_policy_setting_t thread_policy = cp_aggressive;
 };
 
 /**
@@ -1733,17 +1743,17 @@ namespace cache_policy {
 	/**
 	 * @brief A shortcut constant for all caching enabled for use in dpp::cluster constructor
 	 */
-	inline constexpr cache_policy_t cpol_default = { cp_aggressive, cp_aggressive, cp_aggressive, cp_aggressive, cp_aggressive };
+	inline constexpr cache_policy_t cpol_default = { cp_aggressive, cp_aggressive, cp_aggressive, cp_aggressive, cp_aggressive, cp_aggressive };
 
 	/**
 	 * @brief A shortcut constant for a more balanced caching policy for use in dpp::cluster constructor
 	 */
-	inline constexpr cache_policy_t cpol_balanced = { cp_lazy, cp_lazy, cp_lazy, cp_aggressive, cp_aggressive };
+	inline constexpr cache_policy_t cpol_balanced = { cp_lazy, cp_lazy, cp_lazy, cp_aggressive, cp_aggressive, cp_lazy };
 
 	/**
 	 * @brief A shortcut constant for all caching disabled for use in dpp::cluster constructor
 	 */
-	inline constexpr cache_policy_t cpol_none = { cp_none, cp_none, cp_none, cp_none, cp_none };
+	inline constexpr cache_policy_t cpol_none = { cp_none, cp_none, cp_none, cp_none, cp_none, cp_none };
 
 };
 
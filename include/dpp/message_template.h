@@ -0,0 +1,310 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <dpp/snowflake.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace dpp {
+
+struct message;
+class message_template;
+
+/**
+ * @brief Values for the slots of a dpp::message_template, from dpp::message_template::args.
+ * Slots can be set by name or, faster, by the index from dpp::message_template::slot.
+ * Slots which are not set are rendered as an empty string.
+ */
+class DPP_EXPORT template_args {
+	friend class message_template;
+
+	/**
+	 * @brief Slot indexes by name, shared with the template
+	 */
+	std::shared_ptr<const std::unordered_map<std::string, size_t>> names;
+
+	/**
+	 * @brief Rendered value of each slot: JSON string content, without quotes, or a bare number
+	 */
+	std::vector<std::string> values;
+
+	/**
+	 * @brief True for slots holding a number, which is written without quotes in a raw slot
+	 */
+	std::vector<bool> numeric;
+
+	/**
+	 * @brief Construct for a template's slots
+	 */
+	explicit template_args(std::shared_ptr<const std::unordered_map<std::string, size_t>> slot_names);
+
+	/**
+	 * @brief Find a slot by name
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	size_t index_of(const std::string& name) const;
+
+	/**
+	 * @brief Set a slot to a signed whole number
+	 */
+	template_args& set_integer(size_t slot, int64_t number);
+
+	/**
+	 * @brief Set a slot to an unsigned whole number
+	 */
+	template_args& set_integer(size_t slot, uint64_t number);
+
+	/**
+	 * @brief Integer types accepted as numbers. bool and char are not, as they are rarely meant as one.
+	 */
+	template <typename N>
+	static constexpr bool is_number_v = std::is_integral_v<N> && !std::is_same_v<N, bool> && !std::is_same_v<N, char>;
+
+public:
+	/**
+	 * @brief Set a slot to text, which is JSON escaped
+	 * @param slot Slot index
+	 * @param text Text
+	 * @return template_args& reference to self
+	 */
+	template_args& set(size_t slot, std::string_view text);
+
+	/**
+	 * @brief Set a slot to text, which is JSON escaped
+	 * @param slot Slot index
+	 * @param text Text
+	 * @return template_args& reference to self
+	 */
+	template_args& set(size_t slot, const std::string& text);
+
+	/**
+	 * @brief Set a slot to a whole number, of any integer type
+	 * @param slot Slot index
+	 * @param number Number
+	 * @return template_args& reference to self
+	 */
+	template <typename N, std::enable_if_t<is_number_v<N>, int> = 0>
+	template_args& set(size_t slot, N number) {
+		if constexpr (std::is_signed_v<N>) {
+			return set_integer(slot, static_cast<int64_t>(number));
+		} else {
+			return set_integer(slot, static_cast<uint64_t>(number));
+		}
+	}
+
+	/**
+	 * @brief Set a slot to a number
+	 * @param slot Slot index
+	 * @param number Number
+	 * @return template_args& reference to self
+	 */
+	template_args& set(size_t slot, double number);
+
+	/**
+	 * @brief Set a slot to a snowflake, written as a string of digits as Discord expects
+	 * @param slot Slot index
+	 * @param id Snowflake
+	 * @return template_args& reference to self
+	 */
+	template_args& set(size_t slot, snowflake id);
+
+	/**
+	 * @brief Set a slot to a timestamp, written in ISO 8601 form as used by embed timestamps
+	 * @param slot Slot index
+	 * @param timestamp Timestamp
+	 * @return template_args& reference to self
+	 */
+	template_args& set_timestamp(size_t slot, time_t timestamp);
+
+	/**
+	 * @brief Set a slot to text, which is JSON escaped
+	 * @param name Slot name
+	 * @param text Text
+	 * @return template_args& reference to self
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	template_args& set(const std::string& name, std::string_view text);
+
+	/**
+	 * @brief Set a slot to text, which is JSON escaped
+	 * @param name Slot name
+	 * @param text Text
+	 * @return template_args& reference to self
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	template_args& set(const std::string& name, const char* text);
+
+	/**
+	 * @brief Set a slot to text, which is JSON escaped
+	 * @param name Slot name
+	 * @param text Text
+	 * @return template_args& reference to self
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	template_args& set(const std::string& name, const std::string& text);
+
+	/**
+	 * @brief Set a slot to a whole number, of any integer type
+	 * @param name Slot name
+	 * @param number Number
+	 * @return template_args& reference to self
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	template <typename N, std::enable_if_t<is_number_v<N>, int> = 0>
+	template_args& set(const std::string& name, N number) {
+		return set(index_of(name), number);
+	}
+
+	/**
+	 * @brief Set a slot to a number
+	 * @param name Slot name
+	 * @param number Number
+	 * @return template_args& reference to self
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	template_args& set(const std::string& name, double number);
+
+	/**
+	 * @brief Set a slot to a snowflake, written as a string of digits as Discord expects
+	 * @param name Slot name
+	 * @param id Snowflake
+	 * @return template_args& reference to self
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	template_args& set(const std::string& name, snowflake id);
+
+	/**
+	 * @brief Set a slot to a timestamp, written in ISO 8601 form as used by embed timestamps
+	 * @param name Slot name
+	 * @param timestamp Timestamp
+	 * @return template_args& reference to self
+	 * @throw dpp::logic_exception if the template has no such slot
+	 */
+	template_args& set_timestamp(const std::string& name, time_t timestamp);
+};
+
+/**
+ * @brief A dpp::message serialised once into JSON with named slots, for messages which are sent over and
+ * over with only a few values changing, such as leaderboards or welcome messages.
+ *
+ * Slots are written as `{{name}}` anywhere in the message's text: content, embed titles, descriptions,
+ * fields, footers, URLs and so on. Each send fills the slots into the serialised JSON instead of building
+ * and serialising the message again. Values are always written inside the string the slot is in, so a
+ * number set on a field value is still sent as the string Discord expects.
+ *
+ * For JSON compiled directly, a string which is exactly `"{{#name}}"` is a raw slot, replaced whole: a
+ * number set on it is written as a bare JSON number, e.g. `"color":"{{#colour}}"`.
+ *
+ * ```cpp
+ * dpp::message_template welcome(dpp::message().add_embed(dpp::embed().set_title("Welcome {{name}}!").set_description("You are member #{{count}}")));
+ * auto args = welcome.args();
+ * args.set("name", member.get_user()->global_name).set("count", guild->member_count);
+ * bot.message_template_send(welcome, channel_id, args);
+ * ```
+ *
+ * @note Files attached to the message are not part of the template.
+ */
+class DPP_EXPORT message_template {
+	/**
+	 * @brief A slot in the serialised JSON
+	 */
+	struct slot_ref {
+		/**
+		 * @brief Slot index
+		 */
+		size_t index;
+
+		/**
+		 * @brief True for a raw slot which is a whole JSON string, whose quotes are left out of the literals
+		 */
+		bool whole;
+	};
+
+	/**
+	 * @brief Serialised JSON around the slots. There is one more literal than there are slot references.
+	 */
+	std::vector<std::string> literals;
+
+	/**
+	 * @brief Slot references, each following the literal of the same index
+	 */
+	std::vector<slot_ref> refs;
+
+	/**
+	 * @brief Slot indexes by name
+	 */
+	std::shared_ptr<const std::unordered_map<std::string, size_t>> names;
+
+	/**
+	 * @brief Total length of the literals
+	 */
+	size_t literal_length;
+
+public:
+	/**
+	 * @brief Compile a message into a template
+	 * @param m Message containing `{{name}}` slots
+	 */
+	explicit message_template(const message& m);
+
+	/**
+	 * @brief Compile serialised message JSON, e.g. from dpp::message::build_json, into a template
+	 * @param json Message JSON containing `{{name}}` slots
+	 */
+	explicit message_template(const std::string& json);
+
+	/**
+	 * @brief Get an empty set of values for this template's slots
+	 * @return template_args values, all unset
+	 */
+	template_args args() const;
+
+	/**
+	 * @brief Get the index of a slot, for setting it without a name lookup
+	 * @param name Slot name
+	 * @return size_t index
+	 * @throw dpp::logic_exception if there is no such slot
+	 */
+	size_t slot(const std::string& name) const;
+
+	/**
+	 * @brief Get the number of distinct slots
+	 * @return size_t count
+	 */
+	size_t slot_count() const;
+
+	/**
+	 * @brief Fill the slots in
+	 * @param values Values for the slots, from args()
+	 * @return std::string Message JSON, ready to post
+	 */
+	std::string render(const template_args& values) const;
+};
+
+} // namespace dpp
@@ -27,8 +27,10 @@
 #include <map>
 #include <thread>
 #include <shared_mutex>
+#include <mutex>
 #include <vector>
 #include <functional>
+#include <memory>
 #include <condition_variable>
 
 namespace dpp {
@@ -385,9 +387,116 @@ struct DPP_EXPORT bucket_t {
 	 * @brief Timestamp this buckets counters were updated.
 	 */
 	time_t timestamp;
+
+	/**
+	 * @brief Discord's identifier for the bucket, shared by every route with the same limit.
+	 */
+	std::string bucket;
 };
 
 
+/**
+ * @brief Coordinates Discord's global REST rate limit between several request queues,
+ * which may live in different processes on the same host.
+ *
+ * Discord applies one global limit (around 50 requests per second) to every request
+ * made with a bot token, no matter how many processes share that token. When several
+ * dpp::cluster processes run on one token each one only knows about its own traffic,
+ * so together they overshoot the limit. A global_ratelimiter attached to each cluster's
+ * request_queue is consulted before every request to Discord, and is told whenever Discord
+ * replies with a global 429, so that every participant backs off at once.
+ *
+ * Derive from this class to coordinate over some other transport (e.g. a local daemon),
+ * or use dpp::shm_global_ratelimiter which keeps its state in POSIX shared memory.
+ */
+class DPP_EXPORT global_ratelimiter {
+public:
+	/**
+	 * @brief Destroy the global ratelimiter object
+	 */
+	virtual ~global_ratelimiter() = default;
+
+	/**
+	 * @brief Try to reserve one request from the global limit.
+	 * Called from the request threads immediately before a request is sent to Discord.
+	 *
+	 * @return uint64_t Zero if a request was reserved and may be sent now, otherwise
+	 * the number of milliseconds to wait before calling this method again.
+	 */
+	virtual uint64_t acquire() = 0;
+
+	/**
+	 * @brief Publish a global rate limit received from Discord to every participant.
+	 * No participant will be able to acquire a request until the limit has expired.
+	 *
+	 * @param retry_after_ms Milliseconds until the global rate limit expires
+	 */
+	virtual void set_global_limit(uint64_t retry_after_ms) = 0;
+};
+
+/**
+ * @brief A dpp::global_ratelimiter which keeps its state in a named POSIX shared memory
+ * segment, so that every process opening the same name shares one global limit.
+ *
+ * The shared state is a token bucket refilled once per second, plus the time at which the
+ * most recent global 429 expires. Both are updated with lock-free atomic operations, so a
+ * process which dies mid-request can never leave the other processes deadlocked.
+ *
+ * Example, in each process running on the same bot token:
+ * ```cpp
+ * dpp::cluster bot(token);
+ * bot.get_rest()->set_global_ratelimiter(std::make_shared<dpp::shm_global_ratelimiter>("/dpp_mybot"));
+ * ```
+ *
+ * @note Only available on POSIX systems. On Windows the constructor throws dpp::rest_exception.
+ * @note The shared memory segment is not unlinked when the object is destroyed, as other processes
+ * may still be using it. Its contents are always valid, so a stale segment left over from a previous
+ * run is simply reused.
+ */
+class DPP_EXPORT shm_global_ratelimiter : public global_ratelimiter {
+private:
+	/**
+	 * @brief Mapped shared state, see queues.cpp
+	 */
+	struct shm_ratelimit_state* state;
+
+	/**
+	 * @brief Maximum requests per second shared between all participants
+	 */
+	uint32_t requests_per_second;
+
+public:
+	/**
+	 * @brief Open (creating if needed) a shared global rate limit segment
+	 *
+	 * @param name Name of the shared memory segment, which must start with a '/'. Every process
+	 * which should share a limit must use the same name, and processes using different bot
+	 * tokens should use different names.
+	 * @param requests_per_second Number of requests all participants may make between them each second.
+	 * Defaults to 45, leaving some headroom below Discord's global limit of 50.
+	 * @throw dpp::rest_exception if the shared memory segment could not be opened or mapped
+	 */
+	shm_global_ratelimiter(const std::string& name, uint32_t requests_per_second = 45);
+
+	/**
+	 * @brief Unmap the shared memory segment
+	 */
+	~shm_global_ratelimiter() override;
+
+	shm_global_ratelimiter(const shm_global_ratelimiter&) = delete;
+	shm_global_ratelimiter& operator=(const shm_global_ratelimiter&) = delete;
+
+	/**
+	 * @copydoc global_ratelimiter::acquire
+	 */
+	uint64_t acquire() override;
+
+	/**
+	 * @copydoc global_ratelimiter::set_global_limit
+	 */
+	void set_global_limit(uint64_t retry_after_ms) override;
+};
+
 /**
  * @brief Represents a thread in the thread pool handling requests to HTTP(S) servers.
  * There are several of these, the total defined by a constant in queues.cpp, and each
@@ -398,6 +507,11 @@ struct DPP_EXPORT bucket_t {
  */
 class DPP_EXPORT in_thread {
 private:
+	/**
+	 * @brief Required so request_queue can checkpoint and restore buckets
+	 */
+	friend class request_queue;
+
 	/**
 	 * @brief True if ending.
 	 */
@@ -433,6 +547,11 @@ private:
 	 */
 	std::map<std::string, bucket_t> buckets;
 
+	/**
+	 * @brief Protects buckets, which are read by rate limit checkpoints as well as this thread.
+	 */
+	std::mutex bucket_mutex;
+
 	/**
 	 * @brief Queue of requests to be made. Sorted by http_request::endpoint.
 	 */
@@ -603,6 +722,11 @@ protected:
 	 */
 	uint32_t in_thread_pool_size;
 
+	/**
+	 * @brief Optional coordinator for the global rate limit, shared with other request queues
+	 */
+	std::shared_ptr<global_ratelimiter> global_limiter;
+
 	/**
 	 * @brief Outbound queue thread loop
 	 */
@@ -654,6 +778,37 @@ public:
 	 * @return true if globally rate limited
 	 */
 	bool is_globally_ratelimited() const;
+
+	/**
+	 * @brief Share the global rate limit of this queue with other request queues, possibly in other processes.
+	 * Once set, every request thread asks the limiter for permission before making a request, and reports
+	 * any global 429 to it.
+	 * @note Set this before starting the cluster, and only on the queue returned by dpp::cluster::get_rest(),
+	 * as requests to sites other than Discord are not subject to Discord's global rate limit.
+	 * @param limiter Limiter to use, or nullptr to stop coordinating
+	 * @return reference to self
+	 */
+	request_queue& set_global_ratelimiter(std::shared_ptr<global_ratelimiter> limiter);
+
+	/**
+	 * @brief Get the rate limit state learned from Discord's responses, to save and restore on the
+	 * next start with restore_ratelimit_checkpoint. Only buckets whose limits have not reset yet are
+	 * included; once a bucket resets, the library needs nothing from it.
+	 * @return std::string JSON checkpoint
+	 */
+	std::string get_ratelimit_checkpoint();
+
+	/**
+	 * @brief Restore rate limit state saved by get_ratelimit_checkpoint, so requests made straight after
+	 * a restart are paced by the limits Discord still applies, instead of running into 429s to
+	 * learn them again. Buckets which have reset since the checkpoint was taken are skipped.
+	 * @note Call this before making any requests, as it replaces any buckets already learned for the
+	 * same routes. Restore only into a queue with the same token, as Discord's limits are per token.
+	 * @param checkpoint JSON from get_ratelimit_checkpoint
+	 * @return size_t Number of buckets restored
+	 * @throw dpp::rest_exception if the checkpoint is not valid JSON
+	 */
+	size_t restore_ratelimit_checkpoint(const std::string& checkpoint);
 };
 
 } // namespace dpp
@@ -0,0 +1,314 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <dpp/snowflake.h>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace dpp {
+
+/**
+ * @brief What a rate rule is counted against
+ */
+enum rate_scope : uint8_t {
+	/**
+	 * @brief Each user has their own limit
+	 */
+	rs_user = 0,
+
+	/**
+	 * @brief Each guild shares one limit
+	 */
+	rs_guild = 1,
+
+	/**
+	 * @brief Each channel shares one limit
+	 */
+	rs_channel = 2,
+
+	/**
+	 * @brief Everyone shares one limit
+	 */
+	rs_global = 3,
+};
+
+/**
+ * @brief How a rate rule counts
+ */
+enum rate_algorithm : uint8_t {
+	/**
+	 * @brief A bucket of `limit` tokens refilled evenly over `period`, allowing bursts of up to `limit`
+	 */
+	ra_token_bucket = 0,
+
+	/**
+	 * @brief At most `limit` uses in any `period`, estimated from the counts of the current and previous window
+	 */
+	ra_sliding_window = 1,
+};
+
+/**
+ * @brief A limit on how often something may happen, e.g. a command cooldown
+ */
+struct DPP_EXPORT rate_rule {
+	/**
+	 * @brief How uses are counted
+	 */
+	rate_algorithm algorithm{ra_token_bucket};
+
+	/**
+	 * @brief What uses are counted against. Callers use this to choose the key passed to
+	 * dpp::rate_controller::consume; dpp::commandhandler does so automatically.
+	 */
+	rate_scope scope{rs_user};
+
+	/**
+	 * @brief Uses allowed per period
+	 */
+	uint32_t limit{1};
+
+	/**
+	 * @brief Period in seconds
+	 */
+	double period{1.0};
+
+	/**
+	 * @brief A cooldown: one use, then none until the time has passed
+	 *
+	 * @param scope What the cooldown applies to
+	 * @param seconds Cooldown in seconds
+	 * @return rate_rule the rule
+	 */
+	static rate_rule cooldown(rate_scope scope, double seconds);
+
+	/**
+	 * @brief A token bucket, allowing bursts of up to limit uses refilled evenly over the period
+	 *
+	 * @param scope What the limit applies to
+	 * @param limit Bucket size
+	 * @param period Seconds to refill an empty bucket
+	 * @return rate_rule the rule
+	 */
+	static rate_rule token_bucket(rate_scope scope, uint32_t limit, double period);
+
+	/**
+	 * @brief A sliding window of at most limit uses in any period
+	 *
+	 * @param scope What the limit applies to
+	 * @param limit Uses per window
+	 * @param period Window length in seconds
+	 * @return rate_rule the rule
+	 */
+	static rate_rule sliding_window(rate_scope scope, uint32_t limit, double period);
+};
+
+/**
+ * @brief Identifies a rule added to a dpp::rate_controller
+ */
+typedef uint32_t rate_rule_id;
+
+/**
+ * @brief The answer to a dpp::rate_controller::consume call
+ */
+struct DPP_EXPORT rate_decision {
+	/**
+	 * @brief True if the use was allowed, and counted
+	 */
+	bool allowed{true};
+
+	/**
+	 * @brief If not allowed, seconds until the same use would be allowed
+	 */
+	double retry_after{0};
+};
+
+/**
+ * @brief Source of time for a dpp::rate_controller, in seconds
+ */
+typedef std::function<double()> rate_clock_t;
+
+/**
+ * @brief Cooldowns and flood control for commands and events.
+ *
+ * Rules are added once with add_rule, then every use is checked with consume(), which is O(1): one hash
+ * lookup and some arithmetic. State is kept per rule and key, where the key is a user, guild or channel ID
+ * depending on the rule's scope, and is striped across several independently locked tables so threads
+ * handling different keys rarely contend. A key's state is dropped as soon as it would be the same as
+ * a fresh one, found by a timing wheel which is advanced a little on every call, so unlike a map of last
+ * use times the memory used does not grow with every user ever seen. During a raid each extra use costs
+ * the same as the first.
+ *
+ * dpp::commandhandler::add_rate_limit attaches rules to commands. For events, wrap the handler with
+ * limit():
+ * @code{cpp}
+ * dpp::rate_controller flood;
+ * dpp::rate_rule_id per_user = flood.add_rule(dpp::rate_rule::sliding_window(dpp::rs_user, 5, 10));
+ * bot.on_message_create(flood.limit<dpp::message_create_t>(per_user,
+ * 	[](const dpp::message_create_t& event) { return event.msg.author.id; },
+ * 	[](const dpp::message_create_t& event) { ... }));
+ * @endcode
+ */
+class DPP_EXPORT rate_controller {
+	/**
+	 * @brief Internal state, kept out of the header
+	 */
+	struct state;
+
+	/**
+	 * @brief Rules, indexed by rate_rule_id
+	 */
+	std::vector<rate_rule> rules;
+
+	/**
+	 * @brief Protects rules
+	 */
+	mutable std::shared_mutex rules_mutex;
+
+	/**
+	 * @brief Per key state, striped
+	 */
+	std::unique_ptr<state> data;
+
+	/**
+	 * @brief Clock
+	 */
+	rate_clock_t clock;
+
+	/**
+	 * @brief Check, and optionally count, a use
+	 */
+	rate_decision evaluate(rate_rule_id rule, snowflake key, uint32_t cost, bool commit);
+
+public:
+	/**
+	 * @brief Construct a rate controller
+	 *
+	 * @param stripes Number of independently locked tables
+	 * @param clock Source of time in seconds, dpp::utility::time_f if not given. Tests can pass
+	 * their own to control time.
+	 */
+	explicit rate_controller(size_t stripes = 64, rate_clock_t clock = nullptr);
+
+	/**
+	 * @brief Destroy the rate controller
+	 */
+	~rate_controller();
+
+	rate_controller(const rate_controller&) = delete;
+	rate_controller& operator=(const rate_controller&) = delete;
+
+	/**
+	 * @brief Add a rule
+	 *
+	 * @param rule Rule
+	 * @return rate_rule_id ID to pass to consume()
+	 * @throw dpp::logic_exception if the rule's limit or period is zero or negative
+	 */
+	rate_rule_id add_rule(const rate_rule& rule);
+
+	/**
+	 * @brief Get a rule
+	 *
+	 * @param rule Rule ID
+	 * @return rate_rule a copy of the rule
+	 * @throw dpp::logic_exception if there is no such rule
+	 */
+	rate_rule get_rule(rate_rule_id rule) const;
+
+	/**
+	 * @brief Check a use against a rule and count it if it is allowed
+	 *
+	 * @param rule Rule ID
+	 * @param key User, guild or channel ID, per the rule's scope. Use 0 for rs_global.
+	 * @param cost Uses to count, normally 1. A cost above the rule's limit is never allowed.
+	 * @return rate_decision whether the use was allowed
+	 * @throw dpp::logic_exception if there is no such rule
+	 */
+	rate_decision consume(rate_rule_id rule, snowflake key, uint32_t cost = 1);
+
+	/**
+	 * @brief Check a use against several rules at once, and count it against all of them only if every one allows it.
+	 * The check and the count are one step, so two threads cannot both pass a limit with room for only one of them.
+	 *
+	 * @param uses Each rule with its key. Each rule should appear once.
+	 * @param cost Uses to count against each rule, normally 1
+	 * @return rate_decision whether the use was allowed, and if not the longest wait of the rules which refused it
+	 * @throw dpp::logic_exception if a rule does not exist
+	 */
+	rate_decision consume_all(const std::vector<std::pair<rate_rule_id, snowflake>>& uses, uint32_t cost = 1);
+
+	/**
+	 * @brief Check a use against a rule without counting it
+	 *
+	 * @param rule Rule ID
+	 * @param key User, guild or channel ID, per the rule's scope
+	 * @param cost Uses to check for
+	 * @return rate_decision whether the use would be allowed
+	 * @throw dpp::logic_exception if there is no such rule
+	 */
+	rate_decision peek(rate_rule_id rule, snowflake key, uint32_t cost = 1);
+
+	/**
+	 * @brief Forget the uses counted for a key, e.g. to lift a cooldown early
+	 *
+	 * @param rule Rule ID
+	 * @param key Key
+	 */
+	void reset(rate_rule_id rule, snowflake key);
+
+	/**
+	 * @brief Number of keys with state, which are the ones used recently enough to still be limited
+	 *
+	 * @return size_t number of keys
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Wrap an event handler so it is only called when a rule allows it.
+	 *
+	 * @note The rate controller must outlive the returned handler.
+	 * @tparam T Event type, e.g. dpp::message_create_t
+	 * @param rule Rule ID
+	 * @param key Returns the key to count the event against, e.g. the author's ID
+	 * @param handler Called for events which are allowed
+	 * @param limited Optional, called for events which are not
+	 * @return std::function<void(const T&)> handler to attach to the event router
+	 */
+	template <typename T>
+	std::function<void(const T&)> limit(rate_rule_id rule, std::function<snowflake(const T&)> key, std::function<void(const T&)> handler,
+		std::function<void(const T&, const rate_decision&)> limited = nullptr) {
+		return [this, rule, key = std::move(key), handler = std::move(handler), limited = std::move(limited)](const T& event) {
+			rate_decision decision = consume(rule, key(event));
+			if (decision.allowed) {
+				handler(event);
+			} else if (limited) {
+				limited(event, decision);
+			}
+		};
+	}
+};
+
+} // namespace dpp
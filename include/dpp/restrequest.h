@@ -87,6 +87,27 @@ template<> inline void rest_request<confirmation>(dpp::cluster* c, const char* b
 	});
 };
 
+/**
+ * @brief Templated REST request helper for typed results. The value is filled directly
+ * into the dpp::rest_result passed to the callback, without going through confirmation_callback_t.
+ *
+ * @tparam T type to return in lambda callback
+ * @param c calling cluster
+ * @param basepath base path for API call
+ * @param major major API function
+ * @param minor minor API function
+ * @param method HTTP method
+ * @param postdata Post data or empty string
+ * @param callback Callback lambda
+ */
+template<class T> inline void rest_request_typed(dpp::cluster* c, const char* basepath, const std::string &major, const std::string &minor, http_method method, const std::string& postdata, typed_completion_event_t<T> callback) {
+	c->post_rest(basepath, major, minor, method, postdata, [c, callback](json &j, const http_request_completion_t& http) {
+		if (callback) {
+			callback(rest_result<T>::from_response(c, j, http));
+		}
+	});
+};
+
 /**
  * @brief Templated REST request helper to save on typing (for returned lists)
  *  
@@ -330,6 +330,178 @@ struct DPP_EXPORT confirmation_callback_t {
  */
 typedef std::function<void(const confirmation_callback_t&)> command_completion_event_t;
 
+/**
+ * @brief Returns true if a REST response is an error
+ *
+ * @param http The HTTP metadata from the REST call
+ * @param body The parsed response body
+ * @return true if the status code is 4xx/5xx, or the body is a Discord error object
+ */
+bool DPP_EXPORT is_rest_error(const http_request_completion_t& http, const json& body);
+
+/**
+ * @brief Parse the error details from the body of a failed REST response
+ *
+ * @param http The HTTP metadata from the REST call
+ * @return error_info The details of the error message
+ */
+error_info DPP_EXPORT get_rest_error(const http_request_completion_t& http);
+
+/**
+ * @brief The result of a REST call which returns a single known type.
+ *
+ * This is the typed counterpart of confirmation_callback_t. Rather than a variant over every
+ * type the API can return, it holds either a T or an error_info, so the value is built in place
+ * and accessed without std::get. Methods which have a typed form take a typed_completion_event_t<T>
+ * callback, e.g. cluster::message_create_typed.
+ *
+ * @tparam T Type of the value returned on success
+ */
+template <typename T>
+class rest_result {
+	/**
+	 * @brief The value, or the error
+	 */
+	std::variant<T, error_info> result;
+
+public:
+	/**
+	 * @brief Information about the HTTP call used to make the request.
+	 */
+	http_request_completion_t http_info;
+
+	/**
+	 * @brief Construct a successful result
+	 *
+	 * @param value The value returned by the API
+	 * @param http The HTTP metadata from the REST call
+	 */
+	rest_result(T&& value, const http_request_completion_t& http) : result(std::in_place_index<0>, std::move(value)), http_info(http) {
+	}
+
+	/**
+	 * @brief Construct a failed result
+	 *
+	 * @param error The error returned by the API
+	 * @param http The HTTP metadata from the REST call
+	 */
+	rest_result(error_info&& error, const http_request_completion_t& http) : result(std::in_place_index<1>, std::move(error)), http_info(http) {
+	}
+
+	/**
+	 * @brief Build a result from a REST response, filling T directly from the parsed body
+	 *
+	 * @param creator Owning cluster, used as the owner of returned messages
+	 * @param j The parsed response body
+	 * @param http The HTTP metadata from the REST call
+	 * @return rest_result<T> The result
+	 */
+	static rest_result<T> from_response(class cluster* creator, json& j, const http_request_completion_t& http) {
+		if (is_rest_error(http, j)) {
+			return rest_result<T>(get_rest_error(http), http);
+		}
+		rest_result<T> r(T(), http);
+		T& value = std::get<0>(r.result);
+		if constexpr (std::is_same_v<T, message>) {
+			value.owner = creator;
+		}
+		value.fill_from_json(&j);
+		return r;
+	}
+
+	/**
+	 * @brief Returns true if the call resulted in an error
+	 */
+	bool is_error() const noexcept {
+		return result.index() == 1;
+	}
+
+	/**
+	 * @brief Returns true if the call succeeded and holds a value
+	 */
+	explicit operator bool() const noexcept {
+		return !is_error();
+	}
+
+	/**
+	 * @brief Get the error details
+	 *
+	 * @return const error_info& The error, or an empty error_info if the call succeeded
+	 */
+	const error_info& get_error() const noexcept {
+		static const error_info no_error{};
+		return is_error() ? std::get<1>(result) : no_error;
+	}
+
+	/**
+	 * @brief Get the value
+	 *
+	 * @return T& The value returned by the API
+	 * @throw dpp::rest_exception if the call resulted in an error
+	 */
+	T& value() & {
+		check();
+		return std::get<0>(result);
+	}
+
+	/**
+	 * @brief Get the value
+	 *
+	 * @return const T& The value returned by the API
+	 * @throw dpp::rest_exception if the call resulted in an error
+	 */
+	const T& value() const & {
+		check();
+		return std::get<0>(result);
+	}
+
+	/**
+	 * @brief Move the value out of the result
+	 *
+	 * @return T&& The value returned by the API
+	 * @throw dpp::rest_exception if the call resulted in an error
+	 */
+	T&& value() && {
+		check();
+		return std::get<0>(std::move(result));
+	}
+
+	/**
+	 * @brief Access the value. The result must not be an error.
+	 */
+	T* operator->() noexcept {
+		return std::get_if<0>(&result);
+	}
+
+	/**
+	 * @brief Access the value. The result must not be an error.
+	 */
+	const T* operator->() const noexcept {
+		return std::get_if<0>(&result);
+	}
+
+private:
+	/**
+	 * @brief Throw if the result is an error
+	 *
+	 * @throw dpp::rest_exception with the error code and message
+	 */
+	void check() const {
+		if (is_error()) {
+			const error_info& error = std::get<1>(result);
+			throw dpp::rest_exception((exception_error_code)error.code, error.message);
+		}
+	}
+};
+
+/**
+ * @brief A callback upon completion of a typed REST call
+ *
+ * @tparam T Type of the value returned on success
+ */
+template <typename T>
+using typed_completion_event_t = std::function<void(const rest_result<T>&)>;
+
 /**
  * @brief Automatically JSON encoded HTTP result
  */
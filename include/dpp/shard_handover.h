@@ -0,0 +1,131 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <dpp/snowflake.h>
+#include <dpp/json_fwd.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace dpp {
+
+/**
+ * @brief How a shard delivers the events it receives. Changed by dpp::cluster::reshard
+ * while a new set of shards takes over from the old one.
+ */
+enum shard_delivery : uint8_t {
+	/**
+	 * @brief Events are handled and dispatched as normal
+	 */
+	sd_dispatch = 0,
+
+	/**
+	 * @brief The shard belongs to a new shard set which is still connecting. Events other
+	 * than READY and RESUMED are dropped, the old shard set is still handling them.
+	 */
+	sd_standby = 1,
+
+	/**
+	 * @brief The shard belongs to the old shard set while both sets are connected. Each event
+	 * is handled unless its copy has already been handled from the new set.
+	 */
+	sd_handover = 2,
+
+	/**
+	 * @brief The shard belongs to an old shard set which is being closed. All events are dropped.
+	 */
+	sd_retired = 3,
+
+	/**
+	 * @brief The shard belongs to the new shard set while both sets are connected, or just after
+	 * the old set has retired. Each event is handled unless its copy has already been handled
+	 * from the old set. GUILD_CREATE for guilds listed in the shard's READY is dropped.
+	 */
+	sd_takeover = 4,
+};
+
+/**
+ * @brief Decides which events are handled while two shard sets are connected, see dpp::cluster::reshard.
+ *
+ * Both sets receive every event, but sequence numbers belong to a session so they cannot be used
+ * to match the copies. Instead each event handled from one set is kept, by name and payload, until
+ * the same event arrives from the other set and is dropped as its copy. Identical events which
+ * genuinely repeat are counted, so each is paired with its own copy rather than merged.
+ *
+ * The new set also receives a GUILD_CREATE for every guild in its READY, for guilds the old set
+ * already has. These are dropped until each listed guild has arrived once.
+ */
+class DPP_EXPORT shard_handover {
+	/**
+	 * @brief Protects all members below
+	 */
+	std::mutex lock;
+
+	/**
+	 * @brief Events handled from the old set whose copy has not yet arrived on the new set, with a count of each
+	 */
+	std::unordered_map<std::string, size_t> outgoing;
+
+	/**
+	 * @brief Events handled from the new set whose copy has not yet arrived on the old set, with a count of each
+	 */
+	std::unordered_map<std::string, size_t> incoming;
+
+	/**
+	 * @brief Guilds listed in the READY of each new shard, by shard id, whose GUILD_CREATE has not arrived yet
+	 */
+	std::unordered_map<uint32_t, std::unordered_set<snowflake>> bursts;
+
+	/**
+	 * @brief Number of guilds in all bursts
+	 */
+	std::atomic<size_t> burst_size{0};
+
+public:
+	/**
+	 * @brief Decide whether an event should be handled
+	 *
+	 * @param delivery Delivery mode of the shard the event arrived on
+	 * @param shard_id Id of the shard the event arrived on
+	 * @param event Event name, e.g. MESSAGE_CREATE
+	 * @param j Event payload
+	 * @return true if the event should be handled
+	 */
+	bool accept(shard_delivery delivery, uint32_t shard_id, const std::string& event, const json& j);
+
+	/**
+	 * @brief Check if every new shard has received the GUILD_CREATE for each guild in its READY
+	 *
+	 * @return true if no guilds are outstanding
+	 */
+	bool bursts_complete() const;
+
+	/**
+	 * @brief Forget all events and guilds, at the start and end of a reshard
+	 */
+	void clear();
+};
+
+} // namespace dpp
@@ -23,6 +23,7 @@
  ************************************************************************************/
 
 #pragma once
+#include <dpp/export.h>
 #include <string>
 #include <iomanip>
 #include <locale>
@@ -60,6 +61,24 @@ template <typename T> std::basic_string<T> uppercase(const std::basic_string<T>&
 	return s2;
 }
 
+/**
+ * @brief Convert a std::string to lowercase. Only A-Z are changed, which is what tolower() does in the
+ * "C" locale, and it is done a vector at a time by dpp::text::ascii_lowercase.
+ *
+ * @param s String to lowercase
+ * @return std::string lowercased string
+ */
+template <> DPP_EXPORT std::string lowercase<char>(const std::string& s);
+
+/**
+ * @brief Convert a std::string to uppercase. Only a-z are changed, which is what toupper() does in the
+ * "C" locale, and it is done a vector at a time by dpp::text::ascii_uppercase.
+ *
+ * @param s String to uppercase
+ * @return std::string uppercased string
+ */
+template <> DPP_EXPORT std::string uppercase<char>(const std::string& s);
+
 /**
  * @brief trim from end of string (right)
  * 
@@ -0,0 +1,194 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dpp {
+
+class discord_voice_client;
+
+/**
+ * @brief Callbacks and limits for a dpp::subprocess. The callbacks run on the shared subprocess I/O thread,
+ * so they should not block.
+ */
+struct DPP_EXPORT subprocess_options {
+	/**
+	 * @brief Called with each piece of standard output as it arrives
+	 */
+	std::function<void(std::string_view data)> on_stdout;
+
+	/**
+	 * @brief Called with each piece of standard error as it arrives. Unused if merge_stderr is set.
+	 */
+	std::function<void(std::string_view data)> on_stderr;
+
+	/**
+	 * @brief Called once the process has exited and all its output has been delivered, with its exit code,
+	 * or 128 plus the signal number if it was killed by a signal.
+	 * The exit code is -1 if the application ignores SIGCHLD, as the system then discards it.
+	 */
+	std::function<void(int exit_code)> on_exit;
+
+	/**
+	 * @brief Backpressure for standard output. While this returns false output is left in the pipe, so a
+	 * process which writes faster than it is consumed blocks instead of filling memory. It is asked again
+	 * every 20 milliseconds.
+	 */
+	std::function<bool()> ready_for_stdout;
+
+	/**
+	 * @brief Kill the process if it is still running after this long. Zero for no limit.
+	 */
+	std::chrono::milliseconds timeout{0};
+
+	/**
+	 * @brief Send standard error to on_stdout, interleaved with standard output
+	 */
+	bool merge_stderr = false;
+};
+
+/**
+ * @brief A child process started with posix_spawn, without a shell.
+ *
+ * Its standard output and error are read through non-blocking pipes by a single I/O thread shared by every
+ * subprocess, and delivered to the callbacks in dpp::subprocess_options as they arrive. Standard input is
+ * /dev/null. This is a handle: copies refer to the same process, and destroying it does not stop the process.
+ *
+ * @note Not available on Windows, where the constructor throws.
+ */
+class DPP_EXPORT subprocess {
+public:
+	/**
+	 * @brief State shared with the I/O thread
+	 */
+	struct state;
+
+private:
+	/**
+	 * @brief State shared with the I/O thread
+	 */
+	std::shared_ptr<state> process;
+
+public:
+	/**
+	 * @brief Start a process
+	 *
+	 * @param cmd Program to run, looked up in PATH if it contains no slash
+	 * @param parameters Arguments, passed as they are with no shell quoting or expansion
+	 * @param options Callbacks and limits
+	 * @throw dpp::exception if the process could not be started
+	 */
+	subprocess(const std::string& cmd, const std::vector<std::string>& parameters, subprocess_options options);
+
+	/**
+	 * @brief Get the process id
+	 * @return int64_t process id
+	 */
+	int64_t get_pid() const;
+
+	/**
+	 * @brief Check if the process is still running or has output left to deliver
+	 * @return true if on_exit has not been called yet
+	 */
+	bool running() const;
+
+	/**
+	 * @brief Send a signal to the process, if it is still running
+	 * @param signal Signal to send, SIGTERM by default
+	 */
+	void kill(int signal = 15);
+};
+
+/**
+ * @brief Plays the standard output of a process, such as ffmpeg, on a voice connection.
+ *
+ * The process must write 16 bit signed little endian stereo PCM at 48kHz, e.g. `ffmpeg -i input
+ * -f s16le -ar 48000 -ac 2 pipe:1`. Output is cut into frames of dpp::send_audio_raw_max_length bytes and
+ * passed to dpp::discord_voice_client::send_audio_raw as it arrives. Reading stops while more than the
+ * buffered number of seconds are queued on the voice connection, so the process is held back to the speed
+ * audio is sent at instead of being read into memory all at once.
+ */
+class DPP_EXPORT process_audio_source {
+	/**
+	 * @brief State shared with the subprocess callbacks
+	 */
+	struct shared_state;
+
+	/**
+	 * @brief State shared with the subprocess callbacks
+	 */
+	std::shared_ptr<shared_state> shared;
+
+	/**
+	 * @brief The process producing audio
+	 */
+	subprocess process;
+
+public:
+	/**
+	 * @brief Start a process and play its output
+	 *
+	 * @param vc Voice connection to play on. Call stop() before it is destroyed.
+	 * @param cmd Program to run
+	 * @param parameters Arguments for the program
+	 * @param buffer_secs Seconds of audio to keep queued on the voice connection
+	 * @param on_exit Called with the exit code once the process exits and all its audio has been queued
+	 * @throw dpp::exception if the process could not be started
+	 */
+	process_audio_source(discord_voice_client* vc, const std::string& cmd, const std::vector<std::string>& parameters, float buffer_secs = 2.0f, std::function<void(int exit_code)> on_exit = {});
+
+	/**
+	 * @brief Stops the process
+	 */
+	~process_audio_source();
+
+	/**
+	 * @brief dpp::process_audio_source is non-copyable
+	 */
+	process_audio_source(const process_audio_source&) = delete;
+
+	/**
+	 * @brief dpp::process_audio_source is non-copyable
+	 */
+	process_audio_source& operator=(const process_audio_source&) = delete;
+
+	/**
+	 * @brief Stop sending audio and kill the process. Audio already queued on the voice connection still plays.
+	 */
+	void stop();
+
+	/**
+	 * @brief Check if the process is still producing audio
+	 * @return true if it is running
+	 */
+	bool running() const;
+};
+
+} // namespace dpp
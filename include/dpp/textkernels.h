@@ -0,0 +1,93 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <dpp/export.h>
+#include <cstddef>
+
+/**
+ * @brief Vectorised scanning and transforming of text, behind the string helpers in dpp::utility,
+ * dpp::lowercase, dpp::uppercase and dpp::base64_encode.
+ *
+ * Like dpp::audio_mixer, the instruction set is chosen when the library is built, from the AVX_TYPE
+ * detected by cmake: AVX2 and AVX512 builds process 32 bytes at a time, AVX builds use the 16 byte
+ * SSE4 and SSSE3 instructions which come with it, and ARM64 builds use NEON for the ASCII kernels.
+ * Anything else uses plain loops. The results are identical on all of them.
+ */
+namespace dpp::text {
+
+/**
+ * @brief Get the instruction set the kernels were built for
+ * @return const char* "avx2", "sse", "neon" or "scalar"
+ */
+const char* DPP_EXPORT instruction_set();
+
+/**
+ * @brief Count the bytes below 0x80 at the start of a buffer
+ * @param data Buffer
+ * @param length Length of buffer
+ * @return size_t Number of leading ASCII bytes
+ */
+size_t DPP_EXPORT ascii_prefix(const char* data, size_t length);
+
+/**
+ * @brief Count the bytes at the start of a buffer which url encoding leaves as they are: A-Z, a-z, 0-9 and -_.~
+ * @param data Buffer
+ * @param length Length of buffer
+ * @return size_t Number of leading unreserved bytes
+ */
+size_t DPP_EXPORT url_safe_prefix(const char* data, size_t length);
+
+/**
+ * @brief Count the bytes at the start of a buffer which are not markdown syntax, i.e. none of \\*_|~[]()>`
+ * @param data Buffer
+ * @param length Length of buffer
+ * @return size_t Number of leading plain bytes
+ */
+size_t DPP_EXPORT markdown_plain_prefix(const char* data, size_t length);
+
+/**
+ * @brief Convert A-Z to a-z in place. Other bytes, including UTF-8 sequences, are left alone.
+ * @param data Buffer
+ * @param length Length of buffer
+ */
+void DPP_EXPORT ascii_lowercase(char* data, size_t length);
+
+/**
+ * @brief Convert a-z to A-Z in place. Other bytes, including UTF-8 sequences, are left alone.
+ * @param data Buffer
+ * @param length Length of buffer
+ */
+void DPP_EXPORT ascii_uppercase(char* data, size_t length);
+
+/**
+ * @brief Base64 encode as many whole blocks of input as the vector width allows, with no padding.
+ * The caller encodes the rest.
+ *
+ * @param in Input bytes
+ * @param length Length of input
+ * @param out Output, with room for 4 bytes per 3 bytes of input
+ * @return size_t Number of input bytes encoded, always a multiple of 3. 4/3 of this many bytes were written.
+ */
+size_t DPP_EXPORT base64_encode_blocks(const unsigned char* in, size_t length, char* out);
+
+} // namespace dpp::text
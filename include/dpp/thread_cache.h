@@ -0,0 +1,226 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+
+#pragma once
+#include <dpp/export.h>
+#include <dpp/snowflake.h>
+#include <dpp/thread.h>
+#include <unordered_map>
+#include <list>
+#include <optional>
+#include <shared_mutex>
+
+namespace dpp {
+
+/**
+ * @brief A cache of active threads, and optionally their member lists, kept up to date by the library
+ * from the gateway's thread events.
+ *
+ * Unlike the other caches, threads are stored by value and returned by copy, because archived and
+ * deleted threads are evicted as soon as Discord tells us about them, and when a maximum size is set
+ * the thread which has been quiet the longest is evicted to make room for a new one. A copy stays
+ * valid after its thread is evicted, but does not see later updates; call find() again for those.
+ *
+ * What is cached is controlled by dpp::cache_policy_t::thread_policy:
+ * - dpp::cp_aggressive caches threads and their members.
+ * - dpp::cp_lazy caches threads but not their members.
+ * - dpp::cp_none disables the thread cache.
+ *
+ * @note The member lists are only complete if your bot has the GUILD_MEMBERS intent,
+ * as without it Discord only sends thread member updates for the bot itself.
+ */
+class DPP_EXPORT thread_cache {
+private:
+	/**
+	 * @brief A cached thread and its members
+	 */
+	struct entry {
+		/**
+		 * @brief The thread itself
+		 */
+		thread t;
+
+		/**
+		 * @brief Known members of the thread, keyed by user id
+		 */
+		thread_member_map members;
+
+		/**
+		 * @brief Position of this thread in the activity list
+		 */
+		std::list<snowflake>::iterator activity;
+	};
+
+	/**
+	 * @brief Mutex to protect the cache
+	 */
+	mutable std::shared_mutex cache_mutex;
+
+	/**
+	 * @brief Cached threads by thread id
+	 */
+	std::unordered_map<snowflake, entry> threads;
+
+	/**
+	 * @brief Thread ids, most recently active first
+	 */
+	std::list<snowflake> activity;
+
+	/**
+	 * @brief Maximum number of threads to cache, or zero for no limit
+	 */
+	size_t max_threads;
+
+	/**
+	 * @brief Move a thread to the front of the activity list.
+	 * Cache mutex must be held for writing.
+	 * @param e Entry to touch
+	 */
+	void touch(entry& e);
+
+	/**
+	 * @brief Remove a thread by iterator.
+	 * Cache mutex must be held for writing.
+	 * @param i iterator of thread to remove
+	 */
+	void erase(std::unordered_map<snowflake, entry>::iterator i);
+
+public:
+	/**
+	 * @brief Construct a new, empty thread cache with no size limit
+	 */
+	thread_cache();
+
+	/**
+	 * @brief Set the maximum number of threads to cache.
+	 * If there are currently more than this many threads cached, the least recently active threads are evicted.
+	 * @param max Maximum number of threads, or zero for no limit
+	 * @return thread_cache& reference to self
+	 */
+	thread_cache& set_max_threads(size_t max);
+
+	/**
+	 * @brief Get the maximum number of threads cached
+	 * @return size_t maximum number of threads, or zero for no limit
+	 */
+	size_t get_max_threads() const;
+
+	/**
+	 * @brief Store or update a thread. Its cached member list is kept.
+	 * If the thread is archived it is removed from the cache instead.
+	 * @param t Thread to store
+	 */
+	void store(const thread& t);
+
+	/**
+	 * @brief Remove a thread from the cache
+	 * @param thread_id Thread to remove
+	 */
+	void remove(snowflake thread_id);
+
+	/**
+	 * @brief Remove all threads belonging to a guild
+	 * @param guild_id Guild whose threads should be removed
+	 */
+	void remove_guild(snowflake guild_id);
+
+	/**
+	 * @brief Remove the threads of a guild which are not in a list of known active threads.
+	 * Used when the gateway sends a complete list of active threads.
+	 * @param guild_id Guild the list belongs to
+	 * @param parent_ids If not empty, only threads whose parent is in this list are considered
+	 * @param active_ids The threads which are still active
+	 */
+	void retain_guild(snowflake guild_id, const std::vector<snowflake>& parent_ids, const std::vector<snowflake>& active_ids);
+
+	/**
+	 * @brief Add or update a thread member. Ignored if the thread is not cached.
+	 * @param member Thread member to store
+	 * @param is_current_user True if the member represents the bot itself, in which case thread::member is also updated
+	 */
+	void store_member(const thread_member& member, bool is_current_user = false);
+
+	/**
+	 * @brief Apply a thread members update. Ignored if the thread is not cached.
+	 * If the bot itself is added or removed, thread::member is updated or cleared to match.
+	 * @param thread_id Thread which was updated
+	 * @param member_count New approximate member count
+	 * @param added Members added to the thread
+	 * @param removed_ids User ids of members removed from the thread
+	 * @param current_user_id User id of the bot. If not set, the bot is recognised by the user id of thread::member
+	 */
+	void update_members(snowflake thread_id, uint8_t member_count, const std::vector<thread_member>& added, const std::vector<snowflake>& removed_ids, snowflake current_user_id = {});
+
+	/**
+	 * @brief Find a thread by id
+	 * @param thread_id Thread to find
+	 * @return std::optional<thread> A copy of the cached thread, if it is cached
+	 */
+	std::optional<thread> find(snowflake thread_id) const;
+
+	/**
+	 * @brief Get the cached members of a thread
+	 * @param thread_id Thread to get members for
+	 * @return thread_member_map A copy of the known members of the thread, empty if the thread is not cached
+	 */
+	thread_member_map get_members(snowflake thread_id) const;
+
+	/**
+	 * @brief Get all cached threads belonging to a guild
+	 * @param guild_id Guild to get threads for
+	 * @return thread_map Copies of the guild's cached threads
+	 */
+	thread_map get_guild_threads(snowflake guild_id) const;
+
+	/**
+	 * @brief Get the number of cached threads
+	 * @return uint64_t count of threads
+	 */
+	uint64_t count() const;
+
+	/**
+	 * @brief Empty the cache
+	 */
+	void clear();
+};
+
+/**
+ * @brief Get the library's thread cache
+ * @return thread_cache* The thread cache, which is created on first use
+ */
+DPP_EXPORT thread_cache* get_thread_cache();
+
+/**
+ * @brief Find a thread in the thread cache by id
+ * @param id Thread id to find
+ * @return std::optional<thread> A copy of the thread, or std::nullopt if it is not cached
+ */
+DPP_EXPORT std::optional<thread> find_thread(snowflake id);
+
+/**
+ * @brief Get the number of cached threads
+ * @return uint64_t count of threads
+ */
+DPP_EXPORT uint64_t get_thread_count();
+
+} // namespace dpp
@@ -203,18 +203,19 @@ inline const std::string url_host = "https://discord.com";
 typedef std::function<void(const std::string& output)> cmd_result_t;
 
 /**
- * @brief Run a commandline program asynchronously. The command line program
- * is spawned in a separate std::thread, and when complete, its output from
- * stdout is passed to the callback function in its string parameter. For example:
+ * @brief Run a commandline program asynchronously. The program is started with
+ * dpp::subprocess, and when complete, its output from stdout and stderr is passed
+ * to the callback function in its string parameter. For example:
  * ```cpp
  * dpp::utility::exec("/bin/ls", {"-al"}, [](const std::string& output) {
  *     std::cout << "Output of 'ls -al': " << output << "\n";
  * });
  * ```
  * 
- * @param cmd The command to run.
- * @param parameters Command line parameters. Each will be escaped using `std::quoted`.
- * @param callback The callback to call on completion.
+ * @param cmd The command to run, looked up in PATH if it contains no slash. It is not run through a shell.
+ * @param parameters Command line parameters, passed to the program as they are.
+ * @param callback The callback to call on completion. If the program could not be started, it is called with the reason.
+ * @note To stream output as it arrives, set a timeout, or kill the program, use dpp::subprocess directly.
  */
 void DPP_EXPORT exec(const std::string& cmd, std::vector<std::string> parameters = {}, cmd_result_t callback = {});
 
@@ -22,6 +22,7 @@
 #pragma once
 #include <dpp/export.h>
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
 #include <variant>
@@ -125,6 +126,11 @@ class DPP_EXPORT websocket_client : public ssl_client {
 	 */
 	std::map<std::string, std::string> http_headers;
 
+	/**
+	 * @brief Payload bytes still to arrive of a frame being passed to handle_frame_data, 0 if there is none
+	 */
+	uint64_t stream_remaining;
+
 	/**
 	 * @brief Parse headers for a websocket frame from the buffer.
 	 * @param buffer The buffer to operate on. Will modify the string removing completed items from the head of the queue
@@ -178,10 +184,11 @@ public:
 	 * @param port Port to connect to
 	 * @param urlpath The URL path components of the HTTP request to send
 	 * @param opcode The encoding type to use, either OP_BINARY or OP_TEXT
+	 * @param plaintext_downgrade Connect without TLS, e.g. to a local server
 	 * @note Voice websockets only support OP_TEXT, and other websockets must be
 	 * OP_BINARY if you are going to send ETF.
 	 */
-        websocket_client(const std::string &hostname, const std::string &port = "443", const std::string &urlpath = "", ws_opcode opcode = OP_BINARY);
+        websocket_client(const std::string &hostname, const std::string &port = "443", const std::string &urlpath = "", ws_opcode opcode = OP_BINARY, bool plaintext_downgrade = false);
 
 	/**
 	 * @brief Destroy the websocket client object
@@ -213,6 +220,25 @@ public:
 	 */
 	virtual bool handle_frame(const std::string &buffer);
 
+	/**
+	 * @brief Get the payload size from which text and binary frames are passed to handle_frame_data piece
+	 * by piece as they arrive, instead of to handle_frame once complete, so that decoding a large frame can
+	 * overlap receiving it. The default of 0 never does this.
+	 *
+	 * @return size_t Payload size in bytes, or 0
+	 */
+	virtual size_t get_stream_threshold() const;
+
+	/**
+	 * @brief Receives the payload of a large frame as it arrives, see get_stream_threshold.
+	 * The pieces of one frame are passed in order, and together are exactly its payload.
+	 *
+	 * @param chunk Payload received since the last call. Only valid during the call.
+	 * @param first True for the first piece of the frame
+	 * @param last True for the last piece of the frame
+	 */
+	virtual void handle_frame_data(std::string_view chunk, bool first, bool last);
+
 	/**
 	 * @brief Called upon error frame.
 	 * 
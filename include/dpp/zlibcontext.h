@@ -0,0 +1,90 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <dpp/exception.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dpp {
+
+/**
+ * @brief This is an opaque struct containing the zlib stream.
+ * We define it this way so that the public facing D++ library doesn't require
+ * the zlib headers be available to build against it.
+ */
+struct zlib_stream;
+
+/**
+ * @brief Inflates a zlib-stream websocket connection.
+ *
+ * Discord compresses every message on a connection as one stream, ending each message with a
+ * Z_SYNC_FLUSH. Input must be passed in order, but may be split anywhere, including within a
+ * message or its flush marker.
+ */
+class DPP_EXPORT zlibcontext {
+	/**
+	 * @brief The zlib stream
+	 */
+	std::unique_ptr<zlib_stream> stream;
+
+	/**
+	 * @brief Output buffer for inflate
+	 */
+	std::vector<unsigned char> buffer;
+
+	/**
+	 * @brief Last four bytes of input, which are 00 00 FF FF at the end of each message
+	 */
+	uint32_t tail;
+
+public:
+	/**
+	 * @brief Start a new stream
+	 * @throw dpp::connection_exception if zlib cannot be initialised
+	 */
+	zlibcontext();
+
+	/**
+	 * @brief End the stream
+	 */
+	~zlibcontext();
+
+	/**
+	 * @brief Inflate the next part of the stream
+	 * @param input Compressed input
+	 * @param decompressed Decompressed output is appended to this string
+	 * @return err_no_code_specified on success, or one of the err_compression_* codes if the stream failed
+	 */
+	exception_error_code decompress(std::string_view input, std::string& decompressed);
+
+	/**
+	 * @brief Check if the input so far ends a message
+	 * @return true if the last input was the end of a message
+	 */
+	bool message_complete() const;
+};
+
+} // namespace dpp
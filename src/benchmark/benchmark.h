@@ -0,0 +1,95 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace benchmark {
+
+/**
+ * @brief One measurement: a baseline implementation and the library's, run over the same input
+ */
+struct comparison {
+	/**
+	 * @brief Name shown in the report
+	 */
+	std::string name;
+
+	/**
+	 * @brief Bytes processed by one run, for the throughput columns
+	 */
+	size_t bytes;
+
+	/**
+	 * @brief The implementation being compared against
+	 */
+	std::function<void()> baseline;
+
+	/**
+	 * @brief The library's implementation
+	 */
+	std::function<void()> library;
+
+	/**
+	 * @brief Check both produce the same output. Run once before timing.
+	 */
+	std::function<bool()> verify;
+};
+
+/**
+ * @brief Group of comparisons, registered by each source file in this directory
+ */
+struct suite {
+	/**
+	 * @brief Name of the suite, used to select it on the command line
+	 */
+	std::string name;
+
+	/**
+	 * @brief Builds the comparisons. Called only when the suite is run.
+	 */
+	std::function<std::vector<comparison>()> build;
+
+	suite(const std::string& n, std::function<std::vector<comparison>()> b);
+};
+
+/**
+ * @brief Every registered suite
+ */
+std::vector<suite*>& suites();
+
+/**
+ * @brief Where results are sent so the optimiser cannot discard them
+ */
+extern const void* volatile sink;
+
+/**
+ * @brief Stops the optimiser discarding a result
+ */
+template <typename T> void keep(const T& value) {
+	sink = &value;
+}
+
+} // namespace benchmark
@@ -0,0 +1,115 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+/*
+ * Microbenchmarks comparing the library's hot paths with the plain implementations they
+ * replaced. Each comparison checks both produce the same output before it is timed.
+ *
+ *   benchmark [--seconds=F] [suite...]
+ *
+ * Exits with 1 if any comparison produced different output.
+ */
+
+#include "benchmark.h"
+#include <dpp/textkernels.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace benchmark {
+
+const void* volatile sink = nullptr;
+
+suite::suite(const std::string& n, std::function<std::vector<comparison>()> b) : name(n), build(std::move(b)) {
+	suites().push_back(this);
+}
+
+std::vector<suite*>& suites() {
+	static std::vector<suite*> registered;
+	return registered;
+}
+
+} // namespace benchmark
+
+namespace {
+
+/**
+ * @brief Run a function repeatedly for about the given time
+ * @return nanoseconds per run
+ */
+double time_of(const std::function<void()>& f, double seconds) {
+	using clock = std::chrono::steady_clock;
+	uint64_t runs = 0;
+	uint64_t batch = 1;
+	auto start = clock::now();
+	std::chrono::duration<double> elapsed{0};
+	while (elapsed.count() < seconds) {
+		for (uint64_t i = 0; i < batch; ++i) {
+			f();
+		}
+		runs += batch;
+		batch *= 2;
+		elapsed = clock::now() - start;
+	}
+	return elapsed.count() * 1e9 / static_cast<double>(runs);
+}
+
+}
+
+int main(int argc, char** argv) {
+	double seconds = 0.25;
+	std::vector<std::string> only;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg.rfind("--seconds=", 0) == 0) {
+			seconds = std::stod(arg.substr(10));
+		} else {
+			only.push_back(arg);
+		}
+	}
+
+	std::cout << "text kernels: " << dpp::text::instruction_set() << "\n\n";
+	std::cout << std::left << std::setw(36) << "benchmark" << std::right << std::setw(14) << "baseline ns" << std::setw(14) << "library ns"
+		<< std::setw(12) << "MB/s" << std::setw(10) << "speedup" << "\n";
+
+	bool mismatch = false;
+	for (auto* s : benchmark::suites()) {
+		if (!only.empty() && std::find(only.begin(), only.end(), s->name) == only.end()) {
+			continue;
+		}
+		for (auto& c : s->build()) {
+			std::string name = s->name + "/" + c.name;
+			if (c.verify && !c.verify()) {
+				std::cout << std::left << std::setw(36) << name << " OUTPUT DIFFERS\n";
+				mismatch = true;
+				continue;
+			}
+			double base = time_of(c.baseline, seconds);
+			double lib = time_of(c.library, seconds);
+			std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(14) << base << std::setw(14) << lib
+				<< std::setw(12) << (lib > 0 ? static_cast<double>(c.bytes) * 1e3 / lib : 0.0)
+				<< std::setw(9) << std::setprecision(2) << (lib > 0 ? base / lib : 0.0) << "x\n";
+		}
+	}
+	return mismatch ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+/*
+ * Cooldowns with dpp::rate_controller, against the map of last use times most bots keep.
+ */
+
+#include "benchmark.h"
+#include <dpp/dpp.h>
+#include <map>
+#include <memory>
+
+namespace {
+
+/**
+ * @brief A raid: this many users each using a command with a cooldown
+ */
+constexpr uint64_t raiders = 100000;
+
+struct map_cooldown {
+	std::map<dpp::snowflake, double> last_used;
+	double seconds;
+
+	bool consume(dpp::snowflake user, double now) {
+		auto i = last_used.find(user);
+		if (i != last_used.end() && now - i->second < seconds) {
+			return false;
+		}
+		last_used[user] = now;
+		return true;
+	}
+};
+
+std::vector<benchmark::comparison> rate_comparisons() {
+	std::vector<benchmark::comparison> list;
+	auto now = std::make_shared<double>(1000);
+	auto baseline = std::make_shared<map_cooldown>(map_cooldown{{}, 30});
+	auto limits = std::make_shared<dpp::rate_controller>(64, [now]() { return *now; });
+	const dpp::rate_rule_id cooldown = limits->add_rule(dpp::rate_rule::cooldown(dpp::rs_user, 30));
+	auto next = std::make_shared<uint64_t>(0);
+	/* Each run is one use by the next raider; every fourth is a repeat refused by the cooldown */
+	auto user = [next]() {
+		uint64_t n = (*next)++;
+		return dpp::snowflake((n % 4 == 3 ? n - 1 : n) % raiders + 1);
+	};
+	list.push_back({"cooldown/raid", sizeof(uint64_t),
+		[baseline, now, user] { benchmark::keep(baseline->consume(user(), *now)); },
+		[limits, cooldown, user] { benchmark::keep(limits->consume(cooldown, user()).allowed); },
+		[now] {
+			map_cooldown check_map{{}, 30};
+			dpp::rate_controller check_limits(64, [now]() { return *now; });
+			const dpp::rate_rule_id rule = check_limits.add_rule(dpp::rate_rule::cooldown(dpp::rs_user, 30));
+			for (uint64_t n = 0; n < 1000; ++n) {
+				dpp::snowflake id((n % 4 == 3 ? n - 1 : n) + 1);
+				if (check_map.consume(id, *now) != check_limits.consume(rule, id).allowed) {
+					return false;
+				}
+			}
+			return true;
+		}});
+	return list;
+}
+
+benchmark::suite rate_suite("rate", rate_comparisons);
+
+}
@@ -0,0 +1,71 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+/*
+ * Message templates, against building and serialising the same message for every send.
+ */
+
+#include "benchmark.h"
+#include <dpp/dpp.h>
+#include <memory>
+
+namespace {
+
+dpp::message build(const std::string& name, int64_t score, time_t when) {
+	dpp::message m(0, "Well done " + name + ", your score is now " + std::to_string(score));
+	m.add_embed(dpp::embed()
+		.set_title("Leaderboard update for " + name)
+		.set_description("A new high score was posted")
+		.set_color(0x5865f2)
+		.add_field("Player", name, true)
+		.add_field("Score", std::to_string(score), true)
+		.set_footer(dpp::embed_footer().set_text("Posted by the scoreboard"))
+		.set_timestamp(when));
+	return m;
+}
+
+std::vector<benchmark::comparison> template_comparisons() {
+	std::vector<benchmark::comparison> list;
+	/* The score and timestamp are numbers in build(), so their slots are spliced into its JSON */
+	const time_t placeholder = 946684800;
+	std::string json = build("{{name}}", 0, placeholder).build_json();
+	json.replace(json.find("your score is now 0"), 19, "your score is now {{score}}");
+	json.replace(json.find("\"value\":\"0\""), 11, "\"value\":\"{{score}}\"");
+	json.replace(json.find(dpp::ts_to_string(placeholder)), dpp::ts_to_string(placeholder).length(), "{{when}}");
+	auto t = std::make_shared<dpp::message_template>(json);
+	const std::string name = "Bob \"the builder\"";
+	const int64_t score = 123456;
+	const time_t when = 1700000000;
+	auto values = std::make_shared<dpp::template_args>(t->args());
+	values->set("name", name).set("score", score).set_timestamp("when", when);
+	list.push_back({"message/embed", json.length(),
+		[name, score, when] { benchmark::keep(build(name, score, when).build_json()); },
+		[t, values] { benchmark::keep(t->render(*values)); },
+		[t, values, name, score, when] {
+			return dpp::json::parse(build(name, score, when).build_json()) == dpp::json::parse(t->render(*values));
+		}});
+	return list;
+}
+
+benchmark::suite templates_suite("templates", template_comparisons);
+
+}
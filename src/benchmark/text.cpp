@@ -0,0 +1,177 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+/*
+ * The string helpers backed by dpp::text, against the byte at a time loops they replaced.
+ */
+
+#include "benchmark.h"
+#include <dpp/dpp.h>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+/* Mostly ASCII chat text with some markdown, punctuation and multi-byte UTF-8 */
+std::string sample(size_t length, uint32_t seed) {
+	static const char* words[] = {"hello", "world", "the", "quick", "brown", "fox", "**bold**", "_it_", "`code`", "ünïcödé", "emoji 😀", "url?a=b&c=d", "Discord", "BOT", "\n"};
+	std::mt19937 rng(seed);
+	std::string s;
+	while (s.length() < length) {
+		s += words[rng() % (sizeof(words) / sizeof(*words))];
+		s += ' ';
+	}
+	s.resize(length);
+	return s;
+}
+
+/* Long unreserved runs split by the odd slash, like file names and tokens in URLs */
+std::string identifiers(size_t length, uint32_t seed) {
+	static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+	std::mt19937 rng(seed);
+	std::string s;
+	while (s.length() < length) {
+		s += (rng() % 80 == 0) ? '/' : chars[rng() % 64];
+	}
+	return s;
+}
+
+size_t old_utf8len(std::string_view str) {
+	size_t pos = 0, code_points = 0;
+	while (pos != str.length()) {
+		const unsigned char cur = str[pos];
+		size_t code_point_len = 1 + (cur >= 0b11000000) + (cur >= 0b11100000) + (cur >= 0b11110000);
+		if (str.length() - pos < code_point_len) {
+			return 0;
+		}
+		pos += code_point_len;
+		code_points++;
+	}
+	return code_points;
+}
+
+std::string old_url_encode(const std::string& value) {
+	static const char* hex = "0123456789ABCDEF";
+	std::string escaped(value.length() * 3, '\0');
+	char* data = escaped.data();
+	for (unsigned char c : value) {
+		if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+			*data++ = c;
+		} else {
+			*data++ = '%';
+			*data++ = hex[c >> 4];
+			*data++ = hex[c & 0x0f];
+		}
+	}
+	escaped.resize(data - escaped.data());
+	return escaped;
+}
+
+std::string old_markdown_escape(const std::string& text) {
+	enum { md_normal, md_big_code_block, md_small_code_block } state = md_normal;
+	std::string output;
+	const std::string markdown_chars("\\*_|~[]()>");
+	for (size_t n = 0; n < text.length(); ++n) {
+		if (text.substr(n, 3) == "```") {
+			output += "```";
+			n += 2;
+			state = (state == md_normal) ? md_big_code_block : md_normal;
+		} else if (text[n] == '`' && state != md_big_code_block) {
+			output += "`";
+			state = (state == md_normal) ? md_small_code_block : md_normal;
+		} else {
+			if (state == md_normal && markdown_chars.find(text[n]) != std::string::npos) {
+				output += "\\";
+			}
+			output += text[n];
+		}
+	}
+	return output;
+}
+
+std::string old_lowercase(const std::string& s) {
+	std::string s2 = s;
+	std::transform(s2.begin(), s2.end(), s2.begin(), tolower);
+	return s2;
+}
+
+std::string old_base64(const unsigned char* buf, size_t length) {
+	static const char* to_base64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string ret;
+	size_t i = 0;
+	for (; i + 3 <= length; i += 3) {
+		ret.push_back(to_base64[buf[i] >> 2]);
+		ret.push_back(to_base64[((buf[i] & 0x03) << 4) | (buf[i + 1] >> 4)]);
+		ret.push_back(to_base64[((buf[i + 1] & 0x0f) << 2) | (buf[i + 2] >> 6)]);
+		ret.push_back(to_base64[buf[i + 2] & 0x3f]);
+	}
+	if (length - i == 1) {
+		ret.push_back(to_base64[buf[i] >> 2]);
+		ret.push_back(to_base64[(buf[i] & 0x03) << 4]);
+		ret += "==";
+	} else if (length - i == 2) {
+		ret.push_back(to_base64[buf[i] >> 2]);
+		ret.push_back(to_base64[((buf[i] & 0x03) << 4) | (buf[i + 1] >> 4)]);
+		ret.push_back(to_base64[(buf[i + 1] & 0x0f) << 2]);
+		ret += "=";
+	}
+	return ret;
+}
+
+std::vector<benchmark::comparison> text_comparisons() {
+	std::vector<benchmark::comparison> list;
+	for (size_t length : {64, 2000, 65536}) {
+		auto text = std::make_shared<std::string>(sample(length, static_cast<uint32_t>(length)));
+		std::string suffix = "/" + std::to_string(length);
+		list.push_back({"utf8len" + suffix, length,
+			[text] { benchmark::keep(old_utf8len(*text)); },
+			[text] { benchmark::keep(dpp::utility::utf8len(*text)); },
+			[text] { return old_utf8len(*text) == dpp::utility::utf8len(*text); }});
+		list.push_back({"url_encode" + suffix, length,
+			[text] { benchmark::keep(old_url_encode(*text)); },
+			[text] { benchmark::keep(dpp::utility::url_encode(*text)); },
+			[text] { return old_url_encode(*text) == dpp::utility::url_encode(*text); }});
+		auto ids = std::make_shared<std::string>(identifiers(length, static_cast<uint32_t>(length)));
+		list.push_back({"url_encode_ids" + suffix, length,
+			[ids] { benchmark::keep(old_url_encode(*ids)); },
+			[ids] { benchmark::keep(dpp::utility::url_encode(*ids)); },
+			[ids] { return old_url_encode(*ids) == dpp::utility::url_encode(*ids); }});
+		list.push_back({"markdown_escape" + suffix, length,
+			[text] { benchmark::keep(old_markdown_escape(*text)); },
+			[text] { benchmark::keep(dpp::utility::markdown_escape(*text)); },
+			[text] { return old_markdown_escape(*text) == dpp::utility::markdown_escape(*text); }});
+		list.push_back({"lowercase" + suffix, length,
+			[text] { benchmark::keep(old_lowercase(*text)); },
+			[text] { benchmark::keep(dpp::lowercase(*text)); },
+			[text] { return old_lowercase(*text) == dpp::lowercase(*text); }});
+		auto bytes = reinterpret_cast<const unsigned char*>(text->data());
+		list.push_back({"base64_encode" + suffix, length,
+			[text, bytes] { benchmark::keep(old_base64(bytes, text->length())); },
+			[text, bytes] { benchmark::keep(dpp::base64_encode(bytes, static_cast<unsigned int>(text->length()))); },
+			[text, bytes] { return old_base64(bytes, text->length()) == dpp::base64_encode(bytes, static_cast<unsigned int>(text->length())); }});
+	}
+	return list;
+}
+
+benchmark::suite text_suite("text", text_comparisons);
+
+}
@@ -0,0 +1,170 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/alloc_profile.h>
+#include <dpp/utility.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace dpp {
+
+namespace {
+
+constexpr const char* subsystem_names[as_count] = {"other", "decode", "events", "cache", "rest", "voice"};
+
+}
+
+#ifdef DPP_ALLOC_PROFILING
+
+thread_local alloc_subsystem current_alloc_subsystem = as_other;
+
+namespace {
+
+/**
+ * @brief Counters updated by every allocation. Zero initialised before any constructor runs,
+ * so allocations made during static initialisation are counted too.
+ */
+struct atomic_counters {
+	std::atomic<int64_t> live_bytes;
+	std::atomic<int64_t> peak_bytes;
+	std::atomic<uint64_t> allocations;
+	std::atomic<uint64_t> allocated_bytes;
+};
+
+atomic_counters counters[as_count];
+
+/**
+ * @brief Placed in front of every block, so it can be counted against the right subsystem when freed
+ */
+struct block_header {
+	size_t size;
+	alloc_subsystem subsystem;
+};
+
+/**
+ * @brief Size of the header, rounded up so the block after it keeps malloc's alignment
+ */
+constexpr size_t header_size = (sizeof(block_header) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+void* counted_alloc(size_t size) {
+	auto* header = static_cast<block_header*>(std::malloc(size + header_size));
+	if (!header) {
+		return nullptr;
+	}
+	header->size = size;
+	header->subsystem = current_alloc_subsystem;
+	atomic_counters& c = counters[header->subsystem];
+	c.allocations.fetch_add(1, std::memory_order_relaxed);
+	c.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	const int64_t live = c.live_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+	int64_t peak = c.peak_bytes.load(std::memory_order_relaxed);
+	while (live > peak && !c.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+	}
+	return reinterpret_cast<char*>(header) + header_size;
+}
+
+void counted_free(void* p) noexcept {
+	if (!p) {
+		return;
+	}
+	auto* header = reinterpret_cast<block_header*>(static_cast<char*>(p) - header_size);
+	counters[header->subsystem].live_bytes.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+	std::free(header);
+}
+
+}
+
+alloc_profile get_alloc_profile() {
+	alloc_profile profile;
+	profile.enabled = true;
+	profile.time = utility::time_f();
+	for (size_t i = 0; i < as_count; ++i) {
+		profile.subsystems[i].live_bytes = counters[i].live_bytes.load(std::memory_order_relaxed);
+		profile.subsystems[i].peak_bytes = counters[i].peak_bytes.load(std::memory_order_relaxed);
+		profile.subsystems[i].allocations = counters[i].allocations.load(std::memory_order_relaxed);
+		profile.subsystems[i].allocated_bytes = counters[i].allocated_bytes.load(std::memory_order_relaxed);
+	}
+	return profile;
+}
+
+#else
+
+alloc_profile get_alloc_profile() {
+	alloc_profile profile;
+	profile.time = utility::time_f();
+	return profile;
+}
+
+#endif
+
+const char* alloc_subsystem_name(alloc_subsystem subsystem) {
+	return subsystem < as_count ? subsystem_names[subsystem] : "unknown";
+}
+
+double alloc_profile::allocation_rate(const alloc_profile& earlier, alloc_subsystem subsystem) const {
+	const double elapsed = time - earlier.time;
+	return elapsed > 0 ? static_cast<double>(subsystems[subsystem].allocations - earlier.subsystems[subsystem].allocations) / elapsed : 0;
+}
+
+double alloc_profile::byte_rate(const alloc_profile& earlier, alloc_subsystem subsystem) const {
+	const double elapsed = time - earlier.time;
+	return elapsed > 0 ? static_cast<double>(subsystems[subsystem].allocated_bytes - earlier.subsystems[subsystem].allocated_bytes) / elapsed : 0;
+}
+
+} // namespace dpp
+
+#ifdef DPP_ALLOC_PROFILING
+
+/* The replaceable global allocation functions. Every other form of new and delete, other than the
+ * over-aligned ones which are left alone, is defined by the standard library in terms of these.
+ */
+
+void* operator new(size_t size) {
+	void* p = dpp::counted_alloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	dpp::counted_free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	dpp::counted_free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	dpp::counted_free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	dpp::counted_free(p);
+}
+
+#endif
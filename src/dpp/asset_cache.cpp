@@ -0,0 +1,409 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/asset_cache.h>
+#include <dpp/cluster.h>
+#include <dpp/exception.h>
+#include <dpp/utility.h>
+#include <dpp/stringops.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief First line of every file in the disk tier
+ */
+constexpr const char* disk_magic = "dpp-asset 1";
+
+std::string header_value(const http_request_completion_t& http, const std::string& name) {
+	auto i = http.headers.find(name);
+	return i != http.headers.end() ? i->second : "";
+}
+
+http_request_completion_t hit() {
+	http_request_completion_t http;
+	http.status = 200;
+	return http;
+}
+
+}
+
+asset_cache::asset_cache(cluster* owner) : memory_used(0), memory_limit(32 * 1024 * 1024), disk_used(0), disk_limit(0), max_age(86400) {
+	fetcher = [owner](const std::string& url, const std::multimap<std::string, std::string>& headers, http_completion_event callback) {
+		owner->request(url, m_get, std::move(callback), "", "text/plain", headers);
+	};
+}
+
+asset_cache& asset_cache::set_memory_limit(size_t bytes) {
+	std::unique_lock l(mutex);
+	memory_limit = bytes;
+	store_memory("", nullptr);
+	return *this;
+}
+
+asset_cache& asset_cache::set_disk_path(const std::string& directory, size_t bytes) {
+	namespace fs = std::filesystem;
+	/* Reuse what an earlier run left behind, oldest last so they are evicted first */
+	std::vector<std::pair<fs::file_time_type, fs::directory_entry>> files;
+	if (!directory.empty()) {
+		std::error_code ec;
+		fs::create_directories(directory, ec);
+		if (ec) {
+			throw dpp::file_exception(err_asset_cache, "Unable to create asset cache directory " + directory + ": " + ec.message());
+		}
+		for (const auto& f : fs::directory_iterator(directory, ec)) {
+			if (f.is_regular_file() && f.path().extension() == ".asset") {
+				files.emplace_back(f.last_write_time(), f);
+			}
+		}
+		std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+	}
+	std::unique_lock l(mutex);
+	disk.clear();
+	disk_lru.clear();
+	disk_used = 0;
+	disk_path = directory;
+	disk_limit = bytes;
+	for (const auto& [time, f] : files) {
+		std::string name = f.path().filename().string();
+		disk_lru.push_back(name);
+		disk[name] = {static_cast<size_t>(f.file_size()), std::prev(disk_lru.end())};
+		disk_used += f.file_size();
+	}
+	return *this;
+}
+
+asset_cache& asset_cache::set_max_age(time_t seconds) {
+	std::unique_lock l(mutex);
+	max_age = seconds;
+	return *this;
+}
+
+asset_cache& asset_cache::set_fetcher(asset_fetcher_t f) {
+	std::unique_lock l(mutex);
+	fetcher = std::move(f);
+	return *this;
+}
+
+std::string asset_cache::key_of(const std::string& url) {
+	std::string path = url;
+	/* The same asset is served from cdn.discordapp.com and media.discordapp.net */
+	size_t scheme = path.find("://");
+	if (scheme != std::string::npos) {
+		size_t slash = path.find('/', scheme + 3);
+		path = slash == std::string::npos ? "/" : path.substr(slash);
+	}
+	std::string query;
+	size_t q = path.find('?');
+	if (q != std::string::npos) {
+		query = path.substr(q + 1);
+		path = path.substr(0, q);
+	}
+	/* Attachment URLs carry signatures which change on every fetch, only the size changes the content */
+	std::string size;
+	for (const auto& param : utility::tokenize(query, "&")) {
+		if (param.rfind("size=", 0) == 0) {
+			size = param.substr(5);
+		}
+	}
+	size_t last = path.rfind('/') + 1;
+	std::string file = path.substr(last);
+	size_t dot = file.find('.');
+	std::string stem = file.substr(0, dot), ext = dot == std::string::npos ? "" : file.substr(dot);
+	bool animated = stem.rfind("a_", 0) == 0;
+	std::string hex = animated ? stem.substr(2) : stem;
+	if (hex.length() == 32 && std::all_of(hex.begin(), hex.end(), [](unsigned char c) { return std::isxdigit(c); })) {
+		stem = (animated ? "a_" : "") + utility::iconhash(hex).to_string();
+	}
+	return path.substr(0, last) + stem + ext + (size.empty() ? "" : "?size=" + size);
+}
+
+std::string asset_cache::file_of(const std::string& key) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (unsigned char c : key) {
+		h = (h ^ c) * 0x100000001b3ull;
+	}
+	return to_hex(h) + ".asset";
+}
+
+void asset_cache::store_memory(const std::string& key, const std::shared_ptr<const cached_asset>& asset) {
+	if (asset) {
+		auto i = memory.find(key);
+		if (i != memory.end()) {
+			memory_used -= i->second.asset->body.size();
+			memory_lru.erase(i->second.lru);
+			memory.erase(i);
+		}
+		if (asset->body.size() <= memory_limit) {
+			memory_lru.push_front(key);
+			memory[key] = {asset, memory_lru.begin()};
+			memory_used += asset->body.size();
+		}
+	}
+	while (memory_used > memory_limit && !memory_lru.empty()) {
+		auto i = memory.find(memory_lru.back());
+		memory_used -= i->second.asset->body.size();
+		memory.erase(i);
+		memory_lru.pop_back();
+		stats.evictions++;
+	}
+}
+
+void asset_cache::store_disk(const std::string& key, const cached_asset& asset) {
+	static std::atomic<uint64_t> writes{0};
+	std::string path;
+	{
+		std::unique_lock l(mutex);
+		path = disk_path;
+	}
+	if (path.empty()) {
+		return;
+	}
+	std::string name = file_of(key);
+	std::string full = path + "/" + name;
+	/* Renamed over the file once complete, so a load_disk at the same time reads the old file or the new one */
+	std::string temp = full + "." + std::to_string(writes++) + ".tmp";
+	std::error_code ec;
+	size_t size = 0;
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		out << disk_magic << "\n" << key << "\n" << asset.content_type << "\n" << asset.etag << "\n" << asset.last_modified << "\n" << asset.validated << "\n";
+		out.write(asset.body.data(), asset.body.size());
+		if (out) {
+			size = static_cast<size_t>(out.tellp());
+		}
+	}
+	if (size > 0) {
+		std::filesystem::rename(temp, full, ec);
+	}
+	if (size == 0 || ec) {
+		std::filesystem::remove(temp, ec);
+		return;
+	}
+	std::vector<std::string> evicted;
+	{
+		std::unique_lock l(mutex);
+		if (disk_path != path) {
+			/* The disk tier moved while we were writing */
+			return;
+		}
+		auto i = disk.find(name);
+		if (i != disk.end()) {
+			disk_used -= i->second.size;
+			disk_lru.erase(i->second.lru);
+			disk.erase(i);
+		}
+		disk_lru.push_front(name);
+		disk[name] = {size, disk_lru.begin()};
+		disk_used += size;
+		while (disk_used > disk_limit && disk_lru.size() > 1) {
+			auto old = disk.find(disk_lru.back());
+			disk_used -= old->second.size;
+			evicted.emplace_back(path + "/" + old->first);
+			disk.erase(old);
+			disk_lru.pop_back();
+			stats.evictions++;
+		}
+	}
+	for (const auto& file : evicted) {
+		std::filesystem::remove(file, ec);
+	}
+}
+
+std::shared_ptr<const cached_asset> asset_cache::load_disk(const std::string& key) {
+	std::string file;
+	{
+		std::unique_lock l(mutex);
+		if (disk_path.empty()) {
+			return nullptr;
+		}
+		auto i = disk.find(file_of(key));
+		if (i == disk.end()) {
+			return nullptr;
+		}
+		disk_lru.splice(disk_lru.begin(), disk_lru, i->second.lru);
+		file = disk_path + "/" + i->first;
+	}
+	std::ifstream in(file, std::ios::binary);
+	std::string magic, stored_key, validated;
+	auto asset = std::make_shared<cached_asset>();
+	if (!std::getline(in, magic) || magic != disk_magic || !std::getline(in, stored_key) || stored_key != key ||
+		!std::getline(in, asset->content_type) || !std::getline(in, asset->etag) || !std::getline(in, asset->last_modified) || !std::getline(in, validated)) {
+		/* Missing, damaged, or another key with the same file name */
+		return nullptr;
+	}
+	asset->validated = static_cast<time_t>(std::strtoll(validated.c_str(), nullptr, 10));
+	asset->body.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return asset;
+}
+
+std::shared_ptr<const cached_asset> asset_cache::lookup(const std::string& key) {
+	{
+		std::unique_lock l(mutex);
+		auto i = memory.find(key);
+		if (i != memory.end()) {
+			memory_lru.splice(memory_lru.begin(), memory_lru, i->second.lru);
+			stats.memory_hits++;
+			return i->second.asset;
+		}
+	}
+	std::shared_ptr<const cached_asset> asset = load_disk(key);
+	if (asset) {
+		std::unique_lock l(mutex);
+		stats.disk_hits++;
+		store_memory(key, asset);
+	}
+	return asset;
+}
+
+void asset_cache::fetch(const std::string& url, asset_completion_t callback) {
+	std::string key = key_of(url);
+	std::multimap<std::string, std::string> headers;
+	std::shared_ptr<const cached_asset> stale;
+	asset_fetcher_t f;
+	std::shared_ptr<const cached_asset> asset = lookup(key);
+	{
+		std::unique_lock l(mutex);
+		if (asset && time(nullptr) - asset->validated < max_age) {
+			l.unlock();
+			if (callback) {
+				callback(asset, hit());
+			}
+			return;
+		}
+		auto waiting = in_flight.find(key);
+		if (waiting != in_flight.end()) {
+			stats.coalesced++;
+			waiting->second.emplace_back(std::move(callback));
+			return;
+		}
+		in_flight[key].emplace_back(std::move(callback));
+		if (asset) {
+			/* Too old, ask the CDN whether it has changed */
+			stale = asset;
+			if (!asset->etag.empty()) {
+				headers.emplace("If-None-Match", asset->etag);
+			}
+			if (!asset->last_modified.empty()) {
+				headers.emplace("If-Modified-Since", asset->last_modified);
+			}
+		}
+		f = fetcher;
+	}
+	f(url, headers, [this, key, stale](const http_request_completion_t& http) {
+		completed(key, stale, http);
+	});
+}
+
+void asset_cache::completed(const std::string& key, std::shared_ptr<const cached_asset> stale, const http_request_completion_t& http) {
+	std::shared_ptr<const cached_asset> result;
+	std::vector<asset_completion_t> callbacks;
+	{
+		std::unique_lock l(mutex);
+		if (http.status == 304 && stale) {
+			auto refreshed = std::make_shared<cached_asset>(*stale);
+			refreshed->validated = time(nullptr);
+			result = refreshed;
+			stats.revalidations++;
+		} else if (http.error == h_success && http.status == 200) {
+			auto downloaded = std::make_shared<cached_asset>();
+			downloaded->body = http.body;
+			downloaded->content_type = header_value(http, "content-type");
+			downloaded->etag = header_value(http, "etag");
+			downloaded->last_modified = header_value(http, "last-modified");
+			downloaded->validated = time(nullptr);
+			result = downloaded;
+			stats.downloads++;
+		} else {
+			stats.failures++;
+		}
+		if (result) {
+			store_memory(key, result);
+		}
+		auto i = in_flight.find(key);
+		if (i != in_flight.end()) {
+			callbacks = std::move(i->second);
+			in_flight.erase(i);
+		}
+	}
+	if (result) {
+		store_disk(key, *result);
+	}
+	for (const auto& callback : callbacks) {
+		if (callback) {
+			callback(result, http);
+		}
+	}
+}
+
+std::shared_ptr<const cached_asset> asset_cache::find(const std::string& url) {
+	return lookup(key_of(url));
+}
+
+void asset_cache::remove(const std::string& url) {
+	std::string key = key_of(url);
+	std::string file;
+	std::unique_lock l(mutex);
+	auto i = memory.find(key);
+	if (i != memory.end()) {
+		memory_used -= i->second.asset->body.size();
+		memory_lru.erase(i->second.lru);
+		memory.erase(i);
+	}
+	auto d = disk.find(file_of(key));
+	if (d != disk.end()) {
+		file = disk_path + "/" + d->first;
+		disk_used -= d->second.size;
+		disk_lru.erase(d->second.lru);
+		disk.erase(d);
+	}
+	l.unlock();
+	if (!file.empty()) {
+		std::error_code ec;
+		std::filesystem::remove(file, ec);
+	}
+}
+
+void asset_cache::clear_memory() {
+	std::unique_lock l(mutex);
+	memory.clear();
+	memory_lru.clear();
+	memory_used = 0;
+}
+
+asset_cache_stats asset_cache::get_stats() {
+	std::unique_lock l(mutex);
+	return stats;
+}
+
+size_t asset_cache::get_memory_used() {
+	std::unique_lock l(mutex);
+	return memory_used;
+}
+
+} // namespace dpp
@@ -0,0 +1,206 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/autocomplete.h>
+#include <algorithm>
+#include <string_view>
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief ASCII lowercase a string
+ */
+std::string fold(const std::string& s) {
+	std::string out(s);
+	for (char& c : out) {
+		if (c >= 'A' && c <= 'Z') {
+			c = static_cast<char>(c - 'A' + 'a');
+		}
+	}
+	return out;
+}
+
+/**
+ * @brief Returns true if a character separates words in a choice name
+ */
+bool is_separator(char c) {
+	return c == ' ' || c == '-' || c == '_' || c == '.' || c == '/' || c == ':';
+}
+
+/**
+ * @brief Pack three characters into a trigram key
+ */
+uint32_t trigram_at(const std::string& s, size_t i) {
+	return (static_cast<uint32_t>(static_cast<uint8_t>(s[i])) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(s[i + 1])) << 8) | static_cast<uint8_t>(s[i + 2]);
+}
+
+/**
+ * @brief Get the distinct trigrams of a string
+ */
+std::vector<uint32_t> trigrams_of(const std::string& s) {
+	std::vector<uint32_t> out;
+	if (s.length() >= 3) {
+		out.reserve(s.length() - 2);
+		for (size_t i = 0; i + 3 <= s.length(); ++i) {
+			out.push_back(trigram_at(s, i));
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+	return out;
+}
+
+bool starts_with(std::string_view s, std::string_view prefix) {
+	return s.substr(0, prefix.length()) == prefix;
+}
+
+}
+
+autocomplete_index::autocomplete_index(std::vector<command_option_choice> _choices) : choices(std::move(_choices)) {
+	folded.reserve(choices.size());
+	sorted.reserve(choices.size());
+	for (uint32_t i = 0; i < choices.size(); ++i) {
+		folded.push_back(fold(choices[i].name));
+		sorted.push_back(i);
+		const std::string& name = folded.back();
+		for (uint32_t pos = 1; pos < name.length(); ++pos) {
+			if (is_separator(name[pos - 1]) && !is_separator(name[pos])) {
+				word_starts.emplace_back(i, pos);
+			}
+		}
+		for (uint32_t t : trigrams_of(name)) {
+			/* Choices are visited in order, so each posting list is already sorted */
+			trigrams[t].push_back(i);
+		}
+	}
+	std::sort(sorted.begin(), sorted.end(), [this](uint32_t a, uint32_t b) {
+		return folded[a] < folded[b];
+	});
+	std::sort(word_starts.begin(), word_starts.end(), [this](const auto& a, const auto& b) {
+		return std::string_view(folded[a.first]).substr(a.second) < std::string_view(folded[b.first]).substr(b.second);
+	});
+}
+
+autocomplete_index::autocomplete_index(const std::vector<std::string>& names) : autocomplete_index([&names]() {
+	std::vector<command_option_choice> c;
+	c.reserve(names.size());
+	for (const std::string& name : names) {
+		c.emplace_back(name, name);
+	}
+	return c;
+}()) {
+}
+
+size_t autocomplete_index::size() const {
+	return choices.size();
+}
+
+std::vector<command_option_choice> autocomplete_index::search(const std::string& query, size_t limit) const {
+	std::vector<command_option_choice> out;
+	std::string q = fold(query);
+	q.erase(0, q.find_first_not_of(' '));
+	q.erase(q.find_last_not_of(' ') + 1);
+	if (q.empty()) {
+		for (size_t i = 0; i < choices.size() && i < limit; ++i) {
+			out.push_back(choices[i]);
+		}
+		return out;
+	}
+
+	std::vector<uint32_t> found;
+	auto add = [&found, limit](std::vector<uint32_t>& tier) {
+		for (uint32_t i : tier) {
+			if (found.size() >= limit) {
+				return;
+			}
+			if (std::find(found.begin(), found.end(), i) == found.end()) {
+				found.push_back(i);
+			}
+		}
+	};
+	auto shortest_first = [this](uint32_t a, uint32_t b) {
+		return folded[a].length() != folded[b].length() ? folded[a].length() < folded[b].length() : folded[a] < folded[b];
+	};
+
+	/* Names starting with the query are one contiguous range of the sorted names */
+	std::vector<uint32_t> tier;
+	auto it = std::lower_bound(sorted.begin(), sorted.end(), q, [this](uint32_t i, const std::string& value) {
+		return folded[i] < value;
+	});
+	for (; it != sorted.end() && starts_with(folded[*it], q); ++it) {
+		tier.push_back(*it);
+	}
+	std::sort(tier.begin(), tier.end(), shortest_first);
+	add(tier);
+
+	/* Then names with a later word starting with the query */
+	if (found.size() < limit) {
+		tier.clear();
+		auto word = std::lower_bound(word_starts.begin(), word_starts.end(), q, [this](const auto& w, const std::string& value) {
+			return std::string_view(folded[w.first]).substr(w.second) < value;
+		});
+		for (; word != word_starts.end() && starts_with(std::string_view(folded[word->first]).substr(word->second), q); ++word) {
+			tier.push_back(word->first);
+		}
+		std::sort(tier.begin(), tier.end(), shortest_first);
+		add(tier);
+	}
+
+	/* Then fuzzy matches, by the number of trigrams shared with the query */
+	std::vector<uint32_t> query_trigrams = trigrams_of(q);
+	if (found.size() < limit && !query_trigrams.empty()) {
+		std::unordered_map<uint32_t, uint32_t> hits;
+		for (uint32_t t : query_trigrams) {
+			auto posting = trigrams.find(t);
+			if (posting != trigrams.end()) {
+				for (uint32_t i : posting->second) {
+					hits[i]++;
+				}
+			}
+		}
+		/* At least half of the query's trigrams must match, so unrelated names sharing one trigram are not suggested */
+		const uint32_t min_hits = static_cast<uint32_t>((query_trigrams.size() + 1) / 2);
+		std::vector<std::pair<uint32_t, uint32_t>> scored;
+		for (const auto& [i, count] : hits) {
+			if (count >= min_hits) {
+				scored.emplace_back(i, count);
+			}
+		}
+		std::sort(scored.begin(), scored.end(), [&shortest_first](const auto& a, const auto& b) {
+			return a.second != b.second ? a.second > b.second : shortest_first(a.first, b.first);
+		});
+		tier.clear();
+		for (const auto& s : scored) {
+			tier.push_back(s.first);
+		}
+		add(tier);
+	}
+
+	out.reserve(found.size());
+	for (uint32_t i : found) {
+		out.push_back(choices[i]);
+	}
+	return out;
+}
+
+} // namespace dpp
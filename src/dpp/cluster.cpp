@@ -27,11 +27,17 @@
 #include <dpp/cache.h>
 #include <dpp/once.h>
 #include <dpp/sync.h>
+#include <dpp/httpsclient.h>
 #include <chrono>
 #include <iostream>
 #include <dpp/json.h>
 #include <utility>
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 namespace dpp {
 
@@ -93,8 +99,8 @@ template bool DPP_EXPORT validate_configuration<build_type::release>();
 template bool DPP_EXPORT validate_configuration<build_type::universal>();
 
 cluster::cluster(const std::string &_token, uint32_t _intents, uint32_t _shards, uint32_t _cluster_id, uint32_t _maxclusters, bool comp, cache_policy_t policy, uint32_t request_threads, uint32_t request_threads_raw)
-	: default_gateway("gateway.discord.gg"), rest(nullptr), raw_rest(nullptr), compressed(comp), start_time(0), token(_token), last_identify(time(nullptr) - 5), intents(_intents),
-	numshards(_shards), cluster_id(_cluster_id), maxclusters(_maxclusters), rest_ping(0.0), cache_policy(policy), ws_mode(ws_json)
+	: default_gateway("gateway.discord.gg"), rest_host(DISCORD_HOST), rest(nullptr), raw_rest(nullptr), compressed(comp), start_time(0), token(_token), last_identify(time(nullptr) - 5), intents(_intents),
+	numshards(_shards), cluster_id(_cluster_id), maxclusters(_maxclusters), rest_ping(0.0), cache_policy(policy), ws_mode(ws_json), ratelimit_checkpoint_timer(0)
 {
 	/* Instantiate REST request queues */
 	try {
@@ -124,6 +130,8 @@ cluster::cluster(const std::string &_token, uint32_t _intents, uint32_t _shards,
 
 cluster::~cluster()
 {
+	/* The watchdog sends requests, so it must stop before the request queues are deleted */
+	watchdog.reset();
 	this->shutdown();
 	delete rest;
 	delete raw_rest;
@@ -148,6 +156,74 @@ cluster& cluster::set_websocket_protocol(websocket_protocol_t mode) {
 	return *this;
 }
 
+cluster& cluster::set_event_queue(const event_queue_config& config) {
+	if (start_time > 0) {
+		throw dpp::logic_exception(err_event_queue_already_set, "Cannot change the event queue on a started cluster!");
+	}
+	event_queue_settings = std::make_shared<const event_queue_config>(config);
+	return *this;
+}
+
+const event_queue_config* cluster::get_event_queue() const {
+	return event_queue_settings.get();
+}
+
+event_queue_stats cluster::get_event_queue_stats() {
+	event_queue_stats total;
+	std::shared_lock l(shards_lock);
+	for (auto& [id, shard] : shards) {
+		total += shard->get_event_queue_stats();
+	}
+	return total;
+}
+
+cluster& cluster::set_ratelimit_checkpoint(const std::string& filename, uint64_t interval) {
+	if (ratelimit_checkpoint_timer) {
+		stop_timer(ratelimit_checkpoint_timer);
+		ratelimit_checkpoint_timer = 0;
+	}
+	{
+		std::lock_guard lock(ratelimit_checkpoint_mutex);
+		ratelimit_checkpoint_file = filename;
+	}
+	std::ifstream in(filename);
+	if (in) {
+		std::stringstream content;
+		content << in.rdbuf();
+		try {
+			size_t restored = rest->restore_ratelimit_checkpoint(content.str());
+			log(ll_debug, "Restored " + std::to_string(restored) + " rate limit buckets from " + filename);
+		}
+		catch (const dpp::rest_exception& e) {
+			log(ll_warning, "Ignoring rate limit checkpoint " + filename + ": " + e.what());
+		}
+	}
+	ratelimit_checkpoint_timer = start_timer([this](timer) {
+		write_ratelimit_checkpoint();
+	}, std::max<uint64_t>(interval, 1));
+	return *this;
+}
+
+void cluster::write_ratelimit_checkpoint() {
+	std::lock_guard lock(ratelimit_checkpoint_mutex);
+	if (ratelimit_checkpoint_file.empty() || !rest) {
+		return;
+	}
+	/* Write a new file and rename it over the old one, so a crash mid-write leaves the last checkpoint intact */
+	const std::string temp = ratelimit_checkpoint_file + ".tmp";
+	{
+		std::ofstream out(temp, std::ios::trunc);
+		out << rest->get_ratelimit_checkpoint();
+		if (!out) {
+			log(ll_warning, "Could not write rate limit checkpoint " + temp);
+			return;
+		}
+	}
+	if (std::rename(temp.c_str(), ratelimit_checkpoint_file.c_str()) != 0) {
+		log(ll_warning, "Could not replace rate limit checkpoint " + ratelimit_checkpoint_file + ": " + strerror(errno));
+	}
+}
+
 void cluster::log(dpp::loglevel severity, const std::string &msg) const {
 	if (!on_log.empty()) {
 		/* Pass to user if they've hooked the event */
@@ -210,8 +286,12 @@ void cluster::start(bool return_after) {
 		if (s % maxclusters == cluster_id) {
 			/* Each discord_client spawns its own thread in its run() */
 			try {
-				this->shards[s] = new discord_client(this, s, numshards, token, intents, compressed, ws_mode);
-				this->shards[s]->run();
+				discord_client* shard = new discord_client(this, s, numshards, token, intents, compressed, ws_mode);
+				{
+					std::unique_lock l(shards_lock);
+					this->shards[s] = shard;
+				}
+				shard->run();
 			}
 			catch (const std::exception &e) {
 				log(dpp::ll_critical, "Could not start shard " + std::to_string(s) + ": " + std::string(e.what()));
@@ -228,7 +308,7 @@ void cluster::start(bool return_after) {
 					bool all_connected = true;
 					do {
 						all_connected = true;
-						for (auto& shard : this->shards) {
+						for (auto& shard : get_shards()) {
 							if (!shard.second->ready) {
 								all_connected = false;
 								std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -259,20 +339,153 @@ void cluster::start(bool return_after) {
 	}
 }
 
+void cluster::reshard(uint32_t new_shards, std::chrono::seconds overlap) {
+	std::unique_lock reshard_guard(reshard_lock);
+
+	/* The new shards identify while the old ones stay connected, so they need session starts of their own */
+	gateway g = dpp::sync<gateway>(this, &cluster::get_gateway_bot);
+	if (new_shards == 0) {
+		new_shards = g.shards;
+	}
+	if (new_shards == 0) {
+		throw dpp::connection_exception(err_auto_shard, "Reshard: Cannot determine number of shards.");
+	}
+	uint32_t starting = 0;
+	for (uint32_t s = 0; s < new_shards; ++s) {
+		starting += (s % maxclusters == cluster_id) ? 1 : 0;
+	}
+	if (g.session_start_remaining < starting) {
+		throw dpp::connection_exception(err_no_sessions_left, "Reshard: Discord indicates you cannot start " + std::to_string(starting) + " more sessions. The current shards are still running.");
+	}
+	shard_list outgoing = get_shards();
+	log(ll_info, "Reshard: Moving from " + std::to_string(outgoing.size()) + " to " + std::to_string(starting) + " shards on this cluster");
+	handover.clear();
+
+	shard_list incoming;
+	auto abandon = [&incoming]() {
+		/* Never published, so nothing else can hold these */
+		for (const auto& sh : incoming) {
+			sh.second->delivery = sd_retired;
+			delete sh.second;
+		}
+		incoming.clear();
+	};
+	uint32_t concurrency = std::max(1u, g.session_start_max_concurrency);
+	uint32_t started = 0;
+	for (uint32_t s = 0; s < new_shards; ++s) {
+		if (s % maxclusters != cluster_id) {
+			continue;
+		}
+		try {
+			discord_client* shard = new discord_client(this, s, new_shards, token, intents, compressed, ws_mode);
+			shard->delivery = sd_standby;
+			incoming[s] = shard;
+			shard->run();
+		}
+		catch (const std::exception &e) {
+			abandon();
+			throw dpp::connection_exception(err_connect_failure, "Reshard: Could not start shard " + std::to_string(s) + ": " + std::string(e.what()));
+		}
+		/* Stagger the identifies as cluster::start does, one batch of max_concurrency every 5 seconds */
+		if ((++started % concurrency) == 0) {
+			std::this_thread::sleep_for(std::chrono::seconds(5));
+		}
+	}
+
+	/* Wait for every new shard to receive READY */
+	auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+	for (const auto& sh : incoming) {
+		while (!sh.second->ready) {
+			if (std::chrono::steady_clock::now() > give_up) {
+				abandon();
+				throw dpp::connection_exception(err_connect_failure, "Reshard: Shard " + std::to_string(sh.first) + " did not become ready in time. The current shards are still running.");
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+	/* Let the GUILD_CREATE burst that follows READY finish, any stragglers are still dropped during takeover */
+	give_up = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+	while (!handover.bursts_complete() && std::chrono::steady_clock::now() < give_up) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	/* The old set starts recording what it handles before the new set starts handling anything, so
+	 * an event which reaches the new set slightly later than the old one still finds its copy.
+	 */
+	for (const auto& sh : outgoing) {
+		sh.second->delivery = sd_handover;
+	}
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	for (const auto& sh : incoming) {
+		sh.second->delivery = sd_takeover;
+	}
+	log(ll_debug, "Reshard: New shards ready, handing over for " + std::to_string(overlap.count()) + "s");
+	std::this_thread::sleep_for(overlap);
+
+	/* Stop the old set delivering first, then swap the sets over. Readers of the shard map hold
+	 * shards_lock while they use a shard, so once the swap has the lock none of them still does.
+	 */
+	for (const auto& sh : outgoing) {
+		sh.second->delivery = sd_retired;
+	}
+	{
+		std::unique_lock l(shards_lock);
+		shards = incoming;
+		numshards = new_shards;
+	}
+	{
+		dpp::cache<guild>* c = dpp::get_guild_cache();
+		std::unique_lock l(c->get_mutex());
+		for (auto& gc : c->get_container()) {
+			gc.second->shard_id = static_cast<uint16_t>((gc.first >> 22) % new_shards);
+		}
+	}
+	for (const auto& sh : outgoing) {
+		if (!sh.second->connecting_voice_channels.empty()) {
+			log(ll_warning, "Reshard: Closing shard " + std::to_string(sh.first) + " with " + std::to_string(sh.second->connecting_voice_channels.size()) + " voice connections");
+		}
+		/* Joins the shard's thread and event queue, so no handler is still running with it as event.from */
+		sh.second->stop();
+		std::unique_lock l(shards_lock);
+		retired_shards.emplace_back(sh.second);
+	}
+
+	/* Copies the old set delivered may still be in flight on the new one for a moment */
+	std::this_thread::sleep_for(overlap);
+	for (const auto& sh : incoming) {
+		sh.second->delivery = sd_dispatch;
+	}
+	handover.clear();
+	log(ll_info, "Reshard: Now running " + std::to_string(new_shards) + " shards");
+}
+
+bool cluster::accept_event(discord_client* shard, const std::string& event, const json& j) {
+	shard_delivery delivery = shard->delivery;
+	return delivery == sd_dispatch || handover.accept(delivery, shard->shard_id, event, j);
+}
+
 void cluster::shutdown() {
 	/* Signal condition variable to terminate */
 	terminating.notify_all();
+	/* Keep the rate limits learned this run for the next one */
+	if (ratelimit_checkpoint_timer) {
+		stop_timer(ratelimit_checkpoint_timer);
+		ratelimit_checkpoint_timer = 0;
+	}
+	write_ratelimit_checkpoint();
 	/* Free memory for active timers */
 	for (auto & t : timer_list) {
 		delete t.second;
 	}
 	timer_list.clear();
 	/* Terminate shards */
+	std::unique_lock l(shards_lock);
 	for (const auto& sh : shards) {
 		log(ll_info, "Terminating shard id " + std::to_string(sh.second->shard_id));
 		delete sh.second;
 	}
 	shards.clear();
+	retired_shards.clear();
 }
 
 snowflake cluster::get_dm_channel(snowflake user_id) {
@@ -389,6 +602,7 @@ gateway::gateway(nlohmann::json* j) {
 
 void cluster::set_presence(const dpp::presence &p) {
 	json pres = p.to_json();
+	std::shared_lock l(shards_lock);
 	for (auto& s : shards) {
 		if (s.second->is_connected()) {
 			s.second->queue_message(s.second->jsonobj_to_string(pres));
@@ -411,6 +625,15 @@ cluster& cluster::set_default_gateway(std::string &default_gateway_new) {
 	return *this;
 }
 
+cluster& cluster::set_rest_host(const std::string& host) {
+	rest_host = host;
+	return *this;
+}
+
+const std::string& cluster::get_rest_host() const {
+	return rest_host;
+}
+
 std::string cluster::get_audit_reason() {
 	std::string r = audit_reason;
 	audit_reason.clear();
@@ -418,6 +641,7 @@ std::string cluster::get_audit_reason() {
 }
 
 discord_client* cluster::get_shard(uint32_t id) {
+	std::shared_lock l(shards_lock);
 	auto i = shards.find(id);
 	if (i != shards.end()) {
 		return i->second;
@@ -426,8 +650,134 @@ discord_client* cluster::get_shard(uint32_t id) {
 	}
 }
 
-const shard_list& cluster::get_shards() {
+shard_list cluster::get_shards() {
+	std::shared_lock l(shards_lock);
 	return shards;
 }
 
+void cluster::request_guild_member(snowflake guild_id, snowflake user_id, command_completion_event_t callback) {
+	guild* g = find_guild(guild_id);
+	int64_t shard_id = -1;
+	if (g) {
+		auto m = g->members.find(user_id);
+		if (m != g->members.end()) {
+			http_request_completion_t http;
+			http.status = 200;
+			callback(confirmation_callback_t(this, m->second, http));
+			return;
+		}
+		shard_id = g->shard_id;
+	}
+	{
+		/* Held while the shard is used, so cluster::reshard cannot close it underneath us */
+		std::shared_lock l(shards_lock);
+		if (shard_id < 0) {
+			shard_id = numshards ? (guild_id >> 22) % numshards : 0;
+		}
+		auto shard = shards.find(static_cast<uint32_t>(shard_id));
+		if (shard != shards.end()) {
+			shard->second->request_member(guild_id, user_id, std::move(callback));
+			return;
+		}
+	}
+	guild_get_member(guild_id, user_id, std::move(callback));
+}
+
+cluster& cluster::register_autocomplete(const std::string& command, const std::string& option, autocomplete_index index) {
+	auto shared = std::make_shared<const autocomplete_index>(std::move(index));
+	std::unique_lock l(autocomplete_lock);
+	autocomplete_indexes[std::make_pair(command, option)] = std::move(shared);
+	return *this;
+}
+
+cluster& cluster::unregister_autocomplete(const std::string& command, const std::string& option) {
+	std::unique_lock l(autocomplete_lock);
+	autocomplete_indexes.erase(std::make_pair(command, option));
+	return *this;
+}
+
+std::shared_ptr<const autocomplete_index> cluster::find_autocomplete(const std::string& command, const std::string& option) {
+	std::shared_lock l(autocomplete_lock);
+	auto i = autocomplete_indexes.find(std::make_pair(command, option));
+	return i != autocomplete_indexes.end() ? i->second : nullptr;
+}
+
+cluster& cluster::set_auto_defer(std::chrono::milliseconds deadline, bool ephemeral) {
+	std::unique_lock l(auto_defer_lock);
+	auto_defer_after = deadline;
+	auto_defer_ephemeral = ephemeral;
+	if (deadline.count() > 0 && !watchdog) {
+		watchdog = std::make_unique<interaction_watchdog>();
+	}
+	return *this;
+}
+
+std::shared_ptr<interaction_response_state> cluster::watch_interaction(const interaction& i) {
+	if (i.type != it_application_command && i.type != it_component_button && i.type != it_modal_submit) {
+		return nullptr;
+	}
+	std::unique_lock l(auto_defer_lock);
+	if (auto_defer_after.count() <= 0) {
+		return nullptr;
+	}
+	auto state = std::make_shared<interaction_response_state>();
+	interaction_response_type type = (i.type == it_component_button ? ir_deferred_update_message : ir_deferred_channel_message_with_source);
+	message msg{i.channel_id, std::string{"*"}};
+	msg.guild_id = i.guild_id;
+	if (auto_defer_ephemeral && type == ir_deferred_channel_message_with_source) {
+		msg.set_flags(m_ephemeral);
+	}
+	watchdog->watch(std::chrono::steady_clock::now() + auto_defer_after, [this, state, id = i.id, token = i.token, response = interaction_response(type, msg)]() {
+		{
+			std::unique_lock lock(state->mutex);
+			if (state->stage != irs_waiting) {
+				return;
+			}
+			state->stage = irs_deferring;
+		}
+		interaction_response_create(id, token, response, [this, state](const confirmation_callback_t& cc) {
+			std::vector<std::function<void()>> held;
+			{
+				std::unique_lock lock(state->mutex);
+				/* If the deferral failed, held replies go out as ordinary responses */
+				state->stage = cc.is_error() ? irs_responded : irs_deferred;
+				held.swap(state->after_deferral);
+			}
+			if (cc.is_error()) {
+				log(ll_warning, "Automatic deferral of interaction failed: " + cc.get_error().human_readable);
+			}
+			for (auto& reply : held) {
+				reply();
+			}
+		});
+	});
+	return state;
+}
+
+#ifdef DPP_CORO
+async<confirmation_callback_t> cluster::co_request_guild_member(snowflake guild_id, snowflake user_id) {
+	return async<confirmation_callback_t>{ this, static_cast<void (cluster::*)(snowflake, snowflake, command_completion_event_t)>(&cluster::request_guild_member), guild_id, user_id };
+}
+
+async<rest_result<message>> cluster::co_message_get_typed(snowflake message_id, snowflake channel_id) {
+	return async<rest_result<message>>{ this, &cluster::message_get_typed, message_id, channel_id };
+}
+
+async<rest_result<message>> cluster::co_message_create_typed(const message &m) {
+	return async<rest_result<message>>{ this, &cluster::message_create_typed, m };
+}
+
+async<rest_result<message>> cluster::co_message_edit_typed(const message &m) {
+	return async<rest_result<message>>{ this, &cluster::message_edit_typed, m };
+}
+
+async<rest_result<channel>> cluster::co_channel_get_typed(snowflake c) {
+	return async<rest_result<channel>>{ this, &cluster::channel_get_typed, c };
+}
+
+async<rest_result<user_identified>> cluster::co_user_get_typed(snowflake user_id) {
+	return async<rest_result<user_identified>>{ this, &cluster::user_get_typed, user_id };
+}
+#endif
+
 };
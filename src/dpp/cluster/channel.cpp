@@ -77,6 +77,10 @@ void cluster::channel_get(snowflake c, command_completion_event_t callback) {
 	rest_request<channel>(this, API_PATH "/channels", std::to_string(c), "", m_get, "", callback);
 }
 
+void cluster::channel_get_typed(snowflake c, typed_completion_event_t<channel> callback) {
+	rest_request_typed<channel>(this, API_PATH "/channels", std::to_string(c), "", m_get, "", callback);
+}
+
 void cluster::channel_invite_create(const class channel &c, const class invite &i, command_completion_event_t callback) {
 	rest_request<invite>(this, API_PATH "/channels", std::to_string(c.id), "invites", m_post, i.build_json(), callback);
 }
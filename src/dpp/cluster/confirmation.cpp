@@ -20,6 +20,7 @@
  ************************************************************************************/
 #include <dpp/cluster.h>
 #include <dpp/json.h>
+#include <dpp/stringops.h>
 
 namespace dpp {
 
@@ -54,15 +55,7 @@ bool confirmation_callback_t::is_error() const {
 		return false;
 	}
 	try {
-		json j = json::parse(this->http_info.body);
-		if (j.find("code") != j.end() && j.find("errors") != j.end() && j.find("message") != j.end()) {
-			if (j["code"].is_number_unsigned() && j["errors"].is_object() && j["message"].is_string()) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		return false;
+		return is_rest_error(http_info, json::parse(this->http_info.body));
 	}
 	catch (const std::exception &) {
 		/* JSON parse error indicates the content is not JSON.
@@ -72,8 +65,44 @@ bool confirmation_callback_t::is_error() const {
 	}
 }
 
+bool is_rest_error(const http_request_completion_t& http, const json& body) {
+	if (http.status >= 400) {
+		return true;
+	}
+	if (http.status == 204 || !body.is_object()) {
+		return false;
+	}
+	auto code = body.find("code"), errors = body.find("errors"), message = body.find("message");
+	return code != body.end() && errors != body.end() && message != body.end() &&
+		code->is_number_unsigned() && errors->is_object() && message->is_string();
+}
+
 namespace {
 
+/**
+ * @brief Reason phrase for the HTTP statuses a REST call commonly fails with
+ *
+ * @param status HTTP status code
+ * @return std::string Reason phrase, or an empty string if the status is not listed
+ */
+std::string http_status_text(uint32_t status) {
+	switch (status) {
+		case 400: return "Bad Request";
+		case 401: return "Unauthorized";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 408: return "Request Timeout";
+		case 413: return "Payload Too Large";
+		case 429: return "Too Many Requests";
+		case 500: return "Internal Server Error";
+		case 502: return "Bad Gateway";
+		case 503: return "Service Unavailable";
+		case 504: return "Gateway Timeout";
+		default: return "";
+	}
+}
+
 std::vector<error_detail> find_errors_in_array(const std::string& obj, size_t index, const std::string& current_field, json::iterator begin, json::iterator end) {
 	std::vector<error_detail> ret;
 
@@ -104,105 +133,125 @@ std::vector<error_detail> find_errors_in_array(const std::string& obj, size_t in
 
 error_info confirmation_callback_t::get_error() const {
 	if (is_error()) {
-		json j = json::parse(this->http_info.body);
-		error_info e;
-
-		set_int32_not_null(&j, "code", e.code);
-		set_string_not_null(&j, "message", e.message);
-		json& errors = j["errors"];
-		for (auto obj = errors.begin(); obj != errors.end(); ++obj) {
-
-			/* Arrays in the error report are numerically indexed with a number in a string. Ugh. */
-			if (isdigit(*(obj.key().c_str()))) {
-				/* An array of error messages */
-				int array_index = std::atoll(obj.key().c_str());
-				for (auto index = obj->begin(); index != obj->end(); ++index) {
-					if (index->find("_errors") != index->end()) {
-						/* A single object where one or more fields generated an error */
-						for (auto errordetails = (*index)["_errors"].begin(); errordetails != (*index)["_errors"].end(); ++errordetails) {
-							error_detail detail;
-							detail.code = (*errordetails)["code"].get<std::string>();
-							detail.reason = (*errordetails)["message"].get<std::string>();
-							detail.object.clear();
-							detail.field = obj.key();
-							detail.index = array_index;
-							e.errors.emplace_back(detail);
-						}
-					} else {
-						/* An object where one or more fields within it generated an error, e.g. slash command */
-						for (auto fields = index->begin(); fields != index->end(); ++fields) {
-							if (fields->find("_errors") != fields->end()) {
-								for (auto errordetails = (*fields)["_errors"].begin(); errordetails != (*fields)["_errors"].end(); ++errordetails) {
+		return get_rest_error(http_info);
+	}
+	return error_info();
+}
+
+error_info get_rest_error(const http_request_completion_t& http) {
+	error_info e;
+	json j;
+	try {
+		j = json::parse(http.body);
+	}
+	catch (const std::exception &) {
+		/* Not JSON, e.g. an error page from a proxy. Describe it by its status, or failing that by its body */
+		e.code = http.status;
+		e.message = http_status_text(http.status);
+		if (e.message.empty()) {
+			e.message = trim(http.body.substr(0, 128));
+		}
+		if (e.message.empty()) {
+			e.message = "HTTP error";
+		}
+		e.human_readable = std::to_string(e.code) + ": " + e.message;
+		return e;
+	}
+
+	set_int32_not_null(&j, "code", e.code);
+	set_string_not_null(&j, "message", e.message);
+	json& errors = j["errors"];
+	for (auto obj = errors.begin(); obj != errors.end(); ++obj) {
+
+		/* Arrays in the error report are numerically indexed with a number in a string. Ugh. */
+		if (isdigit(*(obj.key().c_str()))) {
+			/* An array of error messages */
+			int array_index = std::atoll(obj.key().c_str());
+			for (auto index = obj->begin(); index != obj->end(); ++index) {
+				if (index->find("_errors") != index->end()) {
+					/* A single object where one or more fields generated an error */
+					for (auto errordetails = (*index)["_errors"].begin(); errordetails != (*index)["_errors"].end(); ++errordetails) {
+						error_detail detail;
+						detail.code = (*errordetails)["code"].get<std::string>();
+						detail.reason = (*errordetails)["message"].get<std::string>();
+						detail.object.clear();
+						detail.field = obj.key();
+						detail.index = array_index;
+						e.errors.emplace_back(detail);
+					}
+				} else {
+					/* An object where one or more fields within it generated an error, e.g. slash command */
+					for (auto fields = index->begin(); fields != index->end(); ++fields) {
+						if (fields->find("_errors") != fields->end()) {
+							for (auto errordetails = (*fields)["_errors"].begin(); errordetails != (*fields)["_errors"].end(); ++errordetails) {
+								error_detail detail;
+								detail.code = (*errordetails)["code"].get<std::string>();
+								detail.reason = (*errordetails)["message"].get<std::string>();
+								detail.field = fields.key();
+								detail.object = obj.key();
+								detail.index = array_index;
+								e.errors.emplace_back(detail);
+							}
+						} else {
+							/* An array of objects where one or more generated an error, e.g. slash command bulk registration */
+							for (auto fields2 = fields->begin(); fields2 != fields->end(); ++fields2) {
+								for (auto errordetails = (*fields2)["_errors"].begin(); errordetails != (*fields2)["_errors"].end(); ++errordetails) {
 									error_detail detail;
 									detail.code = (*errordetails)["code"].get<std::string>();
 									detail.reason = (*errordetails)["message"].get<std::string>();
-									detail.field = fields.key();
+									detail.field = index.key() + "[" + fields.key() +  "]." + fields2.key();
 									detail.object = obj.key();
 									detail.index = array_index;
 									e.errors.emplace_back(detail);
 								}
-							} else {
-								/* An array of objects where one or more generated an error, e.g. slash command bulk registration */
-								for (auto fields2 = fields->begin(); fields2 != fields->end(); ++fields2) {
-									for (auto errordetails = (*fields2)["_errors"].begin(); errordetails != (*fields2)["_errors"].end(); ++errordetails) {
-										error_detail detail;
-										detail.code = (*errordetails)["code"].get<std::string>();
-										detail.reason = (*errordetails)["message"].get<std::string>();
-										detail.field = index.key() + "[" + fields.key() +  "]." + fields2.key();
-										detail.object = obj.key();
-										detail.index = array_index;
-										e.errors.emplace_back(detail);
-									}
-								}
 							}
 						}
 					}
 				}
+			}
 
-			} else if (obj->find("_errors") != obj->end()) {
-				/* An object of error messages (rare) */
-				e.errors.reserve((*obj)["_errors"].size());
-				for (auto errordetails = (*obj)["_errors"].begin(); errordetails != (*obj)["_errors"].end(); ++errordetails) {
-					error_detail detail;
-					detail.code = (*errordetails)["code"].get<std::string>();
-					detail.reason = (*errordetails)["message"].get<std::string>();
-					detail.object.clear();
-					detail.field = obj.key();
-					detail.index = 0;
-					e.errors.emplace_back(detail);
-				}
-			} else {
-				/* An object that has a subobject with errors */
-				for (auto index = obj->begin(); index != obj->end(); ++index) {
-					int array_index = std::atoll(index.key().c_str());
-					auto sub_errors = find_errors_in_array(obj.key(), array_index, {}, index->begin(), index->end());
-
-					if (!sub_errors.empty()) {
-						e.errors.reserve(e.errors.capacity() + sub_errors.size());
-						std::move(sub_errors.begin(), sub_errors.end(), std::back_inserter(e.errors));
-					}
-				}
+		} else if (obj->find("_errors") != obj->end()) {
+			/* An object of error messages (rare) */
+			e.errors.reserve((*obj)["_errors"].size());
+			for (auto errordetails = (*obj)["_errors"].begin(); errordetails != (*obj)["_errors"].end(); ++errordetails) {
+				error_detail detail;
+				detail.code = (*errordetails)["code"].get<std::string>();
+				detail.reason = (*errordetails)["message"].get<std::string>();
+				detail.object.clear();
+				detail.field = obj.key();
+				detail.index = 0;
+				e.errors.emplace_back(detail);
 			}
-		}
+		} else {
+			/* An object that has a subobject with errors */
+			for (auto index = obj->begin(); index != obj->end(); ++index) {
+				int array_index = std::atoll(index.key().c_str());
+				auto sub_errors = find_errors_in_array(obj.key(), array_index, {}, index->begin(), index->end());
 
-		e.human_readable = std::to_string(e.code) + ": " + e.message;
-		std::string prefix = e.errors.size() == 1 ? " " : "\n\t";
-		for (const auto& error : e.errors) {
-			if (error.object.empty()) {
-				/* A singular field with an error in an unnamed object */
-				e.human_readable += prefix + "- " + error.field + ": " + error.reason + " (" + error.code + ")";
-			} else if (isdigit(*(error.object.c_str()))) {
-				/* An unnamed array of objects where one or more generated an error, e.g. slash command bulk registration */
-				e.human_readable += prefix + "- <array>[" + error.object + "]." + error.field + ": " + error.reason + " (" + error.code + ")";
-			} else {
-				/* A named array of objects whre a field in the object has an error */
-				e.human_readable += prefix + "- " + error.object + "[" + std::to_string(error.index) + "]." + error.field + ": " + error.reason + " (" + error.code + ")";
+				if (!sub_errors.empty()) {
+					e.errors.reserve(e.errors.capacity() + sub_errors.size());
+					std::move(sub_errors.begin(), sub_errors.end(), std::back_inserter(e.errors));
+				}
 			}
 		}
+	}
 
-		return e;
+	e.human_readable = std::to_string(e.code) + ": " + e.message;
+	std::string prefix = e.errors.size() == 1 ? " " : "\n\t";
+	for (const auto& error : e.errors) {
+		if (error.object.empty()) {
+			/* A singular field with an error in an unnamed object */
+			e.human_readable += prefix + "- " + error.field + ": " + error.reason + " (" + error.code + ")";
+		} else if (isdigit(*(error.object.c_str()))) {
+			/* An unnamed array of objects where one or more generated an error, e.g. slash command bulk registration */
+			e.human_readable += prefix + "- <array>[" + error.object + "]." + error.field + ": " + error.reason + " (" + error.code + ")";
+		} else {
+			/* A named array of objects whre a field in the object has an error */
+			e.human_readable += prefix + "- " + error.object + "[" + std::to_string(error.index) + "]." + error.field + ": " + error.reason + " (" + error.code + ")";
+		}
 	}
-	return error_info();
+
+	return e;
 }
 
 } // namespace dpp
@@ -43,6 +43,14 @@ void cluster::message_create(const message &m, command_completion_event_t callba
 	}, m.file_data);
 }
 
+void cluster::message_create_typed(const message &m, typed_completion_event_t<message> callback) {
+	this->post_rest_multipart(API_PATH "/channels", std::to_string(m.channel_id), "messages", m_post, m.build_json(), [this, callback](json &j, const http_request_completion_t& http) {
+		if (callback) {
+			callback(rest_result<message>::from_response(this, j, http));
+		}
+	}, m.file_data);
+}
+
 
 void cluster::message_crosspost(snowflake message_id, snowflake channel_id, command_completion_event_t callback) {
 	rest_request<message>(this, API_PATH "/channels", std::to_string(channel_id), "messages/" + std::to_string(message_id) + "/crosspost", m_post, "", callback);
@@ -119,6 +127,14 @@ void cluster::message_edit(const message &m, command_completion_event_t callback
 	}, m.file_data);
 }
 
+void cluster::message_edit_typed(const message &m, typed_completion_event_t<message> callback) {
+	this->post_rest_multipart(API_PATH "/channels", std::to_string(m.channel_id), "messages/" + std::to_string(m.id), m_patch, m.build_json(true), [this, callback](json &j, const http_request_completion_t& http) {
+		if (callback) {
+			callback(rest_result<message>::from_response(this, j, http));
+		}
+	}, m.file_data);
+}
+
 void cluster::message_edit_flags(const message &m, command_completion_event_t callback) {
 	this->post_rest_multipart(API_PATH "/channels", std::to_string(m.channel_id), "messages/" + std::to_string(m.id), m_patch, nlohmann::json{
 		{"flags", m.flags},
@@ -134,6 +150,10 @@ void cluster::message_get(snowflake message_id, snowflake channel_id, command_co
 	rest_request<message>(this, API_PATH "/channels", std::to_string(channel_id), "messages/" + std::to_string(message_id), m_get, "", callback);
 }
 
+void cluster::message_get_typed(snowflake message_id, snowflake channel_id, typed_completion_event_t<message> callback) {
+	rest_request_typed<message>(this, API_PATH "/channels", std::to_string(channel_id), "messages/" + std::to_string(message_id), m_get, "", callback);
+}
+
 
 void cluster::message_get_reactions(const struct message &m, const std::string &reaction, snowflake before, snowflake after, snowflake limit, command_completion_event_t callback) {
 	std::string parameters = utility::make_url_parameters({
@@ -92,6 +92,10 @@ void cluster::user_get(snowflake user_id, command_completion_event_t callback) {
 	rest_request<user_identified>(this, API_PATH "/users", std::to_string(user_id), "", m_get, "", callback);
 }
 
+void cluster::user_get_typed(snowflake user_id, typed_completion_event_t<user_identified> callback) {
+	rest_request_typed<user_identified>(this, API_PATH "/users", std::to_string(user_id), "", m_get, "", callback);
+}
+
 void cluster::user_get_cached(snowflake user_id, command_completion_event_t callback) {
 	user* u = find_user(user_id);
 	if (u) {
@@ -198,6 +198,12 @@ void commandhandler::route(const struct dpp::message_create_t& event)
 				return;
 			}
 
+			/* Refuse rate limited uses before parsing anything */
+			command_source source(event);
+			if (!check_rate_limits(command, found_cmd->second, source)) {
+				return;
+			}
+
 			parameter_list_t call_params;
 
 			/* Command found; parse parameters */
@@ -293,7 +299,7 @@ void commandhandler::route(const struct dpp::message_create_t& event)
 			}
 
 			/* Call command handler */
-			found_cmd->second.func(command, call_params, command_source(event));
+			found_cmd->second.func(command, call_params, source);
 		}
 	}
 }
@@ -307,6 +313,12 @@ void commandhandler::route(const struct slashcommand_t & event)
 
 	auto found_cmd = commands.find(lowercase(cmd.name));
 	if (found_cmd != commands.end()) {
+		/* Refuse rate limited uses before parsing anything */
+		command_source source(event);
+		if (!check_rate_limits(cmd.name, found_cmd->second, source)) {
+			return;
+		}
+
 		/* Command found; parse parameters */
 		parameter_list_t call_params;
 		for (auto& p : found_cmd->second.parameters) {
@@ -404,8 +416,57 @@ void commandhandler::route(const struct slashcommand_t & event)
 		}
 
 		/* Call command handler */
-		found_cmd->second.func(cmd.name, call_params, command_source(event));
+		found_cmd->second.func(cmd.name, call_params, source);
+	}
+}
+
+commandhandler& commandhandler::add_rate_limit(const std::string &command, const rate_rule &rule)
+{
+	auto found_cmd = commands.find(lowercase(command));
+	if (found_cmd == commands.end()) {
+		throw dpp::logic_exception(err_rate_rule, "Cannot add a rate limit to unknown command " + command);
+	}
+	if (!rate_limits) {
+		rate_limits = std::make_unique<rate_controller>();
+	}
+	found_cmd->second.rate_rules.push_back(rate_limits->add_rule(rule));
+	return *this;
+}
+
+commandhandler& commandhandler::set_rate_limited_handler(command_rate_limited_handler handler)
+{
+	rate_limited = std::move(handler);
+	return *this;
+}
+
+bool commandhandler::check_rate_limits(const std::string& command, const command_info_t& info, const command_source& source)
+{
+	if (info.rate_rules.empty()) {
+		return true;
+	}
+	auto key_for = [&source](rate_scope scope) -> snowflake {
+		switch (scope) {
+			case rs_user:
+				return source.issuer.id;
+			case rs_guild:
+				return source.guild_id;
+			case rs_channel:
+				return source.channel_id;
+			default:
+				return 0;
+		}
+	};
+	/* Checked and counted as one step, and a use refused by one rule is not counted against the others */
+	std::vector<std::pair<rate_rule_id, snowflake>> uses;
+	uses.reserve(info.rate_rules.size());
+	for (rate_rule_id id : info.rate_rules) {
+		uses.emplace_back(id, key_for(rate_limits->get_rule(id).scope));
+	}
+	rate_decision decision = rate_limits->consume_all(uses);
+	if (!decision.allowed && rate_limited) {
+		rate_limited(command, decision, source);
 	}
+	return decision.allowed;
 }
 
 void commandhandler::reply(const dpp::message &m, command_source source, command_completion_event_t callback)
@@ -27,9 +27,9 @@
 #include <dpp/cache.h>
 #include <dpp/cluster.h>
 #include <thread>
+#include <algorithm>
 #include <dpp/json.h>
 #include <dpp/etf.h>
-#include <zlib.h>
 #ifdef _WIN32
 	#include <WinSock2.h>
 	#include <WS2tcpip.h>
@@ -47,7 +47,6 @@
 #define PATH_COMPRESSED_JSON	"/?v=" DISCORD_API_VERSION "&encoding=json&compress=zlib-stream"
 #define PATH_UNCOMPRESSED_ETF	"/?v=" DISCORD_API_VERSION "&encoding=etf"
 #define PATH_COMPRESSED_ETF	"/?v=" DISCORD_API_VERSION "&encoding=etf&compress=zlib-stream"
-#define DECOMP_BUFFER_SIZE	512 * 1024
 
 #define STRINGIFY(a) STRINGIFY_(a)
 #define STRINGIFY_(a) #a
@@ -58,18 +57,14 @@
 
 namespace dpp {
 
+namespace {
+
 /**
- * @brief This is an opaque class containing zlib library specific structures.
- * We define it this way so that the public facing D++ library doesn't require
- * the zlib headers be available to build against it.
+ * @brief Compressed frames at least this large are inflated while they are still arriving
  */
-class zlibcontext {
-public:
-	/**
-	 * @brief Zlib stream struct
-	 */
-	z_stream d_stream;
-};
+constexpr size_t stream_frame_threshold = 64 * 1024;
+
+}
 
 /**
  * @brief Stores the most recent ping message on this shard, which we check for to monitor latency
@@ -79,10 +74,10 @@ thread_local static std::string last_ping_message;
 discord_client::discord_client(dpp::cluster* _cluster, uint32_t _shard_id, uint32_t _max_shards, const std::string &_token, uint32_t _intents, bool comp, websocket_protocol_t ws_proto)
        : websocket_client(_cluster->default_gateway, "443", comp ? (ws_proto == ws_json ? PATH_COMPRESSED_JSON : PATH_COMPRESSED_ETF) : (ws_proto == ws_json ? PATH_UNCOMPRESSED_JSON : PATH_UNCOMPRESSED_ETF)),
         terminating(false),
+	member_requests(_cluster),
         runner(nullptr),
 	compressed(comp),
-	decomp_buffer(nullptr),
-	zlib(nullptr),
+	inflate_failed(false),
 	decompressed_total(0),
 	connect_time(0),
 	ping_start(0.0),
@@ -101,17 +96,18 @@ discord_client::discord_client(dpp::cluster* _cluster, uint32_t _shard_id, uint3
 	ready(false),
 	last_heartbeat_ack(time(nullptr)),
 	protocol(ws_proto),
-	resume_gateway_url(_cluster->default_gateway)	
+	resume_gateway_url(_cluster->default_gateway)
 {
-	try {
-		zlib = new zlibcontext();
-		etf = new etf_parser();
-	}
-	catch (std::bad_alloc&) {
-		delete zlib;
-		delete etf;
-		/* Clean up and rethrow to caller */
-		throw std::bad_alloc();
+	etf = new etf_parser();
+	if (_cluster->get_event_queue()) {
+		events = std::make_unique<event_queue>(*_cluster->get_event_queue(), [this](const std::string& event, json& j, const std::string& raw) {
+			try {
+				dispatch_event(event, j, raw);
+			}
+			catch (const std::exception& e) {
+				log(dpp::ll_error, "Exception dispatching " + event + ": " + std::string(e.what()));
+			}
+		}, "events/" + std::to_string(shard_id));
 	}
 	try {
 		this->connect();
@@ -122,15 +118,23 @@ discord_client::discord_client(dpp::cluster* _cluster, uint32_t _shard_id, uint3
 	}
 }
 
-void discord_client::cleanup()
+void discord_client::stop()
 {
 	terminating = true;
 	if (runner) {
 		runner->join();
 		delete runner;
+		runner = nullptr;
 	}
+	events.reset();
+	std::unique_lock lock(voice_mutex);
+	connecting_voice_channels.clear();
+}
+
+void discord_client::cleanup()
+{
+	stop();
 	delete etf;
-	delete zlib;
 }
 
 discord_client::~discord_client()
@@ -143,28 +147,23 @@ uint64_t discord_client::get_decompressed_bytes_in()
 	return decompressed_total;
 }
 
+event_queue_stats discord_client::get_event_queue_stats() const
+{
+	return events ? events->get_stats() : event_queue_stats();
+}
+
 void discord_client::setup_zlib()
 {
 	if (compressed) {
-		zlib->d_stream.zalloc = (alloc_func)0;
-		zlib->d_stream.zfree = (free_func)0;
-		zlib->d_stream.opaque = (voidpf)0;
-		int error = inflateInit(&(zlib->d_stream));
-		if (error != Z_OK) {
-			throw dpp::connection_exception((exception_error_code)error, "Can't initialise stream compression!");
-		}
-		this->decomp_buffer = new unsigned char[DECOMP_BUFFER_SIZE];
+		zlib = std::make_unique<zlibcontext>();
+		decompressed.clear();
+		inflate_failed = false;
 	}
-
 }
 
 void discord_client::end_zlib()
 {
-	if (compressed) {
-		inflateEnd(&(zlib->d_stream));
-		delete[] this->decomp_buffer;
-		this->decomp_buffer = nullptr;
-	}
+	zlib.reset();
 }
 
 void discord_client::set_resume_hostname()
@@ -222,58 +221,60 @@ void discord_client::run()
 
 bool discord_client::handle_frame(const std::string &buffer)
 {
-	std::string& data = (std::string&)buffer;
+	alloc_scope scope(as_decode);
 
 	/* gzip compression is a special case */
 	if (compressed) {
-		/* Check that we have a complete compressed frame */
-		if ((uint8_t)buffer[buffer.size() - 4] == 0x00 && (uint8_t)buffer[buffer.size() - 3] == 0x00 && (uint8_t)buffer[buffer.size() - 2] == 0xFF
-		&& (uint8_t)buffer[buffer.size() - 1] == 0xFF) {
-			/* Decompress buffer */
-			decompressed.clear();
-			zlib->d_stream.next_in = (Bytef *)buffer.c_str();
-			zlib->d_stream.avail_in = (uInt)buffer.size();
-			do {
-				int have = 0;
-				zlib->d_stream.next_out = (Bytef*)decomp_buffer;
-				zlib->d_stream.avail_out = DECOMP_BUFFER_SIZE;
-				int ret = inflate(&(zlib->d_stream), Z_NO_FLUSH);
-				have = DECOMP_BUFFER_SIZE - zlib->d_stream.avail_out;
-				switch (ret)
-				{
-					case Z_NEED_DICT:
-					case Z_STREAM_ERROR:
-						this->error(err_compression_stream);
-						this->close();
-						return true;
-					break;
-					case Z_DATA_ERROR:
-						this->error(err_compression_data);
-						this->close();
-						return true;
-					break;
-					case Z_MEM_ERROR:
-						this->error(err_compression_memory);
-						this->close();
-						return true;
-					break;
-					case Z_OK:
-						this->decompressed.append((const char*)decomp_buffer, have);
-						this->decompressed_total += have;
-					break;
-					default:
-						/* Stub */
-					break;
-				}
-			} while (zlib->d_stream.avail_out == 0);
-			data = decompressed;
-		} else {
-			/* No complete compressed frame yet */
+		if (!inflate_input(buffer)) {
+			return true;
+		}
+		if (!zlib->message_complete()) {
+			/* No complete compressed message yet, the rest is in the next frame */
 			return false;
 		}
+		bool handled = handle_payload(decompressed);
+		decompressed.clear();
+		return handled;
 	}
+	return handle_payload(buffer);
+}
+
+size_t discord_client::get_stream_threshold() const
+{
+	return compressed ? stream_frame_threshold : 0;
+}
 
+void discord_client::handle_frame_data(std::string_view chunk, bool first, bool last)
+{
+	alloc_scope scope(as_decode);
+	if (!inflate_input(chunk)) {
+		return;
+	}
+	if (last && zlib->message_complete()) {
+		handle_payload(decompressed);
+		decompressed.clear();
+	}
+}
 
+bool discord_client::inflate_input(std::string_view input)
+{
+	if (inflate_failed) {
+		return false;
+	}
+	const size_t before = decompressed.size();
+	exception_error_code error = zlib->decompress(input, decompressed);
+	if (error != err_no_code_specified) {
+		inflate_failed = true;
+		this->error(error);
+		this->close();
+		return false;
+	}
+	this->decompressed_total += decompressed.size() - before;
+	return true;
+}
+
+bool discord_client::handle_payload(const std::string &data)
+{
 	json j;
 	
 	/**
@@ -525,6 +526,10 @@ void discord_client::one_second_timer()
 			return;
 		}
 
+		for (auto& payload : member_requests.build_requests(intents & dpp::i_guild_presences)) {
+			queue_message(jsonobj_to_string(payload));
+		}
+
 		/* Rate limit outbound messages, 1 every odd second, 2 every even second */
 		for (int x = 0; x < (time(nullptr) % 2) + 1; ++x) {
 			std::unique_lock locker(queue_mutex);
@@ -684,6 +689,157 @@ voiceconn* discord_client::get_voice(snowflake guild_id) {
 }
 
 
+namespace {
+
+/**
+ * @brief Build the result passed to a lazy member request callback which failed.
+ * The body is shaped like a Discord REST error so is_error() and get_error() behave
+ * the same as they would for cluster::guild_get_member.
+ */
+confirmation_callback_t member_request_error(cluster* creator, uint16_t status, uint32_t code, const std::string& message) {
+	http_request_completion_t http;
+	http.status = status;
+	http.body = json({{"code", code}, {"message", message}, {"errors", json::object()}}).dump();
+	return confirmation_callback_t(creator, confirmation(), http);
+}
+
+/**
+ * @brief Lazy member requests which have not had a reply after this many seconds fail
+ */
+constexpr time_t member_request_timeout = 30;
+
+/**
+ * @brief Maximum number of user ids Discord accepts in one REQUEST_GUILD_MEMBERS
+ */
+constexpr size_t member_request_max_ids = 100;
+
+}
+
+member_request_queue::member_request_queue(cluster* owner) : creator(owner) {
+}
+
+void member_request_queue::request(snowflake guild_id, snowflake user_id, command_completion_event_t callback) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& waiting = callbacks[std::make_pair(guild_id, user_id)];
+	if (waiting.empty()) {
+		/* Only request each user once, however many callers want it */
+		pending[guild_id].push_back(user_id);
+	}
+	waiting.emplace_back(std::move(callback));
+}
+
+std::vector<json> member_request_queue::build_requests(bool presences) {
+	std::vector<json> payloads;
+	std::vector<std::pair<snowflake, snowflake>> timed_out;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		time_t now = time(nullptr);
+		for (auto batch = batches.begin(); batch != batches.end();) {
+			if (now - batch->second.sent >= member_request_timeout) {
+				for (snowflake user_id : batch->second.user_ids) {
+					timed_out.emplace_back(batch->second.guild_id, user_id);
+				}
+				batch = batches.erase(batch);
+			} else {
+				++batch;
+			}
+		}
+		for (auto& [guild_id, user_ids] : pending) {
+			for (size_t start = 0; start < user_ids.size(); start += member_request_max_ids) {
+				std::vector<snowflake> ids(user_ids.begin() + start, user_ids.begin() + std::min(start + member_request_max_ids, user_ids.size()));
+				std::string batch_nonce = std::to_string(++nonce);
+				json ids_json = json::array();
+				for (snowflake id : ids) {
+					ids_json.push_back(std::to_string(id));
+				}
+				json req = json({{"op", 8}, {"d", {{"guild_id", std::to_string(guild_id)}, {"user_ids", ids_json}, {"nonce", batch_nonce}}}});
+				if (presences) {
+					req["d"]["presences"] = true;
+				}
+				payloads.emplace_back(std::move(req));
+				batches[batch_nonce] = member_request_batch{guild_id, std::move(ids), now};
+			}
+		}
+		pending.clear();
+	}
+	for (auto& [guild_id, user_id] : timed_out) {
+		complete(guild_id, user_id, member_request_error(creator, 408, 0, "Timed out waiting for guild member chunk"));
+	}
+	return payloads;
+}
+
+void member_request_queue::chunk_received(json& d) {
+	std::string batch_nonce = string_not_null(&d, "nonce");
+	if (batch_nonce.empty()) {
+		return;
+	}
+	snowflake guild_id = snowflake_not_null(&d, "guild_id");
+	std::vector<std::pair<snowflake, guild_member>> received;
+	std::vector<snowflake> not_found;
+	if (d.find("members") != d.end()) {
+		for (auto & userrec : d["members"]) {
+			snowflake user_id = snowflake_not_null(&userrec["user"], "id");
+			dpp::guild_member gm;
+			gm.fill_from_json(&userrec, guild_id, user_id);
+			received.emplace_back(user_id, gm);
+		}
+	}
+	if (d.find("not_found") != d.end()) {
+		for (auto & id : d["not_found"]) {
+			not_found.push_back(id.is_string() ? snowflake(id.get<std::string>()) : snowflake(id.get<uint64_t>()));
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto batch = batches.find(batch_nonce);
+		if (batch == batches.end()) {
+			return;
+		}
+		std::vector<snowflake>& unanswered = batch->second.user_ids;
+		auto answered = [&received, &not_found](snowflake id) {
+			return std::find(not_found.begin(), not_found.end(), id) != not_found.end() ||
+				std::find_if(received.begin(), received.end(), [id](const auto& r) { return r.first == id; }) != received.end();
+		};
+		unanswered.erase(std::remove_if(unanswered.begin(), unanswered.end(), answered), unanswered.end());
+		/* Requests by user id can still be split into chunks, the batch is done on the last one */
+		if (int32_not_null(&d, "chunk_index") + 1 >= int32_not_null(&d, "chunk_count")) {
+			not_found.insert(not_found.end(), unanswered.begin(), unanswered.end());
+			batches.erase(batch);
+		}
+	}
+	http_request_completion_t http;
+	http.status = 200;
+	for (auto& [user_id, gm] : received) {
+		complete(guild_id, user_id, confirmation_callback_t(creator, gm, http));
+	}
+	for (snowflake user_id : not_found) {
+		complete(guild_id, user_id, member_request_error(creator, 404, 10007, "Unknown Member"));
+	}
+}
+
+void member_request_queue::complete(snowflake guild_id, snowflake user_id, const confirmation_callback_t& result) {
+	std::vector<command_completion_event_t> waiting;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto w = callbacks.find(std::make_pair(guild_id, user_id));
+		if (w == callbacks.end()) {
+			return;
+		}
+		waiting = std::move(w->second);
+		callbacks.erase(w);
+	}
+	for (auto& callback : waiting) {
+		if (callback) {
+			callback(result);
+		}
+	}
+}
+
+discord_client& discord_client::request_member(snowflake guild_id, snowflake user_id, command_completion_event_t callback) {
+	member_requests.request(guild_id, user_id, std::move(callback));
+	return *this;
+}
+
 voiceconn::voiceconn(discord_client* o, snowflake _channel_id) : creator(o), channel_id(_channel_id), voiceclient(nullptr) {
 }
 
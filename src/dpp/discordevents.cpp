@@ -35,9 +35,11 @@
 #include <stdlib.h>
 #include <dpp/discordevents.h>
 #include <dpp/discordclient.h>
+#include <dpp/cluster.h>
 #include <dpp/event.h>
 #include <dpp/cache.h>
 #include <dpp/stringops.h>
+#include <dpp/textkernels.h>
 #include <dpp/json.h>
 #include <time.h>
 #include <iomanip>
@@ -248,6 +250,11 @@ std::string base64_encode(unsigned char const* buf, unsigned int buffer_length)
 
 	ret.reserve(ret_size);
 
+	/* Whole blocks are encoded a vector at a time, the rest below */
+	ret.resize(4 * (buffer_length / 3));
+	i = text::base64_encode_blocks(buf, buffer_length, ret.data());
+	ret.resize(4 * (i / 3));
+
 	if (buffer_length > 2) { //    vvvvv avoid unsigned overflow
 		while (i < buffer_length - 2) {
 			push(ret, buf[i], buf[i + 1], buf[i + 2]);
@@ -419,13 +426,24 @@ static const std::map<std::string, dpp::events::event*> event_map = {
 
 void discord_client::handle_event(const std::string &event, json &j, const std::string &raw)
 {
+	/* READY and RESUMED set up the session, so they are never held back behind other events */
+	if (events && event != "READY" && event != "RESUMED") {
+		events->push(event, j, raw);
+		return;
+	}
+	dispatch_event(event, j, raw);
+}
+
+void discord_client::dispatch_event(const std::string &event, json &j, const std::string &raw)
+{
+	alloc_scope scope(as_events);
 	auto ev_iter = event_map.find(event);
 	if (ev_iter != event_map.end()) {
 		/* A handler with nullptr is silently ignored. We don't plan to make a handler for it
 		 * so this usually some user-only thing that's crept into the API and shown to bots
 		 * that we dont care about.
 		 */
-		if (ev_iter->second != nullptr) {
+		if (ev_iter->second != nullptr && creator->accept_event(this, event, j)) {
 			ev_iter->second->handle(this, j, raw);
 		}
 	} else {
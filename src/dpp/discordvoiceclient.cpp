@@ -81,6 +81,124 @@ moving_averager::operator float() {
 	}
 }
 
+size_t voice_track_mixer::track::queued() const {
+	return pcm.size() - read_pos;
+}
+
+voice_track_mixer::voice_track_mixer() : queued_samples(0), mixer(std::make_unique<audio_mixer>()) {
+}
+
+voice_track_mixer::~voice_track_mixer() = default;
+
+void voice_track_mixer::queue(const std::string& name, const int16_t* pcm, size_t samples) {
+	std::lock_guard<std::mutex> lock(mix_mutex);
+	track& t = tracks[name];
+	t.pcm.insert(t.pcm.end(), pcm, pcm + samples);
+	queued_samples += samples;
+}
+
+void voice_track_mixer::set_gain(const std::string& name, float gain) {
+	std::lock_guard<std::mutex> lock(mix_mutex);
+	tracks[name].gain = gain;
+}
+
+void voice_track_mixer::set_ducking(const std::string& name, float duck_gain) {
+	std::lock_guard<std::mutex> lock(mix_mutex);
+	tracks[name].duck_gain = duck_gain;
+}
+
+void voice_track_mixer::clear(const std::string& name) {
+	std::lock_guard<std::mutex> lock(mix_mutex);
+	auto t = tracks.find(name);
+	if (t != tracks.end()) {
+		queued_samples -= t->second.queued();
+		tracks.erase(t);
+	}
+}
+
+size_t voice_track_mixer::get_queued(const std::string& name) {
+	std::lock_guard<std::mutex> lock(mix_mutex);
+	auto t = tracks.find(name);
+	return t != tracks.end() ? t->second.queued() : 0;
+}
+
+bool voice_track_mixer::has_audio() const {
+	return queued_samples > 0;
+}
+
+bool voice_track_mixer::mix(int16_t* out, size_t samples) {
+	/* 16 is the widest register of any mixer, so this is a multiple of byte_blocks_per_register whichever is in use */
+	if (samples % 16 != 0) {
+		throw dpp::voice_exception(err_invalid_voice_packet_length, "voice_track_mixer::mix: sample count must be a multiple of 16");
+	}
+	std::lock_guard<std::mutex> lock(mix_mutex);
+	if (queued_samples == 0) {
+		return false;
+	}
+	const size_t block = audio_mixer::byte_blocks_per_register;
+	mix_buffer.assign(samples, 0);
+	scaled_buffer.resize(samples);
+	/* Decide which tracks duck the others before any are consumed, so the result does not depend on track names */
+	for (auto& [name, t] : tracks) {
+		t.active = t.queued() > 0;
+	}
+	for (auto& [name, t] : tracks) {
+		/* Each track is ducked by every other track which has audio in this frame */
+		float target_gain = t.gain;
+		for (const auto& [other_name, other] : tracks) {
+			if (&other != &t && other.active) {
+				target_gain *= other.duck_gain;
+			}
+		}
+		size_t available = std::min(t.queued(), samples);
+		if (available == 0) {
+			t.current_gain = target_gain;
+			continue;
+		}
+		const int16_t* pcm = t.pcm.data() + t.read_pos;
+		if (available < samples) {
+			/* End of the track, pad the rest of the frame with silence */
+			std::copy(pcm, pcm + available, scaled_buffer.begin());
+			std::fill(scaled_buffer.begin() + available, scaled_buffer.end(), 0);
+			pcm = scaled_buffer.data();
+		}
+		float increment = (target_gain - t.current_gain) / static_cast<float>(samples);
+		if (t.current_gain == 1.0f && increment == 0.0f) {
+			for (size_t x = 0; x < samples; x += block) {
+				mixer->combine_samples(mix_buffer.data() + x, pcm + x);
+			}
+		} else {
+			/* Widen, apply the gain ramp with clipping, then add to the mix */
+			track_buffer.assign(samples, 0);
+			for (size_t x = 0; x < samples; x += block) {
+				mixer->combine_samples(track_buffer.data() + x, pcm + x);
+			}
+			float gain = t.current_gain;
+			for (size_t x = 0; x < samples; x += block) {
+				mixer->collect_single_register(track_buffer.data() + x, scaled_buffer.data() + x, gain, increment);
+				gain += increment * static_cast<float>(block);
+			}
+			for (size_t x = 0; x < samples; x += block) {
+				mixer->combine_samples(mix_buffer.data() + x, scaled_buffer.data() + x);
+			}
+		}
+		t.current_gain = target_gain;
+		t.read_pos += available;
+		queued_samples -= available;
+		if (t.read_pos == t.pcm.size()) {
+			t.pcm.clear();
+			t.read_pos = 0;
+		} else if (t.read_pos > t.pcm.size() / 2) {
+			t.pcm.erase(t.pcm.begin(), t.pcm.begin() + static_cast<std::ptrdiff_t>(t.read_pos));
+			t.read_pos = 0;
+		}
+	}
+	for (size_t x = 0; x < samples; x += block) {
+		mixer->collect_single_register(mix_buffer.data() + x, out + x, 1.0f, 0.0f);
+	}
+	return true;
+}
+
 [[maybe_unused]]
 constexpr int32_t opus_sample_rate_hz = 48000;
 [[maybe_unused]]
@@ -142,14 +260,14 @@ bool discord_voice_client::voice_payload::operator<(const voice_payload& other)
 }
 
 #ifdef HAVE_VOICE
-size_t audio_mix(discord_voice_client& client, audio_mixer& mixer, opus_int32* pcm_mix, const opus_int16* pcm, size_t park_count, int samples, int& max_samples) {
+size_t audio_mix(discord_voice_client& client, audio_mixer& mixer, opus_int32* pcm_mix, const opus_int16* pcm, size_t park_count, int samples, int channels, int& max_samples) {
 	/* Mix the combined stream if combined audio is bound */
 	if (client.creator->on_voice_receive_combined.empty()) {
 		return 0;
 	}
 
 	/* We must upsample the data to 32 bits wide, otherwise we could overflow */
-	for (opus_int32 v = 0; v < (samples * opus_channel_count) / mixer.byte_blocks_per_register; ++v) {
+	for (opus_int32 v = 0; v < (samples * channels) / mixer.byte_blocks_per_register; ++v) {
 		mixer.combine_samples(pcm_mix, pcm);
 		pcm += mixer.byte_blocks_per_register;
 		pcm_mix += mixer.byte_blocks_per_register;
@@ -163,6 +281,7 @@ size_t audio_mix(discord_voice_client& client, audio_mixer& mixer, opus_int32* p
 void discord_voice_client::voice_courier_loop(discord_voice_client& client, courier_shared_state_t& shared_state) {
 #ifdef HAVE_VOICE
 	utility::set_thread_name(std::string("vcourier/") + std::to_string(client.server_id));
+	alloc_scope scope(as_voice);
 	while (true) {
 		std::this_thread::sleep_for(std::chrono::milliseconds{client.iteration_interval});
 		
@@ -174,6 +293,9 @@ void discord_voice_client::voice_courier_loop(discord_voice_client& client, cour
 			std::shared_ptr<OpusDecoder> decoder;
 		};
 		std::vector<flush_data_t> flush_data;
+		uint32_t sample_rate;
+		uint8_t channels;
+		voice_sample_format_t format;
 
 		/*
 		 * Transport the payloads onto this thread, and
@@ -182,6 +304,11 @@ void discord_voice_client::voice_courier_loop(discord_voice_client& client, cour
 		{
 			std::unique_lock lk(shared_state.mtx);
 
+			/* The decoders taken below were all created with this format, set_receive_format replaces them together */
+			sample_rate = client.receive_sample_rate;
+			channels = client.receive_channels;
+			format = client.receive_format;
+
 			/* mitigates vector resizing while holding the mutex */
 			flush_data.reserve(shared_state.parked_voice_payloads.size());
 
@@ -231,6 +358,9 @@ void discord_voice_client::voice_courier_loop(discord_voice_client& client, cour
 		int max_samples = 0;
 		int samples = 0;
 
+		/* The largest opus frame is 120ms, which is 5760 samples per channel at 48kHz */
+		const int max_frame_size = 5760 * static_cast<int>(sample_rate) / opus_sample_rate_hz;
+
 		for (auto& d : flush_data) {
 			if (!d.decoder) {
 				continue;
@@ -245,16 +375,16 @@ void discord_voice_client::voice_courier_loop(discord_voice_client& client, cour
 					 * Lost a packet with sequence number "seq",
 					 * But Opus decoder might be able to guess something.
 					 */
-					if (int samples = opus_decode(d.decoder.get(), nullptr, 0, pcm, 5760, 0);
+					if (int samples = opus_decode(d.decoder.get(), nullptr, 0, pcm, max_frame_size, 0);
 					    samples >= 0) {
 						/*
 						 * Since this sample comes from a lost packet,
 						 * we can only pretend there is an event, without any raw payload byte.
 						 */
-						voice_receive_t vr(nullptr, "", &client, d.user_id, reinterpret_cast<uint8_t*>(pcm),
-							samples * opus_channel_count * sizeof(opus_int16));
+						voice_receive_t vr(nullptr, "", &client, d.user_id, nullptr, 0);
+						client.set_received_audio(vr, d.user_id, pcm, samples * channels, sample_rate, channels, format);
 
-						park_count = audio_mix(client, *client.mixer, pcm_mix, pcm, park_count, samples, max_samples);
+						park_count = audio_mix(client, *client.mixer, pcm_mix, pcm, park_count, samples, channels, max_samples);
 						client.creator->on_voice_receive.call(vr);
 					}
 				} else {
@@ -263,12 +393,11 @@ void discord_voice_client::voice_courier_loop(discord_voice_client& client, cour
 						throw dpp::length_exception(err_massive_audio, "audio_data > 2GB! This should never happen!");
 					}
 					if (samples = opus_decode(d.decoder.get(), vr.audio_data.data(),
-						static_cast<opus_int32>(vr.audio_data.length() & 0x7FFFFFFF), pcm, 5760, 0);
+						static_cast<opus_int32>(vr.audio_data.length() & 0x7FFFFFFF), pcm, max_frame_size, 0);
 					    samples >= 0) {
-						vr.reassign(&client, d.user_id, reinterpret_cast<uint8_t*>(pcm),
-							samples * opus_channel_count * sizeof(opus_int16));
+						client.set_received_audio(vr, d.user_id, pcm, samples * channels, sample_rate, channels, format);
 						client.end_gain = 1.0f / client.moving_average;
-						park_count = audio_mix(client, *client.mixer, pcm_mix, pcm, park_count, samples, max_samples);
+						park_count = audio_mix(client, *client.mixer, pcm_mix, pcm, park_count, samples, channels, max_samples);
 						client.creator->on_voice_receive.call(vr);
 					}
 
@@ -285,15 +414,15 @@ void discord_voice_client::voice_courier_loop(discord_voice_client& client, cour
 			opus_int16* pcm_downsample_ptr = pcm_downsample;
 			opus_int32* pcm_mix_ptr = pcm_mix;
 			client.increment = (client.end_gain - client.current_gain) / static_cast<float>(samples);
-			for (int64_t x = 0; x < (samples * opus_channel_count) / client.mixer->byte_blocks_per_register; ++x) {
+			for (int64_t x = 0; x < (samples * channels) / client.mixer->byte_blocks_per_register; ++x) {
 				client.mixer->collect_single_register(pcm_mix_ptr, pcm_downsample_ptr, client.current_gain, client.increment);
 				client.current_gain += client.increment * static_cast<float>(client.mixer->byte_blocks_per_register);
 				pcm_mix_ptr += client.mixer->byte_blocks_per_register;
 				pcm_downsample_ptr += client.mixer->byte_blocks_per_register;
 			}
 
-			voice_receive_t vr(nullptr, "", &client, 0, reinterpret_cast<uint8_t*>(pcm_downsample),
-				max_samples * opus_channel_count * sizeof(opus_int16));
+			voice_receive_t vr(nullptr, "", &client, 0, nullptr, 0);
+			client.set_received_audio(vr, 0, pcm_downsample, max_samples * channels, sample_rate, channels, format);
 
 			client.creator->on_voice_receive_combined.call(vr);
 		}
@@ -317,7 +446,17 @@ discord_voice_client::discord_voice_client(dpp::cluster* _cluster, snowflake _ch
 	sequence(0),
 	timestamp(0),
 	last_timestamp(std::chrono::high_resolution_clock::now()),
+	receive_filter(vrf_all),
+	receive_filter_generation(0),
+	filtered_packets(0),
 	sending(false),
+	silence_suppression(false),
+	silence_threshold(0),
+	trailing_silence_frames(trailing_silence_frame_count),
+	suppressed_frames(0),
+	receive_sample_rate(opus_sample_rate_hz),
+	receive_channels(opus_channel_count),
+	receive_format(vsf_int16),
 	tracks(0),
 	creator(_cluster),
 	terminating(false),
@@ -403,6 +542,7 @@ bool discord_voice_client::is_playing() {
 void discord_voice_client::thread_run()
 {
 	utility::set_thread_name(std::string("vc/") + std::to_string(server_id));
+	alloc_scope scope(as_voice);
 
 	size_t times_looped = 0;
 	time_t last_loop_time = time(nullptr);
@@ -494,6 +634,11 @@ bool discord_voice_client::handle_frame(const std::string &data)
 					   [&u_id](const auto & p) { return p.second == u_id; });
 
 					if (it != ssrc_map.end()) {
+						{
+							std::lock_guard lk(receive_filter_mutex);
+							receive_filter_decisions.erase(it->first);
+							receive_filter_generation++;
+						}
 						ssrc_map.erase(it);
 					}
 
@@ -516,6 +661,12 @@ bool discord_voice_client::handle_frame(const std::string &data)
 					uint32_t u_ssrc = j["d"]["ssrc"].get<uint32_t>();
 					snowflake u_id = snowflake_not_null(&j["d"], "user_id");
 					ssrc_map[u_ssrc] = u_id;
+					{
+						/* The filter decided without knowing who this was, or for someone else */
+						std::lock_guard lk(receive_filter_mutex);
+						receive_filter_decisions.erase(u_ssrc);
+						receive_filter_generation++;
+					}
 
 					if (!creator->on_voice_client_speaking.empty()) {
 						voice_client_speaking_t vcs(nullptr, data);
@@ -733,18 +884,25 @@ void discord_voice_client::read_ready()
 			return;
 		}
 
+		/* Get the User ID of the speaker */
+		uint32_t speaker_ssrc;
+		std::memcpy(&speaker_ssrc, &packet[8], sizeof(uint32_t));
+		speaker_ssrc = ntohl(speaker_ssrc);
+		auto speaker = ssrc_map.find(speaker_ssrc);
+		const snowflake speaker_id = speaker != ssrc_map.end() ? speaker->second : snowflake(0);
+
+		/* Drop filtered speakers before doing any of the expensive work */
+		if (!receive_allowed(speaker_ssrc, speaker_id)) {
+			filtered_packets++;
+			return;
+		}
+
 		voice_payload vp{0, // seq, populate later
 		                 0, // timestamp, populate later
 		                 std::make_unique<voice_receive_t>(nullptr, std::string((char*)buffer, r))};
 
 		vp.vr->voice_client = this;
-
-		{	/* Get the User ID of the speaker */
-			uint32_t speaker_ssrc;
-			std::memcpy(&speaker_ssrc, &packet[8], sizeof(uint32_t));
-			speaker_ssrc = ntohl(speaker_ssrc);
-			vp.vr->user_id = ssrc_map[speaker_ssrc];
-		}
+		vp.vr->user_id = speaker_id;
 
 		/* Get the sequence number of the voice UDP packet */
 		std::memcpy(&vp.seq, &packet[2], sizeof(rtp_seq_t));
@@ -803,7 +961,7 @@ void discord_voice_client::read_ready()
 				range.min_timestamp = vp.timestamp;
 
 				int opus_error = 0;
-				decoder.reset(opus_decoder_create(opus_sample_rate_hz, opus_channel_count, &opus_error),
+				decoder.reset(opus_decoder_create(static_cast<opus_int32>(receive_sample_rate), receive_channels, &opus_error),
 				              &opus_decoder_destroy);
 				if (opus_error) {
 					/**
@@ -843,6 +1001,7 @@ void discord_voice_client::write_ready()
 	bool track_marker_found = false;
 	uint64_t bufsize = 0;
 	send_audio_type_t type = satype_recorded_audio; 
+	bool gap = false;
 	{
 		std::lock_guard<std::mutex> lock(this->stream_mutex);
 		if (!this->paused && outbuf.size()) {
@@ -854,7 +1013,23 @@ void discord_voice_client::write_ready()
 					tracks--;
 				}
 			}
-			if (outbuf.size()) {
+			if (outbuf.size() && outbuf[0].packet.empty()) {
+				/* A gap left by silence suppression. Nothing is sent, but it still takes up time */
+				duration = outbuf[0].duration * timescale;
+				outbuf.erase(outbuf.begin());
+				gap = true;
+				if (this->sending) {
+					this->queue_message(json({
+					{"op", 5},
+					{"d", {
+						{"speaking", 0},
+						{"delay", 0},
+						{"ssrc", ssrc}
+					}}
+					}).dump(), true);
+					sending = false;
+				}
+			} else if (outbuf.size()) {
 				if (this->udp_send(outbuf[0].packet.data(), outbuf[0].packet.length()) == (int)outbuf[0].packet.length()) {
 					duration = outbuf[0].duration * timescale;
 					bufsize = outbuf[0].packet.length();
@@ -863,6 +1038,10 @@ void discord_voice_client::write_ready()
 			}
 		}
 	}
+	if (bufsize) {
+		/* Resumes speaking after a gap left by silence suppression, does nothing otherwise */
+		speak();
+	}
 	if (duration) {
 		if (type == satype_recorded_audio) {
 			std::chrono::nanoseconds latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - last_timestamp);
@@ -895,7 +1074,7 @@ void discord_voice_client::write_ready()
 		}
 
 		last_timestamp = std::chrono::high_resolution_clock::now();
-		if (!creator->on_voice_buffer_send.empty()) {
+		if (!gap && !creator->on_voice_buffer_send.empty()) {
 			voice_buffer_send_t snd(nullptr, "");
 			snd.buffer_size = (int)bufsize;
 			snd.voice_client = this;
@@ -916,6 +1095,16 @@ void discord_voice_client::write_ready()
 			creator->on_voice_track_marker.call(vtm);
 		}
 	}
+	if (track_mixer.has_audio()) {
+		mix_tracks();
+	}
+}
+
+void discord_voice_client::mix_tracks() {
+	std::vector<int16_t> frame(send_audio_raw_max_length / sizeof(int16_t));
+	while (get_secs_remaining() < voice_track_mix_lead && track_mixer.mix(frame.data(), frame.size())) {
+		send_audio_raw(reinterpret_cast<uint16_t*>(frame.data()), send_audio_raw_max_length);
+	}
 }
 
 dpp::utility::uptime discord_voice_client::get_uptime()
@@ -930,7 +1119,7 @@ bool discord_voice_client::is_connected()
 
 dpp::socket discord_voice_client::want_write() {
 	std::lock_guard<std::mutex> lock(this->stream_mutex);
-	if (!this->paused && !outbuf.empty()) {
+	if (!this->paused && (!outbuf.empty() || track_mixer.has_audio())) {
 		return fd;
 	} else {
 		return INVALID_SOCKET;
@@ -1188,6 +1377,194 @@ discord_voice_client& discord_voice_client::send_silence(const uint64_t duration
 	return *this;
 }
 
+discord_voice_client& discord_voice_client::set_silence_suppression(bool enabled, uint16_t threshold) {
+#if HAVE_VOICE
+	opus_encoder_ctl(encoder, OPUS_SET_DTX(enabled ? 1 : 0));
+	silence_suppression = enabled;
+	silence_threshold = threshold;
+	trailing_silence_frames = trailing_silence_frame_count;
+#else
+	throw dpp::voice_exception(err_no_voice_support, "Voice support not enabled in this build of D++");
+#endif
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::set_receive_format(uint32_t sample_rate, uint8_t channels, voice_sample_format_t format) {
+#if HAVE_VOICE
+	if (sample_rate != 8000 && sample_rate != 12000 && sample_rate != 16000 && sample_rate != 24000 && sample_rate != 48000) {
+		throw dpp::voice_exception(err_opus, "Unsupported receive sample rate: " + std::to_string(sample_rate));
+	}
+	if (channels != 1 && channels != 2) {
+		throw dpp::voice_exception(err_opus, "Unsupported receive channel count: " + std::to_string(channels));
+	}
+	std::lock_guard lk(voice_courier_shared_state.mtx);
+	if (sample_rate != receive_sample_rate || channels != receive_channels) {
+		/* Replace the decoders of speakers already heard, so every flush decodes all of them in one format */
+		for (auto& [user_id, parking_lot] : voice_courier_shared_state.parked_voice_payloads) {
+			if (!parking_lot.decoder) {
+				continue;
+			}
+			int opus_error = 0;
+			parking_lot.decoder.reset(opus_decoder_create(static_cast<opus_int32>(sample_rate), channels, &opus_error), &opus_decoder_destroy);
+			if (opus_error) {
+				throw dpp::voice_exception((exception_error_code)(opus_error - 10), "discord_voice_client::set_receive_format; opus_decoder_create() failed");
+			}
+			/* Decoder ctls queued for the old decoder no longer apply */
+			parking_lot.pending_decoder_ctls.clear();
+		}
+	}
+	receive_sample_rate = sample_rate;
+	receive_channels = channels;
+	receive_format = format;
+#else
+	throw dpp::voice_exception(err_no_voice_support, "Voice support not enabled in this build of D++");
+#endif
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::send_track_audio(const std::string& track, const uint16_t* audio_data, const size_t length) {
+#if HAVE_VOICE
+	track_mixer.queue(track, reinterpret_cast<const int16_t*>(audio_data), length / sizeof(int16_t));
+#else
+	throw dpp::voice_exception(err_no_voice_support, "Voice support not enabled in this build of D++");
+#endif
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::set_track_gain(const std::string& track, float gain) {
+	track_mixer.set_gain(track, gain);
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::set_track_ducking(const std::string& track, float duck_gain) {
+	track_mixer.set_ducking(track, duck_gain);
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::clear_track(const std::string& track) {
+	track_mixer.clear(track);
+	return *this;
+}
+
+float discord_voice_client::get_track_secs_remaining(const std::string& track) {
+	return static_cast<float>(track_mixer.get_queued(track)) / static_cast<float>(opus_sample_rate_hz * opus_channel_count);
+}
+
+void discord_voice_client::pcm_to_float(const int16_t* pcm, size_t sample_count, float* out) {
+	/* Plain loop with no dependencies between iterations, so the compiler vectorises it */
+	constexpr float scale = 1.0f / 32768.0f;
+	for (size_t i = 0; i < sample_count; ++i) {
+		out[i] = static_cast<float>(pcm[i]) * scale;
+	}
+}
+
+void discord_voice_client::set_received_audio(voice_receive_t& vr, snowflake user_id, const int16_t* pcm, size_t sample_count, uint32_t sample_rate, uint8_t channels, voice_sample_format_t format) {
+	if (format == vsf_float32) {
+		std::vector<float> converted(sample_count);
+		pcm_to_float(pcm, sample_count, converted.data());
+		vr.reassign(this, user_id, reinterpret_cast<const uint8_t*>(converted.data()), sample_count * sizeof(float));
+	} else {
+		vr.reassign(this, user_id, reinterpret_cast<const uint8_t*>(pcm), sample_count * sizeof(int16_t));
+	}
+	vr.sample_rate = sample_rate;
+	vr.channels = channels;
+	vr.format = format;
+}
+
+uint64_t discord_voice_client::get_suppressed_frames() {
+	return suppressed_frames;
+}
+
+bool discord_voice_client::receive_allowed(uint32_t ssrc, snowflake user_id) {
+	std::unique_lock lk(receive_filter_mutex);
+	if (receive_filter == vrf_all) {
+		return true;
+	}
+	auto decision = receive_filter_decisions.find(ssrc);
+	if (decision != receive_filter_decisions.end()) {
+		return decision->second;
+	}
+	bool allowed = true;
+	switch (receive_filter) {
+		case vrf_allow:
+			allowed = receive_filter_users.find(user_id) != receive_filter_users.end();
+		break;
+		case vrf_deny:
+			allowed = receive_filter_users.find(user_id) == receive_filter_users.end();
+		break;
+		case vrf_predicate: {
+			/* Called unlocked, the predicate is user code and may change the filter */
+			voice_receive_predicate_t predicate = receive_filter_predicate;
+			const uint64_t generation = receive_filter_generation;
+			lk.unlock();
+			allowed = predicate(user_id);
+			lk.lock();
+			if (generation != receive_filter_generation) {
+				return allowed;
+			}
+		}
+		break;
+		default:
+		break;
+	}
+	/* Until the ssrc is mapped to a user the answer may change, so only remember it once the user is known */
+	if (!user_id.empty()) {
+		receive_filter_decisions[ssrc] = allowed;
+	}
+	return allowed;
+}
+
+discord_voice_client& discord_voice_client::set_receive_allow_list(const std::vector<snowflake>& users) {
+	std::lock_guard lk(receive_filter_mutex);
+	receive_filter = vrf_allow;
+	receive_filter_users = std::unordered_set<snowflake>(users.begin(), users.end());
+	receive_filter_predicate = nullptr;
+	receive_filter_decisions.clear();
+	receive_filter_generation++;
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::set_receive_deny_list(const std::vector<snowflake>& users) {
+	std::lock_guard lk(receive_filter_mutex);
+	receive_filter = vrf_deny;
+	receive_filter_users = std::unordered_set<snowflake>(users.begin(), users.end());
+	receive_filter_predicate = nullptr;
+	receive_filter_decisions.clear();
+	receive_filter_generation++;
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::set_receive_filter(voice_receive_predicate_t predicate) {
+	std::lock_guard lk(receive_filter_mutex);
+	receive_filter = predicate ? vrf_predicate : vrf_all;
+	receive_filter_users.clear();
+	receive_filter_predicate = std::move(predicate);
+	receive_filter_decisions.clear();
+	receive_filter_generation++;
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::clear_receive_filter() {
+	return set_receive_filter(nullptr);
+}
+
+uint64_t discord_voice_client::get_filtered_packets() {
+	return filtered_packets;
+}
+
+bool discord_voice_client::is_silent(const uint16_t* audio_data, const size_t length, uint16_t threshold) {
+	const int16_t* pcm = reinterpret_cast<const int16_t*>(audio_data);
+	const size_t samples = length / sizeof(int16_t);
+	/* Branchless peak search so the compiler can vectorise it */
+	int32_t peak = 0;
+	for (size_t i = 0; i < samples; ++i) {
+		int32_t sample = pcm[i];
+		int32_t magnitude = sample < 0 ? -sample : sample;
+		peak = magnitude > peak ? magnitude : peak;
+	}
+	return peak <= (int32_t)threshold;
+}
+
 discord_voice_client& discord_voice_client::set_send_audio_type(send_audio_type_t type)
 {
 	{
@@ -1199,6 +1576,7 @@ discord_voice_client& discord_voice_client::set_send_audio_type(send_audio_type_
 
 discord_voice_client& discord_voice_client::send_audio_raw(uint16_t* audio_data, const size_t length)  {
 #if HAVE_VOICE
+	alloc_scope scope(as_voice);
 	if (length < 4) {
 		throw dpp::voice_exception(err_invalid_voice_packet_length, "Raw audio packet size can't be less than 4");
 	}
@@ -1229,6 +1607,30 @@ discord_voice_client& discord_voice_client::send_audio_raw(uint16_t* audio_data,
 		return send_audio_raw((uint16_t*)packet.data(), packet.size());
 	}
 
+	if (silence_suppression) {
+		if (is_silent(audio_data, length, silence_threshold)) {
+			/* Duration of the frame in milliseconds: 4 bytes per stereo sample at 48kHz */
+			uint64_t remaining_ms = length / 4 / 48;
+			bool sent_silence = false;
+			while (trailing_silence_frames > 0 && remaining_ms >= 20) {
+				send_silence(20);
+				--trailing_silence_frames;
+				remaining_ms -= 20;
+				sent_silence = true;
+			}
+			if (!sent_silence) {
+				++suppressed_frames;
+			}
+			if (remaining_ms > 0) {
+				/* Leave a gap in the output buffer so that playback keeps its timing */
+				this->send("", 0, remaining_ms / (timescale / 1000000));
+				timestamp += (uint32_t)(48 * remaining_ms);
+			}
+			return *this;
+		}
+		trailing_silence_frames = trailing_silence_frame_count;
+	}
+
 	opus_int32 encodedAudioMaxLength = (opus_int32)length;
 	std::vector<uint8_t> encodedAudioData(encodedAudioMaxLength);
 	size_t encodedAudioLength = encodedAudioMaxLength;
@@ -1255,6 +1657,7 @@ discord_voice_client& discord_voice_client::send_audio_opus(uint8_t* opus_packet
 
 discord_voice_client& discord_voice_client::send_audio_opus(uint8_t* opus_packet, const size_t length, uint64_t duration) {
 #if HAVE_VOICE
+	alloc_scope scope(as_voice);
 	int frameSize = (int)(48 * duration * (timescale / 1000000));
 	opus_int32 encodedAudioMaxLength = (opus_int32)length;
 	std::vector<uint8_t> encodedAudioData(encodedAudioMaxLength);
@@ -1288,6 +1691,7 @@ discord_voice_client& discord_voice_client::send_audio_opus(uint8_t* opus_packet
 }
 
 discord_voice_client& discord_voice_client::speak() {
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
 	if (!this->sending) {
 		this->queue_message(json({
 		{"op", 5},
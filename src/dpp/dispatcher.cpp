@@ -49,6 +49,38 @@ bool event_dispatch_t::is_cancelled() const {
 	return cancelled;
 }
 
+event_scope message_create_t::get_scope() const {
+	return { msg.guild_id, msg.channel_id, msg.author.id };
+}
+
+event_scope message_update_t::get_scope() const {
+	return { msg.guild_id, msg.channel_id, msg.author.id };
+}
+
+event_scope message_delete_t::get_scope() const {
+	return { guild_id, channel_id, {} };
+}
+
+event_scope message_reaction_add_t::get_scope() const {
+	return { guild_id, channel_id, reacting_user.id };
+}
+
+event_scope message_reaction_remove_t::get_scope() const {
+	return { guild_id, channel_id, reacting_user_id };
+}
+
+event_scope typing_start_t::get_scope() const {
+	return { guild_id, channel_id, user_id };
+}
+
+event_scope voice_state_update_t::get_scope() const {
+	return { state.guild_id, state.channel_id, state.user_id };
+}
+
+event_scope interaction_create_t::get_scope() const {
+	return { command.guild_id, command.channel_id, command.usr.id };
+}
+
 const message& message_context_menu_t::get_message() const {
 	return ctx_message;
 }
@@ -108,16 +140,38 @@ void message_create_t::reply(message&& msg, bool mention_replied_user, command_c
 }
 
 void interaction_create_t::reply(interaction_response_type t, const message& m, command_completion_event_t callback) const {
+	if (response_state) {
+		std::unique_lock lock(response_state->mutex);
+		if (response_state->stage == irs_deferring) {
+			/* An edit sent now could reach Discord before the deferred response it edits */
+			response_state->after_deferral.emplace_back([event = *this, t, m, callback]() {
+				event.reply(t, m, callback);
+			});
+			return;
+		}
+		if (response_state->stage == irs_deferred) {
+			lock.unlock();
+			if (t == ir_channel_message_with_source || t == ir_update_message) {
+				/* The watchdog has already acknowledged the interaction, so the reply becomes its original response */
+				from->creator->interaction_response_edit(this->command.token, m, std::move(callback));
+			} else if (t == ir_deferred_channel_message_with_source || t == ir_deferred_update_message) {
+				if (callback) {
+					http_request_completion_t http;
+					http.status = 204;
+					callback(confirmation_callback_t(from->creator, confirmation(), http));
+				}
+			} else {
+				from->creator->interaction_response_create(this->command.id, this->command.token, dpp::interaction_response(t, m), std::move(callback));
+			}
+			return;
+		}
+		response_state->stage = irs_responded;
+	}
 	from->creator->interaction_response_create(this->command.id, this->command.token, dpp::interaction_response(t, m), std::move(callback));
 }
 
 void interaction_create_t::reply(const message& m, command_completion_event_t callback) const {
-	from->creator->interaction_response_create(
-		this->command.id,
-		this->command.token,
-		dpp::interaction_response(ir_channel_message_with_source, m),
-		std::move(callback)
-	);
+	this->reply(ir_channel_message_with_source, m, std::move(callback));
 }
 
 void interaction_create_t::thinking(bool ephemeral, command_completion_event_t callback) const {
@@ -134,6 +188,12 @@ void interaction_create_t::reply(command_completion_event_t callback) const {
 }
 
 void interaction_create_t::dialog(const interaction_modal_response& mr, command_completion_event_t callback) const {
+	if (response_state) {
+		std::unique_lock lock(response_state->mutex);
+		if (response_state->stage == irs_waiting) {
+			response_state->stage = irs_responded;
+		}
+	}
 	from->creator->interaction_response_create(this->command.id, this->command.token, mr, std::move(callback));
 }
 
@@ -0,0 +1,171 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/entitlement_cache.h>
+#include <dpp/cluster.h>
+#include <dpp/appcommand.h>
+#include <algorithm>
+#include <ctime>
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief Entitlements per page of dpp::cluster::entitlements_get
+ */
+constexpr uint8_t page_size = 100;
+
+bool in_window(time_t starts_at, time_t ends_at, time_t now) {
+	return (!starts_at || starts_at <= now) && (!ends_at || now < ends_at);
+}
+
+}
+
+entitlement_cache::entitlement_cache(cluster* o) : owner(o) {
+	created = owner->on_entitlement_create([this](const entitlement_create_t& event) {
+		insert(event.created);
+	});
+	updated = owner->on_entitlement_update([this](const entitlement_update_t& event) {
+		insert(event.updating_entitlement);
+	});
+	deleted = owner->on_entitlement_delete([this](const entitlement_delete_t& event) {
+		remove(event.deleted.id);
+	});
+}
+
+entitlement_cache::~entitlement_cache() {
+	owner->on_entitlement_create.detach(created);
+	owner->on_entitlement_update.detach(updated);
+	owner->on_entitlement_delete.detach(deleted);
+}
+
+void entitlement_cache::load(command_completion_event_t callback) {
+	load_page(0, 0, std::move(callback));
+}
+
+void entitlement_cache::load_page(snowflake after, size_t loaded, command_completion_event_t callback) {
+	owner->entitlements_get(0, {}, 0, after, page_size, 0, true, [this, loaded, callback](const confirmation_callback_t& cc) {
+		if (cc.is_error()) {
+			owner->log(ll_error, "Unable to load entitlements: " + cc.get_error().human_readable);
+			if (callback) {
+				callback(cc);
+			}
+			return;
+		}
+		const auto& page = std::get<entitlement_map>(cc.value);
+		snowflake last = 0;
+		for (const auto& [id, e] : page) {
+			insert(e);
+			last = std::max(last, id);
+		}
+		if (page.size() >= page_size) {
+			load_page(last, loaded + page.size(), callback);
+			return;
+		}
+		owner->log(ll_debug, "Loaded " + std::to_string(loaded + page.size()) + " entitlements");
+		if (callback) {
+			callback(confirmation_callback_t(owner, confirmation(), cc.http_info));
+		}
+	});
+}
+
+void entitlement_cache::insert(const entitlement& e) {
+	if (e.is_deleted()) {
+		remove(e.id);
+		return;
+	}
+	std::unique_lock l(mutex);
+	auto previous = by_id.find(e.id);
+	std::pair<snowflake, snowflake> key{e.owner_id, e.sku_id};
+	if (previous != by_id.end() && previous->second != key) {
+		auto i = by_owner.find(previous->second);
+		if (i != by_owner.end() && i->second.erase(e.id) && i->second.empty()) {
+			by_owner.erase(i);
+		}
+	}
+	by_id[e.id] = key;
+	by_owner[key][e.id] = window{e.starts_at, e.ends_at};
+}
+
+void entitlement_cache::remove(snowflake id) {
+	std::unique_lock l(mutex);
+	auto previous = by_id.find(id);
+	if (previous == by_id.end()) {
+		return;
+	}
+	auto i = by_owner.find(previous->second);
+	if (i != by_owner.end() && i->second.erase(id) && i->second.empty()) {
+		by_owner.erase(i);
+	}
+	by_id.erase(previous);
+}
+
+bool entitlement_cache::has_entitlement(snowflake owner_id, snowflake sku_id) const {
+	const time_t now = time(nullptr);
+	std::shared_lock l(mutex);
+	auto i = by_owner.find({owner_id, sku_id});
+	if (i == by_owner.end()) {
+		return false;
+	}
+	for (const auto& [id, w] : i->second) {
+		if (in_window(w.starts_at, w.ends_at, now)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool entitlement_cache::has_entitlement(const interaction& i, snowflake sku_id) const {
+	const time_t now = time(nullptr);
+	for (const auto& e : i.entitlements) {
+		if (e.sku_id == sku_id && !e.is_deleted() && in_window(e.starts_at, e.ends_at, now)) {
+			return true;
+		}
+	}
+	return has_entitlement(i.usr.id, sku_id) || (i.guild_id && has_entitlement(i.guild_id, sku_id));
+}
+
+size_t entitlement_cache::prune() {
+	const time_t now = time(nullptr);
+	size_t removed = 0;
+	std::unique_lock l(mutex);
+	for (auto i = by_owner.begin(); i != by_owner.end();) {
+		for (auto w = i->second.begin(); w != i->second.end();) {
+			if (w->second.ends_at && w->second.ends_at <= now) {
+				by_id.erase(w->first);
+				w = i->second.erase(w);
+				removed++;
+			} else {
+				++w;
+			}
+		}
+		i = i->second.empty() ? by_owner.erase(i) : std::next(i);
+	}
+	return removed;
+}
+
+size_t entitlement_cache::count() const {
+	std::shared_lock l(mutex);
+	return by_id.size();
+}
+
+} // namespace dpp
@@ -0,0 +1,210 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/event_queue.h>
+#include <dpp/utility.h>
+#include <dpp/json.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief An event waiting to be dispatched
+ */
+struct queued_event {
+	std::string event;
+	json j;
+	std::string raw;
+
+	/**
+	 * @brief Key it is coalesced by, empty if it is not coalesced
+	 */
+	std::string key;
+};
+
+/**
+ * @brief Key for dpp::sp_coalesce: the event name plus whichever of the user, guild and channel it has
+ */
+std::string coalesce_key(const std::string& event, const json& j) {
+	std::string key = event;
+	auto d = j.find("d");
+	if (d == j.end() || !d->is_object()) {
+		return key;
+	}
+	auto user = d->find("user");
+	if (user != d->end() && user->is_object() && user->contains("id")) {
+		key += ":" + (*user)["id"].dump();
+	} else if (d->contains("user_id")) {
+		key += ":" + (*d)["user_id"].dump();
+	}
+	for (const char* field : {"guild_id", "channel_id"}) {
+		auto f = d->find(field);
+		key += ":" + (f != d->end() ? f->dump() : std::string());
+	}
+	return key;
+}
+
+}
+
+struct event_queue::state {
+	event_queue_dispatch_t dispatch;
+	size_t capacity;
+	uint32_t sample_rate;
+	std::unordered_map<std::string, event_policy> policies;
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	bool terminating = false;
+
+	/**
+	 * @brief Critical events, dispatched first
+	 */
+	std::deque<queued_event> critical;
+
+	/**
+	 * @brief Everything else, in the order received. References into a deque stay valid while
+	 * only its ends are changed, so coalesced events can be found through the index below.
+	 */
+	std::deque<queued_event> normal;
+
+	/**
+	 * @brief Queued events by coalesce key
+	 */
+	std::unordered_map<std::string, queued_event*> by_key;
+
+	/**
+	 * @brief Low priority events seen per type while over capacity, for dpp::sp_sample
+	 */
+	std::unordered_map<std::string, uint64_t> sampled;
+
+	event_queue_stats stats;
+	std::thread dispatcher;
+};
+
+event_queue_stats& event_queue_stats::operator+=(const event_queue_stats& other) {
+	depth += other.depth;
+	peak_depth = std::max(peak_depth, other.peak_depth);
+	dispatched += other.dispatched;
+	for (const auto& [event, count] : other.shed) {
+		shed[event] += count;
+	}
+	for (const auto& [event, count] : other.coalesced) {
+		coalesced[event] += count;
+	}
+	return *this;
+}
+
+event_queue::event_queue(const event_queue_config& config, event_queue_dispatch_t dispatch, const std::string& thread_name) : queue(std::make_unique<state>()) {
+	queue->dispatch = std::move(dispatch);
+	queue->capacity = config.capacity;
+	queue->sample_rate = std::max(config.sample_rate, 1u);
+	queue->policies.insert(config.events.begin(), config.events.end());
+	state* s = queue.get();
+	queue->dispatcher = std::thread([s, thread_name]() {
+		utility::set_thread_name(thread_name);
+		std::unique_lock l(s->mutex);
+		while (true) {
+			s->wake.wait(l, [s]() {
+				return s->terminating || !s->critical.empty() || !s->normal.empty();
+			});
+			if (s->terminating) {
+				return;
+			}
+			std::deque<queued_event>& from = s->critical.empty() ? s->normal : s->critical;
+			queued_event e = std::move(from.front());
+			from.pop_front();
+			if (!e.key.empty()) {
+				s->by_key.erase(e.key);
+			}
+			s->stats.depth--;
+			l.unlock();
+			s->dispatch(e.event, e.j, e.raw);
+			l.lock();
+			s->stats.dispatched++;
+		}
+	});
+}
+
+event_queue::~event_queue() {
+	{
+		std::lock_guard l(queue->mutex);
+		queue->terminating = true;
+	}
+	queue->wake.notify_one();
+	if (queue->dispatcher.joinable()) {
+		queue->dispatcher.join();
+	}
+}
+
+bool event_queue::push(const std::string& event, json& j, const std::string& raw) {
+	event_policy policy;
+	auto p = queue->policies.find(event);
+	if (p != queue->policies.end()) {
+		policy = p->second;
+	}
+	std::string key;
+	if (policy.priority == ep_low && policy.shed == sp_coalesce) {
+		key = coalesce_key(event, j);
+	}
+	{
+		std::lock_guard l(queue->mutex);
+		if (policy.priority == ep_low) {
+			if (!key.empty()) {
+				auto existing = queue->by_key.find(key);
+				if (existing != queue->by_key.end()) {
+					existing->second->j = std::move(j);
+					existing->second->raw = raw;
+					queue->stats.coalesced[event]++;
+					return false;
+				}
+			}
+			if (queue->stats.depth >= queue->capacity) {
+				bool keep = policy.shed == sp_sample && (queue->sampled[event]++ % queue->sample_rate) == 0;
+				if (!keep) {
+					queue->stats.shed[event]++;
+					return false;
+				}
+			}
+		}
+		auto& to = policy.priority == ep_critical ? queue->critical : queue->normal;
+		to.push_back(queued_event{event, std::move(j), raw, key});
+		if (!key.empty()) {
+			queue->by_key[key] = &to.back();
+		}
+		queue->stats.depth++;
+		queue->stats.peak_depth = std::max(queue->stats.peak_depth, queue->stats.depth);
+	}
+	queue->wake.notify_one();
+	return true;
+}
+
+event_queue_stats event_queue::get_stats() const {
+	std::lock_guard l(queue->mutex);
+	return queue->stats;
+}
+
+} // namespace dpp
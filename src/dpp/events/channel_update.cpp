@@ -40,18 +40,25 @@ void channel_update::handle(discord_client* client, json &j, const std::string &
 	json& d = j["d"];
 	channel newchannel;
 	channel* c = nullptr;
-	if (client->creator->cache_policy.channel_policy == cp_none) {
+	channel* before = nullptr;
+	if (client->creator->cache_policy.channel_policy != cp_none) {
+		before = dpp::find_channel(snowflake_not_null(&d, "id"));
+	}
+	if (before) {
+		/* Never modify the cached channel in place, as other threads may be reading it.
+		 * Build a new version and publish it; the cache retires the old one.
+		 */
+		c = dpp::get_channel_cache()->update(before, [&d](channel& next) {
+			next.fill_from_json(&d);
+		});
+	} else {
 		newchannel.fill_from_json(&d);
 		c = &newchannel;
-	} else {
-		c = dpp::find_channel(snowflake_not_null(&d, "id"));
-		if (c) {
-			c->fill_from_json(&d);
-		}
 	}
 	if (!client->creator->on_channel_update.empty()) {
 		dpp::channel_update_t cu(client, raw);
 		cu.updated = c;
+		cu.before = before;
 		cu.updating_guild = dpp::find_guild(c->guild_id);
 		client->creator->on_channel_update.call(cu);
 	}
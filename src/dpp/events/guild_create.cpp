@@ -25,6 +25,7 @@
 #include <dpp/cache.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 
@@ -52,6 +53,7 @@ void guild_create::handle(discord_client* client, json &j, const std::string &ra
 		newguild.fill_from_json(client, &d);
 		g = &newguild;
 	} else {
+		alloc_scope scope(as_cache);
 		bool is_new_guild = false;
 		g = dpp::find_guild(snowflake_not_null(&d, "id"));
 		if (!g) {
@@ -95,6 +97,20 @@ void guild_create::handle(discord_client* client, json &j, const std::string &ra
 			g->threads.reserve(d["threads"].size());
 			for (auto & channel : d["threads"]) {
 				g->threads.push_back(snowflake_not_null(&channel, "id"));
+				if (client->creator->cache_policy.thread_policy != cp_none) {
+					dpp::thread t;
+					t.fill_from_json(&channel);
+					t.guild_id = g->id;
+					if (channel.contains("member")) {
+						/* The ids are omitted from the bot's membership in GUILD_CREATE */
+						t.member.thread_id = t.id;
+						t.member.user_id = client->creator->me.id;
+					}
+					dpp::get_thread_cache()->store(t);
+					if (client->creator->cache_policy.thread_policy == cp_aggressive && t.member.user_id) {
+						dpp::get_thread_cache()->store_member(t.member, true);
+					}
+				}
 			}
 
 			/* Store guild members */
@@ -25,6 +25,7 @@
 #include <dpp/cache.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 
@@ -80,6 +81,9 @@ void guild_delete::handle(discord_client* client, json &j, const std::string &ra
 				}
 			}
 			g->members.clear();
+			if (client->creator->cache_policy.thread_policy != dpp::cp_none) {
+				dpp::get_thread_cache()->remove_guild(g->id);
+			}
 		} else {
 			g->flags |= dpp::g_unavailable;
 		}
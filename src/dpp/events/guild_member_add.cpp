@@ -50,6 +50,7 @@ void guild_member_add::handle(discord_client* client, json &j, const std::string
 			client->creator->on_guild_member_add.call(gmr);
 		}
 	} else {
+		alloc_scope scope(as_cache);
 		dpp::user* u = dpp::find_user(snowflake_not_null(&(d["user"]), "id"));
 		if (!u) {
 			u = new dpp::user();
@@ -42,8 +42,11 @@ void guild_members_chunk::handle(discord_client* client, json &j, const std::str
 	dpp::guild_member_map um;
 	dpp::guild* g = dpp::find_guild(snowflake_not_null(&d, "guild_id"));
 	if (g) {
-		/* Store guild members */
-		if (client->creator->cache_policy.user_policy == cp_aggressive) {
+		/* Store guild members. With the lazy policy these only arrive when requested
+		 * through dpp::cluster::request_guild_member, so they are worth keeping.
+		 */
+		if (client->creator->cache_policy.user_policy != cp_none) {
+			alloc_scope scope(as_cache);
 			for (auto & userrec : d["members"]) {
 				json & userspart = userrec["user"];
 				dpp::user* u = dpp::find_user(snowflake_not_null(&userspart, "id"));
@@ -63,6 +66,8 @@ void guild_members_chunk::handle(discord_client* client, json &j, const std::str
 			}
 		}
 	}
+	/* Complete lazy member requests whether or not anything was cached */
+	client->member_requests.chunk_received(d);
 	if (!client->creator->on_guild_members_chunk.empty()) {
 		dpp::guild_members_chunk_t gmc(client, raw);
 		gmc.adding = g;
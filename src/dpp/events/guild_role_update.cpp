@@ -51,13 +51,17 @@ void guild_role_update::handle(discord_client* client, json &j, const std::strin
 		}
 	} else {
 		json& role = d["role"];
-		dpp::role *r = dpp::find_role(snowflake_not_null(&role, "id"));
-		if (r) {
-			r->fill_from_json(g->id, &role);
+		dpp::role *before = dpp::find_role(snowflake_not_null(&role, "id"));
+		if (before) {
+			/* Publish a new version rather than modifying the cached role in place */
+			dpp::role *r = dpp::get_role_cache()->update(before, [guild_id, &role](dpp::role& next) {
+				next.fill_from_json(guild_id, &role);
+			});
 			if (!client->creator->on_guild_role_update.empty()) {
 				dpp::guild_role_update_t gru(client, raw);
 				gru.updating_guild = g;
 				gru.updated = r;
+				gru.before = before;
 				client->creator->on_guild_role_update.call(gru);
 			}
 		}
@@ -40,33 +40,38 @@ void guild_update::handle(discord_client* client, json &j, const std::string &ra
 	json& d = j["d"];
 	guild newguild;
 	dpp::guild* g = nullptr;
+	dpp::guild* before = nullptr;
 	if (client->creator->cache_policy.guild_policy == cp_none) {
 		newguild.fill_from_json(client, &d);
 		g = &newguild;
 	} else {
-		g = dpp::find_guild(snowflake_not_null(&d, "id"));
-		if (g) {
-			g->fill_from_json(client, &d);
-			if (!g->is_unavailable()) {
-				if (client->creator->cache_policy.role_policy != dpp::cp_none && d.find("roles") != d.end()) {
-					for (size_t rc = 0; rc < g->roles.size(); ++rc) {
-						dpp::role* oldrole = dpp::find_role(g->roles[rc]);
+		before = dpp::find_guild(snowflake_not_null(&d, "id"));
+		if (before) {
+			/* Never modify the cached guild in place, as other threads may be reading it.
+			 * Build a new version and publish it; the cache retires the old one.
+			 */
+			g = dpp::get_guild_cache()->update(before, [client, &d](guild& next) {
+				next.fill_from_json(client, &d);
+				if (!next.is_unavailable() && client->creator->cache_policy.role_policy != dpp::cp_none && d.find("roles") != d.end()) {
+					for (size_t rc = 0; rc < next.roles.size(); ++rc) {
+						dpp::role* oldrole = dpp::find_role(next.roles[rc]);
 						dpp::get_role_cache()->remove(oldrole);
 					}
-					g->roles.clear();
+					next.roles.clear();
 					for (auto & role : d["roles"]) {
 						dpp::role *r = new dpp::role();
-						r->fill_from_json(g->id, &role);
+						r->fill_from_json(next.id, &role);
 						dpp::get_role_cache()->store(r);
-						g->roles.push_back(r->id);
+						next.roles.push_back(r->id);
 					}
 				}
-			}
+			});
 		}
 	}
 	if (!client->creator->on_guild_update.empty()) {
 		dpp::guild_update_t gu(client, raw);
 		gu.updated = g;
+		gu.before = before;
 		client->creator->on_guild_update.call(gu);
 	}
 }
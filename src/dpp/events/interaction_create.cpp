@@ -73,6 +73,28 @@ void fill_options(dpp::json option_json, std::vector<dpp::command_option>& optio
 	}
 }
 
+/**
+ * @brief Find the focused option of an autocomplete interaction, looking inside subcommands.
+ * This works on the raw JSON because Discord sends what the user has typed so far as a string,
+ * even for integer and number options, and fill_options drops values which do not match the type.
+ */
+const dpp::json* find_focused(const dpp::json& options) {
+	if (!options.is_array()) {
+		return nullptr;
+	}
+	for (const auto& o : options) {
+		if (bool_not_null(&o, "focused")) {
+			return &o;
+		}
+		if (o.find("options") != o.end()) {
+			if (const dpp::json* sub = find_focused(o["options"]); sub) {
+				return sub;
+			}
+		}
+	}
+	return nullptr;
+}
+
 }
 
 /**
@@ -88,6 +110,16 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 	/* We must set here because we cant pass it through the nlohmann from_json() */
 	i.cache_policy = client->creator->cache_policy;
 	i.fill_from_json(&d);
+	/* Every event dispatched for this interaction shares one response state, so the deferral
+	 * watchdog sees a reply made through any of them. It is only started if an event is dispatched.
+	 */
+	std::shared_ptr<interaction_response_state> response_state;
+	auto watched = [&]() {
+		if (!response_state) {
+			response_state = client->creator->watch_interaction(i);
+		}
+		return response_state;
+	};
 	/* There are several types of interactions, component interactions,
 	 * auto complete interactions, dialog interactions and slash command
 	 * interactions. Both fire different library events so ensure they are
@@ -101,6 +133,7 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 				/* Message right-click context menu */
 				message_context_menu_t mcm(client, raw);
 				mcm.command = i;
+				mcm.response_state = watched();
 				mcm.set_message(i.resolved.messages.begin()->second);
 				client->creator->on_message_context_menu.call(mcm);
 			}
@@ -109,12 +142,14 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 				/* User right-click context menu */
 				user_context_menu_t ucm(client, raw);
 				ucm.command = i;
+				ucm.response_state = watched();
 				ucm.set_user(i.resolved.users.begin()->second);
 				client->creator->on_user_context_menu.call(ucm);
 			}
 		} else if (cmd_data.type == ctxm_chat_input && !client->creator->on_slashcommand.empty()) {
 			dpp::slashcommand_t sc(client, raw);
 			sc.command = i;
+			sc.response_state = watched();
 			client->creator->on_slashcommand.call(sc);
 		}
 		if (!client->creator->on_interaction_create.empty()) {
@@ -124,6 +159,7 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 			 */
 			dpp::interaction_create_t ic(client, raw);
 			ic.command = i;
+			ic.response_state = watched();
 			client->creator->on_interaction_create.call(ic);
 		}
 	} else if (i.type == it_modal_submit) {
@@ -131,6 +167,7 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 			dpp::form_submit_t fs(client, raw);
 			fs.custom_id = string_not_null(&(d["data"]), "custom_id");
 			fs.command = i;
+			fs.response_state = watched();
 			for (auto & c : d["data"]["components"]) {
 				fs.components.push_back(dpp::component().fill_from_json(&c));
 			}
@@ -138,11 +175,28 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 		}
 	} else if (i.type == it_autocomplete) {
 		// "data":{"id":"903319628816728104","name":"blep","options":[{"focused":true,"name":"animal","type":3,"value":"a"}],"type":1}
-		if (!client->creator->on_autocomplete.empty()) {
+		std::string name = string_not_null(&(d["data"]), "name");
+		std::vector<dpp::command_option> options;
+		fill_options(d["data"]["options"], options);
+		const json* focused = find_focused(d["data"]["options"]);
+		std::shared_ptr<const autocomplete_index> index = focused ? client->creator->find_autocomplete(name, string_not_null(focused, "name")) : nullptr;
+		if (index) {
+			/* Registered with cluster::register_autocomplete, answer it here rather than in a user handler */
+			std::string typed;
+			if (focused->find("value") != focused->end()) {
+				const json& value = focused->at("value");
+				typed = value.is_string() ? value.get<std::string>() : (value.is_null() ? "" : value.dump());
+			}
+			dpp::interaction_response response(ir_autocomplete_reply);
+			for (const auto& choice : index->search(typed)) {
+				response.add_autocomplete_choice(choice);
+			}
+			client->creator->interaction_response_create(i.id, i.token, response);
+		} else if (!client->creator->on_autocomplete.empty()) {
 			dpp::autocomplete_t ac(client, raw);
 			ac.id = snowflake_not_null(&(d["data"]), "id");
-			ac.name = string_not_null(&(d["data"]), "name");
-			fill_options(d["data"]["options"], ac.options);
+			ac.name = name;
+			ac.options = std::move(options);
 			ac.command = i;
 			client->creator->on_autocomplete.call(ac);
 		}
@@ -152,6 +206,7 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 			if (!client->creator->on_button_click.empty()) {
 				dpp::button_click_t ic(client, raw);
 				ic.command = i;
+				ic.response_state = watched();
 				ic.custom_id = bi.custom_id;
 				ic.component_type = bi.component_type;
 				client->creator->on_button_click.call(ic);
@@ -162,6 +217,7 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 			if (!client->creator->on_select_click.empty()) {
 				dpp::select_click_t ic(client, raw);
 				ic.command = i;
+				ic.response_state = watched();
 				ic.custom_id = bi.custom_id;
 				ic.component_type = bi.component_type;
 				ic.values = bi.values;
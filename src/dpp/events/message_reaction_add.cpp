@@ -41,6 +41,7 @@ void message_reaction_add::handle(discord_client* client, json &j, const std::st
 		json &d = j["d"];
 		dpp::message_reaction_add_t mra(client, raw);
 		dpp::snowflake guild_id = snowflake_not_null(&d, "guild_id");
+		mra.guild_id = guild_id;
 		mra.reacting_guild = dpp::find_guild(guild_id);
 		mra.reacting_user = dpp::user().fill_from_json(&(d["member"]["user"]));
 		mra.reacting_member = dpp::guild_member().fill_from_json(&(d["member"]), guild_id, mra.reacting_user.id);
@@ -41,6 +41,7 @@ void message_reaction_remove::handle(discord_client* client, json &j, const std:
 		json &d = j["d"];
 		dpp::message_reaction_remove_t mrr(client, raw);
 		dpp::snowflake guild_id = snowflake_not_null(&d, "guild_id");
+		mrr.guild_id = guild_id;
 		mrr.reacting_guild = dpp::find_guild(guild_id);
 		mrr.reacting_user_id = snowflake_not_null(&d, "user_id");
 		mrr.channel_id = snowflake_not_null(&d, "channel_id");
@@ -67,7 +67,7 @@ void ready::handle(discord_client* client, json &j, const std::string &raw) {
 		client->creator->me.fill_from_json(&(j["d"]["user"]));
 	}
 
-	if (!client->creator->on_ready.empty()) {
+	if (!client->creator->on_ready.empty() && client->delivery != sd_standby) {
 		dpp::ready_t r(client, raw);
 		r.session_id = client->sessionid;
 		r.shard_id = client->shard_id;
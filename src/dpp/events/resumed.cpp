@@ -40,7 +40,7 @@ void resumed::handle(discord_client* client, json &j, const std::string &raw) {
 
 	client->ready = true;
 
-	if (!client->creator->on_resumed.empty()) {
+	if (!client->creator->on_resumed.empty() && client->delivery != sd_standby) {
 		dpp::resumed_t r(client, raw);
 		r.session_id = client->sessionid;
 		r.shard_id = client->shard_id;
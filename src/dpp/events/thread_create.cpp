@@ -24,6 +24,7 @@
 #include <dpp/channel.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 namespace dpp::events {
@@ -38,6 +39,12 @@ void thread_create::handle(discord_client* client, json& j, const std::string& r
 	if (g) {
 		g->threads.push_back(t.id);
 	}
+	if (client->creator->cache_policy.thread_policy != cp_none) {
+		get_thread_cache()->store(t);
+		if (client->creator->cache_policy.thread_policy == cp_aggressive && t.member.user_id) {
+			get_thread_cache()->store_member(t.member, true);
+		}
+	}
 	if (!client->creator->on_thread_create.empty()) {
 		dpp::thread_create_t tc(client, raw);
 		tc.created = t;
@@ -24,6 +24,7 @@
 #include <dpp/channel.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 namespace dpp::events {
@@ -38,6 +39,9 @@ void thread_delete::handle(discord_client* client, json& j, const std::string& r
 	if (g) {
 		g->threads.erase(std::remove(g->threads.begin(), g->threads.end(), t.id), g->threads.end());
 	}
+	if (client->creator->cache_policy.thread_policy != cp_none) {
+		get_thread_cache()->remove(t.id);
+	}
 	if (!client->creator->on_thread_delete.empty()) {
 		dpp::thread_delete_t td(client, raw);
 		td.deleted = t;
@@ -24,6 +24,7 @@
 #include <dpp/channel.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 
@@ -40,6 +41,29 @@ void thread_list_sync::handle(discord_client* client, json& j, const std::string
 			}
 		}
 	}
+	if (client->creator->cache_policy.thread_policy != cp_none) {
+		/* This is the complete list of active threads for the given parent channels (or the whole guild),
+		 * so anything else we have cached for them is stale.
+		 */
+		std::vector<snowflake> parent_ids, active_ids;
+		set_snowflake_array_not_null(&d, "channel_ids", parent_ids);
+		thread_cache* tc = get_thread_cache();
+		if (d.find("threads") != d.end()) {
+			for (auto& t : d["threads"]) {
+				thread th;
+				th.fill_from_json(&t);
+				tc->store(th);
+				active_ids.push_back(th.id);
+			}
+		}
+		tc->retain_guild(snowflake_not_null(&d, "guild_id"), parent_ids, active_ids);
+		if (client->creator->cache_policy.thread_policy == cp_aggressive && d.find("members") != d.end()) {
+			for (auto& tm : d["members"]) {
+				/* These are the current user's memberships */
+				tc->store_member(thread_member().fill_from_json(&tm), true);
+			}
+		}
+	}
 	if (!client->creator->on_thread_list_sync.empty()) {
 		dpp::thread_list_sync_t tls(client, raw);
 		if (d.find("threads") != d.end()) {
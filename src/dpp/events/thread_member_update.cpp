@@ -24,14 +24,19 @@
 #include <dpp/channel.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 namespace dpp::events {
 
 
 void thread_member_update::handle(discord_client* client, json& j, const std::string& raw) {
+	json& d = j["d"];
+	if (client->creator->cache_policy.thread_policy == cp_aggressive) {
+		/* This event is only ever sent for the current user */
+		get_thread_cache()->store_member(thread_member().fill_from_json(&d), true);
+	}
 	if (!client->creator->on_thread_member_update.empty()) {
-		json& d = j["d"];
 		dpp::thread_member_update_t tm(client, raw);
 		tm.updated = thread_member().fill_from_json(&d);
 		client->creator->on_thread_member_update.call(tm);
@@ -24,6 +24,7 @@
 #include <dpp/channel.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 namespace dpp::events {
@@ -33,7 +34,8 @@ void thread_members_update::handle(discord_client* client, json& j, const std::s
 	json& d = j["d"];
 
 	dpp::guild* g = dpp::find_guild(snowflake_not_null(&d, "guild_id"));
-	if (!client->creator->on_thread_members_update.empty()) {
+	bool cache_members = client->creator->cache_policy.thread_policy == cp_aggressive;
+	if (cache_members || !client->creator->on_thread_members_update.empty()) {
 		dpp::thread_members_update_t tms(client, raw);
 		tms.updating_guild = g;
 		set_snowflake_not_null(&d, "id", tms.thread_id);
@@ -52,7 +54,12 @@ void thread_members_update::handle(discord_client* client, json& j, const std::s
 				client->creator->log(dpp::ll_error, std::string("thread_members_update: {}") + e.what());
 			}
 		}
-		client->creator->on_thread_members_update.call(tms);
+		if (cache_members) {
+			get_thread_cache()->update_members(tms.thread_id, tms.member_count, tms.added, tms.removed_ids, client->creator->me.id);
+		}
+		if (!client->creator->on_thread_members_update.empty()) {
+			client->creator->on_thread_members_update.call(tms);
+		}
 	}
 }
 };
@@ -24,6 +24,7 @@
 #include <dpp/channel.h>
 #include <dpp/stringops.h>
 #include <dpp/json.h>
+#include <dpp/thread_cache.h>
 
 
 
@@ -34,6 +35,10 @@ void thread_update::handle(discord_client* client, json& j, const std::string& r
 	dpp::thread t;
 	t.fill_from_json(&d);
 	dpp::guild* g = dpp::find_guild(t.guild_id);
+	if (client->creator->cache_policy.thread_policy != cp_none) {
+		/* Archiving a thread evicts it */
+		get_thread_cache()->store(t);
+	}
 	if (!client->creator->on_thread_update.empty()) {
 		dpp::thread_update_t tu(client, raw);
 		tu.updated = t;
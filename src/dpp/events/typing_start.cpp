@@ -38,8 +38,10 @@ void typing_start::handle(discord_client* client, json &j, const std::string &ra
 	if (!client->creator->on_typing_start.empty()) {
 		json& d = j["d"];
 		dpp::typing_start_t ts(client, raw);
-		ts.typing_guild = dpp::find_guild(snowflake_not_null(&d, "guild_id"));
-		ts.typing_channel = dpp::find_channel(snowflake_not_null(&d, "channel_id"));
+		ts.guild_id = snowflake_not_null(&d, "guild_id");
+		ts.channel_id = snowflake_not_null(&d, "channel_id");
+		ts.typing_guild = dpp::find_guild(ts.guild_id);
+		ts.typing_channel = dpp::find_channel(ts.channel_id);
 		ts.user_id = snowflake_not_null(&d, "user_id");
 		ts.typing_user = dpp::find_user(ts.user_id);
 		ts.timestamp = ts_not_null(&d, "timestamp");
@@ -0,0 +1,79 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/interaction_watchdog.h>
+#include <dpp/utility.h>
+
+namespace dpp {
+
+interaction_watchdog::interaction_watchdog() : terminating(false) {
+	runner = std::thread(&interaction_watchdog::run, this);
+}
+
+interaction_watchdog::~interaction_watchdog() {
+	{
+		std::unique_lock lock(mutex);
+		terminating = true;
+	}
+	changed.notify_one();
+	runner.join();
+}
+
+void interaction_watchdog::watch(std::chrono::steady_clock::time_point deadline, std::function<void()> on_expiry) {
+	bool earliest;
+	{
+		std::unique_lock lock(mutex);
+		auto i = deadlines.emplace(deadline, std::move(on_expiry));
+		earliest = (i == deadlines.begin());
+	}
+	/* Only a new earliest deadline changes how long the thread should sleep for */
+	if (earliest) {
+		changed.notify_one();
+	}
+}
+
+size_t interaction_watchdog::pending() {
+	std::unique_lock lock(mutex);
+	return deadlines.size();
+}
+
+void interaction_watchdog::run() {
+	utility::set_thread_name("watchdog");
+	std::unique_lock lock(mutex);
+	while (!terminating) {
+		if (deadlines.empty()) {
+			changed.wait(lock);
+			continue;
+		}
+		auto first = deadlines.begin();
+		if (first->first > std::chrono::steady_clock::now()) {
+			changed.wait_until(lock, first->first);
+			continue;
+		}
+		std::function<void()> on_expiry = std::move(first->second);
+		deadlines.erase(first);
+		lock.unlock();
+		on_expiry();
+		lock.lock();
+	}
+}
+
+} // namespace dpp
@@ -0,0 +1,248 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/message_template.h>
+#include <dpp/message.h>
+#include <dpp/cluster.h>
+#include <dpp/discordevents.h>
+#include <dpp/exception.h>
+#include <dpp/restrequest.h>
+#include <charconv>
+#include <cstdio>
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief Append text to a JSON string, escaped
+ */
+void append_escaped(std::string& out, std::string_view text) {
+	static constexpr const char* hex = "0123456789abcdef";
+	size_t run = 0;
+	for (size_t i = 0; i < text.length(); ++i) {
+		const unsigned char c = static_cast<unsigned char>(text[i]);
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+		out.append(text, run, i - run);
+		run = i + 1;
+		switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			case '\b': out += "\\b"; break;
+			case '\f': out += "\\f"; break;
+			default:
+				out += "\\u00";
+				out += hex[c >> 4];
+				out += hex[c & 0x0f];
+		}
+	}
+	out.append(text, run, text.length() - run);
+}
+
+bool is_slot_char(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+}
+
+template_args::template_args(std::shared_ptr<const std::unordered_map<std::string, size_t>> slot_names)
+	: names(std::move(slot_names)), values(names->size()), numeric(names->size(), false) {
+}
+
+size_t template_args::index_of(const std::string& name) const {
+	auto i = names->find(name);
+	if (i == names->end()) {
+		throw dpp::logic_exception(err_message_template, "Message template has no slot named " + name);
+	}
+	return i->second;
+}
+
+template_args& template_args::set(size_t slot, std::string_view text) {
+	values.at(slot).clear();
+	append_escaped(values[slot], text);
+	numeric[slot] = false;
+	return *this;
+}
+
+template_args& template_args::set(size_t slot, const std::string& text) {
+	return set(slot, std::string_view(text));
+}
+
+template_args& template_args::set_integer(size_t slot, int64_t number) {
+	char buffer[24];
+	auto r = std::to_chars(buffer, buffer + sizeof(buffer), number);
+	values.at(slot).assign(buffer, r.ptr);
+	numeric[slot] = true;
+	return *this;
+}
+
+template_args& template_args::set_integer(size_t slot, uint64_t number) {
+	char buffer[24];
+	auto r = std::to_chars(buffer, buffer + sizeof(buffer), number);
+	values.at(slot).assign(buffer, r.ptr);
+	numeric[slot] = true;
+	return *this;
+}
+
+template_args& template_args::set(size_t slot, double number) {
+	char buffer[32];
+	int length = snprintf(buffer, sizeof(buffer), "%.17g", number);
+	values.at(slot).assign(buffer, length > 0 ? static_cast<size_t>(length) : 0);
+	numeric[slot] = true;
+	return *this;
+}
+
+template_args& template_args::set(size_t slot, snowflake id) {
+	char buffer[24];
+	auto r = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<uint64_t>(id));
+	values.at(slot).assign(buffer, r.ptr);
+	numeric[slot] = false;
+	return *this;
+}
+
+template_args& template_args::set_timestamp(size_t slot, time_t timestamp) {
+	values.at(slot) = ts_to_string(timestamp);
+	numeric[slot] = false;
+	return *this;
+}
+
+template_args& template_args::set(const std::string& name, std::string_view text) {
+	return set(index_of(name), text);
+}
+
+template_args& template_args::set(const std::string& name, const char* text) {
+	return set(index_of(name), std::string_view(text));
+}
+
+template_args& template_args::set(const std::string& name, const std::string& text) {
+	return set(index_of(name), std::string_view(text));
+}
+
+template_args& template_args::set(const std::string& name, double number) {
+	return set(index_of(name), number);
+}
+
+template_args& template_args::set(const std::string& name, snowflake id) {
+	return set(index_of(name), id);
+}
+
+template_args& template_args::set_timestamp(const std::string& name, time_t timestamp) {
+	return set_timestamp(index_of(name), timestamp);
+}
+
+message_template::message_template(const message& m) : message_template(m.build_json()) {
+}
+
+message_template::message_template(const std::string& json) : literal_length(0) {
+	auto slot_names = std::make_shared<std::unordered_map<std::string, size_t>>();
+	std::string literal;
+	size_t pos = 0;
+	while (pos < json.length()) {
+		size_t open = json.find("{{", pos);
+		if (open == std::string::npos) {
+			break;
+		}
+		const bool raw = open + 2 < json.length() && json[open + 2] == '#';
+		const size_t start = raw ? open + 3 : open + 2;
+		size_t close = start;
+		while (close < json.length() && is_slot_char(json[close])) {
+			close++;
+		}
+		if (close == start || json.compare(close, 2, "}}") != 0) {
+			/* Not a slot, just braces in the text */
+			literal.append(json, pos, open + 1 - pos);
+			pos = open + 1;
+			continue;
+		}
+		const std::string name = json.substr(start, close - start);
+		const size_t end = close + 2;
+		/* A raw slot replaces the whole string it is in, if it sits directly between an opening quote and a closing one */
+		size_t backslashes = 0;
+		while (open >= backslashes + 2 && json[open - backslashes - 2] == '\\') {
+			backslashes++;
+		}
+		const bool whole = raw && open > 0 && json[open - 1] == '"' && backslashes % 2 == 0 && end < json.length() && json[end] == '"';
+		literal.append(json, pos, (whole ? open - 1 : open) - pos);
+		literals.push_back(std::move(literal));
+		literal.clear();
+		auto [index, inserted] = slot_names->emplace(name, slot_names->size());
+		refs.push_back({index->second, whole});
+		pos = whole ? end + 1 : end;
+	}
+	literal.append(json, pos, std::string::npos);
+	literals.push_back(std::move(literal));
+	for (const auto& l : literals) {
+		literal_length += l.length();
+	}
+	names = std::move(slot_names);
+}
+
+template_args message_template::args() const {
+	return template_args(names);
+}
+
+size_t message_template::slot(const std::string& name) const {
+	auto i = names->find(name);
+	if (i == names->end()) {
+		throw dpp::logic_exception(err_message_template, "Message template has no slot named " + name);
+	}
+	return i->second;
+}
+
+size_t message_template::slot_count() const {
+	return names->size();
+}
+
+std::string message_template::render(const template_args& values) const {
+	if (values.names != names) {
+		throw dpp::logic_exception(err_message_template, "Template arguments belong to a different message template");
+	}
+	size_t length = literal_length;
+	for (const auto& ref : refs) {
+		length += values.values[ref.index].length() + 2;
+	}
+	std::string out;
+	out.reserve(length);
+	for (size_t i = 0; i < refs.size(); ++i) {
+		out += literals[i];
+		const std::string& value = values.values[refs[i].index];
+		if (refs[i].whole && !values.numeric[refs[i].index]) {
+			out += '"';
+			out += value;
+			out += '"';
+		} else {
+			out += value;
+		}
+	}
+	out += literals.back();
+	return out;
+}
+
+void cluster::message_template_send(const message_template& t, snowflake channel_id, const template_args& values, command_completion_event_t callback) {
+	rest_request<message>(this, API_PATH "/channels", std::to_string(channel_id), "messages", m_post, t.render(values), callback);
+}
+
+} // namespace dpp
@@ -24,11 +24,23 @@
 /* Central point for forcing inclusion of winsock library for all socket code */
 #include <io.h>
 #pragma comment(lib,"ws2_32")
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
 #endif
+#include <atomic>
+#include <chrono>
 #include <dpp/queues.h>
 #include <dpp/cluster.h>
 #include <dpp/httpsclient.h>
 #include <dpp/stringops.h>
+#include <dpp/exception.h>
+#include <dpp/alloc_profile.h>
+#include <dpp/json.h>
 
 namespace dpp {
 
@@ -109,7 +121,7 @@ http_request_completion_t http_request::run(cluster* owner) {
 
 	http_request_completion_t rv;
 	double start = dpp::utility::time_f();
-	std::string _host = DISCORD_HOST;
+	std::string _host = owner->get_rest_host();
 	std::string _url = endpoint;
 
 	if (non_discord) {
@@ -276,11 +288,20 @@ struct compare_request {
 	};
 };
 
+/**
+ * @brief Returns true if an endpoint is an interaction callback, e.g. a reply to an autocomplete
+ * @param endpoint Endpoint of a request
+ */
+bool is_interaction_endpoint(const std::string& endpoint) {
+	return endpoint.find("/interactions/") != std::string::npos;
+}
+
 }
 
 void in_thread::in_loop(uint32_t index)
 {
 	utility::set_thread_name(std::string("http_req/") + std::to_string(index));
+	alloc_scope scope(as_rest);
 	while (!terminating) {
 		std::mutex mtx;
 		std::unique_lock<std::mutex> lock{ mtx };
@@ -302,36 +323,51 @@ void in_thread::in_loop(uint32_t index)
 					return r.get();
 				});
 			}
+			/* Interaction responses have to arrive within seconds, so they go before anything else queued on this thread */
+			std::stable_partition(requests_view.begin(), requests_view.end(), [](const http_request* r) {
+				return is_interaction_endpoint(r->endpoint);
+			});
 
 			for (auto& request_view : requests_view) {
 				const std::string &key = request_view->endpoint;
 				http_request_completion_t rv;
-				auto                      currbucket = buckets.find(key);
+				bucket_t                  currbucket{};
+				bool                      has_bucket = false;
+				{
+					std::lock_guard bucket_lock(bucket_mutex);
+					auto found = buckets.find(key);
+					if (found != buckets.end()) {
+						currbucket = found->second;
+						has_bucket = true;
+					}
+				}
 
-				if (currbucket != buckets.end()) {
-					/* There's a bucket for this request. Check its status. If the bucket says to wait,
+				if (has_bucket && currbucket.remaining < 1) {
+					/* There's a bucket for this request and it is exhausted. If the bucket says to wait,
 					* skip all requests in this bucket till its ok.
 					*/
-					if (currbucket->second.remaining < 1) {
-						uint64_t wait = (currbucket->second.retry_after ? currbucket->second.retry_after : currbucket->second.reset_after);
-						if ((uint64_t)time(nullptr) > currbucket->second.timestamp + wait) {
-							/* Time has passed, we can process this bucket again. send its request. */
-							rv = request_view->run(creator);
-						} else {
-							if (!request_view->waiting) {
-								request_view->waiting = true;
-							}
-							/* Time not up yet, wait more */
-							break;
+					uint64_t wait = (currbucket.retry_after ? currbucket.retry_after : currbucket.reset_after);
+					if ((uint64_t)time(nullptr) <= currbucket.timestamp + wait) {
+						if (!request_view->waiting) {
+							request_view->waiting = true;
 						}
-					} else {
-						/* There's limit remaining, we can just run the request */
-						rv = request_view->run(creator);
+						/* Time not up yet, wait more */
+						break;
+					}
+				}
+
+				/* Either there's limit remaining, time has passed and we can process this bucket again,
+				 * or there's no bucket for this endpoint yet and we make one from its reply.
+				 * If the global limit is shared with other queues, reserve our slot in it first.
+				 */
+				if (requests->global_limiter && !is_interaction_endpoint(request_view->endpoint)) {
+					/* Interaction endpoints are not bound to the global rate limit */
+					uint64_t global_wait;
+					while (!terminating && (global_wait = requests->global_limiter->acquire()) > 0) {
+						std::this_thread::sleep_for(std::chrono::milliseconds(global_wait));
 					}
-				} else {
-					/* No bucket for this endpoint yet. Just send it, and make one from its reply */
-					rv = request_view->run(creator);
 				}
+				rv = request_view->run(creator);
 
 				bucket_t newbucket;
 				newbucket.limit = rv.ratelimit_limit;
@@ -339,11 +375,19 @@ void in_thread::in_loop(uint32_t index)
 				newbucket.reset_after = rv.ratelimit_reset_after;
 				newbucket.retry_after = rv.ratelimit_retry_after;
 				newbucket.timestamp = time(nullptr);
+				newbucket.bucket = rv.ratelimit_bucket;
 				requests->globally_ratelimited = rv.ratelimit_global;
 				if (requests->globally_ratelimited) {
 					requests->globally_limited_for = (newbucket.retry_after ? newbucket.retry_after : newbucket.reset_after);
+					if (requests->global_limiter) {
+						/* Tell everyone else sharing the token to stop too */
+						requests->global_limiter->set_global_limit(requests->globally_limited_for ? requests->globally_limited_for * 1000 : 1000);
+					}
+				}
+				{
+					std::lock_guard bucket_lock(bucket_mutex);
+					buckets[request_view->endpoint] = newbucket;
 				}
-				buckets[request_view->endpoint] = newbucket;
 
 				/* Remove the request from the incoming requests to transfer it to completed requests */
 				std::unique_ptr<http_request> request;
@@ -394,6 +438,7 @@ bool request_queue::queued_deleting_request::operator<(time_t time) const noexce
 void request_queue::out_loop()
 {
 	utility::set_thread_name("req_callback");
+	alloc_scope scope(as_rest);
 	while (!terminating) {
 
 		std::mutex mtx;
@@ -469,4 +514,181 @@ bool request_queue::is_globally_ratelimited() const
 	return this->globally_ratelimited;
 }
 
+request_queue& request_queue::set_global_ratelimiter(std::shared_ptr<global_ratelimiter> limiter)
+{
+	global_limiter = std::move(limiter);
+	return *this;
+}
+
+namespace {
+
+/**
+ * @brief Unix time at which a bucket stops limiting requests
+ */
+time_t bucket_deadline(const bucket_t& b) {
+	return b.timestamp + static_cast<time_t>(b.retry_after ? b.retry_after : b.reset_after);
+}
+
+}
+
+std::string request_queue::get_ratelimit_checkpoint()
+{
+	const time_t now = time(nullptr);
+	json j = json::array();
+	for (in_thread* thread : requests_in) {
+		std::lock_guard lock(thread->bucket_mutex);
+		for (const auto& [endpoint, b] : thread->buckets) {
+			if (bucket_deadline(b) <= now) {
+				/* Reset already, a fresh start knows as much */
+				continue;
+			}
+			j.push_back({
+				{"endpoint", endpoint},
+				{"bucket", b.bucket},
+				{"limit", b.limit},
+				{"remaining", b.remaining},
+				{"reset_after", b.reset_after},
+				{"retry_after", b.retry_after},
+				{"timestamp", b.timestamp},
+			});
+		}
+	}
+	return j.dump();
+}
+
+size_t request_queue::restore_ratelimit_checkpoint(const std::string& checkpoint)
+{
+	json j;
+	try {
+		j = json::parse(checkpoint);
+	}
+	catch (const std::exception& e) {
+		throw dpp::rest_exception(err_ratelimit_checkpoint, std::string("Invalid rate limit checkpoint: ") + e.what());
+	}
+	if (!j.is_array()) {
+		throw dpp::rest_exception(err_ratelimit_checkpoint, "Invalid rate limit checkpoint: not an array");
+	}
+	const time_t now = time(nullptr);
+	size_t restored = 0;
+	for (const auto& entry : j) {
+		if (!entry.is_object() || !entry.contains("endpoint") || !entry["endpoint"].is_string()) {
+			continue;
+		}
+		/* Skip entries with a field of the wrong type, which value() would throw on */
+		bool valid = !entry.contains("bucket") || entry["bucket"].is_string();
+		for (const char* field : {"limit", "remaining", "reset_after", "retry_after", "timestamp"}) {
+			valid = valid && (!entry.contains(field) || entry[field].is_number());
+		}
+		if (!valid) {
+			continue;
+		}
+		bucket_t b;
+		b.limit = entry.value("limit", 0ULL);
+		b.remaining = entry.value("remaining", 0ULL);
+		b.reset_after = entry.value("reset_after", 0ULL);
+		b.retry_after = entry.value("retry_after", 0ULL);
+		b.timestamp = entry.value("timestamp", static_cast<time_t>(0));
+		b.bucket = entry.value("bucket", std::string());
+		/* Age out buckets which have reset while we were down, or which claim to be from the future */
+		if (bucket_deadline(b) <= now || b.timestamp > now) {
+			continue;
+		}
+		const std::string endpoint = entry["endpoint"].get<std::string>();
+		in_thread* thread = requests_in[hash(endpoint.c_str()) % in_thread_pool_size];
+		std::lock_guard lock(thread->bucket_mutex);
+		thread->buckets[endpoint] = b;
+		restored++;
+	}
+	return restored;
+}
+
+/**
+ * @brief State shared between all processes using a dpp::shm_global_ratelimiter.
+ * An all-zero segment, as created by ftruncate(), is a valid initial state.
+ */
+struct shm_ratelimit_state {
+	/**
+	 * @brief Token bucket. Upper 32 bits are the second (unix time) the bucket was last
+	 * refilled, lower 32 bits the number of requests made during that second.
+	 */
+	std::atomic<uint64_t> bucket;
+
+	/**
+	 * @brief Unix time in milliseconds at which the last global 429 expires
+	 */
+	std::atomic<uint64_t> global_until;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared rate limit state requires lock-free 64 bit atomics");
+
+namespace {
+
+uint64_t unix_time_ms() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}
+
+shm_global_ratelimiter::shm_global_ratelimiter(const std::string& name, uint32_t rps) : state(nullptr), requests_per_second(rps)
+{
+#ifdef _WIN32
+	throw dpp::rest_exception(err_shared_memory, "Shared memory global rate limiting is not supported on this platform");
+#else
+	int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+	if (fd < 0) {
+		throw dpp::rest_exception(err_shared_memory, "Unable to open shared memory segment " + name + ": " + strerror(errno));
+	}
+	if (ftruncate(fd, sizeof(shm_ratelimit_state)) != 0) {
+		int e = errno;
+		close(fd);
+		throw dpp::rest_exception(err_shared_memory, "Unable to size shared memory segment " + name + ": " + strerror(e));
+	}
+	void* mem = mmap(nullptr, sizeof(shm_ratelimit_state), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		throw dpp::rest_exception(err_shared_memory, "Unable to map shared memory segment " + name + ": " + strerror(errno));
+	}
+	state = static_cast<shm_ratelimit_state*>(mem);
+#endif
+}
+
+shm_global_ratelimiter::~shm_global_ratelimiter()
+{
+#ifndef _WIN32
+	if (state) {
+		munmap(state, sizeof(shm_ratelimit_state));
+	}
+#endif
+}
+
+uint64_t shm_global_ratelimiter::acquire()
+{
+	uint64_t now = unix_time_ms();
+	uint64_t blocked_until = state->global_until.load(std::memory_order_acquire);
+	if (blocked_until > now) {
+		return blocked_until - now;
+	}
+	uint64_t second = (now / 1000) & 0xFFFFFFFF;
+	uint64_t current = state->bucket.load(std::memory_order_relaxed);
+	for (;;) {
+		/* A bucket from an earlier second has been refilled */
+		uint64_t used = (current >> 32) == second ? (current & 0xFFFFFFFF) : 0;
+		if (used >= requests_per_second) {
+			return 1000 - (now % 1000);
+		}
+		if (state->bucket.compare_exchange_weak(current, (second << 32) | (used + 1), std::memory_order_acq_rel)) {
+			return 0;
+		}
+	}
+}
+
+void shm_global_ratelimiter::set_global_limit(uint64_t retry_after_ms)
+{
+	uint64_t until = unix_time_ms() + retry_after_ms;
+	uint64_t current = state->global_until.load(std::memory_order_relaxed);
+	/* Only ever extend the limit, never shorten one set by another process */
+	while (current < until && !state->global_until.compare_exchange_weak(current, until, std::memory_order_acq_rel)) {
+	}
+}
+
 } // namespace dpp
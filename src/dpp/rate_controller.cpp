@@ -0,0 +1,360 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/rate_controller.h>
+#include <dpp/exception.h>
+#include <dpp/utility.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief Slots in each stripe's timing wheel
+ */
+constexpr int64_t wheel_slots = 256;
+
+/**
+ * @brief Seconds covered by one slot of the timing wheel
+ */
+constexpr double wheel_tick = 1.0;
+
+/**
+ * @brief Allowance for rounding when comparing use counts
+ */
+constexpr double epsilon = 1e-9;
+
+struct rate_key {
+	rate_rule_id rule;
+	uint64_t id;
+
+	bool operator==(const rate_key& other) const {
+		return rule == other.rule && id == other.id;
+	}
+};
+
+struct rate_key_hash {
+	size_t operator()(const rate_key& k) const {
+		return std::hash<uint64_t>()(k.id) ^ (static_cast<uint64_t>(k.rule) * 0x9e3779b97f4a7c15ULL);
+	}
+};
+
+struct rate_entry {
+	/**
+	 * @brief Tokens left (token bucket), or uses in the current window (sliding window)
+	 */
+	double value{0};
+
+	/**
+	 * @brief Uses in the previous window (sliding window)
+	 */
+	double previous{0};
+
+	/**
+	 * @brief Time of the last refill (token bucket), or index of the current window (sliding window)
+	 */
+	double stamp{0};
+
+	/**
+	 * @brief When this state becomes the same as a fresh one and can be dropped
+	 */
+	double expires{0};
+
+	/**
+	 * @brief Tick of the timing wheel slot the key is in, -1 if it is in none
+	 */
+	int64_t slot_tick{-1};
+};
+
+struct stripe {
+	std::mutex mutex;
+	std::unordered_map<rate_key, rate_entry, rate_key_hash> entries;
+
+	/**
+	 * @brief Keys to look at when the wheel reaches each slot. An entry is in at most one slot; if it
+	 * has not expired when its slot is reached it is moved on to the slot of its new expiry time.
+	 */
+	std::array<std::vector<rate_key>, wheel_slots> wheel;
+
+	/**
+	 * @brief Last tick the wheel was advanced to, -1 before first use
+	 */
+	int64_t tick{-1};
+
+	int64_t tick_of(double time) const {
+		return static_cast<int64_t>(std::floor(time / wheel_tick));
+	}
+
+	void schedule(const rate_key& key, rate_entry& entry) {
+		const int64_t at = std::max(tick_of(entry.expires), tick + 1);
+		wheel[static_cast<size_t>(at % wheel_slots)].push_back(key);
+		entry.slot_tick = at;
+	}
+
+	/**
+	 * @brief Move the wheel on to the current time, dropping entries which have expired.
+	 * Visits at most one turn of the wheel, so the cost of a call is bounded.
+	 */
+	void advance(double now) {
+		const int64_t now_tick = tick_of(now);
+		if (tick < 0 || now_tick <= tick) {
+			tick = std::max(tick, now_tick);
+			return;
+		}
+		const int64_t steps = std::min(now_tick - tick, wheel_slots);
+		const int64_t from = tick;
+		tick = now_tick;
+		for (int64_t i = 1; i <= steps; ++i) {
+			const int64_t at = from + i;
+			std::vector<rate_key>& slot = wheel[static_cast<size_t>(at % wheel_slots)];
+			std::vector<rate_key> due;
+			due.swap(slot);
+			for (const rate_key& key : due) {
+				auto e = entries.find(key);
+				if (e == entries.end()) {
+					/* Reset since it was scheduled */
+					continue;
+				}
+				if (e->second.slot_tick > at) {
+					if ((e->second.slot_tick - at) % wheel_slots == 0) {
+						/* Due on a later turn of the wheel */
+						slot.push_back(key);
+					}
+					/* Otherwise this is a stale copy, the key has been scheduled into another slot since */
+					continue;
+				}
+				if (e->second.expires <= now) {
+					entries.erase(e);
+				} else {
+					schedule(key, e->second);
+				}
+			}
+		}
+	}
+};
+
+}
+
+struct rate_controller::state {
+	std::vector<stripe> stripes;
+
+	explicit state(size_t count) : stripes(std::max<size_t>(count, 1)) {
+	}
+
+	stripe& stripe_for(const rate_key& key) {
+		return stripes[rate_key_hash()(key) % stripes.size()];
+	}
+};
+
+rate_rule rate_rule::cooldown(rate_scope scope, double seconds) {
+	return token_bucket(scope, 1, seconds);
+}
+
+rate_rule rate_rule::token_bucket(rate_scope scope, uint32_t limit, double period) {
+	rate_rule r;
+	r.algorithm = ra_token_bucket;
+	r.scope = scope;
+	r.limit = limit;
+	r.period = period;
+	return r;
+}
+
+rate_rule rate_rule::sliding_window(rate_scope scope, uint32_t limit, double period) {
+	rate_rule r;
+	r.algorithm = ra_sliding_window;
+	r.scope = scope;
+	r.limit = limit;
+	r.period = period;
+	return r;
+}
+
+rate_controller::rate_controller(size_t stripes, rate_clock_t c) : data(std::make_unique<state>(stripes)), clock(c ? std::move(c) : rate_clock_t(utility::time_f)) {
+}
+
+rate_controller::~rate_controller() = default;
+
+rate_rule_id rate_controller::add_rule(const rate_rule& rule) {
+	if (rule.limit == 0 || !(rule.period > 0)) {
+		throw dpp::logic_exception(err_rate_rule, "Rate rules need a limit and period above zero");
+	}
+	std::unique_lock lock(rules_mutex);
+	rules.push_back(rule);
+	return static_cast<rate_rule_id>(rules.size() - 1);
+}
+
+rate_rule rate_controller::get_rule(rate_rule_id rule) const {
+	std::shared_lock lock(rules_mutex);
+	if (rule >= rules.size()) {
+		throw dpp::logic_exception(err_rate_rule, "No rate rule with ID " + std::to_string(rule));
+	}
+	return rules[rule];
+}
+
+namespace {
+
+/**
+ * @brief Check, and optionally count, a use against a key's state. The stripe must be locked and advanced.
+ */
+rate_decision decide(stripe& s, const rate_key& key, const rate_rule& rule, uint32_t cost, double now, bool commit) {
+	const double limit = rule.limit;
+	if (cost > rule.limit) {
+		return {false, std::numeric_limits<double>::infinity()};
+	}
+	auto found = s.entries.find(key);
+	rate_entry e;
+	if (found != s.entries.end()) {
+		e = found->second;
+	} else if (rule.algorithm == ra_token_bucket) {
+		e.value = limit;
+		e.stamp = now;
+	} else {
+		e.stamp = std::floor(now / rule.period);
+	}
+
+	rate_decision decision;
+	if (rule.algorithm == ra_token_bucket) {
+		const double rate = limit / rule.period;
+		e.value = std::min(limit, e.value + std::max(0.0, now - e.stamp) * rate);
+		e.stamp = now;
+		decision.allowed = e.value + epsilon >= cost;
+		if (decision.allowed) {
+			e.value = std::max(0.0, e.value - cost);
+			e.expires = now + (limit - e.value) / rate;
+		} else {
+			decision.retry_after = (cost - e.value) / rate;
+		}
+	} else {
+		const double window = std::floor(now / rule.period);
+		if (window > e.stamp) {
+			/* Roll on to the current window; anything older than the previous one no longer counts */
+			e.previous = window - e.stamp < 1.5 ? e.value : 0;
+			e.value = 0;
+			e.stamp = window;
+		}
+		const double elapsed = now / rule.period - window;
+		decision.allowed = e.previous * (1 - elapsed) + e.value + cost <= limit + epsilon;
+		if (decision.allowed) {
+			e.value += cost;
+			e.expires = (window + 2) * rule.period;
+		} else if (e.value + cost <= limit) {
+			/* The previous window's share falls away as this one goes on */
+			decision.retry_after = (1 - (limit - e.value - cost) / e.previous - elapsed) * rule.period;
+		} else {
+			/* Not before the next window, where this window's count becomes the previous one */
+			decision.retry_after = (1 - elapsed + std::max(0.0, 1 - (limit - cost) / e.value)) * rule.period;
+		}
+	}
+
+	if (commit && decision.allowed) {
+		auto& stored = (found != s.entries.end()) ? found->second : s.entries[key];
+		const int64_t slot_tick = stored.slot_tick;
+		stored = e;
+		stored.slot_tick = slot_tick;
+		if (slot_tick < 0) {
+			s.schedule(key, stored);
+		}
+	}
+	return decision;
+}
+
+}
+
+rate_decision rate_controller::evaluate(rate_rule_id rule_id, snowflake id, uint32_t cost, bool commit) {
+	const rate_rule rule = get_rule(rule_id);
+	const double now = clock();
+	const rate_key key{rule_id, id};
+	stripe& s = data->stripe_for(key);
+	std::lock_guard lock(s.mutex);
+	s.advance(now);
+	return decide(s, key, rule, cost, now, commit);
+}
+
+rate_decision rate_controller::consume(rate_rule_id rule, snowflake key, uint32_t cost) {
+	return evaluate(rule, key, cost, true);
+}
+
+rate_decision rate_controller::consume_all(const std::vector<std::pair<rate_rule_id, snowflake>>& uses, uint32_t cost) {
+	std::vector<rate_rule> used_rules;
+	used_rules.reserve(uses.size());
+	for (const auto& use : uses) {
+		used_rules.push_back(get_rule(use.first));
+	}
+	/* Lock every stripe involved, in index order so two calls cannot each hold one the other needs */
+	std::vector<size_t> order;
+	for (const auto& use : uses) {
+		order.push_back(rate_key_hash()(rate_key{use.first, use.second}) % data->stripes.size());
+	}
+	std::sort(order.begin(), order.end());
+	order.erase(std::unique(order.begin(), order.end()), order.end());
+	std::vector<std::unique_lock<std::mutex>> locks;
+	locks.reserve(order.size());
+	const double now = clock();
+	for (size_t index : order) {
+		locks.emplace_back(data->stripes[index].mutex);
+		data->stripes[index].advance(now);
+	}
+
+	rate_decision refused{true, 0};
+	for (size_t i = 0; i < uses.size(); ++i) {
+		const rate_key key{uses[i].first, uses[i].second};
+		rate_decision d = decide(data->stripe_for(key), key, used_rules[i], cost, now, false);
+		if (!d.allowed) {
+			refused.allowed = false;
+			refused.retry_after = std::max(refused.retry_after, d.retry_after);
+		}
+	}
+	if (!refused.allowed) {
+		return refused;
+	}
+	for (size_t i = 0; i < uses.size(); ++i) {
+		const rate_key key{uses[i].first, uses[i].second};
+		decide(data->stripe_for(key), key, used_rules[i], cost, now, true);
+	}
+	return refused;
+}
+
+rate_decision rate_controller::peek(rate_rule_id rule, snowflake key, uint32_t cost) {
+	return evaluate(rule, key, cost, false);
+}
+
+void rate_controller::reset(rate_rule_id rule, snowflake id) {
+	const rate_key key{rule, id};
+	stripe& s = data->stripe_for(key);
+	std::lock_guard lock(s.mutex);
+	s.entries.erase(key);
+}
+
+size_t rate_controller::size() const {
+	size_t total = 0;
+	for (stripe& s : data->stripes) {
+		std::lock_guard lock(s.mutex);
+		total += s.entries.size();
+	}
+	return total;
+}
+
+} // namespace dpp
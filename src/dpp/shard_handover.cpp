@@ -0,0 +1,92 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/shard_handover.h>
+#include <dpp/discordevents.h>
+#include <dpp/json.h>
+
+namespace dpp {
+
+bool shard_handover::accept(shard_delivery delivery, uint32_t shard_id, const std::string& event, const json& j) {
+	if (delivery == sd_dispatch) {
+		return true;
+	}
+	if (delivery == sd_retired) {
+		return false;
+	}
+	auto d = j.find("d");
+	const bool new_set = delivery == sd_standby || delivery == sd_takeover;
+	if (event == "READY" || event == "RESUMED") {
+		if (event == "READY" && new_set && d != j.end() && d->contains("guilds")) {
+			/* Discord follows READY with a GUILD_CREATE for each of these */
+			std::unique_lock l(lock);
+			auto& burst = bursts[shard_id];
+			burst_size -= burst.size();
+			burst.clear();
+			for (const auto& g : (*d)["guilds"]) {
+				burst.insert(snowflake_not_null(&g, "id"));
+			}
+			burst_size += burst.size();
+		}
+		/* Needed to track the session, ready and resumed don't dispatch for standby shards */
+		return true;
+	}
+	if (new_set && event == "GUILD_CREATE" && burst_size > 0 && d != j.end()) {
+		std::unique_lock l(lock);
+		auto burst = bursts.find(shard_id);
+		if (burst != bursts.end() && burst->second.erase(snowflake_not_null(&(*d), "id"))) {
+			burst_size--;
+			return false;
+		}
+	}
+	if (delivery == sd_standby) {
+		return false;
+	}
+
+	/* Sequence numbers differ between sessions, the name and payload don't */
+	std::string key = event + '\n' + (d != j.end() ? d->dump() : "");
+	std::unique_lock l(lock);
+	auto& mine = delivery == sd_handover ? outgoing : incoming;
+	auto& theirs = delivery == sd_handover ? incoming : outgoing;
+	auto copy = theirs.find(key);
+	if (copy != theirs.end()) {
+		if (--copy->second == 0) {
+			theirs.erase(copy);
+		}
+		return false;
+	}
+	mine[std::move(key)]++;
+	return true;
+}
+
+bool shard_handover::bursts_complete() const {
+	return burst_size == 0;
+}
+
+void shard_handover::clear() {
+	std::unique_lock l(lock);
+	outgoing.clear();
+	incoming.clear();
+	bursts.clear();
+	burst_size = 0;
+}
+
+} // namespace dpp
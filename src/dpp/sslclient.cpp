@@ -240,7 +240,6 @@ ssl_client::ssl_client(const std::string &_hostname, const std::string &_port, b
 	signal(SIGALRM, SIG_IGN);
 	signal(SIGHUP, SIG_IGN);
 	signal(SIGPIPE, SIG_IGN);
-	signal(SIGCHLD, SIG_IGN);
 	signal(SIGXFSZ, SIG_IGN);
 #else
 	// Set up winsock.
@@ -0,0 +1,420 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/subprocess.h>
+#include <dpp/discordvoiceclient.h>
+#include <dpp/exception.h>
+#include <dpp/utility.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace dpp {
+
+struct subprocess::state {
+	/**
+	 * @brief Process id
+	 */
+	int64_t pid = 0;
+
+	/**
+	 * @brief Read ends of the output pipes, -1 once closed. Only touched by the I/O thread after start.
+	 */
+	int out_fd = -1, err_fd = -1;
+
+	/**
+	 * @brief Callbacks and limits
+	 */
+	subprocess_options options;
+
+	/**
+	 * @brief When to kill the process, if it has a timeout
+	 */
+	std::chrono::steady_clock::time_point deadline;
+
+	/**
+	 * @brief True once the process has been killed for running past its deadline
+	 */
+	bool timed_out = false;
+
+	/**
+	 * @brief True until on_exit has been called
+	 */
+	std::atomic<bool> running{true};
+};
+
+#ifndef _WIN32
+
+namespace {
+
+/**
+ * @brief The thread which services the pipes of every subprocess
+ */
+class subprocess_io {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<subprocess::state>> processes;
+	int wake[2] = {-1, -1};
+	bool terminating = false;
+	std::thread runner;
+
+	/**
+	 * @brief Read whatever is waiting on a pipe. Closes it at end of file.
+	 */
+	static void drain(int& fd, const std::function<void(std::string_view)>& callback) {
+		char buffer[65536];
+		while (fd >= 0) {
+			ssize_t n = ::read(fd, buffer, sizeof(buffer));
+			if (n > 0) {
+				if (callback) {
+					callback(std::string_view(buffer, n));
+				}
+				/* Check backpressure again before reading more than one buffer */
+				return;
+			} else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+				return;
+			}
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+	void run() {
+		utility::set_thread_name("subprocess");
+		std::vector<pollfd> fds;
+		std::vector<std::pair<std::shared_ptr<subprocess::state>, int*>> owners;
+		while (true) {
+			std::vector<std::shared_ptr<subprocess::state>> current;
+			{
+				std::unique_lock l(mutex);
+				if (terminating) {
+					return;
+				}
+				current = processes;
+			}
+			fds.clear();
+			owners.clear();
+			fds.push_back({wake[0], POLLIN, 0});
+			owners.emplace_back(nullptr, nullptr);
+			int timeout = -1;
+			auto now = std::chrono::steady_clock::now();
+			for (auto& p : current) {
+				if (p->out_fd >= 0) {
+					if (!p->options.ready_for_stdout || p->options.ready_for_stdout()) {
+						fds.push_back({p->out_fd, POLLIN, 0});
+						owners.emplace_back(p, &p->out_fd);
+					} else {
+						timeout = 20;
+					}
+				}
+				if (p->err_fd >= 0) {
+					fds.push_back({p->err_fd, POLLIN, 0});
+					owners.emplace_back(p, &p->err_fd);
+				}
+				if (p->out_fd < 0 && p->err_fd < 0) {
+					/* Output is finished but the process has not exited yet */
+					timeout = 20;
+				}
+				if (p->options.timeout.count() && !p->timed_out) {
+					if (p->deadline <= now) {
+						::kill(static_cast<pid_t>(p->pid), SIGKILL);
+						p->timed_out = true;
+					} else {
+						int until = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(p->deadline - now).count()) + 1;
+						timeout = timeout < 0 ? until : std::min(timeout, until);
+					}
+				}
+			}
+
+			if (::poll(fds.data(), fds.size(), timeout) > 0) {
+				if (fds[0].revents) {
+					char discard[64];
+					while (::read(wake[0], discard, sizeof(discard)) > 0) {
+					}
+				}
+				for (size_t i = 1; i < fds.size(); ++i) {
+					if (fds[i].revents) {
+						auto& p = owners[i].first;
+						int* fd = owners[i].second;
+						drain(*fd, fd == &p->out_fd ? p->options.on_stdout : p->options.on_stderr);
+					}
+				}
+			}
+
+			/* Reap processes whose output is complete */
+			for (auto& p : current) {
+				int status = 0;
+				if (p->out_fd >= 0 || p->err_fd >= 0) {
+					continue;
+				}
+				pid_t reaped = ::waitpid(static_cast<pid_t>(p->pid), &status, WNOHANG);
+				/* ECHILD means the application ignores SIGCHLD, so the process was reaped for us and its status is lost */
+				const bool lost = reaped < 0 && errno == ECHILD;
+				if (reaped != static_cast<pid_t>(p->pid) && !lost) {
+					continue;
+				}
+				{
+					std::unique_lock l(mutex);
+					processes.erase(std::remove(processes.begin(), processes.end(), p), processes.end());
+				}
+				int code = lost ? -1 : (WIFEXITED(status) ? WEXITSTATUS(status) : (WIFSIGNALED(status) ? 128 + WTERMSIG(status) : -1));
+				p->running = false;
+				if (p->options.on_exit) {
+					p->options.on_exit(code);
+				}
+			}
+		}
+	}
+
+public:
+	subprocess_io() {
+		if (::pipe(wake) != 0) {
+			throw dpp::exception(err_subprocess, "Unable to create subprocess wakeup pipe: " + std::string(strerror(errno)));
+		}
+		for (int fd : wake) {
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		}
+		runner = std::thread(&subprocess_io::run, this);
+	}
+
+	~subprocess_io() {
+		{
+			std::unique_lock l(mutex);
+			terminating = true;
+		}
+		notify();
+		runner.join();
+		::close(wake[0]);
+		::close(wake[1]);
+	}
+
+	void add(std::shared_ptr<subprocess::state> p) {
+		{
+			std::unique_lock l(mutex);
+			processes.emplace_back(std::move(p));
+		}
+		notify();
+	}
+
+	void notify() {
+		char c = 0;
+		[[maybe_unused]] ssize_t n = ::write(wake[1], &c, 1);
+	}
+
+	static subprocess_io& get() {
+		static subprocess_io io;
+		return io;
+	}
+};
+
+/**
+ * @brief Make a pipe whose read end is non-blocking and neither end survives exec
+ */
+void make_pipe(int fds[2]) {
+	if (::pipe(fds) != 0) {
+		throw dpp::exception(err_subprocess, "Unable to create pipe: " + std::string(strerror(errno)));
+	}
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+}
+
+}
+
+subprocess::subprocess(const std::string& cmd, const std::vector<std::string>& parameters, subprocess_options options) : process(std::make_shared<state>()) {
+	subprocess_io& io = subprocess_io::get();
+	int out[2], err[2] = {-1, -1};
+	make_pipe(out);
+	if (!options.merge_stderr) {
+		try {
+			make_pipe(err);
+		}
+		catch (const dpp::exception&) {
+			::close(out[0]);
+			::close(out[1]);
+			throw;
+		}
+	}
+
+	std::vector<char*> argv;
+	argv.push_back(const_cast<char*>(cmd.c_str()));
+	for (const auto& p : parameters) {
+		argv.push_back(const_cast<char*>(p.c_str()));
+	}
+	argv.push_back(nullptr);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+	posix_spawn_file_actions_adddup2(&actions, out[1], 1);
+	posix_spawn_file_actions_adddup2(&actions, options.merge_stderr ? out[1] : err[1], 2);
+	pid_t pid = 0;
+	int rc = posix_spawnp(&pid, cmd.c_str(), &actions, nullptr, argv.data(), environ);
+	posix_spawn_file_actions_destroy(&actions);
+
+	::close(out[1]);
+	if (err[1] >= 0) {
+		::close(err[1]);
+	}
+	if (rc != 0) {
+		::close(out[0]);
+		if (err[0] >= 0) {
+			::close(err[0]);
+		}
+		process->running = false;
+		throw dpp::exception(err_subprocess, "Unable to start " + cmd + ": " + std::string(strerror(rc)));
+	}
+
+	process->pid = pid;
+	process->out_fd = out[0];
+	process->err_fd = err[0];
+	if (options.merge_stderr) {
+		options.on_stderr = {};
+	}
+	process->options = std::move(options);
+	process->deadline = std::chrono::steady_clock::now() + process->options.timeout;
+	io.add(process);
+}
+
+void subprocess::kill(int signal) {
+	if (process->running && process->pid > 0) {
+		::kill(static_cast<pid_t>(process->pid), signal);
+	}
+}
+
+#else
+
+subprocess::subprocess(const std::string& cmd, const std::vector<std::string>& parameters, subprocess_options options) : process(std::make_shared<state>()) {
+	process->running = false;
+	throw dpp::exception(err_subprocess, "dpp::subprocess is not supported on Windows");
+}
+
+void subprocess::kill(int signal) {
+}
+
+#endif
+
+int64_t subprocess::get_pid() const {
+	return process->pid;
+}
+
+bool subprocess::running() const {
+	return process->running;
+}
+
+struct process_audio_source::shared_state {
+	/**
+	 * @brief Protects vc and pending
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief Voice connection to play on, nullptr once stopped
+	 */
+	discord_voice_client* vc;
+
+	/**
+	 * @brief Output which does not yet fill a frame
+	 */
+	std::string pending;
+
+	/**
+	 * @brief Seconds of audio to keep queued
+	 */
+	float buffer_secs;
+
+	shared_state(discord_voice_client* v, float secs) : vc(v), buffer_secs(secs) {
+	}
+};
+
+namespace {
+
+template <typename T> subprocess_options audio_options(const std::shared_ptr<T>& shared, std::function<void(int)> on_exit) {
+	subprocess_options o;
+	o.on_stdout = [shared](std::string_view data) {
+		std::unique_lock l(shared->mutex);
+		if (!shared->vc) {
+			return;
+		}
+		shared->pending.append(data);
+		size_t whole = shared->pending.length() - (shared->pending.length() % send_audio_raw_max_length);
+		for (size_t pos = 0; pos < whole; pos += send_audio_raw_max_length) {
+			shared->vc->send_audio_raw(reinterpret_cast<uint16_t*>(shared->pending.data() + pos), send_audio_raw_max_length);
+		}
+		shared->pending.erase(0, whole);
+	};
+	o.ready_for_stdout = [shared]() {
+		std::unique_lock l(shared->mutex);
+		return !shared->vc || shared->vc->get_secs_remaining() < shared->buffer_secs;
+	};
+	o.on_exit = [shared, on_exit](int code) {
+		{
+			std::unique_lock l(shared->mutex);
+			/* The last frame is padded with silence, it must still be whole samples */
+			size_t usable = shared->pending.length() - (shared->pending.length() % 4);
+			if (shared->vc && usable >= 4) {
+				shared->vc->send_audio_raw(reinterpret_cast<uint16_t*>(shared->pending.data()), usable);
+			}
+			shared->pending.clear();
+		}
+		if (on_exit) {
+			on_exit(code);
+		}
+	};
+	return o;
+}
+
+}
+
+process_audio_source::process_audio_source(discord_voice_client* vc, const std::string& cmd, const std::vector<std::string>& parameters, float buffer_secs, std::function<void(int exit_code)> on_exit)
+	: shared(std::make_shared<shared_state>(vc, buffer_secs)), process(cmd, parameters, audio_options(shared, std::move(on_exit))) {
+}
+
+process_audio_source::~process_audio_source() {
+	stop();
+}
+
+void process_audio_source::stop() {
+	{
+		std::unique_lock l(shared->mutex);
+		shared->vc = nullptr;
+	}
+	process.kill();
+}
+
+bool process_audio_source::running() const {
+	return process.running();
+}
+
+} // namespace dpp
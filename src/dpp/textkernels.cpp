@@ -0,0 +1,305 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/textkernels.h>
+#include <dpp/stringops.h>
+#include <cstdint>
+
+#if AVX_TYPE >= 1
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define DPP_TEXT_NEON 1
+#endif
+
+namespace dpp::text {
+
+namespace {
+
+bool is_url_safe(unsigned char c) {
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+bool is_markdown(unsigned char c) {
+	switch (c) {
+		case '\\': case '*': case '_': case '|': case '~': case '[': case ']': case '(': case ')': case '>': case '`':
+			return true;
+		default:
+			return false;
+	}
+}
+
+constexpr const char* to_base64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#if AVX_TYPE >= 1
+
+/**
+ * @brief Index of the lowest set bit of a non-zero mask
+ */
+inline size_t first_set(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+}
+
+/* The kernels are written once against these, for 32 byte AVX2 or 16 byte SSE vectors */
+#if AVX_TYPE >= 2
+using vec = __m256i;
+constexpr size_t width = 32;
+constexpr uint32_t all_lanes = 0xffffffffu;
+inline vec load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void store(char* p, vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+inline uint32_t lanes(vec v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+inline vec splat(char c) { return _mm256_set1_epi8(c); }
+inline vec eq(vec a, char c) { return _mm256_cmpeq_epi8(a, splat(c)); }
+inline vec either(vec a, vec b) { return _mm256_or_si256(a, b); }
+inline vec both(vec a, vec b) { return _mm256_and_si256(a, b); }
+inline vec add(vec a, vec b) { return _mm256_add_epi8(a, b); }
+/* Signed compares, so bytes of 0x80 and above are never in range */
+inline vec in_range(vec a, char lo, char hi) { return both(_mm256_cmpgt_epi8(a, splat(lo - 1)), _mm256_cmpgt_epi8(splat(hi + 1), a)); }
+#else
+using vec = __m128i;
+constexpr size_t width = 16;
+constexpr uint32_t all_lanes = 0xffffu;
+inline vec load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void store(char* p, vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline uint32_t lanes(vec v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+inline vec splat(char c) { return _mm_set1_epi8(c); }
+inline vec eq(vec a, char c) { return _mm_cmpeq_epi8(a, splat(c)); }
+inline vec either(vec a, vec b) { return _mm_or_si128(a, b); }
+inline vec both(vec a, vec b) { return _mm_and_si128(a, b); }
+inline vec add(vec a, vec b) { return _mm_add_epi8(a, b); }
+inline vec in_range(vec a, char lo, char hi) { return both(_mm_cmpgt_epi8(a, splat(lo - 1)), _mm_cmpgt_epi8(splat(hi + 1), a)); }
+#endif
+
+/**
+ * @brief Scan whole vectors while none of their bytes match, then finish with the scalar test
+ */
+template <typename Matches, typename Scalar> size_t prefix(const char* data, size_t length, Matches matches, Scalar stop) {
+	size_t pos = 0;
+	for (; pos + width <= length; pos += width) {
+		uint32_t found = matches(load(data + pos));
+		if (found) {
+			return pos + first_set(found);
+		}
+	}
+	while (pos < length && !stop(static_cast<unsigned char>(data[pos]))) {
+		++pos;
+	}
+	return pos;
+}
+
+template <typename Scalar> void fold_case(char* data, size_t length, char lo, char hi, char delta, Scalar scalar) {
+	size_t pos = 0;
+	for (; pos + width <= length; pos += width) {
+		vec v = load(data + pos);
+		store(data + pos, add(v, both(in_range(v, lo, hi), splat(delta))));
+	}
+	for (; pos < length; ++pos) {
+		data[pos] = scalar(data[pos]);
+	}
+}
+
+/**
+ * @brief Base64 encode 12 bytes from each 16 byte lane into 16 characters (Wojciech Muła's method)
+ */
+#if AVX_TYPE >= 2
+inline __m256i base64_lane(__m256i in) {
+	in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+	const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+	const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+	const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+	const __m256i indices = _mm256_or_si256(t1, t3);
+	__m256i offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+	offsets = _mm256_or_si256(offsets, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+	const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	return _mm256_add_epi8(_mm256_shuffle_epi8(shift, offsets), indices);
+}
+#else
+inline __m128i base64_lane(__m128i in) {
+	in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+	const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+	const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+	const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+	const __m128i indices = _mm_or_si128(t1, t3);
+	__m128i offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	offsets = _mm_or_si128(offsets, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+	const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	return _mm_add_epi8(_mm_shuffle_epi8(shift, offsets), indices);
+}
+#endif
+
+#endif
+
+}
+
+const char* instruction_set() {
+#if AVX_TYPE >= 2
+	return "avx2";
+#elif AVX_TYPE == 1
+	return "sse";
+#elif DPP_TEXT_NEON
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+size_t ascii_prefix(const char* data, size_t length) {
+#if AVX_TYPE >= 1
+	/* movemask gathers the top bit of each byte, which is exactly the non-ASCII test */
+	return prefix(data, length, [](vec v) { return lanes(v); }, [](unsigned char c) { return c >= 0x80; });
+#else
+	size_t pos = 0;
+#if DPP_TEXT_NEON
+	for (; pos + 16 <= length; pos += 16) {
+		if (vmaxvq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(data + pos))) >= 0x80) {
+			break;
+		}
+	}
+#endif
+	while (pos < length && static_cast<unsigned char>(data[pos]) < 0x80) {
+		++pos;
+	}
+	return pos;
+#endif
+}
+
+size_t url_safe_prefix(const char* data, size_t length) {
+#if AVX_TYPE >= 1
+	return prefix(data, length, [](vec v) {
+		vec safe = either(either(in_range(v, '0', '9'), in_range(v, 'A', 'Z')), in_range(v, 'a', 'z'));
+		safe = either(safe, either(either(eq(v, '-'), eq(v, '_')), either(eq(v, '.'), eq(v, '~'))));
+		return ~lanes(safe) & all_lanes;
+	}, [](unsigned char c) { return !is_url_safe(c); });
+#else
+	size_t pos = 0;
+	while (pos < length && is_url_safe(static_cast<unsigned char>(data[pos]))) {
+		++pos;
+	}
+	return pos;
+#endif
+}
+
+size_t markdown_plain_prefix(const char* data, size_t length) {
+#if AVX_TYPE >= 1
+	return prefix(data, length, [](vec v) {
+		vec special = either(either(eq(v, '\\'), eq(v, '*')), either(eq(v, '_'), eq(v, '|')));
+		special = either(special, either(either(eq(v, '~'), eq(v, '[')), either(eq(v, ']'), eq(v, '('))));
+		special = either(special, either(either(eq(v, ')'), eq(v, '>')), eq(v, '`')));
+		return lanes(special);
+	}, [](unsigned char c) { return is_markdown(c); });
+#else
+	size_t pos = 0;
+	while (pos < length && !is_markdown(static_cast<unsigned char>(data[pos]))) {
+		++pos;
+	}
+	return pos;
+#endif
+}
+
+void ascii_lowercase(char* data, size_t length) {
+	auto scalar = [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : c; };
+#if AVX_TYPE >= 1
+	fold_case(data, length, 'A', 'Z', 32, scalar);
+#else
+	size_t pos = 0;
+#if DPP_TEXT_NEON
+	for (; pos + 16 <= length; pos += 16) {
+		uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(data + pos));
+		uint8x16_t upper = vandq_u8(vcgeq_u8(v, vdupq_n_u8('A')), vcleq_u8(v, vdupq_n_u8('Z')));
+		vst1q_u8(reinterpret_cast<uint8_t*>(data + pos), vaddq_u8(v, vandq_u8(upper, vdupq_n_u8(32))));
+	}
+#endif
+	for (; pos < length; ++pos) {
+		data[pos] = scalar(data[pos]);
+	}
+#endif
+}
+
+void ascii_uppercase(char* data, size_t length) {
+	auto scalar = [](char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 32) : c; };
+#if AVX_TYPE >= 1
+	fold_case(data, length, 'a', 'z', -32, scalar);
+#else
+	size_t pos = 0;
+#if DPP_TEXT_NEON
+	for (; pos + 16 <= length; pos += 16) {
+		uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(data + pos));
+		uint8x16_t lower = vandq_u8(vcgeq_u8(v, vdupq_n_u8('a')), vcleq_u8(v, vdupq_n_u8('z')));
+		vst1q_u8(reinterpret_cast<uint8_t*>(data + pos), vsubq_u8(v, vandq_u8(lower, vdupq_n_u8(32))));
+	}
+#endif
+	for (; pos < length; ++pos) {
+		data[pos] = scalar(data[pos]);
+	}
+#endif
+}
+
+size_t base64_encode_blocks(const unsigned char* in, size_t length, char* out) {
+	size_t pos = 0;
+#if AVX_TYPE >= 2
+	/* Each lane loads 16 bytes and uses 12, so stop while 4 more bytes are readable */
+	for (; pos + 28 <= length; pos += 24, out += 32) {
+		__m256i v = _mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(in + pos + 12), reinterpret_cast<const __m128i*>(in + pos));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), base64_lane(v));
+	}
+#elif AVX_TYPE == 1
+	for (; pos + 16 <= length; pos += 12, out += 16) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_lane(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + pos))));
+	}
+#endif
+	for (; pos + 3 <= length; pos += 3) {
+		*out++ = to_base64[in[pos] >> 2];
+		*out++ = to_base64[((in[pos] & 0x03) << 4) | (in[pos + 1] >> 4)];
+		*out++ = to_base64[((in[pos + 1] & 0x0f) << 2) | (in[pos + 2] >> 6)];
+		*out++ = to_base64[in[pos + 2] & 0x3f];
+	}
+	return pos;
+}
+
+} // namespace dpp::text
+
+namespace dpp {
+
+template <> std::string lowercase<char>(const std::string& s) {
+	std::string s2 = s;
+	text::ascii_lowercase(s2.data(), s2.length());
+	return s2;
+}
+
+template <> std::string uppercase<char>(const std::string& s) {
+	std::string s2 = s;
+	text::ascii_uppercase(s2.data(), s2.length());
+	return s2;
+}
+
+} // namespace dpp
@@ -0,0 +1,201 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <dpp/thread_cache.h>
+#include <algorithm>
+#include <mutex>
+
+namespace dpp {
+
+thread_cache::thread_cache() : max_threads(0) {
+}
+
+void thread_cache::touch(entry& e) {
+	activity.splice(activity.begin(), activity, e.activity);
+}
+
+void thread_cache::erase(std::unordered_map<snowflake, entry>::iterator i) {
+	activity.erase(i->second.activity);
+	threads.erase(i);
+}
+
+thread_cache& thread_cache::set_max_threads(size_t max) {
+	std::unique_lock l(cache_mutex);
+	max_threads = max;
+	while (max_threads && threads.size() > max_threads) {
+		erase(threads.find(activity.back()));
+	}
+	return *this;
+}
+
+size_t thread_cache::get_max_threads() const {
+	std::shared_lock l(cache_mutex);
+	return max_threads;
+}
+
+void thread_cache::store(const thread& t) {
+	if (!t.id) {
+		return;
+	}
+	std::unique_lock l(cache_mutex);
+	auto i = threads.find(t.id);
+	if (t.metadata.archived) {
+		/* Archived threads are no longer active, so they have no business taking up space */
+		if (i != threads.end()) {
+			erase(i);
+		}
+		return;
+	}
+	if (i != threads.end()) {
+		/* Thread updates don't carry the bot's own membership, keep what we know */
+		thread_member current_user = i->second.t.member;
+		i->second.t = t;
+		if (!t.member.user_id) {
+			i->second.t.member = current_user;
+		}
+		touch(i->second);
+		return;
+	}
+	if (max_threads && threads.size() >= max_threads) {
+		/* Evict whichever thread has gone the longest without any activity */
+		erase(threads.find(activity.back()));
+	}
+	activity.push_front(t.id);
+	threads.emplace(t.id, entry{t, {}, activity.begin()});
+}
+
+void thread_cache::remove(snowflake thread_id) {
+	std::unique_lock l(cache_mutex);
+	auto i = threads.find(thread_id);
+	if (i != threads.end()) {
+		erase(i);
+	}
+}
+
+void thread_cache::remove_guild(snowflake guild_id) {
+	retain_guild(guild_id, {}, {});
+}
+
+void thread_cache::retain_guild(snowflake guild_id, const std::vector<snowflake>& parent_ids, const std::vector<snowflake>& active_ids) {
+	std::unique_lock l(cache_mutex);
+	for (auto i = threads.begin(); i != threads.end();) {
+		const thread& t = i->second.t;
+		bool in_scope = t.guild_id == guild_id && (parent_ids.empty() || std::find(parent_ids.begin(), parent_ids.end(), t.parent_id) != parent_ids.end());
+		if (in_scope && std::find(active_ids.begin(), active_ids.end(), t.id) == active_ids.end()) {
+			activity.erase(i->second.activity);
+			i = threads.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void thread_cache::store_member(const thread_member& member, bool is_current_user) {
+	std::unique_lock l(cache_mutex);
+	auto i = threads.find(member.thread_id);
+	if (i == threads.end()) {
+		return;
+	}
+	if (is_current_user) {
+		i->second.t.member = member;
+	}
+	i->second.members[member.user_id] = member;
+}
+
+void thread_cache::update_members(snowflake thread_id, uint8_t member_count, const std::vector<thread_member>& added, const std::vector<snowflake>& removed_ids, snowflake current_user_id) {
+	std::unique_lock l(cache_mutex);
+	auto i = threads.find(thread_id);
+	if (i == threads.end()) {
+		return;
+	}
+	thread& t = i->second.t;
+	snowflake me = current_user_id.empty() ? t.member.user_id : current_user_id;
+	t.member_count = member_count;
+	for (auto& m : added) {
+		i->second.members[m.user_id] = m;
+		if (!me.empty() && m.user_id == me) {
+			t.member = m;
+		}
+	}
+	for (auto& id : removed_ids) {
+		i->second.members.erase(id);
+		if (!me.empty() && id == me) {
+			t.member = {};
+		}
+	}
+	touch(i->second);
+}
+
+std::optional<thread> thread_cache::find(snowflake thread_id) const {
+	std::shared_lock l(cache_mutex);
+	auto i = threads.find(thread_id);
+	if (i == threads.end()) {
+		return std::nullopt;
+	}
+	return i->second.t;
+}
+
+thread_member_map thread_cache::get_members(snowflake thread_id) const {
+	std::shared_lock l(cache_mutex);
+	auto i = threads.find(thread_id);
+	if (i == threads.end()) {
+		return {};
+	}
+	return i->second.members;
+}
+
+thread_map thread_cache::get_guild_threads(snowflake guild_id) const {
+	std::shared_lock l(cache_mutex);
+	thread_map result;
+	for (auto& [id, e] : threads) {
+		if (e.t.guild_id == guild_id) {
+			result.emplace(id, e.t);
+		}
+	}
+	return result;
+}
+
+uint64_t thread_cache::count() const {
+	std::shared_lock l(cache_mutex);
+	return threads.size();
+}
+
+void thread_cache::clear() {
+	std::unique_lock l(cache_mutex);
+	threads.clear();
+	activity.clear();
+}
+
+thread_cache* get_thread_cache() {
+	static thread_cache tc;
+	return &tc;
+}
+
+std::optional<thread> find_thread(snowflake id) {
+	return get_thread_cache()->find(id);
+}
+
+uint64_t get_thread_count() {
+	return get_thread_cache()->count();
+}
+
+} // namespace dpp
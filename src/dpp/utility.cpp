@@ -33,10 +33,13 @@
 #include <fstream>
 #include <streambuf>
 #include <array>
+#include <cstring>
 #include <dpp/cluster.h>
 #include <dpp/dispatcher.h>
 #include <dpp/message.h>
 #include <dpp/discordevents.h>
+#include <dpp/subprocess.h>
+#include <dpp/textkernels.h>
 
 #ifdef _WIN32
 	#include <stdio.h>
@@ -456,6 +459,28 @@ uint32_t hsl(double h, double s, double l) {
 }
 
 void exec(const std::string& cmd, std::vector<std::string> parameters, cmd_result_t callback) {
+#ifndef _WIN32
+	auto output = std::make_shared<std::string>();
+	subprocess_options options;
+	options.merge_stderr = true;
+	options.on_stdout = [output](std::string_view data) {
+		output->append(data);
+	};
+	options.on_exit = [output, callback](int) {
+		if (callback) {
+			callback(*output);
+		}
+	};
+	try {
+		subprocess(cmd, parameters, std::move(options));
+	}
+	catch (const dpp::exception& e) {
+		/* Report it the way a shell would have */
+		if (callback) {
+			callback(std::string(e.what()) + "\n");
+		}
+	}
+#else
 	auto t = std::thread([cmd, parameters, callback]() {
 		utility::set_thread_name("async_exec");
 		std::array<char, 128> buffer;
@@ -480,6 +505,7 @@ void exec(const std::string& cmd, std::vector<std::string> parameters, cmd_resul
 		}
 	});
 	t.detach();
+#endif
 }
 
 size_t utf8len(std::string_view str) {
@@ -490,6 +516,14 @@ size_t utf8len(std::string_view str) {
 	while (pos != raw_len) {
 		const unsigned char cur = str[pos];
 
+		if (cur < 0x80) {
+			/* Runs of ASCII are one code point per byte */
+			const size_t ascii = text::ascii_prefix(str.data() + pos, raw_len - pos);
+			pos += ascii;
+			code_points += ascii;
+			continue;
+		}
+
 		size_t code_point_len = 1;
 		code_point_len += static_cast<size_t>(cur >= 0b11000000);
 		code_point_len += static_cast<size_t>(cur >= 0b11100000);
@@ -525,6 +559,19 @@ std::string_view utf8subview(std::string_view str, size_t start, size_t length)
 
 		const unsigned char cur = str[pos];
 
+		if (cur < 0x80) {
+			/* Skip runs of ASCII, one code point per byte, without stepping past the start or end */
+			size_t ascii = text::ascii_prefix(str.data() + pos, raw_len - pos);
+			for (size_t boundary : {start, start + length}) {
+				if (boundary > code_points) {
+					ascii = std::min(ascii, boundary - code_points);
+				}
+			}
+			pos += ascii;
+			code_points += ascii;
+			continue;
+		}
+
 		size_t code_point_len = 1;
 		code_point_len += static_cast<size_t>(cur >= 0b11000000);
 		code_point_len += static_cast<size_t>(cur >= 0b11100000);
@@ -651,26 +698,44 @@ std::function<void(const dpp::confirmation_callback_t& detail)> log_error() {
 /* Hexadecimal sequence for URL encoding */
 static const char* hex = "0123456789ABCDEF";
 
+/* Unreserved characters, which are not percent-encoded */
+static const std::array<bool, 256> url_unreserved = [] {
+	std::array<bool, 256> table{};
+	for (int c = 0; c < 256; ++c) {
+		table[c] = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' || c == '_' || c == '.' || c == '~';
+	}
+	return table;
+}();
+
 std::string url_encode(const std::string &value) {
 	// Reserve worst-case encoded length of string, input length * 3
 	std::string escaped(value.length() * 3, '\0');
 	char* data = escaped.data();
-	int len = 0;
-	for (auto i = value.begin(); i != value.end(); ++i) {
-		unsigned char c = (unsigned char)(*i);
-		if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+	const char* in = value.data();
+	const size_t length = value.length();
+	size_t run = 0;
+	for (size_t i = 0; i < length; ++i) {
+		unsigned char c = (unsigned char)in[i];
+		if (url_unreserved[c]) {
 			// Keep alphanumeric and other accepted characters intact
 			*data++ = c;
-			len++;
+			// Most runs are short words; only a long one, such as an ID or file name, is worth a vector scan
+			if (++run == 16) {
+				const size_t safe = text::url_safe_prefix(in + i + 1, length - i - 1);
+				std::memcpy(data, in + i + 1, safe);
+				data += safe;
+				i += safe;
+				run = 0;
+			}
 		} else {
 			// Any other characters are percent-encoded
 			*data++ = '%';
 			*data++ = hex[c >> 4];
 			*data++ = hex[c & 0x0f];
-			len += 3;
+			run = 0;
 		}
 	}
-	escaped.resize(len);
+	escaped.resize(data - escaped.data());
 	return escaped;
 }
 
@@ -886,7 +951,14 @@ std::string markdown_escape(const std::string& text, bool escape_code_blocks) {
 	const std::string markdown_chars("\\*_|~[]()>");
 
 	for (size_t n = 0; n < text.length(); ++n) {
-		if (text.substr(n, 3) == "```") {
+		/* Text with no markdown in it is copied as it is, whatever the state */
+		const size_t plain = dpp::text::markdown_plain_prefix(text.data() + n, text.length() - n);
+		if (plain) {
+			output.append(text, n, plain);
+			n += plain - 1;
+			continue;
+		}
+		if (text.compare(n, 3, "```") == 0) {
 			/* Start/end a paragraph code block */
 			output += (escape_code_blocks ? "\\`\\`\\`" : "```");
 			n += 2;
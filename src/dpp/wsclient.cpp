@@ -20,6 +20,7 @@
  *
  ************************************************************************************/
 #include <string>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <dpp/wsclient.h>
@@ -37,11 +38,12 @@ constexpr size_t WS_MAX_PAYLOAD_LENGTH_SMALL = 125;
 constexpr size_t WS_MAX_PAYLOAD_LENGTH_LARGE = 65535;
 constexpr size_t MAXHEADERSIZE = sizeof(uint64_t) + 2;
 
-websocket_client::websocket_client(const std::string &hostname, const std::string &port, const std::string &urlpath, ws_opcode opcode)
-	: ssl_client(hostname, port),
+websocket_client::websocket_client(const std::string &hostname, const std::string &port, const std::string &urlpath, ws_opcode opcode, bool plaintext_downgrade)
+	: ssl_client(hostname, port, plaintext_downgrade),
 	state(HTTP_HEADERS),
 	path(urlpath),
-	data_opcode(opcode)
+	data_opcode(opcode),
+	stream_remaining(0)
 {
 	uint64_t k = (time(nullptr) * time(nullptr));
 	/* A 64 bit value as hex with leading zeroes is always 16 chars.
@@ -60,6 +62,7 @@ websocket_client::websocket_client(const std::string &hostname, const std::strin
 void websocket_client::connect()
 {
 	state = HTTP_HEADERS;
+	stream_remaining = 0;
 	/* Send headers synchronously */
 	this->write(
 		"GET " + this->path + " HTTP/1.1\r\n"
@@ -79,6 +82,16 @@ bool websocket_client::handle_frame(const std::string &buffer)
 	return true;
 }
 
+size_t websocket_client::get_stream_threshold() const
+{
+	return 0;
+}
+
+void websocket_client::handle_frame_data(std::string_view chunk, bool first, bool last)
+{
+	/* This is a stub for classes that derive the websocket client and stream frames */
+}
+
 size_t websocket_client::fill_header(unsigned char* outbuf, size_t sendlength, ws_opcode opcode)
 {
 	size_t pos = 0;
@@ -181,6 +194,19 @@ ws_state websocket_client::get_state()
 
 bool websocket_client::parseheader(std::string &data)
 {
+	if (stream_remaining > 0) {
+		/* More of a large frame's payload, passed straight on */
+		if (data.empty()) {
+			return false;
+		}
+		const size_t take = (size_t)std::min<uint64_t>(data.size(), stream_remaining);
+		stream_remaining -= take;
+		this->handle_frame_data(std::string_view(data.data(), take), false, stream_remaining == 0);
+		data.erase(0, take);
+		/* Once the frame is complete, carry on with the next one */
+		return stream_remaining == 0;
+	}
+
 	if (data.size() < 4) {
 		/* Not enough data to form a frame yet */
 		return false;
@@ -233,6 +259,15 @@ bool websocket_client::parseheader(std::string &data)
 
 				if (data.length() < payloadstartoffset + len) {
 					/* We don't have a complete frame yet */
+					const size_t threshold = get_stream_threshold();
+					const unsigned char type = opcode & ~WS_FINBIT;
+					if (threshold && len >= threshold && data.length() > payloadstartoffset && (type == OP_TEXT || type == OP_BINARY || type == OP_CONTINUATION)) {
+						/* A large frame: pass on the part we have now, and the rest as it arrives */
+						const size_t have = data.length() - payloadstartoffset;
+						stream_remaining = len - have;
+						this->handle_frame_data(std::string_view(data.data() + payloadstartoffset, have), true, false);
+						data.clear();
+					}
 					return false;
 				}
 
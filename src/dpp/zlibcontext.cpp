@@ -0,0 +1,99 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/zlibcontext.h>
+#include <zlib.h>
+
+namespace dpp {
+
+struct zlib_stream {
+	/**
+	 * @brief Zlib stream struct
+	 */
+	z_stream d_stream;
+};
+
+namespace {
+
+/**
+ * @brief Size of the output buffer for inflate
+ */
+constexpr size_t decomp_buffer_size = 512 * 1024;
+
+/**
+ * @brief Last four bytes of each message on a zlib-stream connection, the end of a Z_SYNC_FLUSH
+ */
+constexpr uint32_t zlib_suffix = 0x0000FFFF;
+
+}
+
+zlibcontext::zlibcontext() : stream(std::make_unique<zlib_stream>()), buffer(decomp_buffer_size), tail(0)
+{
+	stream->d_stream = {};
+	int error = inflateInit(&(stream->d_stream));
+	if (error != Z_OK) {
+		throw dpp::connection_exception((exception_error_code)error, "Can't initialise stream compression!");
+	}
+}
+
+zlibcontext::~zlibcontext()
+{
+	inflateEnd(&(stream->d_stream));
+}
+
+exception_error_code zlibcontext::decompress(std::string_view input, std::string& decompressed)
+{
+	for (size_t i = input.size() > 4 ? input.size() - 4 : 0; i < input.size(); ++i) {
+		tail = (tail << 8) | (uint8_t)input[i];
+	}
+	stream->d_stream.next_in = (Bytef *)input.data();
+	stream->d_stream.avail_in = (uInt)input.size();
+	do {
+		stream->d_stream.next_out = (Bytef*)buffer.data();
+		stream->d_stream.avail_out = (uInt)buffer.size();
+		int ret = inflate(&(stream->d_stream), Z_NO_FLUSH);
+		size_t have = buffer.size() - stream->d_stream.avail_out;
+		switch (ret)
+		{
+			case Z_NEED_DICT:
+			case Z_STREAM_ERROR:
+				return err_compression_stream;
+			case Z_DATA_ERROR:
+				return err_compression_data;
+			case Z_MEM_ERROR:
+				return err_compression_memory;
+			case Z_OK:
+				decompressed.append((const char*)buffer.data(), have);
+			break;
+			default:
+				/* Stub */
+			break;
+		}
+	} while (stream->d_stream.avail_out == 0);
+	return err_no_code_specified;
+}
+
+bool zlibcontext::message_complete() const
+{
+	return tail == zlib_suffix;
+}
+
+} // namespace dpp
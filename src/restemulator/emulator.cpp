@@ -0,0 +1,452 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include "emulator.h"
+#include <dpp/json.h>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace restemulator {
+
+namespace {
+
+/**
+ * @brief FNV-1a hash of a bucket name, so buckets get opaque hashes like Discord's
+ */
+std::string bucket_hash(const std::string& name) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (unsigned char c : name) {
+		h = (h ^ c) * 0x100000001b3ull;
+	}
+	char out[17];
+	snprintf(out, sizeof(out), "%016llx", static_cast<unsigned long long>(h));
+	return out;
+}
+
+/**
+ * @brief Format seconds the way Discord does, with three decimal places
+ */
+std::string seconds(std::chrono::steady_clock::duration d) {
+	char out[32];
+	snprintf(out, sizeof(out), "%.3f", std::max(0.0, std::chrono::duration<double>(d).count()));
+	return out;
+}
+
+bool is_number(const std::string& s) {
+	return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+std::vector<std::string> split_path(const std::string& path) {
+	std::vector<std::string> parts;
+	std::string p = path.substr(0, path.find('?'));
+	size_t start = 0;
+	while (start <= p.length()) {
+		size_t end = p.find('/', start);
+		if (end == std::string::npos) {
+			end = p.length();
+		}
+		if (end > start) {
+			parts.push_back(p.substr(start, end - start));
+		}
+		start = end + 1;
+	}
+	/* Drop the /api/vNN prefix */
+	if (parts.size() >= 2 && parts[0] == "api" && parts[1].size() > 1 && parts[1][0] == 'v') {
+		parts.erase(parts.begin(), parts.begin() + 2);
+	}
+	return parts;
+}
+
+std::string status_text(int status) {
+	switch (status) {
+		case 200: return "OK";
+		case 204: return "No Content";
+		case 400: return "Bad Request";
+		case 401: return "Unauthorized";
+		case 429: return "Too Many Requests";
+		case 500: return "Internal Server Error";
+		case 502: return "Bad Gateway";
+		case 503: return "Service Unavailable";
+		default: return "Unknown";
+	}
+}
+
+emulated_response rate_limited(const std::string& scope, std::chrono::steady_clock::duration retry_after, bool global) {
+	emulated_response r;
+	r.status = 429;
+	r.headers.emplace("content-type", "application/json");
+	r.headers.emplace("retry-after", seconds(retry_after));
+	r.headers.emplace("x-ratelimit-retry-after", seconds(retry_after));
+	r.headers.emplace("x-ratelimit-scope", scope);
+	if (global) {
+		r.headers.emplace("x-ratelimit-global", "true");
+	}
+	dpp::json body = {{"message", "You are being rate limited."}, {"retry_after", std::chrono::duration<double>(retry_after).count()}, {"global", global}};
+	r.body = body.dump();
+	return r;
+}
+
+}
+
+emulator::emulator(const emulator_config& cfg) : config(cfg), global_window(std::chrono::steady_clock::now()), random(cfg.seed) {
+}
+
+emulator::~emulator() {
+	stop();
+}
+
+std::string emulator::route_of(const std::string& path, std::string& major) {
+	std::vector<std::string> parts = split_path(path);
+	std::string route;
+	major.clear();
+	for (size_t i = 0; i < parts.size(); ++i) {
+		const std::string& prev = i > 0 ? parts[i - 1] : "";
+		std::string part = parts[i];
+		if (major.empty() && (prev == "channels" || prev == "guilds" || prev == "webhooks")) {
+			major = part;
+			part = "{id}";
+		} else if (i >= 2 && parts[i - 2] == "webhooks" && !is_number(part)) {
+			/* Webhook routes are limited per webhook and token */
+			major += "/" + part;
+			part = "{token}";
+		} else if (prev == "reactions") {
+			part = "{emoji}";
+		} else if (is_number(part)) {
+			part = "{id}";
+		}
+		route += (route.empty() ? "" : "/") + part;
+	}
+	return route;
+}
+
+emulator::bucket_limit emulator::limit_for(const std::string& route) {
+	using namespace std::chrono_literals;
+	/* Message create and edit share a bucket, as do adding and removing our own reactions */
+	static const std::map<std::string, std::pair<std::string, std::pair<uint32_t, std::chrono::milliseconds>>> known = {
+		{"POST channels/{id}/messages", {"messages", {5, 5000ms}}},
+		{"PATCH channels/{id}/messages/{id}", {"messages", {5, 5000ms}}},
+		{"DELETE channels/{id}/messages/{id}", {"message_delete", {5, 1000ms}}},
+		{"PUT channels/{id}/messages/{id}/reactions/{emoji}/@me", {"reactions", {1, 250ms}}},
+		{"DELETE channels/{id}/messages/{id}/reactions/{emoji}/@me", {"reactions", {1, 250ms}}},
+		{"GET channels/{id}", {"channel", {5, 5000ms}}},
+		{"PATCH channels/{id}", {"channel_edit", {2, 600000ms}}},
+		{"GET guilds/{id}", {"guild", {5, 5000ms}}},
+		{"GET guilds/{id}/members", {"guild_members", {10, 10000ms}}},
+	};
+	auto i = known.find(route);
+	if (i != known.end()) {
+		return {bucket_hash(i->second.first), i->second.second.first, i->second.second.second};
+	}
+	return {bucket_hash(route), 5, 5000ms};
+}
+
+emulated_response emulator::handle(const std::string& method, const std::string& path, const std::string& authorization, const std::string& body) {
+	std::string major;
+	const std::string route = method + " " + route_of(path, major);
+	auto now = std::chrono::steady_clock::now();
+	std::unique_lock lock(mutex);
+	stats.requests++;
+
+	if (authorization.rfind("Bot ", 0) != 0) {
+		stats.unauthorized++;
+		emulated_response r;
+		r.status = 401;
+		r.body = R"({"message":"401: Unauthorized","code":0})";
+		r.headers.emplace("content-type", "application/json");
+		return r;
+	}
+
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+	std::chrono::milliseconds delay(config.latency_ms + (config.jitter_ms ? std::uniform_int_distribution<uint32_t>(0, config.jitter_ms)(random) : 0));
+
+	/* Global limit, counted in one second windows */
+	if (now - global_window >= std::chrono::seconds(1)) {
+		global_window = now;
+		global_count = 0;
+	}
+	if (config.global_limit && global_count >= config.global_limit) {
+		stats.global_violations++;
+		emulated_response r = rate_limited("global", global_window + std::chrono::seconds(1) - now, true);
+		r.delay = delay;
+		return r;
+	}
+	global_count++;
+
+	if (chance(random) < config.ratelimit_rate) {
+		/* A shared resource is limited, which the bucket headers could not have predicted */
+		stats.injected_ratelimits++;
+		emulated_response r = rate_limited("shared", std::chrono::seconds(1), false);
+		r.delay = delay;
+		return r;
+	}
+	if (chance(random) < config.error_rate) {
+		stats.injected_errors++;
+		emulated_response r;
+		static const int statuses[] = {500, 502, 503};
+		r.status = statuses[std::uniform_int_distribution<int>(0, 2)(random)];
+		if (r.status == 502) {
+			/* Cloudflare answers these with an HTML page rather than JSON */
+			r.body = "<html><head><title>502 Bad Gateway</title></head><body>502 Bad Gateway</body></html>";
+			r.headers.emplace("content-type", "text/html");
+		} else {
+			r.body = dpp::json({{"message", std::to_string(r.status) + ": " + status_text(r.status)}, {"code", 0}}).dump();
+			r.headers.emplace("content-type", "application/json");
+		}
+		r.delay = delay;
+		return r;
+	}
+
+	bucket_limit limit = limit_for(route);
+	bucket_state& bucket = buckets[limit.hash + ":" + major];
+	if (bucket.reset <= now) {
+		bucket.remaining = limit.limit;
+		bucket.reset = now + limit.window;
+	}
+	emulated_response r;
+	if (bucket.remaining == 0) {
+		stats.bucket_violations++;
+		r = rate_limited("user", bucket.reset - now, false);
+	} else {
+		bucket.remaining--;
+		stats.ok++;
+		std::vector<std::string> parts = split_path(path);
+		std::string id;
+		for (const auto& part : parts) {
+			if (is_number(part)) {
+				id = part;
+			}
+		}
+		if (method == "DELETE" || method == "PUT") {
+			r.status = 204;
+		} else if (method == "GET" && !parts.empty() && !is_number(parts.back())) {
+			/* A list */
+			r.body = "[]";
+		} else {
+			dpp::json j = dpp::json::object();
+			if (!body.empty()) {
+				try {
+					dpp::json sent = dpp::json::parse(body);
+					if (sent.is_object()) {
+						j = sent;
+					}
+				}
+				catch (const std::exception&) {
+					/* Multipart uploads are answered without echoing their content */
+				}
+			}
+			j["id"] = (method == "POST" ? std::to_string(next_id++) : id);
+			if (parts.size() > 2 && parts[0] == "channels") {
+				j["channel_id"] = major;
+			}
+			if (method == "GET") {
+				j["name"] = "emulated";
+				j["type"] = 0;
+			}
+			r.body = j.dump();
+		}
+		if (!r.body.empty()) {
+			r.headers.emplace("content-type", "application/json");
+		}
+	}
+	auto reset_after = bucket.reset - now;
+	auto reset_at = std::chrono::duration<double>((std::chrono::system_clock::now() + reset_after).time_since_epoch()).count();
+	char reset[32];
+	snprintf(reset, sizeof(reset), "%.3f", reset_at);
+	r.headers.emplace("x-ratelimit-bucket", limit.hash);
+	r.headers.emplace("x-ratelimit-limit", std::to_string(limit.limit));
+	r.headers.emplace("x-ratelimit-remaining", std::to_string(bucket.remaining));
+	r.headers.emplace("x-ratelimit-reset", reset);
+	r.headers.emplace("x-ratelimit-reset-after", seconds(reset_after));
+	r.delay = delay;
+	return r;
+}
+
+emulator_stats emulator::get_stats() {
+	std::unique_lock lock(mutex);
+	return stats;
+}
+
+#ifndef _WIN32
+
+uint16_t emulator::start() {
+	listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		throw std::runtime_error("Unable to create socket");
+	}
+	int one = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(config.port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd, 128) != 0 ||
+		getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+		::close(listen_fd);
+		listen_fd = -1;
+		throw std::runtime_error("Unable to listen on port " + std::to_string(config.port));
+	}
+	bound_port = ntohs(addr.sin_port);
+	terminating = false;
+	acceptor = std::thread(&emulator::accept_loop, this);
+	return bound_port;
+}
+
+void emulator::stop() {
+	if (listen_fd < 0) {
+		return;
+	}
+	terminating = true;
+	acceptor.join();
+	::close(listen_fd);
+	listen_fd = -1;
+	while (active > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+void emulator::accept_loop() {
+	while (!terminating) {
+		pollfd pfd{listen_fd, POLLIN, 0};
+		if (poll(&pfd, 1, 100) <= 0) {
+			continue;
+		}
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd < 0) {
+			continue;
+		}
+		active++;
+		std::thread([this, fd]() {
+			serve(fd);
+			::close(fd);
+			active--;
+		}).detach();
+	}
+}
+
+void emulator::serve(int fd) {
+	timeval tv{5, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	std::string buffer;
+	char chunk[4096];
+	size_t header_end;
+	while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+		ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+		if (n <= 0) {
+			return;
+		}
+		buffer.append(chunk, n);
+	}
+
+	/* Request line, then headers with lowercased names */
+	std::string method, path, authorization;
+	size_t content_length = 0;
+	bool bad_request = false;
+	size_t line_start = 0;
+	while (line_start < header_end) {
+		size_t line_end = buffer.find("\r\n", line_start);
+		std::string line = buffer.substr(line_start, line_end - line_start);
+		if (line_start == 0) {
+			size_t sp1 = line.find(' '), sp2 = line.find(' ', sp1 + 1);
+			if (sp1 == std::string::npos || sp2 == std::string::npos) {
+				return;
+			}
+			method = line.substr(0, sp1);
+			path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+		} else if (size_t colon = line.find(':'); colon != std::string::npos) {
+			std::string name = line.substr(0, colon);
+			std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+			std::string value = line.substr(colon + 1);
+			value.erase(0, value.find_first_not_of(' '));
+			value.erase(value.find_last_not_of(' ') + 1);
+			if (name == "content-length") {
+				auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), content_length);
+				bad_request = bad_request || ec != std::errc() || end != value.data() + value.size();
+			} else if (name == "authorization") {
+				authorization = value;
+			}
+		}
+		line_start = line_end + 2;
+	}
+	emulated_response r;
+	if (bad_request) {
+		/* The body can't be found without a length, so answer and close without reading it */
+		r.status = 400;
+		r.body = dpp::json({{"message", "400: Bad Request"}, {"code", 0}}).dump();
+		r.headers.emplace("content-type", "application/json");
+	} else {
+		std::string body = buffer.substr(header_end + 4);
+		while (body.length() < content_length) {
+			ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+			if (n <= 0) {
+				return;
+			}
+			body.append(chunk, n);
+		}
+		r = handle(method, path, authorization, body);
+	}
+	if (r.delay.count() > 0) {
+		std::this_thread::sleep_for(r.delay);
+	}
+	std::string out = "HTTP/1.1 " + std::to_string(r.status) + " " + status_text(r.status) + "\r\n";
+	for (const auto& [name, value] : r.headers) {
+		out += name + ": " + value + "\r\n";
+	}
+	out += "Content-Length: " + std::to_string(r.body.length()) + "\r\nConnection: close\r\n\r\n" + r.body;
+	size_t sent = 0;
+	while (sent < out.length()) {
+		ssize_t n = ::send(fd, out.data() + sent, out.length() - sent, MSG_NOSIGNAL);
+		if (n <= 0) {
+			return;
+		}
+		sent += n;
+	}
+}
+
+#else
+
+uint16_t emulator::start() {
+	throw std::runtime_error("The REST emulator is not supported on Windows");
+}
+
+void emulator::stop() {
+}
+
+void emulator::accept_loop() {
+}
+
+void emulator::serve(int) {
+}
+
+#endif
+
+} // namespace restemulator
@@ -0,0 +1,218 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+/**
+ * @brief A local stand-in for the Discord REST API, for tuning and testing dpp::request_queue
+ * without sending any traffic to Discord.
+ *
+ * Every route answers with plausible JSON and the same x-ratelimit-* headers Discord sends:
+ * routes are grouped into buckets with a hash, some routes share a bucket, each bucket is
+ * tracked per major parameter (channel, guild or webhook), and there is a global limit per
+ * second across all routes. Requests over a limit are answered with a 429 and counted as
+ * violations. Spurious 429s, 5xx errors and latency can be injected at configurable rates.
+ *
+ * The emulator speaks plain HTTP on the loopback interface. Point a cluster at it with
+ * dpp::cluster::set_rest_host("http://127.0.0.1:<port>").
+ */
+namespace restemulator {
+
+/**
+ * @brief Emulator settings
+ */
+struct emulator_config {
+	/**
+	 * @brief Port to listen on, or zero to pick a free one
+	 */
+	uint16_t port = 0;
+
+	/**
+	 * @brief Global limit, in requests per second across all routes
+	 */
+	uint32_t global_limit = 50;
+
+	/**
+	 * @brief Fraction of requests answered with an injected 429 of shared scope
+	 */
+	double ratelimit_rate = 0.0;
+
+	/**
+	 * @brief Fraction of requests answered with an injected 500, 502 or 503
+	 */
+	double error_rate = 0.0;
+
+	/**
+	 * @brief Latency added to every response, in milliseconds
+	 */
+	uint32_t latency_ms = 0;
+
+	/**
+	 * @brief Random extra latency of up to this many milliseconds
+	 */
+	uint32_t jitter_ms = 0;
+
+	/**
+	 * @brief Seed for the injected failures and latency, so runs can be repeated
+	 */
+	uint32_t seed = 1;
+};
+
+/**
+ * @brief Counts of what the emulator has answered
+ */
+struct emulator_stats {
+	uint64_t requests = 0;
+	uint64_t ok = 0;
+	uint64_t bucket_violations = 0;
+	uint64_t global_violations = 0;
+	uint64_t injected_ratelimits = 0;
+	uint64_t injected_errors = 0;
+	uint64_t unauthorized = 0;
+};
+
+/**
+ * @brief A response to send
+ */
+struct emulated_response {
+	int status = 200;
+	std::string body;
+	std::multimap<std::string, std::string> headers;
+
+	/**
+	 * @brief Injected latency to wait before sending the response
+	 */
+	std::chrono::milliseconds delay{0};
+};
+
+class emulator {
+	/**
+	 * @brief Limit of a bucket of routes
+	 */
+	struct bucket_limit {
+		std::string hash;
+		uint32_t limit;
+		std::chrono::milliseconds window;
+	};
+
+	/**
+	 * @brief State of a bucket for one major parameter
+	 */
+	struct bucket_state {
+		uint32_t remaining = 0;
+		std::chrono::steady_clock::time_point reset;
+	};
+
+	emulator_config config;
+
+	/**
+	 * @brief Protects everything below
+	 */
+	std::mutex mutex;
+
+	std::map<std::string, bucket_state> buckets;
+	std::chrono::steady_clock::time_point global_window;
+	uint32_t global_count = 0;
+	std::mt19937 random;
+	emulator_stats stats;
+	uint64_t next_id = 1000000000000000000ull;
+
+	int listen_fd = -1;
+	uint16_t bound_port = 0;
+	std::atomic<bool> terminating{false};
+	std::atomic<uint32_t> active{0};
+	std::thread acceptor;
+
+	/**
+	 * @brief Accept connections until stopped
+	 */
+	void accept_loop();
+
+	/**
+	 * @brief Read one request from a connection, answer it and close the connection
+	 */
+	void serve(int fd);
+
+	/**
+	 * @brief Find the bucket for a route
+	 */
+	static bucket_limit limit_for(const std::string& route);
+
+public:
+	/**
+	 * @brief Create an emulator, not yet listening
+	 */
+	explicit emulator(const emulator_config& cfg);
+
+	/**
+	 * @brief Stops the emulator if it is running
+	 */
+	~emulator();
+
+	/**
+	 * @brief Start listening on the loopback interface
+	 * @return uint16_t The port listened on
+	 * @throw std::runtime_error if the socket could not be opened
+	 */
+	uint16_t start();
+
+	/**
+	 * @brief Stop listening and wait for open connections to finish
+	 */
+	void stop();
+
+	/**
+	 * @brief Answer a request. Used by serve(), and directly in tests.
+	 *
+	 * @param method HTTP method
+	 * @param path Request path, e.g. /api/v10/channels/123/messages
+	 * @param authorization Value of the Authorization header
+	 * @param body Request body
+	 * @return emulated_response The response
+	 */
+	emulated_response handle(const std::string& method, const std::string& path, const std::string& authorization, const std::string& body);
+
+	/**
+	 * @brief Get the counts of what has been answered so far
+	 */
+	emulator_stats get_stats();
+
+	/**
+	 * @brief Split a path into its route and major parameter, e.g.
+	 * /api/v10/channels/123/messages/456 is route "channels/{id}/messages/{id}" with major parameter "123"
+	 *
+	 * @param path Request path
+	 * @param major Set to the major parameter, or empty
+	 * @return std::string The route
+	 */
+	static std::string route_of(const std::string& path, std::string& major);
+};
+
+} // namespace restemulator
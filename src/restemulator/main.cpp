@@ -0,0 +1,220 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+/*
+ * Workload driver for the REST emulator. Starts an emulator, points a cluster's request
+ * queue at it, submits a configurable mix of requests and reports throughput, how long
+ * requests waited in the queue, and whether the queue ever broke a rate limit.
+ *
+ *   restemulator [--requests=N] [--threads=N] [--channels=N] [--global=N]
+ *                [--errors=F] [--ratelimits=F] [--latency=MS] [--jitter=MS]
+ *                [--mix=messages:50,edits:10,reactions:20,channels:15,deletes:5]
+ *                [--port=N] [--serve]
+ *
+ * With --serve only the emulator runs, for pointing another bot at with set_rest_host().
+ */
+
+#include <dpp/dpp.h>
+#include "emulator.h"
+#include <algorithm>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+struct options {
+	restemulator::emulator_config emulator;
+	uint32_t requests = 500;
+	uint32_t threads = 12;
+	uint32_t channels = 4;
+	bool serve = false;
+	std::vector<std::pair<std::string, uint32_t>> mix = {{"messages", 50}, {"edits", 10}, {"reactions", 20}, {"channels", 15}, {"deletes", 5}};
+};
+
+options parse(int argc, char** argv) {
+	options o;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		size_t eq = arg.find('=');
+		std::string name = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+		if (name == "--requests") {
+			o.requests = std::stoul(value);
+		} else if (name == "--threads") {
+			o.threads = std::stoul(value);
+		} else if (name == "--channels") {
+			o.channels = std::max(1ul, std::stoul(value));
+		} else if (name == "--global") {
+			o.emulator.global_limit = std::stoul(value);
+		} else if (name == "--errors") {
+			o.emulator.error_rate = std::stod(value);
+		} else if (name == "--ratelimits") {
+			o.emulator.ratelimit_rate = std::stod(value);
+		} else if (name == "--latency") {
+			o.emulator.latency_ms = std::stoul(value);
+		} else if (name == "--jitter") {
+			o.emulator.jitter_ms = std::stoul(value);
+		} else if (name == "--port") {
+			o.emulator.port = static_cast<uint16_t>(std::stoul(value));
+		} else if (name == "--serve") {
+			o.serve = true;
+		} else if (name == "--mix") {
+			o.mix.clear();
+			for (const auto& part : dpp::utility::tokenize(value, ",")) {
+				size_t colon = part.find(':');
+				if (colon != std::string::npos) {
+					o.mix.emplace_back(part.substr(0, colon), std::stoul(part.substr(colon + 1)));
+				}
+			}
+		} else {
+			throw std::invalid_argument("Unknown option: " + arg);
+		}
+	}
+	return o;
+}
+
+double percentile(std::vector<double>& sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+	std::cerr << "The REST emulator is not supported on Windows\n";
+	return 1;
+#else
+	options o;
+	try {
+		o = parse(argc, argv);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	restemulator::emulator emu(o.emulator);
+	uint16_t port = emu.start();
+	std::cout << "REST emulator listening on http://127.0.0.1:" << port << "\n";
+	if (o.serve) {
+		while (true) {
+			std::this_thread::sleep_for(std::chrono::seconds(60));
+		}
+	}
+
+	/* The cluster is never started, only its request queue is used */
+	dpp::cluster bot("emulated", 0, 1, 0, 1, false, dpp::cache_policy::cpol_default, o.threads);
+	bot.set_rest_host("http://127.0.0.1:" + std::to_string(port));
+
+	std::mutex lock;
+	std::condition_variable done;
+	uint32_t outstanding = 0;
+	std::map<uint16_t, uint32_t> statuses;
+	std::vector<double> queued;
+	std::vector<std::string> kinds;
+
+	uint32_t total_weight = 0;
+	for (const auto& [kind, weight] : o.mix) {
+		total_weight += weight;
+	}
+	if (total_weight == 0) {
+		std::cerr << "The request mix is empty\n";
+		return 1;
+	}
+	for (uint32_t i = 0; i < o.requests; ++i) {
+		/* Spread the kinds evenly through the run rather than sending them in blocks */
+		uint32_t slot = (i * 7919) % total_weight;
+		for (const auto& [kind, weight] : o.mix) {
+			if (slot < weight) {
+				kinds.push_back(kind);
+				break;
+			}
+			slot -= weight;
+		}
+	}
+
+	auto started = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < o.requests; ++i) {
+		dpp::snowflake channel_id = 1000 + (i % o.channels);
+		dpp::snowflake message_id = 2000 + i;
+		auto submitted = std::chrono::steady_clock::now();
+		auto completed = [&, submitted](const dpp::confirmation_callback_t& cc) {
+			double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - submitted).count();
+			std::unique_lock l(lock);
+			statuses[cc.http_info.status]++;
+			queued.push_back(std::max(0.0, total - cc.http_info.latency) * 1000.0);
+			if (--outstanding == 0) {
+				done.notify_all();
+			}
+		};
+		{
+			std::unique_lock l(lock);
+			outstanding++;
+		}
+		const std::string& kind = kinds[i];
+		if (kind == "messages") {
+			bot.message_create(dpp::message(channel_id, "workload " + std::to_string(i)), completed);
+		} else if (kind == "edits") {
+			dpp::message m(channel_id, "edited " + std::to_string(i));
+			m.id = message_id;
+			bot.message_edit(m, completed);
+		} else if (kind == "reactions") {
+			bot.message_add_reaction(message_id, channel_id, "👍", completed);
+		} else if (kind == "deletes") {
+			bot.message_delete(message_id, channel_id, completed);
+		} else {
+			bot.channel_get(channel_id, completed);
+		}
+	}
+
+	{
+		std::unique_lock l(lock);
+		done.wait(l, [&]() { return outstanding == 0; });
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	emu.stop();
+
+	std::sort(queued.begin(), queued.end());
+	restemulator::emulator_stats stats = emu.get_stats();
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Requests:           " << o.requests << " in " << elapsed << "s (" << (o.requests / elapsed) << "/s)\n";
+	std::cout << "Statuses:          ";
+	for (const auto& [status, count] : statuses) {
+		std::cout << " " << status << "=" << count;
+	}
+	std::cout << "\n";
+	std::cout << "Queue time (ms):    mean " << (queued.empty() ? 0 : std::accumulate(queued.begin(), queued.end(), 0.0) / queued.size())
+		<< " p50 " << percentile(queued, 0.50) << " p95 " << percentile(queued, 0.95) << " p99 " << percentile(queued, 0.99)
+		<< " max " << (queued.empty() ? 0 : queued.back()) << "\n";
+	std::cout << "Emulator:           " << stats.requests << " requests, " << stats.ok << " ok, "
+		<< stats.injected_ratelimits << " injected 429s, " << stats.injected_errors << " injected errors\n";
+	std::cout << "Limit violations:   " << stats.bucket_violations << " bucket, " << stats.global_violations << " global\n";
+	return (stats.bucket_violations + stats.global_violations) ? 2 : 0;
+#endif
+}
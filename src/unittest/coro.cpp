@@ -407,6 +407,55 @@ void coro_offline_tests()
 
 	start_test(CORO_ASYNC_OFFLINE);
 	async_test();
+
+	start_test(CORO_POOL_OFFLINE);
+	[]() -> dpp::job {
+		auto call = []() -> dpp::task<int> {
+			co_return co_await dpp::async<int>{sync_awaitable_fun};
+		};
+		// Warm up the pool, after which every task frame and async state should be a reused block
+		for (int i = 0; i < 4; ++i) {
+			co_await call();
+		}
+		dpp::coro_allocation_stats before = dpp::get_coro_allocation_stats();
+		for (int i = 0; i < 100; ++i) {
+			co_await call();
+		}
+		dpp::coro_allocation_stats after = dpp::get_coro_allocation_stats();
+		set_status(CORO_POOL_OFFLINE, after.pool_hits >= before.pool_hits + 200 ? ts_success : ts_failed);
+	}();
+
+	start_test(CORO_POOL_CROSS_THREAD);
+	{
+		// Allocated here and freed on another thread, the way a co_* call is started on a shard and finished on a REST thread
+		struct state : dpp::detail::pooled_allocation {
+			char data[200];
+		};
+		auto round = []() {
+			std::vector<state*> states(32);
+			for (auto& s : states) {
+				s = new state;
+			}
+			std::thread([&states]() {
+				for (auto s : states) {
+					delete s;
+				}
+			}).join();
+		};
+		for (int i = 0; i < 4; ++i) {
+			round();
+		}
+		// Other offline coroutine tests may still be allocating on their own threads, so allow a few attempts at a quiet window
+		bool steady = false;
+		for (int attempt = 0; attempt < 5 && !steady; ++attempt) {
+			uint64_t before = dpp::get_coro_allocation_stats().heap_allocations;
+			for (int i = 0; i < 50; ++i) {
+				round();
+			}
+			steady = dpp::get_coro_allocation_stats().heap_allocations == before;
+		}
+		set_status(CORO_POOL_CROSS_THREAD, steady ? ts_success : ts_failed);
+	}
 }
 
 void event_handler_test(dpp::cluster *bot) {
@@ -25,6 +25,16 @@
 #include <dpp/unicode_emoji.h>
 #include <dpp/restrequest.h>
 #include <dpp/json.h>
+#include <filesystem>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+#include <random>
+#include <zlib.h>
 
 /**
  * @brief Type trait to check if a certain type has a build_json method
@@ -64,6 +74,47 @@ struct has_fill_from_json<T, std::void_t<decltype(std::declval<T&>().fill_from_j
 template <typename T>
 constexpr bool has_fill_from_json_v = has_fill_from_json<T>::value;
 
+#ifndef _WIN32
+/**
+ * @brief A websocket client which inflates a zlib-stream the same way as dpp::discord_client,
+ * connected to a local listener so that tests can feed it frames directly
+ */
+class inflating_client : public dpp::websocket_client {
+	dpp::zlibcontext zlib;
+	std::string decompressed;
+
+	void inflate(std::string_view input, bool end_of_frame) {
+		failed |= zlib.decompress(input, decompressed) != dpp::err_no_code_specified;
+		if (end_of_frame && zlib.message_complete()) {
+			messages.emplace_back(std::move(decompressed));
+			decompressed.clear();
+		}
+	}
+
+public:
+	std::vector<std::string> messages;
+	size_t streamed_frames{0};
+	bool failed{false};
+
+	explicit inflating_client(uint16_t port) : dpp::websocket_client("127.0.0.1", std::to_string(port), "/", dpp::OP_BINARY, true) {
+	}
+
+	bool handle_frame(const std::string &buffer) override {
+		inflate(buffer, true);
+		return true;
+	}
+
+	size_t get_stream_threshold() const override {
+		return 64 * 1024;
+	}
+
+	void handle_frame_data(std::string_view chunk, bool first, bool last) override {
+		streamed_frames += first;
+		inflate(chunk, last);
+	}
+};
+#endif
+
 /* Unit tests go here */
 int main(int argc, char *argv[])
 {
@@ -325,6 +376,950 @@ Markdown lol \\|\\|spoiler\\|\\| \\~\\~strikethrough\\~\\~ \\`small \\*code\\* b
 		set_test(WEBHOOK, false);
 	}
 
+#ifndef _WIN32
+	{ // test dpp::shm_global_ratelimiter, two limiters on one segment act like two processes
+		start_test(GLOBAL_RATELIMITER);
+		std::string segment = "/dpp_unittest_" + std::to_string(time(nullptr));
+		try {
+			dpp::shm_global_ratelimiter a(segment, 1), b(segment, 1);
+			bool shared_bucket = false;
+			/* Retry in case we straddle a one second boundary */
+			for (int attempt = 0; attempt < 3 && !shared_bucket; ++attempt) {
+				shared_bucket = a.acquire() == 0 && b.acquire() > 0;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+			b.set_global_limit(5000);
+			bool shared_global = a.acquire() > 1000;
+			set_status(GLOBAL_RATELIMITER, shared_bucket && shared_global ? ts_success : ts_failed);
+		}
+		catch (const dpp::exception& e) {
+			set_status(GLOBAL_RATELIMITER, ts_failed, e.what());
+		}
+		shm_unlink(segment.c_str());
+	}
+#else
+	skip_test(GLOBAL_RATELIMITER);
+#endif
+
+	{ // test dpp::thread_cache
+		start_test(THREAD_CACHE);
+		bool success = true;
+		dpp::thread_cache tc;
+		tc.set_max_threads(2);
+		dpp::thread t1, t2, t3;
+		t1.id = 1; t2.id = 2; t3.id = 3;
+		t1.guild_id = t2.guild_id = t3.guild_id = 100;
+		t2.parent_id = 50;
+		tc.store(t1);
+		tc.store(t2);
+		tc.store(t1); /* t1 now more recently active than t2 */
+		tc.store(t3); /* evicts t2 */
+		DPP_RUNTIME_CHECK(THREAD_CACHE, (tc.count() == 2 && tc.find(1) && !tc.find(2) && tc.find(3)), success);
+
+		dpp::thread_member m;
+		m.thread_id = 3;
+		m.user_id = 1000;
+		tc.update_members(3, 1, {m}, {});
+		DPP_RUNTIME_CHECK(THREAD_CACHE, (tc.get_members(3).size() == 1 && tc.find(3)->member_count == 1), success);
+		tc.update_members(3, 0, {}, {dpp::snowflake(1000)});
+		DPP_RUNTIME_CHECK(THREAD_CACHE, tc.get_members(3).empty(), success);
+
+		/* The bot joining and leaving through a members update keeps thread::member in step */
+		dpp::thread_member me;
+		me.thread_id = 3;
+		me.user_id = 2000;
+		tc.update_members(3, 1, {me}, {}, 2000);
+		DPP_RUNTIME_CHECK(THREAD_CACHE, (tc.find(3)->member.user_id == 2000), success);
+		tc.update_members(3, 0, {}, {dpp::snowflake(2000)});
+		DPP_RUNTIME_CHECK(THREAD_CACHE, (tc.find(3)->member.user_id.empty() && tc.get_members(3).empty()), success);
+
+		t3.metadata.archived = true;
+		tc.store(t3); /* archiving evicts */
+		DPP_RUNTIME_CHECK(THREAD_CACHE, (!tc.find(3) && tc.count() == 1), success);
+
+		tc.store(t2);
+		tc.retain_guild(100, {50}, {}); /* t2 no longer active under parent 50, t1 untouched */
+		DPP_RUNTIME_CHECK(THREAD_CACHE, (tc.find(1) && !tc.find(2)), success);
+		tc.remove_guild(100);
+		DPP_RUNTIME_CHECK(THREAD_CACHE, (tc.count() == 0), success);
+		set_status(THREAD_CACHE, success ? ts_success : ts_failed);
+	}
+
+	{ // test that an update publishes a new version and leaves the one other threads may hold alone
+		start_test(CACHE_VERSIONS);
+		bool success = true;
+		dpp::cache<dpp::guild> guilds;
+		dpp::guild* g = new dpp::guild();
+		g->id = 800;
+		g->name = "before";
+		dpp::guild_member m;
+		m.user_id = 801;
+		m.guild_id = 800;
+		g->members[m.user_id] = m;
+		guilds.store(g);
+		const dpp::guild* before = guilds.find(800);
+		dpp::json update = {{"id", "800"}, {"name", "after"}};
+		dpp::guild* after = guilds.update(before, [&update](dpp::guild& next) {
+			next.fill_from_json(nullptr, &update);
+		});
+		DPP_RUNTIME_CHECK(CACHE_VERSIONS, (guilds.find(800) == after && after != before), success);
+		DPP_RUNTIME_CHECK(CACHE_VERSIONS, (before->name == "before" && before->members.size() == 1 && before->members.count(801)), success);
+		DPP_RUNTIME_CHECK(CACHE_VERSIONS, (after->name == "after" && after->members.size() == 1 && after->members.count(801)), success);
+		guilds.remove(after);
+		set_status(CACHE_VERSIONS, success ? ts_success : ts_failed);
+	}
+
+	{ // test silence detection used by voice silence suppression
+		start_test(VOICE_SILENCE_DETECT);
+		bool success = true;
+		std::vector<int16_t> pcm(dpp::send_audio_raw_max_length / sizeof(int16_t), 0);
+		const uint16_t* data = reinterpret_cast<const uint16_t*>(pcm.data());
+		DPP_RUNTIME_CHECK(VOICE_SILENCE_DETECT, dpp::discord_voice_client::is_silent(data, dpp::send_audio_raw_max_length, 0), success);
+		pcm[1000] = -20;
+		DPP_RUNTIME_CHECK(VOICE_SILENCE_DETECT, !dpp::discord_voice_client::is_silent(data, dpp::send_audio_raw_max_length, 0), success);
+		DPP_RUNTIME_CHECK(VOICE_SILENCE_DETECT, dpp::discord_voice_client::is_silent(data, dpp::send_audio_raw_max_length, 32), success);
+		pcm[5759] = -32768;
+		DPP_RUNTIME_CHECK(VOICE_SILENCE_DETECT, !dpp::discord_voice_client::is_silent(data, dpp::send_audio_raw_max_length, 32767), success);
+		set_status(VOICE_SILENCE_DETECT, success ? ts_success : ts_failed);
+	}
+
+	{ // test conversion of received audio to the float receive format
+		start_test(VOICE_RECEIVE_FLOAT);
+		bool success = true;
+		const int16_t pcm[5] = { 0, 16384, -16384, -32768, 32767 };
+		float out[5] = { 9.0f, 9.0f, 9.0f, 9.0f, 9.0f };
+		dpp::discord_voice_client::pcm_to_float(pcm, 5, out);
+		DPP_RUNTIME_CHECK(VOICE_RECEIVE_FLOAT, (out[0] == 0.0f && out[1] == 0.5f && out[2] == -0.5f && out[3] == -1.0f), success);
+		DPP_RUNTIME_CHECK(VOICE_RECEIVE_FLOAT, (out[4] < 1.0f && out[4] > 0.9999f), success);
+		set_status(VOICE_RECEIVE_FLOAT, success ? ts_success : ts_failed);
+	}
+
+	{ // test outbound voice track mixing
+		start_test(VOICE_TRACK_MIXER);
+		bool success = true;
+		dpp::voice_track_mixer mixer;
+		std::vector<int16_t> music(64, 1000), speech(32, 500), out(32, 0);
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (!mixer.has_audio() && !mixer.mix(out.data(), out.size())), success);
+		mixer.queue("music", music.data(), music.size());
+		mixer.queue("speech", speech.data(), speech.size());
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (mixer.get_queued("music") == 64 && mixer.get_queued("speech") == 32), success);
+		mixer.mix(out.data(), out.size());
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (out[0] == 1500 && out[31] == 1500), success);
+		mixer.set_ducking("speech", 0.5f);
+		mixer.set_gain("music", 2.0f);
+		mixer.queue("speech", speech.data(), 16);
+		mixer.mix(out.data(), out.size());
+		/* Music is doubled but ducked by half while speech plays, and speech ends half way through the frame */
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (out[0] == 1500 && out[16] == 1000 && out[31] == 1000), success);
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (!mixer.has_audio() && !mixer.mix(out.data(), out.size())), success);
+		std::vector<int16_t> loud(16, 30000);
+		mixer.queue("music", loud.data(), loud.size());
+		mixer.queue("speech", loud.data(), loud.size());
+		mixer.set_ducking("speech", 1.0f);
+		mixer.set_gain("music", 1.0f);
+		mixer.mix(out.data(), 16);
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (out[0] == 32767), success);
+		mixer.queue("speech", speech.data(), speech.size());
+		mixer.clear("speech");
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (!mixer.has_audio() && mixer.get_queued("speech") == 0), success);
+
+		/* Ducking must not depend on whether the ducking track sorts before or after the ducked one */
+		dpp::voice_track_mixer ordered;
+		ordered.set_ducking("a_speech", 0.5f);
+		ordered.queue("music", music.data(), 32);
+		ordered.queue("a_speech", speech.data(), 16);
+		ordered.mix(out.data(), out.size());
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, (out[20] < 1000), success);
+		bool thrown = false;
+		try {
+			ordered.mix(out.data(), 20);
+		}
+		catch (const dpp::voice_exception&) {
+			thrown = true;
+		}
+		DPP_RUNTIME_CHECK(VOICE_TRACK_MIXER, thrown, success);
+		set_status(VOICE_TRACK_MIXER, success ? ts_success : ts_failed);
+	}
+
+	{ // test typed rest results
+		start_test(REST_TYPED_RESULT);
+		bool success = true;
+		dpp::http_request_completion_t http;
+		http.status = 200;
+		http.body = R"({"id":"123","name":"general","type":0})";
+		json j = json::parse(http.body);
+		auto ok = dpp::rest_result<dpp::channel>::from_response(nullptr, j, http);
+		DPP_RUNTIME_CHECK(REST_TYPED_RESULT, (!ok.is_error() && ok && ok.value().name == "general" && ok->id == 123), success);
+
+		http.status = 404;
+		http.body = R"({"message":"Unknown Channel","code":10003})";
+		j = json::parse(http.body);
+		auto failed = dpp::rest_result<dpp::channel>::from_response(nullptr, j, http);
+		DPP_RUNTIME_CHECK(REST_TYPED_RESULT, (failed.is_error() && failed.get_error().code == 10003 && failed.get_error().message == "Unknown Channel"), success);
+		bool thrown = false;
+		try {
+			[[maybe_unused]] const dpp::channel& c = failed.value();
+		}
+		catch (const dpp::rest_exception&) {
+			thrown = true;
+		}
+		DPP_RUNTIME_CHECK(REST_TYPED_RESULT, thrown, success);
+
+		/* A Discord error object is an error even with a 2xx status, matching confirmation_callback_t */
+		http.status = 200;
+		http.body = R"({"message":"Invalid Form Body","code":50035,"errors":{"name":{"_errors":[{"code":"BASE_TYPE_REQUIRED","message":"This field is required"}]}}})";
+		j = json::parse(http.body);
+		auto form = dpp::rest_result<dpp::channel>::from_response(nullptr, j, http);
+		DPP_RUNTIME_CHECK(REST_TYPED_RESULT, (form.is_error() && form.get_error().errors.size() == 1 && dpp::confirmation_callback_t(http).is_error()), success);
+
+		/* An error page from a proxy is not JSON, the message comes from the status or the body */
+		http.status = 502;
+		http.body = "<html>bad gateway</html>";
+		j = json();
+		auto proxy = dpp::rest_result<dpp::channel>::from_response(nullptr, j, http);
+		DPP_RUNTIME_CHECK(REST_TYPED_RESULT, (proxy.is_error() && proxy.get_error().code == 502 && proxy.get_error().human_readable == "502: Bad Gateway"), success);
+		http.status = 520;
+		http.body = "  origin returned an unknown error\n";
+		DPP_RUNTIME_CHECK(REST_TYPED_RESULT, (dpp::get_rest_error(http).message == "origin returned an unknown error"), success);
+		set_status(REST_TYPED_RESULT, success ? ts_success : ts_failed);
+	}
+
+	{ // test autocomplete index
+		start_test(AUTOCOMPLETE_INDEX);
+		bool success = true;
+		dpp::autocomplete_index index(std::vector<std::string>{"Red Panda", "Panda", "Pangolin", "Giant Panda", "Capybara", "Red Fox"});
+		auto names = [](const std::vector<dpp::command_option_choice>& choices) {
+			std::vector<std::string> out;
+			for (const auto& c : choices) {
+				out.push_back(c.name);
+			}
+			return out;
+		};
+		DPP_RUNTIME_CHECK(AUTOCOMPLETE_INDEX, (index.size() == 6), success);
+		/* Prefix matches shortest first, then names with a later word matching */
+		DPP_RUNTIME_CHECK(AUTOCOMPLETE_INDEX, (names(index.search("pan")) == std::vector<std::string>{"Panda", "Pangolin", "Red Panda", "Giant Panda"}), success);
+		DPP_RUNTIME_CHECK(AUTOCOMPLETE_INDEX, (names(index.search("RED")) == std::vector<std::string>{"Red Fox", "Red Panda"}), success);
+		/* Substring and typo matches through trigrams */
+		DPP_RUNTIME_CHECK(AUTOCOMPLETE_INDEX, (names(index.search("ybara")) == std::vector<std::string>{"Capybara"}), success);
+		DPP_RUNTIME_CHECK(AUTOCOMPLETE_INDEX, (names(index.search("capybra")).front() == "Capybara"), success);
+		DPP_RUNTIME_CHECK(AUTOCOMPLETE_INDEX, (index.search("zebra").empty()), success);
+		/* An empty query lists the first choices in the order given */
+		DPP_RUNTIME_CHECK(AUTOCOMPLETE_INDEX, (names(index.search("", 2)) == std::vector<std::string>{"Red Panda", "Panda"}), success);
+		set_status(AUTOCOMPLETE_INDEX, success ? ts_success : ts_failed);
+	}
+
+	{ // test lazy member requests, as used by cluster::request_guild_member with the lazy user cache policy
+		start_test(MEMBER_REQUEST_QUEUE);
+		bool success = true;
+		dpp::cluster lazy("", dpp::i_default_intents, 0, 0, 1, true, dpp::cache_policy::cpol_balanced);
+		dpp::member_request_queue queue(&lazy);
+		int found = 0, missing = 0, first_code = 0;
+		queue.request(100, 1, [&](const dpp::confirmation_callback_t& cc) {
+			found += (!cc.is_error() && std::get<dpp::guild_member>(cc.value).user_id == 1);
+		});
+		queue.request(100, 1, [&](const dpp::confirmation_callback_t& cc) {
+			found += (!cc.is_error() && std::get<dpp::guild_member>(cc.value).user_id == 1);
+		});
+		queue.request(100, 2, [&](const dpp::confirmation_callback_t& cc) {
+			missing += cc.is_error();
+			first_code = cc.get_error().code;
+		});
+		std::vector<json> payloads = queue.build_requests(false);
+		DPP_RUNTIME_CHECK(MEMBER_REQUEST_QUEUE, (payloads.size() == 1), success);
+		json request = payloads.front();
+		DPP_RUNTIME_CHECK(MEMBER_REQUEST_QUEUE, (request["op"] == 8 && request["d"]["user_ids"].size() == 2), success);
+		DPP_RUNTIME_CHECK(MEMBER_REQUEST_QUEUE, (queue.build_requests(false).empty()), success);
+
+		/* The first of two chunks has only a not_found user. Nothing in it is cached, but it must still complete */
+		json chunk = {{"guild_id", "100"}, {"nonce", request["d"]["nonce"]}, {"chunk_index", 0}, {"chunk_count", 2}, {"members", json::array()}, {"not_found", {"2"}}};
+		queue.chunk_received(chunk);
+		DPP_RUNTIME_CHECK(MEMBER_REQUEST_QUEUE, (missing == 1 && first_code == 10007 && found == 0), success);
+
+		/* The last chunk has a member who may already be cached, both waiting callbacks complete */
+		chunk["chunk_index"] = 1;
+		chunk["members"] = {{{"user", {{"id", "1"}}}}};
+		chunk["not_found"] = json::array();
+		queue.chunk_received(chunk);
+		DPP_RUNTIME_CHECK(MEMBER_REQUEST_QUEUE, (found == 2 && missing == 1), success);
+
+		/* Users the final chunk does not mention fail rather than waiting forever */
+		int unanswered = 0;
+		queue.request(100, 3, [&](const dpp::confirmation_callback_t& cc) {
+			unanswered += cc.is_error();
+		});
+		chunk["nonce"] = queue.build_requests(false).front()["d"]["nonce"];
+		chunk["chunk_index"] = 0;
+		chunk["chunk_count"] = 1;
+		chunk["members"] = json::array();
+		queue.chunk_received(chunk);
+		queue.chunk_received(chunk);
+		DPP_RUNTIME_CHECK(MEMBER_REQUEST_QUEUE, (unanswered == 1), success);
+		set_status(MEMBER_REQUEST_QUEUE, success ? ts_success : ts_failed);
+	}
+
+	{ // test the deferral watchdog, without letting it send a deferral
+		start_test(INTERACTION_WATCHDOG);
+		bool success = true;
+		std::vector<int> fired;
+		std::mutex fired_lock;
+		{
+			dpp::interaction_watchdog watchdog;
+			auto now = std::chrono::steady_clock::now();
+			for (int n : {3, 1, 2}) {
+				watchdog.watch(now + std::chrono::milliseconds(20 * n), [&fired, &fired_lock, n]() {
+					std::lock_guard<std::mutex> l(fired_lock);
+					fired.push_back(n);
+				});
+			}
+			watchdog.watch(now + std::chrono::hours(1), []() {});
+			std::this_thread::sleep_for(std::chrono::milliseconds(300));
+			DPP_RUNTIME_CHECK(INTERACTION_WATCHDOG, (watchdog.pending() == 1), success);
+		}
+		DPP_RUNTIME_CHECK(INTERACTION_WATCHDOG, (fired == std::vector<int>{1, 2, 3}), success);
+
+		/* Only interactions which can be deferred are watched, and only while enabled */
+		dpp::cluster watched("");
+		dpp::interaction i;
+		i.type = dpp::it_application_command;
+		DPP_RUNTIME_CHECK(INTERACTION_WATCHDOG, (watched.watch_interaction(i) == nullptr), success);
+		watched.set_auto_defer(std::chrono::hours(1));
+		auto state = watched.watch_interaction(i);
+		DPP_RUNTIME_CHECK(INTERACTION_WATCHDOG, (state && state->stage == dpp::irs_waiting), success);
+		i.type = dpp::it_autocomplete;
+		DPP_RUNTIME_CHECK(INTERACTION_WATCHDOG, (watched.watch_interaction(i) == nullptr), success);
+
+		/* A reply while the deferral is in flight is held back until it completes */
+		dpp::slashcommand_t sc(nullptr, "");
+		sc.response_state = state;
+		state->stage = dpp::irs_deferring;
+		sc.reply("done");
+		DPP_RUNTIME_CHECK(INTERACTION_WATCHDOG, (state->after_deferral.size() == 1), success);
+		state->after_deferral.clear();
+		watched.set_auto_defer(std::chrono::milliseconds(0));
+		set_status(INTERACTION_WATCHDOG, success ? ts_success : ts_failed);
+	}
+
+	{ // test which copy of each event is handled while two shard sets are connected
+		start_test(SHARD_HANDOVER);
+		bool success = true;
+		dpp::shard_handover handover;
+		auto payload = [](const std::string& id, const std::string& extra = "") {
+			return dpp::json({{"op", 0}, {"d", {{"id", id}, {"extra", extra}}}});
+		};
+		dpp::json ready = {{"op", 0}, {"d", {{"guilds", {{{"id", "10"}, {"unavailable", true}}, {{"id", "11"}, {"unavailable", true}}}}}}};
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_dispatch, 0, "MESSAGE_CREATE", payload("1"))), success);
+		/* A connecting shard only tracks its session, and starts counting off its GUILD_CREATE burst */
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_standby, 0, "READY", ready) && handover.accept(dpp::sd_standby, 0, "RESUMED", payload("0"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.accept(dpp::sd_standby, 0, "MESSAGE_CREATE", payload("1")) && !handover.accept(dpp::sd_standby, 0, "GUILD_CREATE", payload("10"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.bursts_complete()), success);
+		/* The rest of the burst arrives after the shard has started delivering, and is still dropped */
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.accept(dpp::sd_takeover, 0, "GUILD_CREATE", payload("11")) && handover.bursts_complete()), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_takeover, 0, "GUILD_CREATE", payload("12")) && !handover.accept(dpp::sd_handover, 3, "GUILD_CREATE", payload("12"))), success);
+		/* Added, removed and added again: each is paired with its own copy, whichever set is first */
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_handover, 3, "MESSAGE_REACTION_ADD", payload("5"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_handover, 3, "MESSAGE_REACTION_REMOVE", payload("5"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_handover, 3, "MESSAGE_REACTION_ADD", payload("5"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.accept(dpp::sd_takeover, 1, "MESSAGE_REACTION_ADD", payload("5"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.accept(dpp::sd_takeover, 1, "MESSAGE_REACTION_REMOVE", payload("5"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.accept(dpp::sd_takeover, 1, "MESSAGE_REACTION_ADD", payload("5"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_takeover, 1, "MESSAGE_REACTION_ADD", payload("5"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_takeover, 1, "MESSAGE_CREATE", payload("6")) && !handover.accept(dpp::sd_handover, 3, "MESSAGE_CREATE", payload("6"))), success);
+		/* Same payload under another event name is a different event */
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_handover, 3, "MESSAGE_UPDATE", payload("6"))), success);
+		/* Once the old set retires its late events are dropped and the new set handles them */
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_handover, 3, "MESSAGE_CREATE", payload("7", "a"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.accept(dpp::sd_retired, 3, "MESSAGE_CREATE", payload("8"))), success);
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (!handover.accept(dpp::sd_takeover, 1, "MESSAGE_CREATE", payload("7", "a")) && handover.accept(dpp::sd_takeover, 1, "MESSAGE_CREATE", payload("8"))), success);
+		handover.clear();
+		DPP_RUNTIME_CHECK(SHARD_HANDOVER, (handover.accept(dpp::sd_takeover, 1, "MESSAGE_UPDATE", payload("6")) && handover.bursts_complete()), success);
+		set_status(SHARD_HANDOVER, success ? ts_success : ts_failed);
+	}
+
+#ifndef _WIN32
+	{ // test websocket frames and the zlib-stream they carry, split across reads at every kind of boundary
+		start_test(WEBSOCKET_STREAM);
+		bool success = true;
+		int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t address_length = sizeof(address);
+		if (listener < 0 || ::bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listener, 16) != 0 || ::getsockname(listener, (sockaddr*)&address, &address_length) != 0) {
+			set_status(WEBSOCKET_STREAM, ts_failed, "can't listen on loopback");
+		} else {
+			std::mt19937 rng(7);
+			auto text = [&rng](size_t length) {
+				std::string t;
+				while (t.length() < length) {
+					t += "abcdefghijklmnopqrstuvwxyz0123456789{}:,\" "[rng() % 42];
+				}
+				return t;
+			};
+			z_stream deflater{};
+			deflateInit(&deflater, Z_DEFAULT_COMPRESSION);
+			auto deflate_message = [&deflater](const std::string& message) {
+				std::string out(deflateBound(&deflater, (uLong)message.size()) + 64, '\0');
+				deflater.next_in = (Bytef*)message.data();
+				deflater.avail_in = (uInt)message.size();
+				deflater.next_out = (Bytef*)out.data();
+				deflater.avail_out = (uInt)out.size();
+				deflate(&deflater, Z_SYNC_FLUSH);
+				out.resize(out.size() - deflater.avail_out);
+				return out;
+			};
+			auto frame = [](unsigned char opcode, const std::string& payload) {
+				std::string f(1, (char)opcode);
+				if (payload.size() < 126) {
+					f += (char)payload.size();
+				} else if (payload.size() <= 65535) {
+					f += (char)126;
+					f += (char)(payload.size() >> 8);
+					f += (char)(payload.size() & 0xff);
+				} else {
+					f += (char)127;
+					for (int shift = 56; shift >= 0; shift -= 8) {
+						f += (char)((uint64_t)payload.size() >> shift);
+					}
+				}
+				return f + payload;
+			};
+			std::vector<std::string> messages = {"{\"op\":11}", text(200000), text(3000), text(300000), "{\"op\":1}"};
+			std::string wire;
+			/* A small message, then a large one which is streamed */
+			wire += frame(0x82, deflate_message(messages[0]));
+			wire += frame(0x82, deflate_message(messages[1]));
+			/* A message over three frames, the last holding only part of its flush marker */
+			std::string split = deflate_message(messages[2]);
+			wire += frame(0x02, split.substr(0, 1000)) + frame(0x00, split.substr(1000, split.size() - 1002)) + frame(0x80, split.substr(split.size() - 2));
+			/* A message over two frames which are both streamed */
+			split = deflate_message(messages[3]);
+			wire += frame(0x02, split.substr(0, split.size() / 2)) + frame(0x80, split.substr(split.size() / 2));
+			wire += frame(0x82, deflate_message(messages[4]));
+			deflateEnd(&deflater);
+			DPP_RUNTIME_CHECK(WEBSOCKET_STREAM, (split.size() / 2 > 64 * 1024), success);
+
+			/* Whole, byte by byte, at a fixed stride and at random lengths */
+			std::vector<std::function<size_t()>> slicings = {
+				[] { return std::string::npos; },
+				[] { return 1; },
+				[] { return 7; },
+				[&rng] { return 1 + rng() % 9000; },
+				[&rng] { return 1 + rng() % 70000; },
+			};
+			for (size_t i = 0; i < slicings.size(); ++i) {
+				try {
+					inflating_client client(ntohs(address.sin_port));
+					std::string buffer = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n";
+					client.handle_buffer(buffer);
+					for (size_t offset = 0; offset < wire.size();) {
+						size_t length = std::min(slicings[i](), wire.size() - offset);
+						buffer.append(wire, offset, length);
+						offset += length;
+						client.handle_buffer(buffer);
+					}
+					DPP_RUNTIME_CHECK(WEBSOCKET_STREAM, (!client.failed && client.messages == messages && buffer.empty()), success);
+					/* Large frames are only streamed when they arrive in pieces */
+					DPP_RUNTIME_CHECK(WEBSOCKET_STREAM, (client.streamed_frames == (i == 0 ? 0 : 3)), success);
+				}
+				catch (const std::exception& e) {
+					std::cout << "WEBSOCKET_STREAM: " << e.what() << "\n";
+					success = false;
+				}
+			}
+			::close(listener);
+			set_status(WEBSOCKET_STREAM, success ? ts_success : ts_failed);
+		}
+	}
+#endif
+
+	{ // test the CDN asset cache with a fake downloader
+		start_test(ASSET_CACHE);
+		bool success = true;
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (dpp::asset_cache::key_of("https://cdn.discordapp.com/avatars/189759562910400512/a_0123456789ABCDEF0123456789ABCDEF.gif?size=256") == "/avatars/189759562910400512/a_0123456789abcdef0123456789abcdef.gif?size=256"), success);
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (dpp::asset_cache::key_of("https://media.discordapp.net/attachments/1/2/card.png?ex=1&is=2&hm=3") == "/attachments/1/2/card.png"), success);
+
+		std::vector<std::pair<std::multimap<std::string, std::string>, dpp::http_completion_event>> downloads;
+		dpp::cluster owner("");
+		dpp::asset_cache assets(&owner);
+		assets.set_fetcher([&downloads](const std::string&, const std::multimap<std::string, std::string>& headers, dpp::http_completion_event cb) {
+			downloads.emplace_back(headers, std::move(cb));
+		});
+		auto respond = [&downloads](size_t n, uint16_t status, const std::string& body) {
+			dpp::http_request_completion_t http;
+			http.status = status;
+			http.body = body;
+			http.headers.emplace("etag", "\"v1\"");
+			downloads[n].second(http);
+		};
+
+		/* Two requests for the same avatar share one download */
+		std::vector<std::string> bodies;
+		auto collect = [&bodies](const std::shared_ptr<const dpp::cached_asset>& a, const dpp::http_request_completion_t&) {
+			bodies.push_back(a ? a->body : "<none>");
+		};
+		const std::string avatar = "https://cdn.discordapp.com/avatars/1/0123456789abcdef0123456789abcdef.png?size=64";
+		assets.fetch(avatar, collect);
+		assets.fetch("https://media.discordapp.net/avatars/1/0123456789ABCDEF0123456789ABCDEF.png?size=64", collect);
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (downloads.size() == 1 && bodies.empty()), success);
+		respond(0, 200, "abc");
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (bodies == std::vector<std::string>{"abc", "abc"}), success);
+		assets.fetch(avatar, collect);
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (downloads.size() == 1 && bodies.size() == 3 && assets.get_stats().memory_hits == 1 && assets.get_stats().coalesced == 1), success);
+
+		/* The least recently used asset makes room */
+		assets.set_memory_limit(5);
+		assets.fetch("https://cdn.discordapp.com/emojis/2.png", collect);
+		respond(1, 200, "xyz");
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (assets.find(avatar) == nullptr && assets.get_memory_used() == 3 && assets.get_stats().evictions == 1), success);
+
+		/* Stale assets are revalidated with their etag */
+		assets.set_max_age(-1);
+		assets.fetch("https://cdn.discordapp.com/emojis/2.png", collect);
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (downloads.size() == 3 && downloads[2].first.count("If-None-Match") == 1), success);
+		respond(2, 304, "");
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (bodies.back() == "xyz" && assets.get_stats().revalidations == 1), success);
+
+		/* A failed download reports no asset */
+		assets.fetch("https://cdn.discordapp.com/emojis/3.png", collect);
+		respond(3, 404, "");
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (bodies.back() == "<none>" && assets.get_stats().failures == 1), success);
+
+		/* The disk tier outlives the cache */
+		const std::string dir = "asset_cache_test";
+		std::filesystem::remove_all(dir);
+		{
+			dpp::asset_cache first(&owner);
+			first.set_disk_path(dir);
+			first.set_fetcher([](const std::string&, const std::multimap<std::string, std::string>&, dpp::http_completion_event cb) {
+				dpp::http_request_completion_t http;
+				http.status = 200;
+				http.body = std::string("\x89PNG\n\0", 6);
+				cb(http);
+			});
+			first.fetch(avatar, nullptr);
+		}
+		dpp::asset_cache second(&owner);
+		second.set_disk_path(dir);
+		auto from_disk = second.find(avatar);
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (from_disk && from_disk->body == std::string("\x89PNG\n\0", 6) && second.get_stats().disk_hits == 1), success);
+		/* A full disk tier evicts the oldest file, and leaves no partly written files behind */
+		second.set_disk_path(dir, 1);
+		second.set_fetcher([](const std::string&, const std::multimap<std::string, std::string>&, dpp::http_completion_event cb) {
+			dpp::http_request_completion_t http;
+			http.status = 200;
+			http.body = "GIF89a";
+			cb(http);
+		});
+		second.fetch("https://cdn.discordapp.com/emojis/4.gif", nullptr);
+		std::vector<std::string> files;
+		for (const auto& f : std::filesystem::directory_iterator(dir)) {
+			files.push_back(f.path().filename().string());
+		}
+		DPP_RUNTIME_CHECK(ASSET_CACHE, (files.size() == 1 && files[0].find(".asset") == 16 && second.get_stats().evictions == 1), success);
+		std::filesystem::remove_all(dir);
+		set_status(ASSET_CACHE, success ? ts_success : ts_failed);
+	}
+
+#ifndef _WIN32
+	{ // test the subprocess engine
+		start_test(SUBPROCESS);
+		bool success = true;
+		std::mutex output_lock;
+		std::string out, err;
+		std::atomic<int> exit_code{-1};
+		dpp::subprocess_options options;
+		options.on_stdout = [&](std::string_view data) {
+			std::lock_guard<std::mutex> l(output_lock);
+			out.append(data);
+		};
+		options.on_stderr = [&](std::string_view data) {
+			std::lock_guard<std::mutex> l(output_lock);
+			err.append(data);
+		};
+		options.on_exit = [&](int code) {
+			exit_code = code;
+		};
+		dpp::subprocess sh("sh", {"-c", "echo out; echo err >&2; exit 3"}, options);
+		while (sh.running()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		DPP_RUNTIME_CHECK(SUBPROCESS, (exit_code == 3 && out == "out\n" && err == "err\n"), success);
+
+		/* Killed with SIGKILL once its timeout passes */
+		dpp::subprocess_options limited;
+		limited.timeout = std::chrono::milliseconds(50);
+		limited.on_exit = [&](int code) {
+			exit_code = code;
+		};
+		dpp::subprocess sleeper("sleep", {"10"}, limited);
+		while (sleeper.running()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		DPP_RUNTIME_CHECK(SUBPROCESS, (exit_code == 128 + 9), success);
+
+		/* Nothing is read while the consumer is not ready */
+		std::atomic<bool> ready{false};
+		std::atomic<size_t> received{0};
+		dpp::subprocess_options held;
+		held.ready_for_stdout = [&ready]() {
+			return ready.load();
+		};
+		held.on_stdout = [&received](std::string_view data) {
+			received += data.size();
+		};
+		dpp::subprocess producer("head", {"-c", "200000", "/dev/zero"}, held);
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		DPP_RUNTIME_CHECK(SUBPROCESS, (received == 0 && producer.running()), success);
+		ready = true;
+		while (producer.running()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		DPP_RUNTIME_CHECK(SUBPROCESS, (received == 200000), success);
+
+		bool threw = false;
+		try {
+			dpp::subprocess missing("/nonexistent/program", {}, {});
+		}
+		catch (const dpp::exception&) {
+			threw = true;
+		}
+		DPP_RUNTIME_CHECK(SUBPROCESS, (threw), success);
+		set_status(SUBPROCESS, success ? ts_success : ts_failed);
+	}
+#endif
+
+	{ // test the entitlement cache, fed through the entitlement events
+		start_test(ENTITLEMENT_CACHE);
+		bool success = true;
+		dpp::cluster owner("");
+		dpp::entitlement_cache premium(&owner);
+		const time_t now = time(nullptr);
+		auto make = [](uint64_t id, uint64_t sku, const char* field, uint64_t holder) {
+			json j = {{"id", std::to_string(id)}, {"sku_id", std::to_string(sku)}, {field, std::to_string(holder)}, {"type", 8}};
+			return dpp::entitlement().fill_from_json(&j);
+		};
+		dpp::entitlement_create_t created(nullptr, "");
+		created.created = make(1, 100, "user_id", 10);
+		owner.on_entitlement_create.call(created);
+		created.created = make(2, 100, "guild_id", 20);
+		created.created.ends_at = now - 60;
+		owner.on_entitlement_create.call(created);
+		created.created = make(3, 200, "user_id", 10);
+		created.created.starts_at = now + 3600;
+		owner.on_entitlement_create.call(created);
+		DPP_RUNTIME_CHECK(ENTITLEMENT_CACHE, (premium.count() == 3), success);
+		DPP_RUNTIME_CHECK(ENTITLEMENT_CACHE, (premium.has_entitlement(10, 100) && !premium.has_entitlement(10, 300)), success);
+		DPP_RUNTIME_CHECK(ENTITLEMENT_CACHE, (!premium.has_entitlement(20, 100) && !premium.has_entitlement(10, 200)), success);
+
+		/* A renewal moves the end date */
+		dpp::entitlement_update_t updated(nullptr, "");
+		updated.updating_entitlement = make(2, 100, "guild_id", 20);
+		updated.updating_entitlement.ends_at = now + 60;
+		owner.on_entitlement_update.call(updated);
+		DPP_RUNTIME_CHECK(ENTITLEMENT_CACHE, (premium.has_entitlement(20, 100)), success);
+
+		/* Interactions check both the invoking user and the guild */
+		dpp::interaction i;
+		i.usr.id = 30;
+		i.guild_id = 20;
+		DPP_RUNTIME_CHECK(ENTITLEMENT_CACHE, (premium.has_entitlement(i, 100) && !premium.has_entitlement(i, 200)), success);
+
+		dpp::entitlement_delete_t deleted(nullptr, "");
+		deleted.deleted = make(1, 100, "user_id", 10);
+		owner.on_entitlement_delete.call(deleted);
+		DPP_RUNTIME_CHECK(ENTITLEMENT_CACHE, (!premium.has_entitlement(10, 100) && premium.count() == 2), success);
+		created.created = make(4, 100, "user_id", 10);
+		created.created.ends_at = now - 1;
+		premium.insert(created.created);
+		DPP_RUNTIME_CHECK(ENTITLEMENT_CACHE, (premium.prune() == 1 && premium.count() == 2), success);
+		set_status(ENTITLEMENT_CACHE, success ? ts_success : ts_failed);
+	}
+
+	{ // test event queue shedding while the dispatcher is held up
+		start_test(EVENT_QUEUE);
+		bool success = true;
+		std::mutex gate;
+		std::vector<std::string> order;
+		dpp::event_queue_config config;
+		config.capacity = 4;
+		config.sample_rate = 2;
+		config.events["MESSAGE_REACTION_ADD"] = {dpp::ep_low, dpp::sp_sample};
+		std::unique_lock held(gate);
+		{
+			dpp::event_queue queue(config, [&](const std::string& event, json& j, const std::string&) {
+				std::lock_guard l(gate);
+				order.push_back(event + (j["d"].contains("status") ? ":" + j["d"]["status"].get<std::string>() : ""));
+			}, "events/test");
+			auto push = [&queue](const std::string& event, json j) {
+				return queue.push(event, j, "");
+			};
+			/* The first is taken by the dispatcher, which then waits on the gate */
+			push("MESSAGE_CREATE", {{"d", json::object()}});
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			push("PRESENCE_UPDATE", {{"d", {{"user", {{"id", "1"}}}, {"guild_id", "9"}, {"status", "idle"}}}});
+			push("MESSAGE_CREATE", {{"d", json::object()}});
+			/* Same user and guild, replaces the queued presence in place */
+			DPP_RUNTIME_CHECK(EVENT_QUEUE, (!push("PRESENCE_UPDATE", {{"d", {{"user", {{"id", "1"}}}, {"guild_id", "9"}, {"status", "online"}}}})), success);
+			push("TYPING_START", {{"d", json::object()}});
+			push("GUILD_MEMBER_ADD", {{"d", json::object()}});
+			/* Now at capacity: low priority events are shed, others are still queued */
+			DPP_RUNTIME_CHECK(EVENT_QUEUE, (!push("TYPING_START", {{"d", json::object()}})), success);
+			DPP_RUNTIME_CHECK(EVENT_QUEUE, (!push("PRESENCE_UPDATE", {{"d", {{"user", {{"id", "2"}}}, {"status", "dnd"}}}})), success);
+			DPP_RUNTIME_CHECK(EVENT_QUEUE, (push("MESSAGE_REACTION_ADD", {{"d", json::object()}}) && !push("MESSAGE_REACTION_ADD", {{"d", json::object()}})), success);
+			DPP_RUNTIME_CHECK(EVENT_QUEUE, (push("INTERACTION_CREATE", {{"d", json::object()}})), success);
+			auto stats = queue.get_stats();
+			DPP_RUNTIME_CHECK(EVENT_QUEUE, (stats.depth == 6 && stats.coalesced["PRESENCE_UPDATE"] == 1), success);
+			DPP_RUNTIME_CHECK(EVENT_QUEUE, (stats.shed["TYPING_START"] == 1 && stats.shed["PRESENCE_UPDATE"] == 1 && stats.shed["MESSAGE_REACTION_ADD"] == 1), success);
+			held.unlock();
+			for (int i = 0; i < 100 && queue.get_stats().dispatched < 7; ++i) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+		DPP_RUNTIME_CHECK(EVENT_QUEUE, (order == std::vector<std::string>{"MESSAGE_CREATE", "INTERACTION_CREATE", "PRESENCE_UPDATE:online", "MESSAGE_CREATE", "TYPING_START", "GUILD_MEMBER_ADD", "MESSAGE_REACTION_ADD"}), success);
+		set_status(EVENT_QUEUE, success ? ts_success : ts_failed);
+	}
+
+	{ // test allocation profiling, which only counts anything in a DPP_ALLOC_PROFILING build
+		start_test(ALLOC_PROFILE);
+		bool success = true;
+		dpp::alloc_profile before = dpp::get_alloc_profile();
+		std::vector<char>* block = nullptr;
+		{
+			dpp::alloc_scope scope(dpp::as_voice);
+			block = new std::vector<char>(1 << 20);
+		}
+		dpp::alloc_profile during = dpp::get_alloc_profile();
+		delete block;
+		dpp::alloc_profile after = dpp::get_alloc_profile();
+		const auto& voice_during = during.subsystems[dpp::as_voice];
+		const auto& voice_before = before.subsystems[dpp::as_voice];
+		if (during.enabled) {
+			DPP_RUNTIME_CHECK(ALLOC_PROFILE, (voice_during.live_bytes - voice_before.live_bytes >= (1 << 20) && voice_during.peak_bytes >= (1 << 20)), success);
+			DPP_RUNTIME_CHECK(ALLOC_PROFILE, (after.subsystems[dpp::as_voice].live_bytes == voice_before.live_bytes), success);
+			DPP_RUNTIME_CHECK(ALLOC_PROFILE, (voice_during.allocations - voice_before.allocations == 2), success);
+		} else {
+			DPP_RUNTIME_CHECK(ALLOC_PROFILE, (voice_during.allocations == 0 && after.subsystems[dpp::as_other].live_bytes == 0), success);
+		}
+		DPP_RUNTIME_CHECK(ALLOC_PROFILE, (std::string(dpp::alloc_subsystem_name(dpp::as_decode)) == "decode"), success);
+		set_status(ALLOC_PROFILE, success ? ts_success : ts_failed);
+	}
+
+	{ // test message templates render the same JSON as building the message each time
+		start_test(MESSAGE_TEMPLATE);
+		bool success = true;
+		dpp::message m(0, "Hello {{name}}, you have {{count}} points");
+		m.add_embed(dpp::embed().set_title("{{name}}").add_field("Score", "{{count}}"));
+		dpp::message_template t(m);
+		dpp::template_args values = t.args();
+		values.set("name", "Bob \"the\" \\ builder").set("count", 42);
+		json j = json::parse(t.render(values));
+		DPP_RUNTIME_CHECK(MESSAGE_TEMPLATE, (t.slot_count() == 2), success);
+		DPP_RUNTIME_CHECK(MESSAGE_TEMPLATE, (j["content"] == "Hello Bob \"the\" \\ builder, you have 42 points"), success);
+		DPP_RUNTIME_CHECK(MESSAGE_TEMPLATE, (j["embeds"][0]["title"] == "Bob \"the\" \\ builder" && j["embeds"][0]["fields"][0]["value"] == "42"), success);
+		values.set(t.slot("count"), std::numeric_limits<uint64_t>::max());
+		DPP_RUNTIME_CHECK(MESSAGE_TEMPLATE, (json::parse(t.render(values))["embeds"][0]["fields"][0]["value"] == "18446744073709551615"), success);
+		dpp::message_template raw("{\"embeds\":[{\"color\":\"{{#colour}}\",\"description\":\"{not a slot}\"}]}");
+		json r = json::parse(raw.render(raw.args().set("colour", 255u)));
+		DPP_RUNTIME_CHECK(MESSAGE_TEMPLATE, (r["embeds"][0]["color"] == 255 && r["embeds"][0]["description"] == "{not a slot}"), success);
+		bool thrown = false;
+		try {
+			values.set("missing", "x");
+		}
+		catch (const dpp::logic_exception&) {
+			thrown = true;
+		}
+		DPP_RUNTIME_CHECK(MESSAGE_TEMPLATE, (thrown), success);
+		set_status(MESSAGE_TEMPLATE, success ? ts_success : ts_failed);
+	}
+
+	{ // test cooldowns and flood control against a clock we control
+		start_test(RATE_CONTROL);
+		bool success = true;
+		double now = 1000;
+		dpp::rate_controller limits(1, [&now]() { return now; });
+		dpp::rate_rule_id cooldown = limits.add_rule(dpp::rate_rule::cooldown(dpp::rs_user, 5));
+		dpp::rate_rule_id bucket = limits.add_rule(dpp::rate_rule::token_bucket(dpp::rs_guild, 3, 3));
+		dpp::rate_rule_id window = limits.add_rule(dpp::rate_rule::sliding_window(dpp::rs_channel, 4, 10));
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.consume(cooldown, 1).allowed && limits.consume(cooldown, 2).allowed), success);
+		dpp::rate_decision refused = limits.consume(cooldown, 1);
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (!refused.allowed && std::abs(refused.retry_after - 5) < 0.001), success);
+		now += 5;
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.peek(cooldown, 1).allowed && limits.consume(cooldown, 1).allowed), success);
+		/* A full bucket allows a burst, then one use per second */
+		int burst = 0;
+		while (limits.consume(bucket, 10).allowed) {
+			burst++;
+		}
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (burst == 3), success);
+		now += 1;
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.consume(bucket, 10).allowed && !limits.consume(bucket, 10).allowed), success);
+		/* Several rules are checked and counted together, a refusal by one counts against none */
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.consume_all({{cooldown, 50}, {bucket, 50}}).allowed), success);
+		dpp::rate_decision both = limits.consume_all({{cooldown, 50}, {bucket, 50}});
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (!both.allowed && std::abs(both.retry_after - 5) < 0.001), success);
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.consume(bucket, 50).allowed && limits.consume(bucket, 50).allowed && !limits.consume(bucket, 50).allowed), success);
+		/* Four uses late in one window still weigh on the start of the next */
+		now = 2009;
+		for (int i = 0; i < 4; ++i) {
+			limits.consume(window, 20);
+		}
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (!limits.consume(window, 20).allowed), success);
+		now = 2012;
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (!limits.consume(window, 20).allowed), success);
+		now = 2013;
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.consume(window, 20).allowed), success);
+		limits.reset(window, 20);
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.peek(window, 20, 4).allowed && !limits.peek(window, 20, 5).allowed), success);
+		/* State which has run its course is dropped by the timing wheel */
+		limits.consume(cooldown, 30);
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.size() > 0), success);
+		for (int i = 0; i < 40; ++i) {
+			now += 1;
+			for (uint64_t k = 100; k < 108; ++k) {
+				limits.peek(cooldown, k);
+			}
+		}
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (limits.size() == 0), success);
+		bool thrown = false;
+		try {
+			limits.add_rule(dpp::rate_rule::cooldown(dpp::rs_user, 0));
+		}
+		catch (const dpp::logic_exception&) {
+			thrown = true;
+		}
+		DPP_RUNTIME_CHECK(RATE_CONTROL, (thrown), success);
+		set_status(RATE_CONTROL, success ? ts_success : ts_failed);
+	}
+
+	{ // test rate limit buckets survive a restart through a checkpoint, and stale ones are aged out
+		start_test(RATELIMIT_CHECKPOINT);
+		bool success = true;
+		const time_t now = time(nullptr);
+		dpp::json saved = dpp::json::array();
+		saved.push_back({{"endpoint", "/api/v10/channels/1/messages"}, {"bucket", "abcd1234"}, {"limit", 5}, {"remaining", 0}, {"reset_after", 60}, {"retry_after", 0}, {"timestamp", now}});
+		saved.push_back({{"endpoint", "/api/v10/guilds/2"}, {"bucket", "ef56"}, {"limit", 5}, {"remaining", 0}, {"reset_after", 5}, {"retry_after", 0}, {"timestamp", now - 100}});
+		saved.push_back({{"endpoint", "/api/v10/users/3"}, {"bucket", "7890"}, {"limit", 5}, {"remaining", 0}, {"reset_after", 5}, {"retry_after", 0}, {"timestamp", now + 3600}});
+		const std::string filename = "ratelimit_checkpoint_test.json";
+		{
+			std::ofstream out(filename);
+			out << saved.dump();
+		}
+		{
+			dpp::cluster owner("");
+			owner.set_ratelimit_checkpoint(filename);
+			dpp::json restored = dpp::json::parse(owner.get_rest()->get_ratelimit_checkpoint());
+			DPP_RUNTIME_CHECK(RATELIMIT_CHECKPOINT, (restored.size() == 1 && restored[0]["endpoint"] == "/api/v10/channels/1/messages" && restored[0]["bucket"] == "abcd1234"), success);
+			bool thrown = false;
+			try {
+				owner.get_rest()->restore_ratelimit_checkpoint("{not json");
+			}
+			catch (const dpp::rest_exception&) {
+				thrown = true;
+			}
+			DPP_RUNTIME_CHECK(RATELIMIT_CHECKPOINT, (thrown), success);
+			/* Entries with fields of the wrong type are skipped rather than failing the whole checkpoint */
+			dpp::json mistyped = dpp::json::array();
+			mistyped.push_back({{"endpoint", "/api/v10/channels/4"}, {"limit", "5"}, {"reset_after", 60}, {"timestamp", now}});
+			mistyped.push_back({{"endpoint", "/api/v10/channels/5"}, {"bucket", 7}, {"reset_after", 60}, {"timestamp", now}});
+			mistyped.push_back({{"endpoint", "/api/v10/channels/6"}, {"limit", 5}, {"reset_after", nullptr}, {"timestamp", now}});
+			mistyped.push_back(saved[0]);
+			size_t restored_mistyped = 0;
+			try {
+				restored_mistyped = owner.get_rest()->restore_ratelimit_checkpoint(mistyped.dump());
+			}
+			catch (const std::exception&) {
+			}
+			DPP_RUNTIME_CHECK(RATELIMIT_CHECKPOINT, (restored_mistyped == 1), success);
+			std::remove(filename.c_str());
+		}
+		/* Shutting the cluster down writes the checkpoint out again */
+		dpp::json written = dpp::json::parse(dpp::utility::read_file(filename));
+		DPP_RUNTIME_CHECK(RATELIMIT_CHECKPOINT, (written.size() == 1 && written[0]["remaining"] == 0 && written[0]["timestamp"] == now), success);
+		std::remove(filename.c_str());
+		set_status(RATELIMIT_CHECKPOINT, success ? ts_success : ts_failed);
+	}
+
+	{ // test the text kernels against byte at a time versions, at lengths either side of the vector width
+		start_test(TEXT_KERNELS);
+		bool success = true;
+		std::string text;
+		for (int i = 0; text.length() < 300; ++i) {
+			text += (i % 7 == 0) ? "ünï😀 " : (i % 5 == 0) ? "**Bold** [x](y) `c` " : "Plain-Text_1.2~ ";
+		}
+		for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 63, 100, 300}) {
+			std::string s = text.substr(0, length);
+			size_t ascii = 0, safe = 0, plain = 0;
+			while (ascii < length && static_cast<unsigned char>(s[ascii]) < 0x80) {
+				ascii++;
+			}
+			while (safe < length && (isalnum(static_cast<unsigned char>(s[safe])) || std::string("-_.~").find(s[safe]) != std::string::npos)) {
+				safe++;
+			}
+			while (plain < length && std::string("\\*_|~[]()>`").find(s[plain]) == std::string::npos) {
+				plain++;
+			}
+			DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::text::ascii_prefix(s.data(), length) == ascii), success);
+			DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::text::url_safe_prefix(s.data(), length) == safe), success);
+			DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::text::markdown_plain_prefix(s.data(), length) == plain), success);
+			std::string lower = s, upper = s;
+			std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return (c >= 'A' && c <= 'Z') ? c + 32 : c; });
+			std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) { return (c >= 'a' && c <= 'z') ? c - 32 : c; });
+			DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::lowercase(s) == lower && dpp::uppercase(s) == upper), success);
+		}
+		std::string bytes;
+		for (int i = 0; i < 100; ++i) {
+			bytes += static_cast<char>(i * 37);
+		}
+		const unsigned char* raw = reinterpret_cast<const unsigned char*>(bytes.data());
+		DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::base64_encode(raw, 0) == "" && dpp::base64_encode(raw, 1) == "AA==" && dpp::base64_encode(raw, 2) == "ACU="), success);
+		DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::base64_encode(raw, 30) == "ACVKb5S53gMoTXKXvOEGK1B1mr/kCS5TeJ3C5wwx"), success);
+		DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::utility::utf8len("añb😀" + std::string(40, 'x')) == 44), success);
+		DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::utility::utf8substr(std::string(20, 'a') + "ñ" + std::string(20, 'b'), 19, 3) == "añb"), success);
+		DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::utility::url_encode("a b/ü_-.~") == "a%20b%2F%C3%BC_-.~"), success);
+		DPP_RUNTIME_CHECK(TEXT_KERNELS, (dpp::utility::markdown_escape("plain *bold* `c*` ```x_y``` end_") == "plain \\*bold\\* `c*` ```x_y``` end\\_"), success);
+		set_status(TEXT_KERNELS, success ? ts_success : ts_failed);
+	}
+
+	{ // test scoped event listeners
+		start_test(SCOPED_EVENTS);
+		bool success = true;
+		dpp::event_router_t<dpp::message_create_t> router;
+		int global = 0, on_guild = 0, on_other_guild = 0, on_channel = 0, on_user = 0;
+		router([&](const dpp::message_create_t&) { global++; });
+		router.attach_scoped(dpp::es_guild, 10, [&](const dpp::message_create_t&) { on_guild++; });
+		dpp::event_handle other = router.attach_scoped(dpp::es_guild, 11, [&](const dpp::message_create_t&) { on_other_guild++; });
+		router.attach_scoped(dpp::es_channel, 20, [&](const dpp::message_create_t&) { on_channel++; });
+		router.attach_scoped(dpp::es_user, 30, [&](const dpp::message_create_t&) { on_user++; });
+
+		dpp::message_create_t event(nullptr, "");
+		event.msg.guild_id = 10;
+		event.msg.channel_id = 20;
+		event.msg.author.id = 31;
+		router.call(event);
+		DPP_RUNTIME_CHECK(SCOPED_EVENTS, (global == 1 && on_guild == 1 && on_other_guild == 0 && on_channel == 1 && on_user == 0), success);
+
+		event.msg.guild_id = 11;
+		event.msg.author.id = 30;
+		router.call(event);
+		DPP_RUNTIME_CHECK(SCOPED_EVENTS, (global == 2 && on_guild == 1 && on_other_guild == 1 && on_user == 1), success);
+
+		DPP_RUNTIME_CHECK(SCOPED_EVENTS, (router.detach(other) && !router.detach(other)), success);
+		router.call(event);
+		DPP_RUNTIME_CHECK(SCOPED_EVENTS, (global == 3 && on_other_guild == 1 && on_channel == 3), success);
+
+		/* Nothing is cached here, scopes must come from the ids in the payload */
+		dpp::event_router_t<dpp::typing_start_t> typing;
+		int typing_guild = 0, typing_thread = 0;
+		typing.attach_scoped(dpp::es_guild, 10, [&](const dpp::typing_start_t&) { typing_guild++; });
+		typing.attach_scoped(dpp::es_channel, 21, [&](const dpp::typing_start_t&) { typing_thread++; });
+		dpp::typing_start_t ts(nullptr, "");
+		ts.guild_id = 10;
+		ts.channel_id = 21;
+		typing.call(ts);
+		DPP_RUNTIME_CHECK(SCOPED_EVENTS, (typing_guild == 1 && typing_thread == 1 && ts.typing_guild == nullptr), success);
+		set_status(SCOPED_EVENTS, success ? ts_success : ts_failed);
+	}
+
 	{ // test dpp::snowflake
 		start_test(SNOWFLAKE);
 		bool success = true;
@@ -1113,6 +2108,12 @@ Markdown lol \\|\\|spoiler\\|\\| \\~\\~strikethrough\\~\\~ \\`small \\*code\\* b
 		bot.on_guild_create([&](const dpp::guild_create_t & event) {
 			if (event.created->id == TEST_GUILD_ID) {
 				set_test(GUILDCREATE, true);
+				set_test(REQUEST_GUILD_MEMBER, false);
+				bot.request_guild_member(TEST_GUILD_ID, TEST_USER_ID, [](const dpp::confirmation_callback_t& callback) {
+					if (!callback.is_error()) {
+						set_test(REQUEST_GUILD_MEMBER, std::get<dpp::guild_member>(callback.value).user_id == TEST_USER_ID);
+					}
+				});
 				if (event.presences.size() && event.presences.begin()->second.user_id > 0) {
 					set_test(PRESENCE, true);
 				}
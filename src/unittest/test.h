@@ -101,6 +101,8 @@ DPP_TEST(USERCACHE, "Test user cache", tf_online);
 DPP_TEST(REACT, "React to a message", tf_online);
 DPP_TEST(REACTEVENT, "Reaction event", tf_online);
 DPP_TEST(GUILDCREATE, "Receive guild create event", tf_online);
+DPP_TEST(REQUEST_GUILD_MEMBER, "cluster::request_guild_member()", tf_online);
+DPP_TEST(MEMBER_REQUEST_QUEUE, "dpp::member_request_queue", tf_offline);
 DPP_TEST(MESSAGESGET, "Get messages", tf_online);
 DPP_TEST(TIMESTAMP, "crossplatform_strptime()", tf_online);
 DPP_TEST(ICONHASH, "utility::iconhash", tf_offline);
@@ -149,6 +151,27 @@ DPP_TEST(FORUM_CREATION, "create a forum channel", tf_online);
 DPP_TEST(FORUM_CHANNEL_GET, "retrieve the created forum channel", tf_online);
 DPP_TEST(FORUM_CHANNEL_DELETE, "delete the created forum channel", tf_online);
 DPP_TEST(ERRORS, "Human readable error translation", tf_offline);
+DPP_TEST(GLOBAL_RATELIMITER, "shm_global_ratelimiter", tf_offline);
+DPP_TEST(THREAD_CACHE, "thread_cache eviction and members", tf_offline);
+DPP_TEST(CACHE_VERSIONS, "cache::update versions", tf_offline);
+DPP_TEST(VOICE_SILENCE_DETECT, "discord_voice_client::is_silent", tf_offline);
+DPP_TEST(VOICE_RECEIVE_FLOAT, "discord_voice_client::pcm_to_float", tf_offline);
+DPP_TEST(SCOPED_EVENTS, "event_router_t::attach_scoped", tf_offline);
+DPP_TEST(VOICE_TRACK_MIXER, "dpp::voice_track_mixer", tf_offline);
+DPP_TEST(REST_TYPED_RESULT, "dpp::rest_result", tf_offline);
+DPP_TEST(AUTOCOMPLETE_INDEX, "dpp::autocomplete_index", tf_offline);
+DPP_TEST(INTERACTION_WATCHDOG, "deferral watchdog for interactions", tf_offline);
+DPP_TEST(SHARD_HANDOVER, "event handover between shard sets", tf_offline);
+DPP_TEST(WEBSOCKET_STREAM, "websocket frames and zlib-stream split across reads", tf_offline);
+DPP_TEST(ASSET_CACHE, "dpp::asset_cache", tf_offline);
+DPP_TEST(SUBPROCESS, "dpp::subprocess", tf_offline);
+DPP_TEST(ENTITLEMENT_CACHE, "dpp::entitlement_cache", tf_offline);
+DPP_TEST(EVENT_QUEUE, "bounded event queue and shedding", tf_offline);
+DPP_TEST(ALLOC_PROFILE, "allocation profiling by subsystem", tf_offline);
+DPP_TEST(MESSAGE_TEMPLATE, "pre-serialised message templates", tf_offline);
+DPP_TEST(RATE_CONTROL, "cooldowns and flood control", tf_offline);
+DPP_TEST(RATELIMIT_CHECKPOINT, "rest rate limit checkpoints", tf_offline);
+DPP_TEST(TEXT_KERNELS, "dpp::text vectorised string kernels", tf_offline);
 
 DPP_TEST(GUILD_EDIT, "cluster::guild_edit", tf_online);
 DPP_TEST(GUILD_BAN_CREATE, "cluster::guild_ban_add ban three deleted discord accounts", tf_online);
@@ -252,6 +275,8 @@ DPP_TEST(CORO_JOB_OFFLINE, "coro: offline job", tf_offline | tf_coro);
 DPP_TEST(CORO_COROUTINE_OFFLINE, "coro: offline coroutine", tf_offline | tf_coro);
 DPP_TEST(CORO_TASK_OFFLINE, "coro: offline task", tf_offline | tf_coro);
 DPP_TEST(CORO_ASYNC_OFFLINE, "coro: offline async", tf_offline | tf_coro);
+DPP_TEST(CORO_POOL_OFFLINE, "coro: pooled frame and async state allocation", tf_offline | tf_coro);
+DPP_TEST(CORO_POOL_CROSS_THREAD, "coro: pooled blocks freed on another thread", tf_offline | tf_coro);
 DPP_TEST(CORO_EVENT_HANDLER, "coro: online event handler", tf_online | tf_coro);
 DPP_TEST(CORO_API_CALLS, "coro: online api calls", tf_online | tf_coro);
 DPP_TEST(CORO_MUMBO_JUMBO, "coro: online mumbo jumbo in event handler", tf_online | tf_coro | tf_extended);